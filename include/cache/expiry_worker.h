@@ -0,0 +1,63 @@
+#pragma once
+
+#include "segmented_cache.h"
+#include "../compat/threading.h"
+
+#include <chrono>
+
+namespace dcs {
+namespace cache {
+
+/**
+ * ExpiryWorker — background thread driving active TTL expiry.
+ *
+ * Every `interval` it runs one SegmentedCache::expire_cycle().  Each
+ * segment does a bounded amount of wheel work per pass, so a mass expiry
+ * is spread over several passes instead of holding a segment lock for
+ * the whole burst; keys are still expired lazily if touched meanwhile.
+ */
+class ExpiryWorker {
+public:
+    static constexpr size_t kWorkPerSegment = 256;
+
+    ExpiryWorker(SegmentedCache* cache, std::chrono::milliseconds interval)
+        : cache_(cache)
+        , interval_(interval)
+        , running_(false) {}
+
+    ~ExpiryWorker() {
+        stop();
+    }
+
+    void start() {
+        if (running_.exchange(true)) return;
+        thread_ = compat::Thread([this] { run_loop(); });
+    }
+
+    void stop() {
+        if (!running_.exchange(false)) return;
+        cv_.notify_all();
+        if (thread_.joinable()) thread_.join();
+    }
+
+private:
+    void run_loop() {
+        while (running_.load()) {
+            compat::UniqueLock<compat::Mutex> lock(mu_);
+            cv_.wait_for(lock, interval_, [this] { return !running_.load(); });
+            if (!running_.load()) break;
+            lock.unlock();
+            cache_->expire_cycle(kWorkPerSegment);
+        }
+    }
+
+    SegmentedCache* cache_;
+    std::chrono::milliseconds interval_;
+    compat::Atomic<bool> running_;
+    compat::Thread thread_;
+    compat::Mutex mu_;
+    compat::CondVar cv_;
+};
+
+}  // namespace cache
+}  // namespace dcs
@@ -0,0 +1,117 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace dcs {
+namespace cache {
+
+/**
+ * FrequencySketch — count-min sketch of recent access frequency (TinyLFU).
+ *
+ * Four 4-bit counters per key, packed sixteen to a 64-bit word; the
+ * estimate is the smallest of the four, so collisions can only
+ * over-count.  After `sample_size` increments (ten per tracked entry)
+ * every counter is halved, so the sketch forgets old popularity
+ * and a key that was hot yesterday has to earn its place again.
+ *
+ * Memory is 8 bytes per tracked entry.  Not thread-safe; the owning
+ * LRUCache only touches it under its segment's exclusive lock.
+ */
+class FrequencySketch {
+public:
+    static constexpr uint32_t kMaxCount = 15;
+
+    explicit FrequencySketch(size_t expected_entries = 64) { ensure_capacity(expected_entries); }
+
+    /**
+     * Grow the table to track `entries` keys.  Counts are dropped on
+     * resize (cheap, happens O(log n) times as a budget-mode cache fills).
+     */
+    void ensure_capacity(size_t entries) {
+        size_t want = round_up_pow2(std::max<size_t>(entries, 16));
+        if (want <= table_.size()) return;
+        table_.assign(want, 0);
+        mask_ = want - 1;
+        sample_size_ = want * 10;
+        additions_ = 0;
+    }
+
+    /** Estimated accesses for `hash` within the current aging window. */
+    uint32_t frequency(uint64_t hash) const {
+        uint64_t h = spread(hash);
+        uint32_t freq = kMaxCount;
+        for (uint32_t i = 0; i < 4; ++i) {
+            freq = std::min(freq, counter(h, i));
+        }
+        return freq;
+    }
+
+    /** Record one access; halves every counter once per sample period. */
+    void increment(uint64_t hash) {
+        uint64_t h = spread(hash);
+        bool added = false;
+        for (uint32_t i = 0; i < 4; ++i) {
+            size_t word  = index_of(h, i);
+            uint32_t shift = nibble_of(h, i) * 4;
+            uint64_t mask = 0xFull << shift;
+            if ((table_[word] & mask) != mask) {
+                table_[word] += 1ull << shift;
+                added = true;
+            }
+        }
+        if (added && ++additions_ >= sample_size_) age();
+    }
+
+    size_t width() const { return table_.size(); }
+
+private:
+    static size_t round_up_pow2(size_t n) {
+        size_t p = 1;
+        while (p < n) p <<= 1;
+        return p;
+    }
+
+    // std::hash on libstdc++ is already well mixed, but other standard
+    // libraries hash integers as identity — run it through a finalizer.
+    static uint64_t spread(uint64_t x) {
+        x ^= x >> 33;
+        x *= 0xff51afd7ed558ccdull;
+        x ^= x >> 33;
+        x *= 0xc4ceb9fe1a85ec53ull;
+        x ^= x >> 33;
+        return x;
+    }
+
+    size_t index_of(uint64_t h, uint32_t i) const {
+        static const uint64_t kSeeds[4] = {
+            0xc3a5c85c97cb3127ull, 0xb492b66fbe98f273ull,
+            0x9ae16a3b2f90404full, 0xcbf29ce484222325ull };
+        uint64_t x = (h + kSeeds[i]) * kSeeds[i];
+        return static_cast<size_t>(x >> 32) & mask_;
+    }
+
+    // Each row uses its own quarter of the word (nibbles 4i..4i+3)
+    static uint32_t nibble_of(uint64_t h, uint32_t i) {
+        return i * 4 + static_cast<uint32_t>((h >> (i * 2)) & 3);
+    }
+
+    uint32_t counter(uint64_t h, uint32_t i) const {
+        return static_cast<uint32_t>((table_[index_of(h, i)] >> (nibble_of(h, i) * 4)) & 0xF);
+    }
+
+    void age() {
+        for (auto& w : table_) w = (w >> 1) & 0x7777777777777777ull;
+        additions_ /= 2;
+    }
+
+    std::vector<uint64_t> table_;
+    size_t mask_ = 0;
+    size_t sample_size_ = 0;
+    size_t additions_ = 0;
+};
+
+}  // namespace cache
+}  // namespace dcs
@@ -0,0 +1,307 @@
+#pragma once
+
+#include "segmented_cache.h"
+#include "../compat/threading.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace dcs {
+namespace cache {
+
+/**
+ * HotKeyTracker — sampled top-K of the keys each cache segment serves.
+ *
+ * One GET in 2^sample_shift is offered to its segment's Space-Saving
+ * summary (kSlotsPerSegment counters: a new key replaces the smallest
+ * count and inherits it as its error bound).  Sampling uses a per-thread
+ * xorshift, and a sampled GET that finds the summary busy is dropped
+ * rather than waited for, so the tracker never adds a blocking lock to
+ * the read path.  Every kDecayEvery samples a segment halves its counts:
+ * a key has to stay popular to stay on top.
+ */
+class HotKeyTracker {
+public:
+    static constexpr size_t   kSlotsPerSegment = 16;
+    static constexpr uint64_t kDecayEvery      = 4096;
+
+    struct HotKey {
+        std::string key;
+        uint64_t    hits = 0;     // estimated GETs in the decayed window
+        size_t      segment = 0;
+        double      share = 0;    // of all sampled GETs in the window
+    };
+
+    HotKeyTracker(size_t segments, unsigned sample_shift)
+        : segments_(new Segment[std::max<size_t>(1, segments)])
+        , n_segments_(std::max<size_t>(1, segments))
+        , shift_(std::min(sample_shift, 16u))
+        , mask_((1u << shift_) - 1) {}
+
+    HotKeyTracker(const HotKeyTracker&) = delete;
+    HotKeyTracker& operator=(const HotKeyTracker&) = delete;
+
+    /** Offer a GET of `key` (served by `segment`); most calls return at once. */
+    void record(size_t segment, std::string_view key) {
+        if (mask_ && (next_random() & mask_)) return;
+        Segment& s = segments_[segment % n_segments_];
+        if (!s.mu.try_lock()) return;
+        s.offer(key);
+        s.mu.unlock();
+    }
+
+    /** The `n` hottest keys across all segments, hottest first. */
+    std::vector<HotKey> top(size_t n) const {
+        std::vector<HotKey> all;
+        uint64_t window = 0;
+        for (size_t i = 0; i < n_segments_; ++i) {
+            compat::LockGuard<compat::Mutex> lock(segments_[i].mu);
+            window += segments_[i].window;
+            for (const auto& slot : segments_[i].slots) {
+                if (!slot.count) continue;
+                HotKey h;
+                h.key = slot.key;
+                h.hits = slot.count;
+                h.segment = i;
+                all.push_back(std::move(h));
+            }
+        }
+        std::sort(all.begin(), all.end(), [](const HotKey& a, const HotKey& b) { return a.hits > b.hits; });
+        if (all.size() > n) all.resize(n);
+        for (auto& h : all) {
+            h.share = window ? static_cast<double>(h.hits) / static_cast<double>(window) : 0.0;
+            h.hits <<= shift_;
+        }
+        return all;
+    }
+
+    void clear() {
+        for (size_t i = 0; i < n_segments_; ++i) {
+            compat::LockGuard<compat::Mutex> lock(segments_[i].mu);
+            segments_[i].slots.clear();
+            segments_[i].window = 0;
+        }
+    }
+
+    unsigned sample_shift() const { return shift_; }
+
+private:
+    struct Slot {
+        std::string key;
+        uint64_t    count = 0;
+        uint64_t    error = 0;
+    };
+
+    struct alignas(kCacheLineSize) Segment {
+        mutable compat::Mutex mu;
+        std::vector<Slot> slots;
+        uint64_t window = 0;     // samples since start, halved with the counts
+
+        void offer(std::string_view key) {
+            if (++window >= 2 * kDecayEvery) decay();
+            Slot* min = nullptr;
+            for (auto& slot : slots) {
+                if (slot.key == key) {
+                    slot.count++;
+                    return;
+                }
+                if (!min || slot.count < min->count) min = &slot;
+            }
+            if (slots.size() < kSlotsPerSegment) {
+                slots.push_back(Slot{std::string(key), 1, 0});
+                return;
+            }
+            min->key.assign(key.data(), key.size());
+            min->error = min->count;
+            min->count++;
+        }
+
+        void decay() {
+            window /= 2;
+            for (auto& slot : slots) {
+                slot.count /= 2;
+                slot.error /= 2;
+            }
+        }
+    };
+
+    static uint32_t next_random() {
+        thread_local uint32_t x = static_cast<uint32_t>(reinterpret_cast<uintptr_t>(&x) >> 4) | 1u;
+        x ^= x << 13;
+        x ^= x >> 17;
+        x ^= x << 5;
+        return x;
+    }
+
+    std::unique_ptr<Segment[]> segments_;
+    size_t   n_segments_;
+    unsigned shift_;
+    uint32_t mask_;
+};
+
+/**
+ * HotReplica — a read-mostly copy of the hottest keys' values, so GETs
+ * of them skip their segment's lock.
+ *
+ * The replicated set is an immutable sorted snapshot published under a
+ * leaf lock with a global epoch.  Each thread keeps its own reference to
+ * the snapshot and re-reads it only when the epoch moves, so a lookup
+ * costs one load of a line that is written only when the set changes,
+ * plus a binary search over at most a few dozen keys.
+ *
+ * Writers call invalidate() after updating the cache.  A rebuild first
+ * publishes the new keys as pending and only then reads their values, all
+ * under build_mu_; a write that raced the read therefore sees the pending
+ * key and waits on build_mu_ to drop it, and a write that did not see it
+ * happened before the read.  Entries carry the TTL deadline they were
+ * read with and stop answering once it passes.
+ */
+class HotReplica {
+public:
+    /** Current value and TTL deadline of `key`; false if it isn't cached. */
+    using Fetch = std::function<bool(const std::string& key, std::string& value, uint64_t& expire_at)>;
+
+    HotReplica()
+        : id_(next_instance_id())
+        , current_(std::make_shared<const Snapshot>()) {}
+
+    HotReplica(const HotReplica&) = delete;
+    HotReplica& operator=(const HotReplica&) = delete;
+
+    /** Copy the replicated value of `key`; false if it isn't replicated. */
+    bool lookup(std::string_view key, std::string& value) const {
+        const Entry* e = local()->find(key);
+        if (!e || !e->ready) return false;
+        if (e->expire_at && steady_now_ms() >= e->expire_at) return false;
+        value = e->value;
+        return true;
+    }
+
+    /** Drop `key` if it is replicated (or about to be); call after the write. */
+    void invalidate(std::string_view key) {
+        if (!local()->find(key)) return;
+        compat::LockGuard<compat::Mutex> build(build_mu_);
+        auto cur = snapshot();
+        if (!cur->find(key)) return;
+        auto next = std::make_shared<Snapshot>();
+        for (const auto& e : cur->entries) {
+            if (e.key != key) next->entries.push_back(e);
+        }
+        publish(std::move(next));
+    }
+
+    /** Replace the replicated set with `keys`, reading values through `fetch`. */
+    void rebuild(std::vector<std::string> keys, const Fetch& fetch) {
+        std::sort(keys.begin(), keys.end());
+        keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+        compat::LockGuard<compat::Mutex> build(build_mu_);
+        auto cur = snapshot();
+
+        bool changed = keys.size() != cur->entries.size();
+        auto pending = std::make_shared<Snapshot>();
+        for (const auto& k : keys) {
+            const Entry* old = cur->find(k);
+            if (old) {
+                pending->entries.push_back(*old);
+            } else {
+                changed = true;
+                pending->entries.push_back(Entry{k, std::string(), 0, false});
+            }
+        }
+        if (!changed) return;
+        publish(pending);   // writers to the new keys now queue on build_mu_
+
+        auto next = std::make_shared<Snapshot>();   // `pending` is shared now: copy, don't fill in place
+        for (const auto& p : pending->entries) {
+            Entry e = p;
+            if (!e.ready) e.ready = fetch(e.key, e.value, e.expire_at);
+            if (e.ready) next->entries.push_back(std::move(e));
+        }
+        publish(std::move(next));
+    }
+
+    void clear() {
+        compat::LockGuard<compat::Mutex> build(build_mu_);
+        publish(std::make_shared<Snapshot>());
+    }
+
+    /** Replicated keys, sorted. */
+    std::vector<std::string> keys() const {
+        std::vector<std::string> out;
+        for (const auto& e : snapshot()->entries) out.push_back(e.key);
+        return out;
+    }
+
+    size_t size() const { return snapshot()->entries.size(); }
+    uint64_t epoch() const { return epoch_.load(); }
+
+private:
+    struct Entry {
+        std::string key;
+        std::string value;
+        uint64_t    expire_at = 0;
+        bool        ready = false;   // false: announced by a rebuild, value not read yet
+    };
+
+    struct Snapshot {
+        std::vector<Entry> entries;   // sorted by key
+
+        const Entry* find(std::string_view key) const {
+            if (entries.empty()) return nullptr;
+            auto it = std::lower_bound(entries.begin(), entries.end(), key,
+                                       [](const Entry& e, std::string_view k) { return e.key < k; });
+            return it != entries.end() && it->key == key ? &*it : nullptr;
+        }
+    };
+
+    static uint64_t next_instance_id() {
+        static compat::Atomic<uint64_t> next{1};
+        return next++;
+    }
+
+    std::shared_ptr<const Snapshot> snapshot() const {
+        compat::LockGuard<compat::Mutex> lock(ptr_mu_);
+        return current_;
+    }
+
+    void publish(std::shared_ptr<const Snapshot> next) {
+        std::shared_ptr<const Snapshot> old;
+        {
+            compat::LockGuard<compat::Mutex> lock(ptr_mu_);
+            old = std::move(current_);
+            current_ = std::move(next);
+            epoch_.store(epoch_.load() + 1);
+        }
+    }   // `old` is released outside the lock
+
+    /** This thread's view of the snapshot, refreshed when the epoch moved. */
+    const Snapshot* local() const {
+        struct View {
+            uint64_t owner = 0;
+            uint64_t epoch = 0;
+            std::shared_ptr<const Snapshot> snap;
+        };
+        thread_local View view;
+        if (view.owner != id_ || view.epoch != epoch_.load()) {
+            compat::LockGuard<compat::Mutex> lock(ptr_mu_);
+            view.snap = current_;
+            view.epoch = epoch_.load();
+            view.owner = id_;
+        }
+        return view.snap.get();
+    }
+
+    const uint64_t id_;                    // tells thread-local views of two replicas apart
+    mutable compat::Mutex ptr_mu_;         // leaf lock: guards current_ and epoch_ updates
+    compat::Mutex build_mu_;               // serializes rebuild / invalidate / clear
+    std::shared_ptr<const Snapshot> current_;
+    compat::Atomic<uint64_t> epoch_{0};
+};
+
+}  // namespace cache
+}  // namespace dcs
@@ -1,12 +1,21 @@
 #pragma once
 
 #include "node.h"
+#include "slab_allocator.h"
+#include "memory_budget.h"
+#include "frequency_sketch.h"
+#include "timing_wheel.h"
 
 #include <string>
+#include <string_view>
 #include <unordered_map>
 #include <functional>
 #include <vector>
 #include <utility>
+#include <new>
+#include <cstring>
+#include <limits>
+#include <memory>
 
 namespace dcs {
 namespace cache {
@@ -18,28 +27,103 @@ struct CacheResult {
     bool hit;
     std::string value;
 
-    static CacheResult Hit(const std::string& v) { return {true, v}; }
+    static CacheResult Hit(std::string_view v) { return {true, std::string(v)}; }
     static CacheResult Miss() { return {false, ""}; }
 };
 
 /**
  * Eviction callback: called when a node is evicted from the cache.
- * Signature: void(const std::string& key, const std::string& value, bool dirty)
+ * Signature: void(const std::string& key, const std::string& value, bool dirty,
+ *                 uint64_t expire_at)   — TTL deadline, 0 = none
+ * `dirty` is also set for an entry drained into a write-back batch that
+ * hasn't been stored yet: the batch may still fail.
  */
-using EvictionCallback = std::function<void(const std::string&, const std::string&, bool)>;
+using EvictionCallback = std::function<void(const std::string&, const std::string&, bool, uint64_t)>;
+
+/** A drained write-back entry; `expire_at` is its TTL deadline (0 = none). */
+struct DirtyEntry {
+    std::string key;
+    std::string value;
+    uint64_t    expire_at;
+};
+
+/**
+ * Expiry callback: called when an entry is removed because its TTL ran
+ * out (lazily on access, by the timing wheel, or when found at the
+ * eviction tail).  Expired values are never handed to EvictionCallback.
+ * Signature: void(const std::string& key, bool dirty)
+ */
+using ExpiryCallback = std::function<void(const std::string&, bool)>;
+
+/** put() deadline meaning "leave the entry's current TTL alone" (KEEPTTL). */
+static constexpr uint64_t kKeepTTL = std::numeric_limits<uint64_t>::max();
+
+/**
+ * Replacement policy for LRUCache.
+ *
+ *   LRU   — exact recency order; every hit relinks the node to MRU, so
+ *           GET mutates the list and needs an exclusive lock.
+ *   Clock — approximate LRU (second chance); a hit only sets the node's
+ *           reference bit, so GET can run under a shared lock.  The
+ *           evictor rotates referenced nodes back to MRU instead.
+ *   TinyLFU — W-TinyLFU: new keys enter a small LRU window (1%); to move
+ *           into the main region a window victim must have a higher
+ *           FrequencySketch estimate than the main region's victim,
+ *           so one-off scans are rejected instead of flushing the
+ *           working set.  The main region is an SLRU (80% protected,
+ *           entered on a second hit).  Hits relink lists: exclusive lock.
+ */
+enum class EvictionPolicy { LRU, Clock, TinyLFU };
+
+inline const char* policy_name(EvictionPolicy p) {
+    switch (p) {
+        case EvictionPolicy::LRU:     return "lru";
+        case EvictionPolicy::Clock:   return "clock";
+        case EvictionPolicy::TinyLFU: return "tinylfu";
+    }
+    return "unknown";
+}
 
 /**
- * LRU Cache — O(1) GET, PUT, DELETE.
+ * LRU Cache — O(1) GET, PUT, DELETE (amortised O(1) eviction under Clock).
  *
- * Uses a custom doubly linked list + unordered_map.
+ * Uses a custom doubly linked list + unordered_map.  Entries live in one
+ * slab block each (header + key + value, see Node); the map is keyed by
+ * a string_view into that block, so keys are stored once.
+ *
+ * Under TinyLFU the list is the probation segment and two more lists
+ * hold the window and protected regions (Node::region says which).
+ *
+ * Entries may carry a TTL (Node::expire_at).  Expired entries are dropped
+ * lazily when touched and actively by expire_due(), which drains this
+ * cache's TimingWheel a bounded amount at a time.
+ *
+ * `capacity` bounds the entry count.  With a MemoryBudget attached every
+ * entry's bytes are also charged to it; the owner (SegmentedCache) then
+ * decides which cache to evict from via evict_one().
  * NOT thread-safe by itself — concurrency is handled by SegmentedCache.
  */
 class LRUCache {
 public:
-    explicit LRUCache(size_t capacity = 1024)
-        : capacity_(capacity) {}
+    explicit LRUCache(size_t capacity = 1024, EvictionPolicy policy = EvictionPolicy::LRU,
+                      MemoryBudget* budget = nullptr)
+        : capacity_(capacity)
+        , policy_(policy)
+        , budget_(budget) {
+        if (policy_ == EvictionPolicy::TinyLFU && !unbounded()) sketch_.ensure_capacity(capacity_);
+    }
 
-    ~LRUCache() = default;
+    ~LRUCache() {
+        for (DoublyLinkedList* list : {&window_, &list_, &protected_}) {
+            Node* curr = list->head_sentinel()->next;
+            Node* tail = list->tail_sentinel();
+            while (curr != tail) {
+                Node* next = curr->next;
+                free_node(curr);
+                curr = next;
+            }
+        }
+    }
 
     // Non-copyable
     LRUCache(const LRUCache&) = delete;
@@ -50,32 +134,111 @@ public:
      * On hit: moves the node to MRU and returns the value.
      * On miss: returns CacheResult::Miss().
      */
-    CacheResult get(const std::string& key) {
+    CacheResult get(std::string_view key) {
+        if (policy_ == EvictionPolicy::TinyLFU) sketch_.increment(hasher_(key));
         auto it = map_.find(key);
         if (it == map_.end()) {
             return CacheResult::Miss();
         }
 
         Node* node = it->second;
-        node->last_access = std::chrono::steady_clock::now();
-        list_.move_to_front(node);
-        return CacheResult::Hit(node->value);
+        if (is_expired(node)) {
+            unlink_and_drop(node);
+            return CacheResult::Miss();
+        }
+        touch(node);
+        if (policy_ == EvictionPolicy::Clock) {
+            node->referenced.store(1, std::memory_order_relaxed);
+            return CacheResult::Hit(node->value());
+        }
+        promote(node);
+        return CacheResult::Hit(node->value());
+    }
+
+    /**
+     * GET for the Clock policy — touches nothing but the reference bit,
+     * so any number of callers may run it concurrently as long as no
+     * writer holds the segment (i.e. under a shared lock).  An expired
+     * entry reads as a miss and sets `*expired`; the caller removes it
+     * with expire_key() once it holds the lock exclusively.
+     */
+    CacheResult get_shared(std::string_view key, bool* expired = nullptr) const {
+        auto it = map_.find(key);
+        if (it == map_.end()) {
+            return CacheResult::Miss();
+        }
+        Node* node = it->second;
+        if (is_expired(node)) {
+            if (expired) *expired = true;
+            return CacheResult::Miss();
+        }
+        if (!node->referenced.load(std::memory_order_relaxed)) {
+            node->referenced.store(1, std::memory_order_relaxed);
+        }
+        touch(node);
+        return CacheResult::Hit(node->value());
     }
 
     /**
      * PUT — Insert or update a key-value pair.
      * If key exists: updates value, marks dirty, moves to MRU.
      * If key is new and cache is full: evicts LRU entry first.
+     * `expire_at` is the new TTL deadline (0 = none, as SET clears TTLs;
+     * kKeepTTL keeps an existing one).
      */
-    void put(const std::string& key, const std::string& value) {
+    void put(std::string_view key, std::string_view value, uint64_t expire_at = 0) {
+        if (policy_ == EvictionPolicy::TinyLFU) sketch_.increment(hasher_(key));
         auto it = map_.find(key);
+        if (it != map_.end() && is_expired(it->second)) {
+            unlink_and_drop(it->second);   // the old entry is gone; this is an insert
+            it = map_.end();
+        }
         if (it != map_.end()) {
-            // Key exists — update in place
+            // Key exists — update in place, or move to a bigger block
             Node* node = it->second;
-            node->value = value;
-            node->dirty = true;
-            node->last_access = std::chrono::steady_clock::now();
-            list_.move_to_front(node);
+            if (!node->fits(value.size())) {
+                Node* grown = alloc_node(key, value);
+                grown->referenced.store(node->referenced.load(std::memory_order_relaxed),
+                                        std::memory_order_relaxed);
+                grown->region = node->region;
+                if (node->expire_at) {   // same key, so its armed timer still applies
+                    grown->expire_at = node->expire_at;
+                    volatile_.fetch_add(1, std::memory_order_relaxed);
+                }
+                list_of(node).replace(node, grown);
+                if (node->dirty) {   // keep its place (and age) in the flush queue
+                    dirty_.replace(node, grown);
+                    grown->dirty = true;
+                    grown->dirty_since = node->dirty_since;
+                    node->dirty = false;
+                } else if (node->flushing) {
+                    in_flight_.replace(node, grown);
+                }
+                grown->flushing = node->flushing;
+                node->flushing = false;
+                map_.erase(it);
+                map_.emplace(grown->key(), grown);
+                free_node(node);
+                node = grown;
+            } else {
+                payload_bytes_ -= node->value_len;
+                node->set_value(value);
+                payload_bytes_ += value.size();
+            }
+            mark_dirty(node);
+            if (expire_at != kKeepTTL) set_expiry(node, expire_at);
+            touch(node);
+            if (policy_ == EvictionPolicy::Clock) {
+                node->referenced.store(1, std::memory_order_relaxed);
+            } else {
+                promote(node);
+            }
+            return;
+        }
+        if (expire_at == kKeepTTL) expire_at = 0;
+
+        if (policy_ == EvictionPolicy::TinyLFU) {
+            insert_tinylfu(key, value, expire_at);
             return;
         }
 
@@ -85,35 +248,159 @@ public:
         }
 
         // Insert new node at MRU position
-        Node* node = new Node(key, value);
-        node->dirty = true;
+        Node* node = alloc_node(key, value);
+        mark_dirty(node);
+        set_expiry(node, expire_at);
+        touch(node);
         list_.push_front(node);
-        map_[key] = node;
+        map_.emplace(node->key(), node);
     }
 
     /**
      * DELETE — Remove a key from the cache.
      * Returns true if the key existed and was removed.
      */
-    bool del(const std::string& key) {
+    bool del(std::string_view key) {
         auto it = map_.find(key);
         if (it == map_.end()) return false;
 
         Node* node = it->second;
-        list_.detach(node);
+        if (is_expired(node)) {
+            unlink_and_drop(node);
+            return false;
+        }
+        list_of(node).detach(node);
         map_.erase(it);
 
         if (eviction_cb_) {
-            eviction_cb_(node->key, node->value, node->dirty);
+            eviction_cb_(std::string(node->key()), std::string(node->value()), unpersisted(node),
+                         node->expire_at);
         }
 
-        delete node;
+        free_node(node);
+        return true;
+    }
+
+    /**
+     * Remove a key and hand back its value and TTL deadline, without
+     * reporting it to the eviction callback: the caller now owns the
+     * only copy (used to move keys to another node).  False if absent.
+     */
+    bool take(std::string_view key, std::string& value, uint64_t& expire_at) {
+        auto it = map_.find(key);
+        if (it == map_.end()) return false;
+        Node* node = it->second;
+        if (is_expired(node)) {
+            unlink_and_drop(node);
+            return false;
+        }
+        value.assign(node->value());
+        expire_at = node->expire_at;
+        list_of(node).detach(node);
+        map_.erase(it);
+        free_node(node);
         return true;
     }
 
     /** Check if a key exists without promoting it. */
-    bool exists(const std::string& key) const {
-        return map_.find(key) != map_.end();
+    bool exists(std::string_view key) const {
+        auto it = map_.find(key);
+        return it != map_.end() && !is_expired(it->second);
+    }
+
+    /** Copy a live entry's value and TTL deadline without promoting it. */
+    bool peek(std::string_view key, std::string& value, uint64_t& expire_at) const {
+        auto it = map_.find(key);
+        if (it == map_.end() || is_expired(it->second)) return false;
+        value.assign(it->second->value());
+        expire_at = it->second->expire_at;
+        return true;
+    }
+
+    // ── Expiry ─────────────────────────────────────────────────────
+
+    /**
+     * Report a key with no live entry as expired, e.g. a backend record
+     * found past its deadline: the expiry callback runs as if its node
+     * had timed out here (a stale node is dropped the usual way).  False,
+     * doing nothing, if the key is live.
+     */
+    bool expire_absent(std::string_view key) {
+        auto it = map_.find(key);
+        if (it != map_.end()) {
+            if (!is_expired(it->second)) return false;
+            unlink_and_drop(it->second);
+            return true;
+        }
+        expired_.fetch_add(1, std::memory_order_relaxed);
+        if (expiry_cb_) expiry_cb_(std::string(key), false);
+        return true;
+    }
+
+    /** Set a TTL deadline (steady_now_ms() base).  False if the key is absent. */
+    bool expire(std::string_view key, uint64_t expire_at) {
+        Node* node = live_node(key);
+        if (!node) return false;
+        set_expiry(node, expire_at);
+        return true;
+    }
+
+    /** Remove a key's TTL.  True if it had one. */
+    bool persist(std::string_view key) {
+        Node* node = live_node(key);
+        if (!node || !node->expire_at) return false;
+        set_expiry(node, 0);
+        return true;
+    }
+
+    /** Remaining TTL in ms: -2 if the key is absent, -1 if it has no TTL. */
+    int64_t ttl_ms(std::string_view key) const {
+        auto it = map_.find(key);
+        if (it == map_.end()) return -2;
+        const Node* node = it->second;
+        if (!node->expire_at) return -1;
+        uint64_t now = steady_now_ms();
+        if (node->expire_at <= now) return -2;
+        return static_cast<int64_t>(node->expire_at - now);
+    }
+
+    /** Drop `key` if its TTL has run out (after get_shared() reported it). */
+    bool expire_key(std::string_view key) {
+        auto it = map_.find(key);
+        if (it == map_.end() || !is_expired(it->second)) return false;
+        unlink_and_drop(it->second);
+        return true;
+    }
+
+    /**
+     * Active expiry: advance the timing wheel to `now_ms`, dropping entries
+     * whose deadline has passed.  Does at most about `max_work` units of
+     * work (see TimingWheel::advance); returns the number of keys expired.
+     */
+    size_t expire_due(uint64_t now_ms, size_t max_work) {
+        if (!wheel_) return 0;
+        size_t expired = 0;
+        wheel_->advance(now_ms, max_work, [&](const std::string& key) {
+            auto it = map_.find(key);
+            if (it == map_.end() || !it->second->expired(now_ms)) return;  // stale timer
+            unlink_and_drop(it->second);
+            ++expired;
+        });
+        timers_.store(wheel_->pending(), std::memory_order_relaxed);
+        return expired;
+    }
+
+    /** Keys carrying a TTL. */
+    size_t volatile_count() const { return volatile_.load(std::memory_order_relaxed); }
+
+    /** Keys removed because their TTL ran out. */
+    uint64_t expired_count() const { return expired_.load(std::memory_order_relaxed); }
+
+    /** Armed (possibly stale) timers; zero means expire_due() has nothing to do. */
+    size_t pending_timers() const { return timers_.load(std::memory_order_relaxed); }
+
+    void set_expiry_callback(ExpiryCallback cb) {
+        expiry_cb_ = std::move(cb);
     }
 
     /** Return all keys currently in the cache. */
@@ -121,33 +408,146 @@ public:
         std::vector<std::string> result;
         result.reserve(map_.size());
         for (auto it = map_.begin(); it != map_.end(); ++it) {
-            result.push_back(it->first);
+            if (!is_expired(it->second)) result.emplace_back(it->first);
+        }
+        return result;
+    }
+
+    /**
+     * Up to `limit` keys, hottest first as far as the policy can tell:
+     * TinyLFU's protected region and recently referenced entries, then
+     * everything else in MRU order.  Feeds the persisted warm-up list.
+     */
+    std::vector<std::string> hot_keys(size_t limit) const {
+        std::vector<std::string> result;
+        for (int pass = 0; pass < 2; ++pass) {
+            for (const DoublyLinkedList* list : {&protected_, &window_, &list_}) {
+                Node* curr = list->head_sentinel()->next;
+                Node* tail = list->tail_sentinel();
+                for (; curr != tail && result.size() < limit; curr = curr->next) {
+                    bool hot = list == &protected_ ||
+                               curr->referenced.load(std::memory_order_relaxed) != 0;
+                    if (hot == (pass == 0) && !is_expired(curr)) result.emplace_back(curr->key());
+                }
+            }
         }
         return result;
     }
 
-    /** Collect all dirty keys (for write-back flush). */
+    /** Collect all dirty keys, oldest write first (does not clear them). */
     std::vector<std::pair<std::string, std::string>> dirty_entries() const {
         std::vector<std::pair<std::string, std::string>> result;
-        Node* curr = list_.head_sentinel()->next;
-        Node* tail = list_.tail_sentinel();
-        while (curr != tail) {
-            if (curr->dirty) {
-                result.emplace_back(curr->key, curr->value);
+        result.reserve(dirty_.size());
+        for (Node* curr = dirty_.front(); curr; curr = curr->dirty_next) {
+            // Expired values must not be written back: the expiry
+            // callback removes them from the backend instead.
+            if (!is_expired(curr)) {
+                result.emplace_back(std::string(curr->key()), std::string(curr->value()));
             }
-            curr = curr->next;
         }
         return result;
     }
 
+    /**
+     * Move up to `max` of the oldest dirty entries into `out`; returns
+     * how many were taken off the dirty list.  Work is bounded by `max`,
+     * not by the cache size.  Drained entries stay in flight (still
+     * reported dirty on eviction) until settle_flush().  A key written
+     * again after this re-enters the list at the back.
+     *
+     * A node is on in_flight_ exactly while it is flushing and not dirty.
+     * One that is still flushing from an unsettled batch is put back
+     * there by mark_clean() already; the flag is per node, not per
+     * batch, so callers settle a batch before draining the next
+     * (WriteBackWorker holds flush_mu_ across a pass).
+     */
+    size_t drain_dirty(size_t max, std::vector<DirtyEntry>& out) {
+        size_t taken = 0;
+        while (taken < max) {
+            Node* node = dirty_.front();
+            if (!node) break;
+            mark_clean(node);
+            ++taken;
+            if (!is_expired(node)) {
+                if (!node->flushing) {
+                    node->flushing = true;
+                    in_flight_.push_back(node);
+                }
+                out.push_back({std::string(node->key()), std::string(node->value()), node->expire_at});
+            }
+        }
+        return taken;
+    }
+
     /** Clear dirty flag for a key (after successful persistence). */
-    void clear_dirty(const std::string& key) {
+    void clear_dirty(std::string_view key) {
         auto it = map_.find(key);
-        if (it != map_.end()) {
-            it->second->dirty = false;
+        if (it != map_.end()) mark_clean(it->second);
+    }
+
+    /**
+     * A drained key's batch was stored (`stored`) or failed.  The entry
+     * leaves the in-flight state; after a failure it goes back on the
+     * dirty list.  A rewrite since the drain is already queued and stays
+     * so.  No-op if the key was deleted or replaced meanwhile.
+     */
+    void settle_flush(std::string_view key, bool stored) {
+        auto it = map_.find(key);
+        if (it == map_.end() || !it->second->flushing) return;
+        Node* node = it->second;
+        node->flushing = false;
+        if (!node->dirty) in_flight_.remove(node);
+        if (!stored) mark_dirty(node);
+    }
+
+    /**
+     * Append the live keys the backend may not hold yet — dirty or in
+     * flight — that start with `prefix` and sort after `after` (SCAN
+     * merges them into backend pages).  Work is O(unpersisted entries).
+     */
+    void unpersisted_keys(std::string_view prefix, std::string_view after,
+                          std::vector<std::string>& out) const {
+        for (const DirtyList* list : {&dirty_, &in_flight_}) {
+            for (Node* curr = list->front(); curr; curr = curr->dirty_next) {
+                std::string_view k = curr->key();
+                if (k.substr(0, prefix.size()) == prefix && k > after && !is_expired(curr)) {
+                    out.emplace_back(k);
+                }
+            }
         }
     }
 
+    /** Entries drained but not yet settled. */
+    size_t in_flight_count() const { return in_flight_.size(); }
+
+    /** Entries drained but not yet settled (tests). */
+    bool flushing(std::string_view key) const {
+        auto it = map_.find(key);
+        return it != map_.end() && it->second->flushing;
+    }
+
+    /**
+     * Queue a live key for write-back without changing its value, e.g.
+     * after its TTL changed.  False if absent.
+     */
+    bool mark_dirty(std::string_view key) {
+        Node* node = live_node(key);
+        if (!node) return false;
+        mark_dirty(node);
+        return true;
+    }
+
+    /** Entries awaiting write-back; safe to read without the owner's lock. */
+    size_t dirty_count() const { return dirty_.size(); }
+
+    /** steady_now_ms() (low 32 bits) of the oldest unflushed write. */
+    bool oldest_dirty_since(uint32_t& since) const {
+        Node* front = dirty_.front();
+        if (!front) return false;
+        since = front->dirty_since;
+        return true;
+    }
+
     /** Set the eviction callback. */
     void set_eviction_callback(EvictionCallback cb) {
         eviction_cb_ = std::move(cb);
@@ -156,32 +556,308 @@ public:
     size_t size() const { return map_.size(); }
     size_t capacity() const { return capacity_; }
     bool empty() const { return map_.empty(); }
+    EvictionPolicy policy() const { return policy_; }
+
+    /** TinyLFU: new entries dropped because they lost the frequency duel. */
+    uint64_t admission_rejections() const { return rejections_.load(std::memory_order_relaxed); }
+
+    /**
+     * Bytes this cache holds for its entries: slab pages and large blocks
+     * plus the hash index (bucket array and one map node per entry).
+     */
+    size_t memory_bytes() const {
+        return slab_.bytes_reserved()
+             + map_.bucket_count() * sizeof(void*)
+             + map_.size() * kMapNodeBytes;
+    }
+
+    /** Key + value bytes actually stored (excludes all overhead). */
+    size_t payload_bytes() const { return payload_bytes_; }
+
+    /**
+     * Bytes charged for live entries (block + index node each).  Atomic
+     * so SegmentedCache can compare segments without taking their locks.
+     */
+    size_t charged_bytes() const { return charged_bytes_.load(std::memory_order_relaxed); }
+
+    /** Evict a single entry by this cache's policy; false if empty. */
+    bool evict_one() {
+        if (map_.empty()) return false;
+        evict_lru();
+        return true;
+    }
+
+    /**
+     * Last-touch tick of the next eviction candidate (budget mode), used
+     * to find the segment holding the globally oldest data.
+     */
+    bool tail_tick(uint32_t& tick) const {
+        Node* tail = list_.back();
+        if (!tail) tail = protected_.back();
+        if (!tail) tail = window_.back();
+        if (!tail) return false;
+        tick = tail->tick.load(std::memory_order_relaxed);
+        return true;
+    }
 
     /** Flush entire cache (for shutdown). */
     void clear() {
         // Evict all entries through callback
-        while (!map_.empty()) {
-            evict_lru();
+        for (DoublyLinkedList* list : {&window_, &list_, &protected_}) {
+            while (Node* node = list->pop_back()) drop(node);
         }
     }
 
 private:
+    enum Region : uint8_t { kMain = 0, kWindow = 1, kProtected = 2 };
+
+    // libstdc++ map node: next pointer + key/value pair + cached hash
+    static constexpr size_t kMapNodeBytes =
+        sizeof(void*) + sizeof(std::pair<const std::string_view, Node*>) + sizeof(size_t);
+
+    size_t entry_bytes(const Node* node) const {
+        return sizeof(Node) + node->capacity + kMapNodeBytes;
+    }
+
+    void touch(Node* node) const {
+        if (budget_) node->tick.store(MemoryBudget::now_tick(), std::memory_order_relaxed);
+    }
+
+    Node* alloc_node(std::string_view key, std::string_view value) {
+        size_t want = sizeof(Node) + key.size() + value.size();
+        uint8_t cls;
+        void* mem = slab_.allocate(want, cls);
+        Node* node = new (mem) Node();
+        node->size_class = cls;
+        node->capacity = static_cast<uint32_t>(SlabAllocator::block_size(cls, want) - sizeof(Node));
+        node->key_len = static_cast<uint32_t>(key.size());
+        std::memcpy(node->payload(), key.data(), key.size());
+        node->set_value(value);
+        payload_bytes_ += key.size() + value.size();
+        size_t charge = entry_bytes(node);
+        charged_bytes_.fetch_add(charge, std::memory_order_relaxed);
+        if (budget_) budget_->charge(charge);
+        return node;
+    }
+
+    void free_node(Node* node) {
+        if (node->dirty) dirty_.remove(node);
+        else if (node->flushing) in_flight_.remove(node);
+        if (node->expire_at) volatile_.fetch_sub(1, std::memory_order_relaxed);
+        payload_bytes_ -= node->key_len + node->value_len;
+        size_t charge = entry_bytes(node);
+        charged_bytes_.fetch_sub(charge, std::memory_order_relaxed);
+        if (budget_) budget_->release(charge);
+        uint8_t cls = node->size_class;
+        size_t bytes = sizeof(Node) + node->capacity;
+        node->~Node();
+        slab_.deallocate(node, cls, bytes);
+    }
+
+    void mark_dirty(Node* node) {
+        if (node->dirty) return;   // already queued: the flush picks up this value
+        if (node->flushing) in_flight_.remove(node);   // rewritten in flight: queue it again
+        node->dirty = true;
+        node->dirty_since = static_cast<uint32_t>(steady_now_ms());
+        dirty_.push_back(node);
+    }
+
+    void mark_clean(Node* node) {
+        if (!node->dirty) return;
+        node->dirty = false;
+        dirty_.remove(node);
+        if (node->flushing) in_flight_.push_back(node);
+    }
+
+    /** Not known to be in the backend: dirty, or drained into a batch in flight. */
+    static bool unpersisted(const Node* node) { return node->dirty || node->flushing; }
+
     void evict_lru() {
+        if (policy_ == EvictionPolicy::TinyLFU) {
+            evict_tinylfu();
+            return;
+        }
+        if (policy_ == EvictionPolicy::Clock) second_chance_sweep();
         Node* lru = list_.pop_back();
         if (!lru) return;
+        drop(lru);
+    }
 
-        if (eviction_cb_) {
-            eviction_cb_(lru->key, lru->value, lru->dirty);
+    /**
+     * Report an unlinked node to the eviction callback (or, if its TTL has
+     * run out, the expiry callback), unindex and free it.
+     */
+    void drop(Node* node) {
+        if (is_expired(node)) {
+            expired_.fetch_add(1, std::memory_order_relaxed);
+            if (expiry_cb_) expiry_cb_(std::string(node->key()), node->dirty);
+        } else if (eviction_cb_) {
+            eviction_cb_(std::string(node->key()), std::string(node->value()), unpersisted(node),
+                         node->expire_at);
+        }
+        map_.erase(node->key());
+        free_node(node);
+    }
+
+    void unlink_and_drop(Node* node) {
+        list_of(node).detach(node);
+        drop(node);
+    }
+
+    static bool is_expired(const Node* node) {
+        return node->expire_at != 0 && node->expire_at <= steady_now_ms();
+    }
+
+    Node* live_node(std::string_view key) {
+        auto it = map_.find(key);
+        if (it == map_.end()) return nullptr;
+        if (is_expired(it->second)) {
+            unlink_and_drop(it->second);
+            return nullptr;
         }
+        return it->second;
+    }
+
+    /** Set (or clear, with 0) a node's deadline and arm a timer for it. */
+    void set_expiry(Node* node, uint64_t expire_at) {
+        if (!node->expire_at && expire_at) volatile_.fetch_add(1, std::memory_order_relaxed);
+        if (node->expire_at && !expire_at) volatile_.fetch_sub(1, std::memory_order_relaxed);
+        if (node->expire_at == expire_at) return;
+        node->expire_at = expire_at;
+        if (!expire_at) return;   // any armed timer goes stale
+        uint64_t now = steady_now_ms();
+        if (!wheel_) wheel_ = std::make_unique<TimingWheel>(now);
+        wheel_->schedule(node->key(), expire_at, now);
+        timers_.store(wheel_->pending(), std::memory_order_relaxed);
+    }
+
+    // ── TinyLFU ────────────────────────────────────────────────────
+
+    DoublyLinkedList& list_of(Node* node) {
+        if (node->region == kWindow) return window_;
+        if (node->region == kProtected) return protected_;
+        return list_;
+    }
 
-        map_.erase(lru->key);
-        delete lru;
+    bool unbounded() const { return capacity_ == std::numeric_limits<size_t>::max(); }
+
+    // Region sizes follow the entry limit, or the live entry count when a
+    // byte budget (unbounded capacity) decides how many entries fit.
+    size_t window_capacity() const {
+        size_t total = unbounded() ? map_.size() : capacity_;
+        return std::max<size_t>(1, total / 100);
+    }
+
+    size_t protected_capacity() const {
+        size_t total = unbounded() ? map_.size() : capacity_;
+        return (total - std::min(total, window_capacity())) * 4 / 5;
+    }
+
+    /** Hit (or update) under LRU/TinyLFU: relink towards MRU, SLRU promotion. */
+    void promote(Node* node) {
+        if (node->region == kMain && policy_ == EvictionPolicy::TinyLFU) {
+            // Probation hit: move to protected, demoting its LRU if full
+            list_.detach(node);
+            node->region = kProtected;
+            protected_.push_front(node);
+            while (protected_.size() > protected_capacity()) {
+                Node* demoted = protected_.pop_back();
+                demoted->region = kMain;
+                list_.push_front(demoted);
+            }
+            return;
+        }
+        list_of(node).move_to_front(node);
+    }
+
+    void insert_tinylfu(std::string_view key, std::string_view value, uint64_t expire_at) {
+        Node* node = alloc_node(key, value);
+        mark_dirty(node);
+        node->region = kWindow;
+        set_expiry(node, expire_at);
+        touch(node);
+        window_.push_front(node);
+        map_.emplace(node->key(), node);
+        if (unbounded()) sketch_.ensure_capacity(map_.size());
+
+        // Window overflow moves into probation while the main region has
+        // room; once full, each overflow is settled by a frequency duel.
+        while (window_.size() > window_capacity()) {
+            if (map_.size() <= capacity_) {
+                Node* cand = window_.pop_back();
+                cand->region = kMain;
+                list_.push_front(cand);
+            } else {
+                evict_tinylfu();
+            }
+        }
+        while (map_.size() > capacity_) evict_tinylfu();
+    }
+
+    /**
+     * Evict one entry: the window's LRU (candidate) against the main
+     * region's LRU (victim).  The candidate is admitted to probation only
+     * if the sketch says it is more popular; ties favour the incumbent.
+     */
+    void evict_tinylfu() {
+        Node* cand = window_.back();
+        Node* victim = list_.back();
+        if (!victim) victim = protected_.back();
+        if (!victim || !cand) {
+            Node* only = victim ? victim : cand;
+            if (!only) return;
+            list_of(only).detach(only);
+            drop(only);
+            return;
+        }
+        window_.detach(cand);
+        if (sketch_.frequency(hasher_(cand->key())) > sketch_.frequency(hasher_(victim->key()))) {
+            list_of(victim).detach(victim);
+            drop(victim);
+            cand->region = kMain;
+            list_.push_front(cand);
+        } else {
+            rejections_.fetch_add(1, std::memory_order_relaxed);
+            drop(cand);
+        }
+    }
+
+    /**
+     * CLOCK hand: recycle referenced tail nodes to MRU (clearing the bit)
+     * until an unreferenced one sits at the tail.  Terminates within one
+     * lap because every rotated node comes back with its bit cleared.
+     */
+    void second_chance_sweep() {
+        size_t budget = list_.size();
+        Node* tail = list_.back();
+        while (tail && budget-- > 0 && tail->referenced.load(std::memory_order_relaxed)) {
+            tail->referenced.store(0, std::memory_order_relaxed);
+            list_.move_to_front(tail);
+            tail = list_.back();
+        }
     }
 
     size_t capacity_;
-    DoublyLinkedList list_;
-    std::unordered_map<std::string, Node*> map_;
+    EvictionPolicy policy_;
+    MemoryBudget* budget_;          // shared, owned by SegmentedCache; may be null
+    SlabAllocator slab_;            // declared before list_/map_: outlives them
+    DoublyLinkedList list_;         // LRU/Clock order; TinyLFU probation
+    DoublyLinkedList window_;       // TinyLFU admission window
+    DoublyLinkedList protected_;    // TinyLFU protected main region
+    DirtyList dirty_;               // write-back queue, oldest write first
+    DirtyList in_flight_;           // drained, clean, batch not yet settled
+    std::unordered_map<std::string_view, Node*> map_;
+    FrequencySketch sketch_{16};
+    std::hash<std::string_view> hasher_;
+    std::atomic<uint64_t> rejections_{0};
     EvictionCallback eviction_cb_;
+    ExpiryCallback expiry_cb_;
+    std::unique_ptr<TimingWheel> wheel_;   // created on first TTL
+    std::atomic<size_t> volatile_{0};
+    std::atomic<size_t> timers_{0};
+    std::atomic<uint64_t> expired_{0};
+    size_t payload_bytes_ = 0;
+    std::atomic<size_t> charged_bytes_{0};
 };
 
 }  // namespace cache
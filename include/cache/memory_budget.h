@@ -0,0 +1,51 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+namespace dcs {
+namespace cache {
+
+/**
+ * MemoryBudget — global byte limit (maxmemory) shared by every segment.
+ *
+ * Segments charge each entry's full footprint (slab block + index node)
+ * on insert and release it on removal.  SegmentedCache checks over()
+ * after a write and evicts from whichever segment holds the oldest
+ * entries, so a hot segment may grow past an even share as long as
+ * colder segments have something to give back.
+ */
+class MemoryBudget {
+public:
+    explicit MemoryBudget(size_t limit_bytes)
+        : limit_(limit_bytes), used_(0) {}
+
+    MemoryBudget(const MemoryBudget&) = delete;
+    MemoryBudget& operator=(const MemoryBudget&) = delete;
+
+    void charge(size_t bytes)  { used_.fetch_add(bytes, std::memory_order_relaxed); }
+    void release(size_t bytes) { used_.fetch_sub(bytes, std::memory_order_relaxed); }
+
+    bool   over()  const { return used_.load(std::memory_order_relaxed) > limit_; }
+    size_t used()  const { return used_.load(std::memory_order_relaxed); }
+    size_t limit() const { return limit_; }
+
+    /**
+     * Coarse access clock (1 ms ticks, wraps after ~49 days) stamped on
+     * entries when touched; victim selection compares tail entries by it.
+     */
+    static uint32_t now_tick() {
+        using namespace std::chrono;
+        return static_cast<uint32_t>(
+            duration_cast<milliseconds>(steady_clock::now().time_since_epoch()).count());
+    }
+
+private:
+    const size_t limit_;
+    std::atomic<size_t> used_;
+};
+
+}  // namespace cache
+}  // namespace dcs
@@ -1,43 +1,93 @@
 #pragma once
 
-#include <string>
-#include <chrono>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
 
 namespace dcs {
 namespace cache {
 
 /**
  * A node in the doubly linked list used by the LRU cache.
- * Each node stores a key-value pair and pointers to its neighbors.
+ *
+ * The node is a header followed by its key and value bytes in the same
+ * block (allocated by the segment's SlabAllocator), so an entry is one
+ * allocation and the hash index keys on a string_view into the node
+ * rather than a second copy of the key.
+ *
+ *   [ Node header | key bytes | value bytes | slack up to capacity ]
+ *
  * Hand-rolled (no std::list) for O(1) move/detach operations.
  */
 struct Node {
-    std::string key;
-    std::string value;
     Node* prev;
     Node* next;
-    bool dirty;  // Marks node as modified (for write-back sync)
-    std::chrono::steady_clock::time_point last_access;
+    Node* dirty_prev;    // DirtyList links: the dirty queue while `dirty`
+                         // is set, else the in-flight list while `flushing`
+    Node* dirty_next;
+    uint32_t key_len;
+    uint32_t value_len;
+    uint32_t capacity;   // payload bytes available after the header
+    bool dirty : 1;      // Marks node as modified (for write-back sync)
+    bool flushing : 1;   // Drained into a write-back batch not yet stored
+    uint8_t size_class;  // SlabAllocator class of this block
+    uint8_t region;      // Which LRUCache list holds it (TinyLFU regions)
+
+    // CLOCK reference bit.  Set by readers holding only a shared lock, so
+    // it is a (lock-free) byte atomic; cleared by the evictor.
+    std::atomic<uint8_t> referenced;
+
+    // Last-touch tick (MemoryBudget::now_tick); only maintained when the
+    // cache runs under a byte budget, to compare segments' oldest entries.
+    std::atomic<uint32_t> tick;
+
+    // When the node last went from clean to dirty (low 32 bits of
+    // steady_now_ms()); the oldest one gives the write-back lag.
+    uint32_t dirty_since;
+
+    // Expiry deadline in steady_now_ms() milliseconds; 0 = no TTL.
+    uint64_t expire_at;
 
     Node()
         : prev(nullptr)
         , next(nullptr)
+        , dirty_prev(nullptr)
+        , dirty_next(nullptr)
+        , key_len(0)
+        , value_len(0)
+        , capacity(0)
         , dirty(false)
-        , last_access(std::chrono::steady_clock::now()) {}
+        , flushing(false)
+        , size_class(0)
+        , region(0)
+        , referenced(0)
+        , tick(0)
+        , dirty_since(0)
+        , expire_at(0) {}
 
-    Node(const std::string& k, const std::string& v)
-        : key(k)
-        , value(v)
-        , prev(nullptr)
-        , next(nullptr)
-        , dirty(false)
-        , last_access(std::chrono::steady_clock::now()) {}
+    char* payload() { return reinterpret_cast<char*>(this + 1); }
+    const char* payload() const { return reinterpret_cast<const char*>(this + 1); }
+
+    std::string_view key() const { return {payload(), key_len}; }
+    std::string_view value() const { return {payload() + key_len, value_len}; }
+
+    bool expired(uint64_t now_ms) const { return expire_at != 0 && expire_at <= now_ms; }
+
+    /** True if a value of `len` bytes fits without reallocating the node. */
+    bool fits(size_t len) const { return key_len + len <= capacity; }
+
+    void set_value(std::string_view v) {
+        std::memcpy(payload() + key_len, v.data(), v.size());
+        value_len = static_cast<uint32_t>(v.size());
+    }
 };
 
 /**
  * Intrusive doubly linked list.
  * Head sentinel = MRU side, Tail sentinel = LRU side.
- * All operations are O(1).
+ * All operations are O(1).  The list does not own its nodes — they
+ * belong to the LRUCache's allocator and are freed there.
  */
 class DoublyLinkedList {
 public:
@@ -50,12 +100,6 @@ public:
     }
 
     ~DoublyLinkedList() {
-        Node* curr = head_->next;
-        while (curr != tail_) {
-            Node* next = curr->next;
-            delete curr;
-            curr = next;
-        }
         delete head_;
         delete tail_;
     }
@@ -98,6 +142,16 @@ public:
         --size_;
     }
 
+    /** Put `fresh` where `old` is linked (old is unlinked, size unchanged). */
+    void replace(Node* old, Node* fresh) {
+        fresh->prev = old->prev;
+        fresh->next = old->next;
+        old->prev->next = fresh;
+        old->next->prev = fresh;
+        old->prev = nullptr;
+        old->next = nullptr;
+    }
+
     /** Move an existing node to the MRU position (front). */
     void move_to_front(Node* node) {
         detach(node);
@@ -129,5 +183,62 @@ private:
     size_t size_;
 };
 
+/**
+ * Intrusive FIFO of dirty nodes, oldest first, threaded through
+ * Node::dirty_prev/dirty_next.  The owner keeps a node on it exactly
+ * while its dirty flag is set, so dirtying a queued node again leaves
+ * it in place: repeat writes coalesce into one pending flush of the
+ * latest value.  (A second list holds drained nodes, clean but not yet
+ * stored.)  size() may be read without the owner's lock.
+ */
+class DirtyList {
+public:
+    DirtyList() = default;
+    DirtyList(const DirtyList&) = delete;
+    DirtyList& operator=(const DirtyList&) = delete;
+
+    void push_back(Node* node) {
+        node->dirty_prev = tail_;
+        node->dirty_next = nullptr;
+        if (tail_) tail_->dirty_next = node;
+        else head_ = node;
+        tail_ = node;
+        size_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void remove(Node* node) {
+        if (node->dirty_prev) node->dirty_prev->dirty_next = node->dirty_next;
+        else head_ = node->dirty_next;
+        if (node->dirty_next) node->dirty_next->dirty_prev = node->dirty_prev;
+        else tail_ = node->dirty_prev;
+        node->dirty_prev = nullptr;
+        node->dirty_next = nullptr;
+        size_.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    /** Put `fresh` where `old` is queued (old is unlinked, size unchanged). */
+    void replace(Node* old, Node* fresh) {
+        fresh->dirty_prev = old->dirty_prev;
+        fresh->dirty_next = old->dirty_next;
+        if (old->dirty_prev) old->dirty_prev->dirty_next = fresh;
+        else head_ = fresh;
+        if (old->dirty_next) old->dirty_next->dirty_prev = fresh;
+        else tail_ = fresh;
+        old->dirty_prev = nullptr;
+        old->dirty_next = nullptr;
+    }
+
+    /** Oldest dirty node, or nullptr. */
+    Node* front() const { return head_; }
+
+    size_t size() const { return size_.load(std::memory_order_relaxed); }
+    bool empty() const { return head_ == nullptr; }
+
+private:
+    Node* head_ = nullptr;
+    Node* tail_ = nullptr;
+    std::atomic<size_t> size_{0};
+};
+
 }  // namespace cache
 }  // namespace dcs
@@ -3,12 +3,14 @@
 #include "lru_cache.h"
 #include "../compat/threading.h"
 
-#include <array>
+#include <algorithm>
 #include <functional>
 #include <vector>
 #include <string>
+#include <string_view>
 #include <memory>
 #include <cstdint>
+#include <limits>
 
 namespace dcs {
 namespace cache {
@@ -16,67 +18,313 @@ namespace cache {
 /**
  * SegmentedCache — Thread-safe LRU cache with granular locking.
  *
- * The key space is divided into N_SEGMENTS independent segments, each
+ * The key space is divided into independent segments, each
  * with its own LRU cache and its own read-write lock.
  *
- * - GET acquires a shared (read) lock  -> concurrent reads don't block.
+ * - GET under the Clock policy (default) acquires a shared (read) lock
+ *   and only sets the entry's reference bit -> concurrent reads don't block.
+ *   Under the exact LRU and TinyLFU policies a hit relinks lists (and
+ *   TinyLFU bumps its frequency sketch), so GET is exclusive.
  * - PUT/DELETE acquires an exclusive (write) lock -> blocks only its segment.
  * - A write to key "A" in segment 3 does NOT block a read of key "B" in segment 7.
  *
- * Hashing: std::hash<string> mod N_SEGMENTS determines the segment.
+ * The segment count is fixed at construction and always a power of two,
+ * so the segment is picked with `hash & (count - 1)`.  By default it
+ * scales with the core count (see default_segment_count()).  Each
+ * segment sits on its own cache line so neighbouring segment locks do
+ * not false-share.
+ *
+ * Capacity is either an entry count split evenly across segments, or a
+ * global byte budget (maxmemory) that all segments draw from.  In budget
+ * mode a write that pushes usage over the limit samples a few segments
+ * and evicts from the one whose LRU tail is oldest, locking one segment
+ * at a time, until usage fits again.
+ *
+ * Keys with a TTL are expired lazily by the operations that touch them
+ * and actively by expire_cycle(), which drains each segment's own timing
+ * wheel under that segment's lock, a bounded amount per call.
  */
-static constexpr size_t N_SEGMENTS = 32;
+static constexpr size_t kCacheLineSize = 64;
 
 class SegmentedCache {
 public:
     /**
      * @param total_capacity  Total number of entries across all segments.
-     *                        Each segment gets total_capacity / N_SEGMENTS.
+     *                        Each segment gets total_capacity / segment count.
+     * @param policy          Replacement policy used by every segment.
+     * @param n_segments      Segment count, rounded up to a power of two;
+     *                        0 picks default_segment_count(total_capacity).
+     * @param max_memory      Global byte budget; when non-zero it replaces
+     *                        the entry-count limit.
      */
-    explicit SegmentedCache(size_t total_capacity = 65536) {
-        size_t per_segment = std::max<size_t>(1, total_capacity / N_SEGMENTS);
-        for (size_t i = 0; i < N_SEGMENTS; ++i) {
-            segments_[i].cache = std::make_unique<LRUCache>(per_segment);
+    explicit SegmentedCache(size_t total_capacity = 65536,
+                            EvictionPolicy policy = EvictionPolicy::Clock,
+                            size_t n_segments = 0,
+                            size_t max_memory = 0)
+        : policy_(policy)
+        , evictions_(0)
+        , drain_cursor_(0) {
+        n_segments_ = resolve_segment_count(n_segments, total_capacity);
+        mask_ = n_segments_ - 1;
+        if (max_memory) budget_ = std::make_unique<MemoryBudget>(max_memory);
+        segments_.reset(new Segment[n_segments_]);
+
+        size_t per_segment = budget_ ? std::numeric_limits<size_t>::max()
+                                     : std::max<size_t>(1, total_capacity / n_segments_);
+        for (size_t i = 0; i < n_segments_; ++i) {
+            segments_[i].cache = std::make_unique<LRUCache>(per_segment, policy, budget_.get());
         }
     }
 
+    /** Segment count a cache built with these arguments will use. */
+    static size_t resolve_segment_count(size_t requested, size_t total_capacity) {
+        return requested ? round_up_pow2(requested) : default_segment_count(total_capacity);
+    }
+
+    /**
+     * Four segments per hardware thread (so two cores rarely meet on one
+     * lock), clamped to [8, 1024] and reduced while segments would hold
+     * fewer than 64 entries — tiny segments make eviction order noisy.
+     */
+    static size_t default_segment_count(size_t total_capacity) {
+        size_t cores = compat::Thread::hardware_concurrency();
+        if (cores == 0) cores = 4;
+        size_t n = std::min<size_t>(1024, std::max<size_t>(8, round_up_pow2(cores * 4)));
+        while (n > 1 && total_capacity / n < 64) n >>= 1;
+        return n;
+    }
+
     // ── Core Operations ────────────────────────────────────────────
 
-    /** Thread-safe GET (lock on segment). */
-    CacheResult get(const std::string& key) {
+    /** Thread-safe GET (shared lock under Clock, exclusive under LRU). */
+    CacheResult get(std::string_view key) {
         auto& seg = segment_for(key);
-        compat::LockGuard<compat::Mutex> lock(seg.mutex);
+        if (policy_ == EvictionPolicy::Clock) {
+            bool expired = false;
+            CacheResult r = CacheResult::Miss();
+            {
+                compat::SharedLock<compat::SharedMutex> lock(seg.mutex);
+                r = seg.cache->get_shared(key, &expired);
+            }
+            if (expired) {
+                // Remove it now so a read-through miss can't race the expiry
+                compat::LockGuard<compat::SharedMutex> lock(seg.mutex);
+                seg.cache->expire_key(key);
+            }
+            return r;
+        }
+        compat::LockGuard<compat::SharedMutex> lock(seg.mutex);
         return seg.cache->get(key);
     }
 
-    /** Thread-safe PUT (lock on segment). */
-    void put(const std::string& key, const std::string& value) {
+    /** Thread-safe PUT (lock on segment, then budget eviction if needed). */
+    void put(std::string_view key, std::string_view value, uint64_t expire_at = 0) {
         auto& seg = segment_for(key);
-        compat::LockGuard<compat::Mutex> lock(seg.mutex);
-        seg.cache->put(key, value);
+        {
+            compat::LockGuard<compat::SharedMutex> lock(seg.mutex);
+            seg.cache->put(key, value, expire_at);
+        }
+        if (budget_ && budget_->over()) enforce_memory_budget();
     }
 
     /** Thread-safe DELETE (lock on segment). */
-    bool del(const std::string& key) {
+    bool del(std::string_view key) {
         auto& seg = segment_for(key);
-        compat::LockGuard<compat::Mutex> lock(seg.mutex);
+        compat::LockGuard<compat::SharedMutex> lock(seg.mutex);
         return seg.cache->del(key);
     }
 
-    /** Thread-safe EXISTS (lock on segment). */
-    bool exists(const std::string& key) {
+    /** Remove a key, returning its value and TTL deadline (no eviction callback). */
+    bool take(std::string_view key, std::string& value, uint64_t& expire_at) {
+        auto& seg = segment_for(key);
+        compat::LockGuard<compat::SharedMutex> lock(seg.mutex);
+        return seg.cache->take(key, value, expire_at);
+    }
+
+    /** PUT only if the key isn't live here; the check and insert share one lock. */
+    bool put_if_absent(std::string_view key, std::string_view value, uint64_t expire_at = 0) {
+        auto& seg = segment_for(key);
+        {
+            compat::LockGuard<compat::SharedMutex> lock(seg.mutex);
+            if (seg.cache->exists(key)) return false;
+            seg.cache->put(key, value, expire_at);
+        }
+        if (budget_ && budget_->over()) enforce_memory_budget();
+        return true;
+    }
+
+    /**
+     * Run the expiry path for a key that has no live entry, under its
+     * segment lock (so ordered against a write creating it).  False if
+     * the key is live.
+     */
+    bool expire_absent(std::string_view key) {
         auto& seg = segment_for(key);
-        compat::LockGuard<compat::Mutex> lock(seg.mutex);
+        compat::LockGuard<compat::SharedMutex> lock(seg.mutex);
+        return seg.cache->expire_absent(key);
+    }
+
+    /** Thread-safe EXISTS (shared lock on segment). */
+    bool exists(std::string_view key) {
+        auto& seg = segment_for(key);
+        compat::SharedLock<compat::SharedMutex> lock(seg.mutex);
         return seg.cache->exists(key);
     }
 
+    /** Read a value and its TTL deadline without touching recency (shared lock). */
+    bool peek(std::string_view key, std::string& value, uint64_t& expire_at) const {
+        auto& seg = segment_for(key);
+        compat::SharedLock<compat::SharedMutex> lock(seg.mutex);
+        return seg.cache->peek(key, value, expire_at);
+    }
+
+    // ── Batch Operations ───────────────────────────────────────────
+    // Keys are grouped by segment and each segment is locked once per
+    // batch, in ascending index order; results keep the callers' order.
+
+    /** Batch GET: one result per key (shared lock per segment under Clock). */
+    std::vector<CacheResult> get_many(const std::vector<std::string_view>& keys) {
+        std::vector<CacheResult> out(keys.size(), CacheResult::Miss());
+        for_each_segment_group(keys, [&](const Segment& seg, const uint32_t* idx, size_t n) {
+            if (policy_ != EvictionPolicy::Clock) {
+                compat::LockGuard<compat::SharedMutex> lock(seg.mutex);
+                for (size_t j = 0; j < n; ++j) out[idx[j]] = seg.cache->get(keys[idx[j]]);
+                return;
+            }
+            bool any_expired = false;
+            {
+                compat::SharedLock<compat::SharedMutex> lock(seg.mutex);
+                for (size_t j = 0; j < n; ++j) {
+                    bool expired = false;
+                    out[idx[j]] = seg.cache->get_shared(keys[idx[j]], &expired);
+                    any_expired |= expired;
+                }
+            }
+            if (any_expired) {
+                compat::LockGuard<compat::SharedMutex> lock(seg.mutex);
+                for (size_t j = 0; j < n; ++j) {
+                    if (!out[idx[j]].hit) seg.cache->expire_key(keys[idx[j]]);
+                }
+            }
+        });
+        return out;
+    }
+
+    /**
+     * Batch PUT (no TTL, like SET).  `dirty = false` marks the entries as
+     * already persisted (read-through fills) within the same lock hold.
+     */
+    void put_many(const std::vector<std::pair<std::string_view, std::string_view>>& entries,
+                  bool dirty = true) {
+        std::vector<std::string_view> keys;
+        keys.reserve(entries.size());
+        for (const auto& e : entries) keys.push_back(e.first);
+        for_each_segment_group(keys, [&](const Segment& seg, const uint32_t* idx, size_t n) {
+            compat::LockGuard<compat::SharedMutex> lock(seg.mutex);
+            for (size_t j = 0; j < n; ++j) {
+                const auto& e = entries[idx[j]];
+                seg.cache->put(e.first, e.second);
+                if (!dirty) seg.cache->clear_dirty(e.first);
+            }
+        });
+        if (budget_ && budget_->over()) enforce_memory_budget();
+    }
+
+    /** Batch DELETE; returns how many of the keys were present. */
+    size_t del_many(const std::vector<std::string_view>& keys) {
+        size_t removed = 0;
+        for_each_segment_group(keys, [&](const Segment& seg, const uint32_t* idx, size_t n) {
+            compat::LockGuard<compat::SharedMutex> lock(seg.mutex);
+            for (size_t j = 0; j < n; ++j) removed += seg.cache->del(keys[idx[j]]) ? 1 : 0;
+        });
+        return removed;
+    }
+
+    /** Batch EXISTS; counts duplicates as many times as they are given. */
+    size_t exists_many(const std::vector<std::string_view>& keys) const {
+        size_t found = 0;
+        for_each_segment_group(keys, [&](const Segment& seg, const uint32_t* idx, size_t n) {
+            compat::SharedLock<compat::SharedMutex> lock(seg.mutex);
+            for (size_t j = 0; j < n; ++j) found += seg.cache->exists(keys[idx[j]]) ? 1 : 0;
+        });
+        return found;
+    }
+
+    /** Clear dirty flags for keys persisted by a batch write-through. */
+    void clear_dirty_many(const std::vector<std::string_view>& keys) {
+        for_each_segment_group(keys, [&](const Segment& seg, const uint32_t* idx, size_t n) {
+            compat::LockGuard<compat::SharedMutex> lock(seg.mutex);
+            for (size_t j = 0; j < n; ++j) seg.cache->clear_dirty(keys[idx[j]]);
+        });
+    }
+
+    // ── Expiry ─────────────────────────────────────────────────────
+
+    /** Set a TTL deadline (steady_now_ms() base); false if the key is absent. */
+    bool expire(std::string_view key, uint64_t expire_at) {
+        auto& seg = segment_for(key);
+        compat::LockGuard<compat::SharedMutex> lock(seg.mutex);
+        return seg.cache->expire(key, expire_at);
+    }
+
+    bool persist(std::string_view key) {
+        auto& seg = segment_for(key);
+        compat::LockGuard<compat::SharedMutex> lock(seg.mutex);
+        return seg.cache->persist(key);
+    }
+
+    /** Remaining TTL in ms: -2 if absent, -1 if the key has no TTL. */
+    int64_t ttl_ms(std::string_view key) const {
+        auto& seg = segment_for(key);
+        compat::SharedLock<compat::SharedMutex> lock(seg.mutex);
+        return seg.cache->ttl_ms(key);
+    }
+
+    /**
+     * One active-expiry pass: every segment with armed timers advances its
+     * wheel, doing at most `max_work_per_segment` units under its lock.
+     * Returns the number of keys expired.
+     */
+    size_t expire_cycle(size_t max_work_per_segment) {
+        uint64_t now = steady_now_ms();
+        size_t expired = 0;
+        for (size_t i = 0; i < n_segments_; ++i) {
+            if (segments_[i].cache->pending_timers() == 0) continue;
+            compat::LockGuard<compat::SharedMutex> lock(segments_[i].mutex);
+            expired += segments_[i].cache->expire_due(now, max_work_per_segment);
+        }
+        return expired;
+    }
+
+    /** Set the expiry callback on all segments. */
+    void set_expiry_callback(ExpiryCallback cb) {
+        for (size_t i = 0; i < n_segments_; ++i) {
+            compat::LockGuard<compat::SharedMutex> lock(segments_[i].mutex);
+            segments_[i].cache->set_expiry_callback(cb);
+        }
+    }
+
+    /** Keys currently carrying a TTL. */
+    size_t volatile_count() const {
+        size_t total = 0;
+        for (size_t i = 0; i < n_segments_; ++i) total += segments_[i].cache->volatile_count();
+        return total;
+    }
+
+    /** Keys removed because their TTL ran out. */
+    uint64_t expired_count() const {
+        uint64_t total = 0;
+        for (size_t i = 0; i < n_segments_; ++i) total += segments_[i].cache->expired_count();
+        return total;
+    }
+
     // ── Bulk / Admin Operations ────────────────────────────────────
 
     /** Return total number of cached entries across all segments. */
     size_t size() const {
         size_t total = 0;
-        for (size_t i = 0; i < N_SEGMENTS; ++i) {
-            compat::LockGuard<compat::Mutex> lock(segments_[i].mutex);
+        for (size_t i = 0; i < n_segments_; ++i) {
+            compat::SharedLock<compat::SharedMutex> lock(segments_[i].mutex);
             total += segments_[i].cache->size();
         }
         return total;
@@ -84,9 +332,9 @@ public:
 
     /** Return per-segment entry counts (for dashboard heat map). */
     std::vector<size_t> segment_sizes() const {
-        std::vector<size_t> sizes(N_SEGMENTS);
-        for (size_t i = 0; i < N_SEGMENTS; ++i) {
-            compat::LockGuard<compat::Mutex> lock(segments_[i].mutex);
+        std::vector<size_t> sizes(n_segments_);
+        for (size_t i = 0; i < n_segments_; ++i) {
+            compat::SharedLock<compat::SharedMutex> lock(segments_[i].mutex);
             sizes[i] = segments_[i].cache->size();
         }
         return sizes;
@@ -95,9 +343,44 @@ public:
     /** Return all keys (acquires lock on each segment). */
     std::vector<std::string> keys() const {
         std::vector<std::string> all;
-        for (size_t i = 0; i < N_SEGMENTS; ++i) {
-            compat::LockGuard<compat::Mutex> lock(segments_[i].mutex);
-            auto seg_keys = segments_[i].cache->keys();
+        for (size_t i = 0; i < n_segments_; ++i) {
+            auto seg_keys = segment_keys(i);
+            all.insert(all.end(), seg_keys.begin(), seg_keys.end());
+        }
+        return all;
+    }
+
+    /** Keys of one segment, under that segment's lock only (SCAN). */
+    std::vector<std::string> segment_keys(size_t index) const {
+        if (index >= n_segments_) return {};
+        compat::SharedLock<compat::SharedMutex> lock(segments_[index].mutex);
+        return segments_[index].cache->keys();
+    }
+
+    /**
+     * Keys not yet known to the backend (dirty or in flight) that start
+     * with `prefix` and sort after `after`, ascending.  Segments with
+     * nothing unpersisted are skipped without locking.
+     */
+    std::vector<std::string> unpersisted_keys(std::string_view prefix, std::string_view after) const {
+        std::vector<std::string> out;
+        for (size_t i = 0; i < n_segments_; ++i) {
+            const LRUCache& cache = *segments_[i].cache;
+            if (cache.dirty_count() == 0 && cache.in_flight_count() == 0) continue;
+            compat::SharedLock<compat::SharedMutex> lock(segments_[i].mutex);
+            cache.unpersisted_keys(prefix, after, out);
+        }
+        std::sort(out.begin(), out.end());
+        return out;
+    }
+
+    /** Up to `limit` hot keys, an even share from each segment. */
+    std::vector<std::string> hot_keys(size_t limit) const {
+        std::vector<std::string> all;
+        size_t share = (limit + n_segments_ - 1) / n_segments_;
+        for (size_t i = 0; i < n_segments_ && all.size() < limit; ++i) {
+            compat::SharedLock<compat::SharedMutex> lock(segments_[i].mutex);
+            auto seg_keys = segments_[i].cache->hot_keys(std::min(share, limit - all.size()));
             all.insert(all.end(), seg_keys.begin(), seg_keys.end());
         }
         return all;
@@ -109,55 +392,252 @@ public:
      */
     std::vector<std::pair<std::string, std::string>> dirty_entries() const {
         std::vector<std::pair<std::string, std::string>> all;
-        for (size_t i = 0; i < N_SEGMENTS; ++i) {
-            compat::LockGuard<compat::Mutex> lock(segments_[i].mutex);
+        for (size_t i = 0; i < n_segments_; ++i) {
+            compat::SharedLock<compat::SharedMutex> lock(segments_[i].mutex);
             auto seg_dirty = segments_[i].cache->dirty_entries();
             all.insert(all.end(), seg_dirty.begin(), seg_dirty.end());
         }
         return all;
     }
 
+    /**
+     * Move up to `max` of the oldest dirty entries into `out`, in flight
+     * until settle_flush() (for incremental write-back).  Segments are
+     * visited in order, each call starting one segment further along
+     * than the last, each under its own lock for at most one bounded
+     * batch, so writers elsewhere never wait and a busy segment cannot
+     * keep the others out of every batch.  Clean
+     * segments are skipped without locking.  Returns how many entries
+     * left the dirty lists (expired ones are dropped, so this can exceed
+     * out.size()).
+     */
+    size_t drain_dirty(size_t max, std::vector<DirtyEntry>& out) {
+        size_t taken = 0;
+        size_t start = static_cast<size_t>(drain_cursor_.fetch_add(1));
+        for (size_t n = 0; n < n_segments_ && taken < max; ++n) {
+            Segment& seg = segments_[(start + n) & mask_];
+            if (seg.cache->dirty_count() == 0) continue;
+            compat::LockGuard<compat::SharedMutex> lock(seg.mutex);
+            taken += seg.cache->drain_dirty(max - taken, out);
+        }
+        return taken;
+    }
+
+    /** End a drained key's in-flight state once its batch is stored or failed. */
+    void settle_flush(std::string_view key, bool stored) {
+        auto& seg = segment_for(key);
+        compat::LockGuard<compat::SharedMutex> lock(seg.mutex);
+        seg.cache->settle_flush(key, stored);
+    }
+
+    /** Queue a live key for write-back as it stands (see LRUCache::mark_dirty). */
+    bool mark_dirty(std::string_view key) {
+        auto& seg = segment_for(key);
+        compat::LockGuard<compat::SharedMutex> lock(seg.mutex);
+        return seg.cache->mark_dirty(key);
+    }
+
+    /** Entries awaiting write-back, summed without taking segment locks. */
+    size_t dirty_count() const {
+        size_t total = 0;
+        for (size_t i = 0; i < n_segments_; ++i) total += segments_[i].cache->dirty_count();
+        return total;
+    }
+
+    /** Age in ms of the oldest write not yet handed to write-back (0 if none). */
+    uint64_t flush_lag_ms() const {
+        uint32_t now = static_cast<uint32_t>(steady_now_ms());
+        uint32_t lag = 0;
+        for (size_t i = 0; i < n_segments_; ++i) {
+            if (segments_[i].cache->dirty_count() == 0) continue;
+            compat::SharedLock<compat::SharedMutex> lock(segments_[i].mutex);
+            uint32_t since;
+            if (segments_[i].cache->oldest_dirty_since(since)) lag = std::max(lag, now - since);
+        }
+        return lag;
+    }
+
     /** Clear dirty flag on a key after it has been persisted. */
-    void clear_dirty(const std::string& key) {
+    void clear_dirty(std::string_view key) {
         auto& seg = segment_for(key);
-        compat::LockGuard<compat::Mutex> lock(seg.mutex);
+        compat::LockGuard<compat::SharedMutex> lock(seg.mutex);
         seg.cache->clear_dirty(key);
     }
 
     /** Set eviction callback on all segments. */
     void set_eviction_callback(EvictionCallback cb) {
-        for (size_t i = 0; i < N_SEGMENTS; ++i) {
-            compat::LockGuard<compat::Mutex> lock(segments_[i].mutex);
+        for (size_t i = 0; i < n_segments_; ++i) {
+            compat::LockGuard<compat::SharedMutex> lock(segments_[i].mutex);
             segments_[i].cache->set_eviction_callback(cb);
         }
     }
 
+    /** Bytes held for entries across all segments (see LRUCache::memory_bytes). */
+    size_t memory_bytes() const {
+        size_t total = 0;
+        for (size_t i = 0; i < n_segments_; ++i) {
+            compat::SharedLock<compat::SharedMutex> lock(segments_[i].mutex);
+            total += segments_[i].cache->memory_bytes();
+        }
+        return total;
+    }
+
+    /** Key + value bytes stored across all segments. */
+    size_t payload_bytes() const {
+        size_t total = 0;
+        for (size_t i = 0; i < n_segments_; ++i) {
+            compat::SharedLock<compat::SharedMutex> lock(segments_[i].mutex);
+            total += segments_[i].cache->payload_bytes();
+        }
+        return total;
+    }
+
+    /** Byte budget in force (0 in entry-count mode). */
+    size_t max_memory() const { return budget_ ? budget_->limit() : 0; }
+
+    /** Bytes charged against the budget (entry blocks + index nodes). */
+    size_t used_memory() const {
+        if (budget_) return budget_->used();
+        size_t total = 0;
+        for (size_t i = 0; i < n_segments_; ++i) total += segments_[i].cache->charged_bytes();
+        return total;
+    }
+
+    /** Inserts rejected by TinyLFU admission, summed over segments. */
+    uint64_t admission_rejections() const {
+        uint64_t total = 0;
+        for (size_t i = 0; i < n_segments_; ++i) total += segments_[i].cache->admission_rejections();
+        return total;
+    }
+
+    /** Entries evicted to honour the byte budget. */
+    uint64_t budget_evictions() const { return evictions_.load(); }
+
+    EvictionPolicy policy() const { return policy_; }
+    size_t segment_count() const { return n_segments_; }
+
+    /** Segment index a key maps to (for per-segment telemetry). */
+    size_t segment_index(std::string_view key) const {
+        return hasher_(key) & mask_;
+    }
+
     /** Flush all segments (for graceful shutdown). */
     void clear() {
-        for (size_t i = 0; i < N_SEGMENTS; ++i) {
-            compat::LockGuard<compat::Mutex> lock(segments_[i].mutex);
+        for (size_t i = 0; i < n_segments_; ++i) {
+            compat::LockGuard<compat::SharedMutex> lock(segments_[i].mutex);
             segments_[i].cache->clear();
         }
     }
 
 private:
-    struct Segment {
-        mutable compat::Mutex mutex;
+    struct alignas(kCacheLineSize) Segment {
+        mutable compat::SharedMutex mutex;
         std::unique_ptr<LRUCache> cache;
     };
 
-    Segment& segment_for(const std::string& key) {
-        size_t idx = hasher_(key) % N_SEGMENTS;
-        return segments_[idx];
+    static constexpr size_t kVictimSamples = 5;
+
+    /**
+     * Evict until usage is back under maxmemory.  Each round samples up to
+     * kVictimSamples segments (shared locks, one at a time), picks the one
+     * whose eviction candidate was touched longest ago, and evicts a
+     * single entry from it under its exclusive lock.
+     */
+    void enforce_memory_budget() {
+        size_t empty_rounds = 0;
+        while (budget_->over() && empty_rounds < n_segments_) {
+            size_t victim = pick_victim();
+            bool evicted;
+            {
+                compat::LockGuard<compat::SharedMutex> lock(segments_[victim].mutex);
+                evicted = segments_[victim].cache->evict_one();
+            }
+            if (evicted) {
+                evictions_++;
+                empty_rounds = 0;
+            } else {
+                ++empty_rounds;
+            }
+        }
+    }
+
+    size_t pick_victim() const {
+        static thread_local uint64_t rng = 0x9E3779B97F4A7C15ull ^
+            reinterpret_cast<uintptr_t>(&rng);
+        size_t samples = std::min(kVictimSamples, n_segments_);
+        size_t best = 0;
+        uint32_t best_age = 0;
+        bool found = false;
+        uint32_t now = MemoryBudget::now_tick();
+        for (size_t i = 0; i < samples; ++i) {
+            rng ^= rng << 13; rng ^= rng >> 7; rng ^= rng << 17;
+            size_t idx = static_cast<size_t>(rng) & mask_;
+            uint32_t tick;
+            bool has;
+            {
+                compat::SharedLock<compat::SharedMutex> lock(segments_[idx].mutex);
+                has = segments_[idx].cache->tail_tick(tick);
+            }
+            if (!has) continue;
+            uint32_t age = now - tick;  // wrap-safe
+            if (!found || age > best_age) {
+                best = idx;
+                best_age = age;
+                found = true;
+            }
+        }
+        if (found) return best;
+        // Sampled segments were all empty — fall back to the largest one
+        for (size_t i = 0; i < n_segments_; ++i) {
+            if (segments_[i].cache->charged_bytes() > segments_[best].cache->charged_bytes()) best = i;
+        }
+        return best;
+    }
+
+    /**
+     * Call fn(segment, indices, count) once per segment touched by `keys`,
+     * segments in ascending order, indices in input order within each.
+     */
+    template <typename Fn>
+    void for_each_segment_group(const std::vector<std::string_view>& keys, Fn&& fn) const {
+        std::vector<std::pair<uint32_t, uint32_t>> order;   // (segment, key index)
+        order.reserve(keys.size());
+        for (size_t i = 0; i < keys.size(); ++i) {
+            order.emplace_back(static_cast<uint32_t>(segment_index(keys[i])), static_cast<uint32_t>(i));
+        }
+        std::sort(order.begin(), order.end());
+        std::vector<uint32_t> idx(order.size());
+        for (size_t i = 0; i < order.size(); ++i) idx[i] = order[i].second;
+        for (size_t begin = 0; begin < order.size();) {
+            size_t end = begin;
+            while (end < order.size() && order[end].first == order[begin].first) ++end;
+            fn(segments_[order[begin].first], idx.data() + begin, end - begin);
+            begin = end;
+        }
+    }
+
+    static size_t round_up_pow2(size_t n) {
+        size_t p = 1;
+        while (p < n) p <<= 1;
+        return p;
+    }
+
+    Segment& segment_for(std::string_view key) {
+        return segments_[hasher_(key) & mask_];
     }
 
-    const Segment& segment_for(const std::string& key) const {
-        size_t idx = hasher_(key) % N_SEGMENTS;
-        return segments_[idx];
+    const Segment& segment_for(std::string_view key) const {
+        return segments_[hasher_(key) & mask_];
     }
 
-    std::array<Segment, N_SEGMENTS> segments_;
-    std::hash<std::string> hasher_;
+    EvictionPolicy policy_;
+    std::unique_ptr<MemoryBudget> budget_;   // declared before segments_: outlives them
+    compat::Atomic<uint64_t> evictions_;
+    compat::Atomic<uint64_t> drain_cursor_;
+    size_t n_segments_;
+    size_t mask_;
+    std::unique_ptr<Segment[]> segments_;
+    std::hash<std::string_view> hasher_;
 };
 
 }  // namespace cache
@@ -0,0 +1,137 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace dcs {
+namespace cache {
+
+/**
+ * SlabAllocator — size-class allocator for cache entries.
+ *
+ * Blocks are carved out of per-class pages and recycled through an
+ * intrusive free list, so an insert/evict cycle costs a pointer pop/push
+ * instead of three malloc/free pairs.  One allocator belongs to one
+ * segment and is only touched under that segment's exclusive lock —
+ * it does no locking of its own.
+ *
+ * Size classes step by 16 bytes up to 128, then four classes per power
+ * of two (≤ 25% internal waste) up to kMaxSlabBlock.  Larger requests go
+ * straight to operator new and are tagged kLargeClass.
+ */
+class SlabAllocator {
+public:
+    static constexpr size_t  kMaxSlabBlock = 16 * 1024;
+    static constexpr size_t  kMaxPageBytes = 64 * 1024;
+    static constexpr uint8_t kLargeClass   = 0xFF;
+
+    SlabAllocator() : classes_(class_table().size()) {}
+
+    SlabAllocator(const SlabAllocator&) = delete;
+    SlabAllocator& operator=(const SlabAllocator&) = delete;
+
+    /** Size-class index for a request of `bytes`, or kLargeClass. */
+    static uint8_t class_for(size_t bytes) {
+        const auto& table = class_table();
+        auto it = std::lower_bound(table.begin(), table.end(), bytes);
+        if (it == table.end()) return kLargeClass;
+        return static_cast<uint8_t>(it - table.begin());
+    }
+
+    /** Usable bytes of a block in class `cls` (`bytes` for large blocks). */
+    static size_t block_size(uint8_t cls, size_t bytes) {
+        return cls == kLargeClass ? bytes : class_table()[cls];
+    }
+
+    /** Allocate a block of at least `bytes`; `cls` receives its class. */
+    void* allocate(size_t bytes, uint8_t& cls) {
+        cls = class_for(bytes);
+        if (cls == kLargeClass) {
+            large_bytes_ += bytes;
+            in_use_bytes_ += bytes;
+            return ::operator new(bytes);
+        }
+        SizeClass& sc = classes_[cls];
+        if (!sc.free_list) refill(cls);
+        FreeBlock* b = sc.free_list;
+        sc.free_list = b->next;
+        in_use_bytes_ += class_table()[cls];
+        return b;
+    }
+
+    /** Return a block; `bytes` must match the original request for large blocks. */
+    void deallocate(void* p, uint8_t cls, size_t bytes) {
+        if (cls == kLargeClass) {
+            large_bytes_ -= bytes;
+            in_use_bytes_ -= bytes;
+            ::operator delete(p);
+            return;
+        }
+        auto* b = static_cast<FreeBlock*>(p);
+        b->next = classes_[cls].free_list;
+        classes_[cls].free_list = b;
+        in_use_bytes_ -= class_table()[cls];
+    }
+
+    /** Bytes obtained from the system (slab pages + large blocks). */
+    size_t bytes_reserved() const { return page_bytes_ + large_bytes_; }
+
+    /** Bytes currently handed out, rounded up to block sizes. */
+    size_t bytes_in_use() const { return in_use_bytes_; }
+
+private:
+    struct FreeBlock { FreeBlock* next; };
+
+    struct SizeClass {
+        FreeBlock* free_list = nullptr;
+        size_t     next_page = 0;   // bytes for the next page (grows ×2)
+        std::vector<std::unique_ptr<char[]>> pages;
+    };
+
+    static const std::vector<size_t>& class_table() {
+        static const std::vector<size_t> table = [] {
+            std::vector<size_t> t;
+            for (size_t s = 32; s <= 128; s += 16) t.push_back(s);
+            for (size_t base = 128; base < kMaxSlabBlock; base *= 2) {
+                for (size_t q = 1; q <= 4; ++q) t.push_back(base + base * q / 4);
+            }
+            return t;
+        }();
+        return table;
+    }
+
+    /**
+     * Carve a fresh page into blocks.  The first page of a class holds
+     * eight blocks so small caches stay small; pages then double up to
+     * kMaxPageBytes (or four blocks, for the largest classes).
+     */
+    void refill(uint8_t cls) {
+        size_t block = class_table()[cls];
+        SizeClass& sc = classes_[cls];
+        if (sc.next_page == 0) sc.next_page = block * 8;
+        size_t page = sc.next_page;
+        sc.next_page = std::min(page * 2, std::max(kMaxPageBytes, block * 4));
+
+        size_t count = page / block;
+        sc.pages.emplace_back(new char[count * block]);
+        char* base = sc.pages.back().get();
+        page_bytes_ += count * block;
+
+        for (size_t i = count; i-- > 0;) {
+            auto* b = reinterpret_cast<FreeBlock*>(base + i * block);
+            b->next = sc.free_list;
+            sc.free_list = b;
+        }
+    }
+
+    std::vector<SizeClass> classes_;
+    size_t page_bytes_   = 0;
+    size_t large_bytes_  = 0;
+    size_t in_use_bytes_ = 0;
+};
+
+}  // namespace cache
+}  // namespace dcs
@@ -0,0 +1,130 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace dcs {
+namespace cache {
+
+/** Monotonic milliseconds; the time base for Node::expire_at. */
+inline uint64_t steady_now_ms() {
+    using namespace std::chrono;
+    return static_cast<uint64_t>(
+        duration_cast<milliseconds>(steady_clock::now().time_since_epoch()).count());
+}
+
+/**
+ * TimingWheel — hierarchical timer wheel for key expiry (one per segment).
+ *
+ * Four levels of 64 slots over 10 ms ticks: level 0 covers the next
+ * 640 ms at tick resolution, level 1 the next ~41 s, level 2 ~44 min and
+ * level 3 ~46 h; later deadlines park in the farthest level-3 slot and
+ * are re-filed when it comes round.  Scheduling is O(1); when the wheel
+ * crosses a level boundary the next coarser slot is cascaded down.
+ *
+ * Timers hold a copy of the key rather than a Node pointer, so entries
+ * can be updated, deleted or evicted without unlinking their timer.  The
+ * owner checks the live entry's deadline when a timer fires and ignores
+ * stale ones.  Not thread-safe — used under the segment's exclusive lock.
+ */
+class TimingWheel {
+public:
+    static constexpr uint64_t kTickMs   = 10;
+    static constexpr size_t   kSlotBits = 6;
+    static constexpr size_t   kSlots    = size_t(1) << kSlotBits;
+    static constexpr size_t   kLevels   = 4;
+
+    explicit TimingWheel(uint64_t now_ms) : current_(now_ms / kTickMs), pending_(0) {}
+
+    /** Arm a timer for `key` at `deadline_ms` (steady_now_ms() base). */
+    void schedule(std::string_view key, uint64_t deadline_ms, uint64_t now_ms) {
+        // An idle wheel may be far behind the clock; resync so we don't
+        // spin through empty ticks on the next advance().
+        if (pending_ == 0) current_ = now_ms / kTickMs;
+        file(Timer{std::string(key), (deadline_ms + kTickMs - 1) / kTickMs});
+        ++pending_;
+    }
+
+    /**
+     * Fire timers due by `now_ms`, calling on_due(key) for each.  Stops
+     * after `max_work` units (one per tick advanced, timer fired or timer
+     * re-filed) so a burst of expiries is spread over several calls.
+     * Returns the number of timers fired.
+     */
+    template <typename OnDue>
+    size_t advance(uint64_t now_ms, size_t max_work, OnDue&& on_due) {
+        const uint64_t target = now_ms / kTickMs;
+        size_t work = 0, fired = 0;
+        while (work < max_work) {
+            auto& slot = wheel_[0][current_ & (kSlots - 1)];
+            while (!slot.empty() && work < max_work) {
+                Timer t = std::move(slot.back());
+                slot.pop_back();
+                ++work;
+                if (t.deadline_tick > current_) {
+                    file(std::move(t));   // parked beyond the top level
+                    continue;
+                }
+                --pending_;
+                ++fired;
+                on_due(t.key);
+            }
+            if (!slot.empty() || current_ >= target) break;
+            ++current_;
+            ++work;
+            work += cascade();
+        }
+        return fired;
+    }
+
+    /** Timers armed and not yet fired (includes stale ones). */
+    size_t pending() const { return pending_; }
+
+private:
+    struct Timer {
+        std::string key;
+        uint64_t    deadline_tick;
+    };
+
+    void file(Timer t) {
+        uint64_t delta = t.deadline_tick > current_ ? t.deadline_tick - current_ : 0;
+        for (size_t level = 0; level < kLevels; ++level) {
+            if (delta < (uint64_t(1) << (kSlotBits * (level + 1)))) {
+                size_t idx = (std::max(t.deadline_tick, current_) >> (kSlotBits * level)) & (kSlots - 1);
+                wheel_[level][idx].push_back(std::move(t));
+                return;
+            }
+        }
+        // Beyond the wheel's horizon: the slot just behind the top-level
+        // hand is the last one to come round.
+        size_t top = kLevels - 1;
+        size_t idx = ((current_ >> (kSlotBits * top)) - 1) & (kSlots - 1);
+        wheel_[top][idx].push_back(std::move(t));
+    }
+
+    /** Re-file the coarser slots whose span starts at the current tick. */
+    size_t cascade() {
+        size_t moved = 0;
+        for (size_t level = 1; level < kLevels; ++level) {
+            if (current_ & ((uint64_t(1) << (kSlotBits * level)) - 1)) break;
+            auto& slot = wheel_[level][(current_ >> (kSlotBits * level)) & (kSlots - 1)];
+            std::vector<Timer> timers;
+            timers.swap(slot);
+            for (auto& t : timers) file(std::move(t));
+            moved += timers.size();
+        }
+        return moved;
+    }
+
+    std::vector<Timer> wheel_[kLevels][kSlots];
+    uint64_t current_;   // last tick processed
+    size_t   pending_;
+};
+
+}  // namespace cache
+}  // namespace dcs
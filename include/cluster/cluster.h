@@ -0,0 +1,475 @@
+#pragma once
+
+#include "remote.h"
+#include "slot_map.h"
+#include "../ml/predictive_sharder.h"
+#include "../sync/cache_manager.h"
+#include "../compat/threading.h"
+
+#include <algorithm>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace dcs {
+namespace cluster {
+
+struct ClusterOptions {
+    size_t migrate_batch      = 256;    // keys per IMPORT round trip
+    size_t max_slots_per_move = 64;     // one rebalance moves at most this many slots...
+    float  max_move_share     = 0.5f;   // ...carrying at most this share of the node's traffic
+};
+
+/**
+ * Cluster — one node's membership in a hash-slot cluster: which slots it
+ * serves, how to redirect requests for the rest, and online migration
+ * of slots to other nodes.
+ *
+ * Requests are routed before they execute (see route()).  A slot moves
+ * while both nodes keep serving it:
+ *   1. the target marks it importing, the source marks it migrating;
+ *   2. the source streams its keys in batches, removing each batch
+ *      locally as it is taken; a request for a key it no longer holds
+ *      gets ASK, so new writes land on the target.  A second pass
+ *      sweeps up writes that were already past routing meanwhile;
+ *   3. ownership flips on the target, then here, then on the other
+ *      nodes, and a last sweep catches writes racing the flip.
+ * The target keeps a key it already holds rather than an imported copy:
+ * a local copy can only come from an ASK write, which is newer.
+ */
+class Cluster {
+public:
+    using TargetFactory = std::function<std::unique_ptr<SlotTarget>(const NodeAddress&)>;
+
+    enum class Verdict { Local, Moved, Ask, TryAgain, CrossSlot, Down };
+
+    struct Decision {
+        Verdict     verdict = Verdict::Local;
+        uint16_t    slot = 0;
+        std::string endpoint;   // host:port for Moved / Ask
+    };
+
+    Cluster(sync::CacheManager* manager, int self_id, const ClusterOptions& options = ClusterOptions())
+        : manager_(manager)
+        , options_(options)
+        , map_(self_id)
+        , heat_(new compat::Atomic<uint32_t>[kSlotCount])
+        , ops_(0)
+        , keys_moved_(0)
+        , slots_moved_(0)
+        , factory_([](const NodeAddress& n) { return std::unique_ptr<SlotTarget>(new RespSlotTarget(n)); }) {
+        for (size_t i = 0; i < kSlotCount; ++i) heat_[i].store(0);
+    }
+
+    Cluster(const Cluster&) = delete;
+    Cluster& operator=(const Cluster&) = delete;
+
+    SlotMap& slots() { return map_; }
+    const SlotMap& slots() const { return map_; }
+    int self() const { return map_.self(); }
+
+    /** How to reach other nodes (RESP by default; tests wire nodes in-process). */
+    void set_target_factory(TargetFactory factory) { factory_ = std::move(factory); }
+
+    // ── Routing ────────────────────────────────────────────────────
+
+    /**
+     * Decide where a command on `keys` runs.  All keys must share a
+     * slot.  A migrating slot is served here only for keys still here
+     * (none: ASK the target; some: TRYAGAIN); an importing slot only
+     * after ASKING.  Local decisions count toward the slot's heat.
+     */
+    Decision route(const std::vector<std::string_view>& keys, bool asking) {
+        Decision d;
+        if (keys.empty()) return d;
+        d.slot = key_slot(keys[0]);
+        for (size_t i = 1; i < keys.size(); ++i) {
+            if (key_slot(keys[i]) != d.slot) {
+                d.verdict = Verdict::CrossSlot;
+                return d;
+            }
+        }
+        SlotRoute r = map_.route(d.slot);
+        if (r.owner == self()) {
+            if (r.state == SlotState::Migrating) {
+                size_t here = 0;
+                for (auto k : keys) here += manager_->contains(std::string(k)) ? 1 : 0;
+                if (here == 0) return redirect(d, Verdict::Ask, r.peer);
+                if (here < keys.size()) {
+                    d.verdict = Verdict::TryAgain;
+                    return d;
+                }
+            }
+            return local(d);
+        }
+        if (r.state == SlotState::Importing && asking) return local(d);
+        if (r.owner < 0) {
+            d.verdict = Verdict::Down;
+            return d;
+        }
+        return redirect(d, Verdict::Moved, r.owner);
+    }
+
+    // ── Migration ──────────────────────────────────────────────────
+
+    /**
+     * Move `slots` (those this node owns and isn't already moving) to
+     * node `to`, blocking until done.  Returns the slots whose ownership
+     * changed.  A slot whose stream fails stays (or goes back to)
+     * migrating, so requests keep finding keys on either side; calling
+     * again resumes it.
+     */
+    std::vector<uint16_t> migrate_slots(const std::vector<uint16_t>& slots, int to) {
+        compat::LockGuard<compat::Mutex> one(migrate_mu_);
+        std::vector<uint16_t> moved;
+        NodeAddress addr;
+        if (to == self() || !map_.node(to, addr)) return moved;
+        std::unique_ptr<SlotTarget> target = factory_(addr);
+
+        std::vector<bool> moving(kSlotCount, false);
+        std::vector<uint16_t> started;
+        for (uint16_t slot : slots) {
+            SlotRoute r = map_.route(slot);
+            if (r.owner != self() || moving[slot]) continue;
+            if (r.state == SlotState::Migrating && r.peer != to) continue;
+            if (!target->set_importing(slot, self()) || !map_.set_migrating(slot, to)) continue;
+            moving[slot] = true;
+            started.push_back(slot);
+        }
+        if (started.empty()) return moved;
+
+        // One walk of the key space finds the keys of every moving slot;
+        // a second sweeps up writes that were already past routing when
+        // the first began.  Both run while the slot is still migrating, so
+        // a failed stream puts its batch back where requests still find it.
+        std::vector<bool> failed(kSlotCount, false);
+        for (int pass = 0; pass < 2; ++pass) {
+            auto by_slot = collect(moving);
+            for (uint16_t slot : started) {
+                if (failed[slot]) continue;
+                if (!stream(*target, slot, by_slot[slot])) {
+                    failed[slot] = true;
+                    moving[slot] = false;
+                }
+            }
+        }
+
+        // Flip ownership target-first so a redirected client never
+        // bounces back.
+        std::vector<bool> flipped(kSlotCount, false);
+        for (uint16_t slot : started) {
+            if (failed[slot] || !target->set_owner(slot, to)) continue;
+            map_.set_owner(slot, to);
+            flipped[slot] = true;
+            moved.push_back(slot);
+        }
+        if (moved.empty()) return moved;
+
+        // Anything still here was written in the instant between the last
+        // sweep and the flip.  If it can't be handed over, the slot goes
+        // back to migrating from this node: the keys stay reachable here
+        // and calling again resumes the move.
+        auto stragglers = collect(flipped);
+        for (uint16_t slot : moved) {
+            if (stragglers[slot].empty() || stream(*target, slot, stragglers[slot])) continue;
+            std::cerr << "[Cluster] Slot " << slot << " sweep failed; taking it back as migrating\n";
+            if (target->set_owner(slot, self())) target->set_importing(slot, self());
+            map_.set_owner(slot, self());
+            map_.set_migrating(slot, to);
+            flipped[slot] = false;
+        }
+        moved.erase(std::remove_if(moved.begin(), moved.end(),
+                                   [&](uint16_t slot) { return !flipped[slot]; }),
+                    moved.end());
+        if (moved.empty()) return moved;
+        announce(moved, to);
+        slots_moved_.fetch_add(moved.size());
+        std::cout << "[Cluster] Moved " << moved.size() << " slot(s) to node " << to << "\n";
+        return moved;
+    }
+
+    /**
+     * Target side of a migration: store a batch for `slot`.  Refused
+     * (-1) unless the slot is importing here or already owned here.
+     */
+    int64_t import(uint16_t slot, const std::vector<MovedEntry>& batch) {
+        SlotRoute r = map_.route(slot);
+        if (r.owner != self() && r.state != SlotState::Importing) return -1;
+        int64_t stored = 0;
+        for (const auto& e : batch) {
+            if (key_slot(e.key) != slot) continue;
+            if (manager_->import_entry(e.key, e.value, e.ttl_ms)) ++stored;
+        }
+        return stored;
+    }
+
+    // ── Load and rebalancing ───────────────────────────────────────
+
+    /** Requests served locally so far (CLUSTER LOAD). */
+    uint64_t ops() const { return ops_.load(); }
+    uint64_t keys_moved() const { return keys_moved_.load(); }
+    uint64_t slots_moved() const { return slots_moved_.load(); }
+    uint32_t slot_heat(uint16_t slot) const { return heat_[slot % kSlotCount].load(); }
+
+    /** Requests served by node `id` so far (this node's own count, or CLUSTER LOAD). */
+    bool node_ops(int id, uint64_t& ops) {
+        if (id == self()) {
+            ops = ops_.load();
+            return true;
+        }
+        NodeAddress addr;
+        if (!map_.node(id, addr)) return false;
+        auto target = factory_(addr);
+        return target->load(ops);
+    }
+
+    /**
+     * Act on a sharder recommendation whose shards are node ids: if this
+     * node is the overloaded one, move its hottest slots to the
+     * recommended node.  The share of traffic moved closes half the
+     * predicted gap, scaled by the model's confidence.  Heat is halved
+     * afterwards so the next decision favours recent traffic.
+     */
+    std::vector<uint16_t> rebalance(const ml::MigrationRecommendation& rec) {
+        std::vector<uint16_t> moved;
+        if (rec.from_shard != self() || rec.to_shard == self()) return moved;
+        float from = std::max(rec.predicted_load_from, 1e-6f);
+        float share = std::min(options_.max_move_share,
+                               std::max(0.0f, rec.predicted_load_from - rec.predicted_load_to) / (2 * from));
+        share *= std::min(1.0f, std::max(0.0f, rec.confidence));
+        auto hot = hottest_slots(share);
+        if (!hot.empty()) moved = migrate_slots(hot, rec.to_shard);
+        decay_heat();
+        return moved;
+    }
+
+    /**
+     * The hottest owned slots together carrying up to `share` of this
+     * node's slot traffic (at least one if any is hot), capped at
+     * max_slots_per_move.  One owned slot is always left behind.
+     */
+    std::vector<uint16_t> hottest_slots(float share) const {
+        std::vector<std::pair<uint32_t, uint16_t>> owned;
+        uint64_t total = 0;
+        for (uint16_t slot : map_.slots_of(self())) {
+            uint32_t h = heat_[slot].load();
+            total += h;
+            if (h) owned.emplace_back(h, slot);
+        }
+        std::vector<uint16_t> out;
+        if (owned.empty() || share <= 0) return out;
+        std::sort(owned.begin(), owned.end(), [](const std::pair<uint32_t, uint16_t>& a,
+                                                 const std::pair<uint32_t, uint16_t>& b) {
+            return a.first > b.first;
+        });
+        size_t keep = map_.slots_of(self()).size() - 1;
+        uint64_t budget = static_cast<uint64_t>(share * static_cast<float>(total));
+        uint64_t taken = 0;
+        for (const auto& o : owned) {
+            if (out.size() >= std::min(options_.max_slots_per_move, keep)) break;
+            if (!out.empty() && taken + o.first > budget) break;
+            out.push_back(o.second);
+            taken += o.first;
+        }
+        return out;
+    }
+
+    void decay_heat() {
+        for (size_t i = 0; i < kSlotCount; ++i) heat_[i].store(heat_[i].load() / 2);
+    }
+
+private:
+    Decision local(Decision& d) {
+        heat_[d.slot].fetch_add(1);
+        ops_.fetch_add(1);
+        return d;
+    }
+
+    Decision redirect(Decision& d, Verdict v, int node) {
+        NodeAddress addr;
+        if (!map_.node(node, addr)) {
+            d.verdict = Verdict::Down;
+            return d;
+        }
+        d.verdict = v;
+        d.endpoint = addr.endpoint();
+        return d;
+    }
+
+    std::unordered_map<uint16_t, std::vector<std::string>> collect(const std::vector<bool>& mask) {
+        std::unordered_map<uint16_t, std::vector<std::string>> by_slot;
+        for (auto& k : manager_->keys_where([&](const std::string& key) { return mask[key_slot(key)]; })) {
+            uint16_t slot = key_slot(k);
+            by_slot[slot].push_back(std::move(k));
+        }
+        return by_slot;
+    }
+
+    /**
+     * Hand `keys` of `slot` to the target in batches.  A batch is taken
+     * out of this node first; if the target can't be reached it is put
+     * back and the stream stops.
+     */
+    bool stream(SlotTarget& target, uint16_t slot, const std::vector<std::string>& keys) {
+        std::vector<MovedEntry> batch;
+        for (size_t i = 0; i < keys.size();) {
+            batch.clear();
+            for (; i < keys.size() && batch.size() < options_.migrate_batch; ++i) {
+                MovedEntry e;
+                e.key = keys[i];
+                if (manager_->take(e.key, e.value, e.ttl_ms)) batch.push_back(std::move(e));
+            }
+            if (batch.empty()) continue;
+            if (!target.import(slot, batch)) {
+                for (const auto& e : batch) manager_->import_entry(e.key, e.value, e.ttl_ms);
+                std::cerr << "[Cluster] Slot " << slot << " migration stalled; kept migrating\n";
+                return false;
+            }
+            keys_moved_.fetch_add(batch.size());
+        }
+        return true;
+    }
+
+    /** Best-effort: tell the remaining nodes who owns the moved slots now. */
+    void announce(const std::vector<uint16_t>& slots, int owner) {
+        for (const auto& n : map_.nodes()) {
+            if (n.id == self() || n.id == owner) continue;
+            auto peer = factory_(n);
+            for (uint16_t slot : slots) {
+                if (!peer->set_owner(slot, owner)) break;
+            }
+        }
+    }
+
+    sync::CacheManager* manager_;
+    ClusterOptions options_;
+    SlotMap map_;
+    std::unique_ptr<compat::Atomic<uint32_t>[]> heat_;   // local requests per slot
+    compat::Atomic<uint64_t> ops_;
+    compat::Atomic<uint64_t> keys_moved_;
+    compat::Atomic<uint64_t> slots_moved_;
+    compat::Mutex migrate_mu_;   // one migration at a time
+    TargetFactory factory_;
+};
+
+/**
+ * SlotTarget for a Cluster in the same process (tests, embedded use):
+ * the calls a RespSlotTarget makes over the wire, made directly.
+ */
+class LocalSlotTarget : public SlotTarget {
+public:
+    explicit LocalSlotTarget(Cluster* target) : target_(target) {}
+
+    bool set_importing(uint16_t slot, int from) override { return target_->slots().set_importing(slot, from); }
+    bool import(uint16_t slot, const std::vector<MovedEntry>& batch) override { return target_->import(slot, batch) >= 0; }
+    bool set_owner(uint16_t slot, int owner) override { return target_->slots().set_owner(slot, owner); }
+    bool load(uint64_t& ops) override {
+        ops = target_->ops();
+        return true;
+    }
+
+private:
+    Cluster* target_;
+};
+
+// ──── Balancer ─────────────────────────────────────────────────
+
+/**
+ * ClusterBalancer — feeds per-node request rates to a PredictiveSharder
+ * whose shards are the cluster's nodes, and hands its migration
+ * recommendations to Cluster::rebalance().  A recommendation is only
+ * acted on when the measured rates agree with the prediction, so an
+ * untrained model can't shuffle slots around.
+ */
+class ClusterBalancer {
+public:
+    ClusterBalancer(Cluster* cluster, std::chrono::milliseconds interval = std::chrono::seconds(5),
+                    const ml::PINNConfig& config = ml::PINNConfig())
+        : cluster_(cluster)
+        , interval_(interval)
+        , ids_(node_ids(cluster))
+        , sharder_(static_cast<int>(ids_.size()), config)
+        , last_ops_(ids_.size(), 0)
+        , rates_(ids_.size(), 0.0f)
+        , running_(false) {}
+
+    ~ClusterBalancer() { stop(); }
+
+    void start() {
+        if (running_.exchange(true)) return;
+        sharder_.Start();
+        thread_ = compat::Thread([this] { run_loop(); });
+    }
+
+    void stop() {
+        if (!running_.exchange(false)) return;
+        cv_.notify_all();
+        if (thread_.joinable()) thread_.join();
+        sharder_.Stop();
+    }
+
+    /**
+     * One step: sample every node's request count, record the rates
+     * (normalised to the busiest node) and act on any recommendation
+     * for this node.  Returns the slots moved.
+     */
+    std::vector<uint16_t> tick(float threshold = 0.7f) {
+        float peak = 0;
+        for (size_t i = 0; i < ids_.size(); ++i) {
+            uint64_t ops;
+            if (!cluster_->node_ops(ids_[i], ops)) continue;
+            rates_[i] = static_cast<float>(ops >= last_ops_[i] ? ops - last_ops_[i] : ops);
+            last_ops_[i] = ops;
+            peak = std::max(peak, rates_[i]);
+        }
+        if (peak <= 0) return {};
+        for (size_t i = 0; i < ids_.size(); ++i) {
+            sharder_.RecordTelemetry(static_cast<int>(i), rates_[i] / peak, 1.0f, 0.0f);
+        }
+        for (const auto& rec : sharder_.GetRecommendations(threshold)) {
+            size_t from = static_cast<size_t>(rec.from_shard), to = static_cast<size_t>(rec.to_shard);
+            if (ids_[from] != cluster_->self() || rates_[from] <= rates_[to]) continue;
+            ml::MigrationRecommendation mapped = rec;
+            mapped.from_shard = ids_[from];
+            mapped.to_shard = ids_[to];
+            return cluster_->rebalance(mapped);
+        }
+        return {};
+    }
+
+private:
+    static std::vector<int> node_ids(Cluster* cluster) {
+        std::vector<int> ids;
+        for (const auto& n : cluster->slots().nodes()) ids.push_back(n.id);
+        return ids;
+    }
+
+    void run_loop() {
+        while (running_.load()) {
+            compat::UniqueLock<compat::Mutex> lock(mu_);
+            cv_.wait_for(lock, interval_, [this] { return !running_.load(); });
+            if (!running_.load()) break;
+            lock.unlock();
+            tick();
+        }
+    }
+
+    Cluster* cluster_;
+    std::chrono::milliseconds interval_;
+    std::vector<int> ids_;          // sharder shard i = node ids_[i]
+    ml::PredictiveSharder sharder_;
+    std::vector<uint64_t> last_ops_;
+    std::vector<float> rates_;
+
+    compat::Atomic<bool> running_;
+    compat::Thread thread_;
+    compat::Mutex mu_;
+    compat::CondVar cv_;
+};
+
+}  // namespace cluster
+}  // namespace dcs
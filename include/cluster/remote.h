@@ -0,0 +1,264 @@
+#pragma once
+
+// Winsock MUST be included before windows.h (pulled in by compat/threading.h)
+#ifdef _WIN32
+    #ifndef WIN32_LEAN_AND_MEAN
+        #define WIN32_LEAN_AND_MEAN
+    #endif
+    #include <winsock2.h>
+    #include <ws2tcpip.h>
+    #pragma comment(lib, "Ws2_32.lib")
+    using socket_t = SOCKET;
+    #define SOCKET_INVALID INVALID_SOCKET
+    #define CLOSE_SOCKET(s) closesocket(s)
+#else
+    #include <sys/socket.h>
+    #include <sys/time.h>
+    #include <netinet/in.h>
+    #include <netinet/tcp.h>
+    #include <arpa/inet.h>
+    #include <netdb.h>
+    #include <unistd.h>
+    using socket_t = int;
+    #define SOCKET_INVALID (-1)
+    #define CLOSE_SOCKET(s) close(s)
+#endif
+
+#include "slot_map.h"
+#include "../network/resp_parser.h"
+
+#include <charconv>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace dcs {
+namespace cluster {
+
+/** One key in flight between nodes; ttl_ms as CacheManager::take() (-1 = none). */
+struct MovedEntry {
+    std::string key;
+    std::string value;
+    int64_t     ttl_ms = -1;
+};
+
+/**
+ * The receiving end of a slot migration.  The source calls these in
+ * order: set_importing, import (once per batch), then set_owner.  Each
+ * returns false if the target could not be reached or refused.
+ */
+class SlotTarget {
+public:
+    virtual ~SlotTarget() = default;
+    virtual bool set_importing(uint16_t slot, int from) = 0;
+    virtual bool import(uint16_t slot, const std::vector<MovedEntry>& batch) = 0;
+    virtual bool set_owner(uint16_t slot, int owner) = 0;
+    virtual bool load(uint64_t& ops) = 0;   // CLUSTER LOAD: requests served so far
+};
+
+/**
+ * RespClient — minimal blocking RESP client for node-to-node commands.
+ * Only simple-string, error, integer and bulk replies are understood,
+ * which is all the CLUSTER commands it sends ever get back.  Reconnects
+ * on the next call after a failure.
+ */
+class RespClient {
+public:
+    struct Reply {
+        char        type = 0;   // '+', '-', ':' or '$'
+        std::string text;       // simple string, error or bulk payload
+        int64_t     integer = 0;
+        bool ok() const { return type && type != '-'; }
+    };
+
+    RespClient(const std::string& host, uint16_t port, int timeout_ms = 2000)
+        : host_(host), port_(port), timeout_ms_(timeout_ms) {}
+
+    ~RespClient() { close_socket(); }
+
+    RespClient(const RespClient&) = delete;
+    RespClient& operator=(const RespClient&) = delete;
+
+    bool call(const std::vector<std::string>& argv, Reply& reply) {
+        if (fd_ == SOCKET_INVALID && !connect_socket()) return false;
+        std::string out;
+        network::RESPParser::append_array_header(out, argv.size());
+        for (const auto& a : argv) network::RESPParser::append_bulk_string(out, a);
+        if (!send_all(out) || !read_reply(reply)) {
+            close_socket();
+            return false;
+        }
+        return true;
+    }
+
+    /**
+     * Pipelining: send() any number of RESP-encoded commands, then
+     * receive() their replies one by one, in order.  A failure of either
+     * closes the connection.
+     */
+    bool send(const std::string& wire) {
+        if (fd_ == SOCKET_INVALID && !connect_socket()) return false;
+        if (send_all(wire)) return true;
+        close_socket();
+        return false;
+    }
+
+    bool receive(Reply& reply) {
+        if (fd_ != SOCKET_INVALID && read_reply(reply)) return true;
+        close_socket();
+        return false;
+    }
+
+private:
+    bool connect_socket() {
+#ifdef _WIN32
+        static bool started = [] { WSADATA wsa; return WSAStartup(MAKEWORD(2, 2), &wsa) == 0; }();
+        (void)started;
+#endif
+        addrinfo hints{};
+        addrinfo* res = nullptr;
+        hints.ai_family = AF_INET;
+        hints.ai_socktype = SOCK_STREAM;
+        std::string port = std::to_string(port_);
+        if (getaddrinfo(host_.c_str(), port.c_str(), &hints, &res) != 0 || !res) return false;
+        socket_t fd = socket(res->ai_family, res->ai_socktype, res->ai_protocol);
+        bool ok = fd != SOCKET_INVALID &&
+                  connect(fd, res->ai_addr, static_cast<socklen_t>(res->ai_addrlen)) == 0;
+        freeaddrinfo(res);
+        if (!ok) {
+            if (fd != SOCKET_INVALID) CLOSE_SOCKET(fd);
+            return false;
+        }
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, reinterpret_cast<const char*>(&one), sizeof(one));
+#ifdef _WIN32
+        DWORD tv = static_cast<DWORD>(timeout_ms_);
+#else
+        timeval tv{timeout_ms_ / 1000, (timeout_ms_ % 1000) * 1000};
+#endif
+        setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, reinterpret_cast<const char*>(&tv), sizeof(tv));
+        setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, reinterpret_cast<const char*>(&tv), sizeof(tv));
+        fd_ = fd;
+        in_.clear();
+        return true;
+    }
+
+    void close_socket() {
+        if (fd_ != SOCKET_INVALID) CLOSE_SOCKET(fd_);
+        fd_ = SOCKET_INVALID;
+    }
+
+    bool send_all(const std::string& data) {
+        const char* p = data.data();
+        size_t n = data.size();
+        while (n > 0) {
+#ifdef _WIN32
+            int w = ::send(fd_, p, static_cast<int>(n), 0);
+#elif defined(MSG_NOSIGNAL)
+            ssize_t w = ::send(fd_, p, n, MSG_NOSIGNAL);
+#else
+            ssize_t w = ::send(fd_, p, n, 0);
+#endif
+            if (w <= 0) return false;
+            p += w;
+            n -= static_cast<size_t>(w);
+        }
+        return true;
+    }
+
+    /** Make sure `in_` holds at least `n` bytes. */
+    bool fill(size_t n) {
+        char buf[4096];
+        while (in_.size() < n) {
+#ifdef _WIN32
+            int r = recv(fd_, buf, sizeof(buf), 0);
+#else
+            ssize_t r = recv(fd_, buf, sizeof(buf), 0);
+#endif
+            if (r <= 0) return false;
+            in_.append(buf, static_cast<size_t>(r));
+        }
+        return true;
+    }
+
+    bool read_line(std::string& line) {
+        size_t eol;
+        while ((eol = in_.find("\r\n")) == std::string::npos) {
+            if (!fill(in_.size() + 1)) return false;
+        }
+        line.assign(in_, 0, eol);
+        in_.erase(0, eol + 2);
+        return true;
+    }
+
+    bool read_reply(Reply& reply) {
+        std::string line;
+        if (!read_line(line) || line.empty()) return false;
+        reply = Reply();
+        reply.type = line[0];
+        reply.text = line.substr(1);
+        if (reply.type == '+' || reply.type == '-') return true;
+        int64_t n = 0;
+        auto r = std::from_chars(reply.text.data(), reply.text.data() + reply.text.size(), n);
+        if (r.ec != std::errc()) return false;
+        reply.integer = n;
+        if (reply.type == ':') return true;
+        if (reply.type != '$') return false;
+        reply.text.clear();
+        if (n < 0) return true;   // null bulk
+        if (!fill(static_cast<size_t>(n) + 2)) return false;
+        reply.text.assign(in_, 0, static_cast<size_t>(n));
+        in_.erase(0, static_cast<size_t>(n) + 2);
+        return true;
+    }
+
+    std::string host_;
+    uint16_t    port_;
+    int         timeout_ms_;
+    socket_t    fd_ = SOCKET_INVALID;
+    std::string in_;   // received bytes not yet consumed
+};
+
+/** SlotTarget reached over RESP through the target's client port. */
+class RespSlotTarget : public SlotTarget {
+public:
+    explicit RespSlotTarget(const NodeAddress& node) : client_(node.host, node.port) {}
+
+    bool set_importing(uint16_t slot, int from) override {
+        return ok({"CLUSTER", "SETSLOT", std::to_string(slot), "IMPORTING", std::to_string(from)});
+    }
+
+    bool import(uint16_t slot, const std::vector<MovedEntry>& batch) override {
+        std::vector<std::string> argv{"CLUSTER", "IMPORT", std::to_string(slot)};
+        argv.reserve(3 + batch.size() * 3);
+        for (const auto& e : batch) {
+            argv.push_back(e.key);
+            argv.push_back(e.value);
+            argv.push_back(std::to_string(e.ttl_ms));
+        }
+        return ok(argv);
+    }
+
+    bool set_owner(uint16_t slot, int owner) override {
+        return ok({"CLUSTER", "SETSLOT", std::to_string(slot), "NODE", std::to_string(owner)});
+    }
+
+    bool load(uint64_t& ops) override {
+        RespClient::Reply reply;
+        if (!client_.call({"CLUSTER", "LOAD"}, reply) || reply.type != ':') return false;
+        ops = static_cast<uint64_t>(reply.integer);
+        return true;
+    }
+
+private:
+    bool ok(const std::vector<std::string>& argv) {
+        RespClient::Reply reply;
+        return client_.call(argv, reply) && reply.ok();
+    }
+
+    RespClient client_;
+};
+
+}  // namespace cluster
+}  // namespace dcs
@@ -0,0 +1,222 @@
+#pragma once
+
+#include "../compat/threading.h"
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace dcs {
+namespace cluster {
+
+/**
+ * Hash slots, as in Redis Cluster: the key space is split into
+ * kSlotCount slots by CRC16(key) mod kSlotCount, and every slot is owned
+ * by exactly one node.  Moving capacity between nodes means moving
+ * slots, so adding a node never rehashes keys that stay put.
+ *
+ * A key containing "{tag}" hashes only the tag, so related keys
+ * ("user:{42}:name", "user:{42}:cart") share a slot and can be used
+ * together in one multi-key command.
+ */
+constexpr uint16_t kSlotCount = 16384;
+
+/** CRC16-CCITT (XMODEM), the Redis Cluster key hash. */
+inline uint16_t crc16(const char* p, size_t n) {
+    uint16_t crc = 0;
+    for (size_t i = 0; i < n; ++i) {
+        crc ^= static_cast<uint16_t>(static_cast<unsigned char>(p[i]) << 8);
+        for (int k = 0; k < 8; ++k) {
+            crc = (crc & 0x8000) ? static_cast<uint16_t>((crc << 1) ^ 0x1021)
+                                 : static_cast<uint16_t>(crc << 1);
+        }
+    }
+    return crc;
+}
+
+inline uint16_t key_slot(std::string_view key) {
+    size_t open = key.find('{');
+    if (open != std::string_view::npos) {
+        size_t close = key.find('}', open + 1);
+        if (close != std::string_view::npos && close > open + 1) {
+            key = key.substr(open + 1, close - open - 1);
+        }
+    }
+    return static_cast<uint16_t>(crc16(key.data(), key.size()) % kSlotCount);
+}
+
+struct NodeAddress {
+    int         id = -1;
+    std::string host;
+    uint16_t    port = 0;
+
+    std::string endpoint() const { return host + ":" + std::to_string(port); }
+};
+
+/**
+ * Where a slot lives, from this node's point of view.  While a slot
+ * moves, its owner marks it migrating (keys it no longer holds are
+ * answered with ASK to the target) and the target marks it importing
+ * (it serves requests that come with ASKING).
+ */
+enum class SlotState : uint8_t { Stable, Migrating, Importing };
+
+struct SlotRoute {
+    int       owner = -1;
+    SlotState state = SlotState::Stable;
+    int       peer  = -1;   // migration target, or import source
+};
+
+/**
+ * SlotMap — this node's view of slot ownership.  Lookups take a shared
+ * lock; changes bump epoch() so callers can tell a view went stale.
+ */
+class SlotMap {
+public:
+    explicit SlotMap(int self_id) : self_(self_id), epoch_(0) {
+        for (auto& r : routes_) r = SlotRoute();
+    }
+
+    SlotMap(const SlotMap&) = delete;
+    SlotMap& operator=(const SlotMap&) = delete;
+
+    int self() const { return self_; }
+    uint64_t epoch() const { return epoch_.load(); }
+
+    void add_node(const NodeAddress& node) {
+        compat::LockGuard<compat::SharedMutex> lock(mu_);
+        nodes_[node.id] = node;
+        epoch_.fetch_add(1);
+    }
+
+    bool node(int id, NodeAddress& out) const {
+        compat::SharedLock<compat::SharedMutex> lock(mu_);
+        auto it = nodes_.find(id);
+        if (it == nodes_.end()) return false;
+        out = it->second;
+        return true;
+    }
+
+    std::vector<NodeAddress> nodes() const {
+        compat::SharedLock<compat::SharedMutex> lock(mu_);
+        std::vector<NodeAddress> out;
+        for (const auto& n : nodes_) out.push_back(n.second);
+        return out;
+    }
+
+    /** Give slots [first, last] to `owner`, clearing any migration on them. */
+    void assign(uint16_t first, uint16_t last, int owner) {
+        compat::LockGuard<compat::SharedMutex> lock(mu_);
+        for (uint32_t s = first; s <= last && s < kSlotCount; ++s) routes_[s] = SlotRoute{owner, SlotState::Stable, -1};
+        epoch_.fetch_add(1);
+    }
+
+    /** Split all slots into contiguous, near-equal ranges over the known nodes. */
+    void assign_evenly() {
+        std::vector<int> ids;
+        {
+            compat::SharedLock<compat::SharedMutex> lock(mu_);
+            for (const auto& n : nodes_) ids.push_back(n.first);
+        }
+        if (ids.empty()) return;
+        uint32_t per = kSlotCount / static_cast<uint32_t>(ids.size());
+        uint32_t extra = kSlotCount % static_cast<uint32_t>(ids.size());
+        uint32_t first = 0;
+        for (size_t i = 0; i < ids.size(); ++i) {
+            uint32_t n = per + (i < extra ? 1 : 0);
+            assign(static_cast<uint16_t>(first), static_cast<uint16_t>(first + n - 1), ids[i]);
+            first += n;
+        }
+    }
+
+    SlotRoute route(uint16_t slot) const {
+        compat::SharedLock<compat::SharedMutex> lock(mu_);
+        return routes_[slot % kSlotCount];
+    }
+
+    int owner(uint16_t slot) const { return route(slot).owner; }
+
+    /** CLUSTER SETSLOT <slot> MIGRATING <to>: only the owner may start a move. */
+    bool set_migrating(uint16_t slot, int to) {
+        compat::LockGuard<compat::SharedMutex> lock(mu_);
+        SlotRoute& r = routes_[slot % kSlotCount];
+        if (r.owner != self_ || to == self_ || !nodes_.count(to)) return false;
+        r.state = SlotState::Migrating;
+        r.peer = to;
+        epoch_.fetch_add(1);
+        return true;
+    }
+
+    /** CLUSTER SETSLOT <slot> IMPORTING <from>. */
+    bool set_importing(uint16_t slot, int from) {
+        compat::LockGuard<compat::SharedMutex> lock(mu_);
+        SlotRoute& r = routes_[slot % kSlotCount];
+        if (r.owner == self_ || from == self_ || !nodes_.count(from)) return false;
+        r.state = SlotState::Importing;
+        r.peer = from;
+        epoch_.fetch_add(1);
+        return true;
+    }
+
+    /** CLUSTER SETSLOT <slot> NODE <owner>: the move is done (or ownership learnt). */
+    bool set_owner(uint16_t slot, int owner) {
+        compat::LockGuard<compat::SharedMutex> lock(mu_);
+        if (!nodes_.count(owner)) return false;
+        routes_[slot % kSlotCount] = SlotRoute{owner, SlotState::Stable, -1};
+        epoch_.fetch_add(1);
+        return true;
+    }
+
+    /** CLUSTER SETSLOT <slot> STABLE: abandon a move, keeping the owner. */
+    void set_stable(uint16_t slot) {
+        compat::LockGuard<compat::SharedMutex> lock(mu_);
+        SlotRoute& r = routes_[slot % kSlotCount];
+        r.state = SlotState::Stable;
+        r.peer = -1;
+        epoch_.fetch_add(1);
+    }
+
+    /** Contiguous [first, last] slot ranges per owner, in slot order (CLUSTER SLOTS). */
+    struct Range {
+        uint16_t first;
+        uint16_t last;
+        int      owner;
+    };
+
+    std::vector<Range> ranges() const {
+        compat::SharedLock<compat::SharedMutex> lock(mu_);
+        std::vector<Range> out;
+        for (uint32_t s = 0; s < kSlotCount; ++s) {
+            int owner = routes_[s].owner;
+            if (owner < 0) continue;
+            if (!out.empty() && out.back().owner == owner && out.back().last + 1u == s) {
+                out.back().last = static_cast<uint16_t>(s);
+            } else {
+                out.push_back({static_cast<uint16_t>(s), static_cast<uint16_t>(s), owner});
+            }
+        }
+        return out;
+    }
+
+    std::vector<uint16_t> slots_of(int owner) const {
+        compat::SharedLock<compat::SharedMutex> lock(mu_);
+        std::vector<uint16_t> out;
+        for (uint32_t s = 0; s < kSlotCount; ++s) {
+            if (routes_[s].owner == owner) out.push_back(static_cast<uint16_t>(s));
+        }
+        return out;
+    }
+
+private:
+    int self_;
+    mutable compat::SharedMutex mu_;
+    std::map<int, NodeAddress> nodes_;
+    SlotRoute routes_[kSlotCount];
+    compat::Atomic<uint64_t> epoch_;
+};
+
+}  // namespace cluster
+}  // namespace dcs
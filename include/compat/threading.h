@@ -7,7 +7,8 @@
  * <condition_variable>.  This header provides dcs::compat:: types that
  * wrap Win32 APIs.  On modern compilers, they alias the std:: types.
  *
- * All project code uses: Mutex, LockGuard, UniqueLock, CondVar, Thread, Atomic.
+ * All project code uses: Mutex, SharedMutex, LockGuard, UniqueLock, SharedLock,
+ * CondVar, Thread, Atomic.
  */
 
 #if defined(__MINGW32__) && !defined(_GLIBCXX_HAS_GTHREADS)
@@ -44,11 +45,26 @@ public:
     Mutex& operator=(const Mutex&) = delete;
     void lock() { EnterCriticalSection(&cs_); }
     void unlock() { LeaveCriticalSection(&cs_); }
+    bool try_lock() { return TryEnterCriticalSection(&cs_) != 0; }
     CRITICAL_SECTION& native() { return cs_; }
 private:
     CRITICAL_SECTION cs_;
 };
 
+/** Reader-writer lock on a Slim Reader/Writer lock (Vista+). */
+class SharedMutex {
+public:
+    SharedMutex() { InitializeSRWLock(&srw_); }
+    SharedMutex(const SharedMutex&) = delete;
+    SharedMutex& operator=(const SharedMutex&) = delete;
+    void lock() { AcquireSRWLockExclusive(&srw_); }
+    void unlock() { ReleaseSRWLockExclusive(&srw_); }
+    void lock_shared() { AcquireSRWLockShared(&srw_); }
+    void unlock_shared() { ReleaseSRWLockShared(&srw_); }
+private:
+    SRWLOCK srw_;
+};
+
 template<class M>
 class LockGuard {
 public:
@@ -75,6 +91,17 @@ private:
     bool owns_;
 };
 
+template<class M>
+class SharedLock {
+public:
+    explicit SharedLock(M& m) : m_(m) { m_.lock_shared(); }
+    ~SharedLock() { m_.unlock_shared(); }
+    SharedLock(const SharedLock&) = delete;
+    SharedLock& operator=(const SharedLock&) = delete;
+private:
+    M& m_;
+};
+
 class CondVar {
 public:
     CondVar() { event_ = CreateEvent(NULL, FALSE, FALSE, NULL); }
@@ -141,6 +168,12 @@ public:
     Thread(const Thread&) = delete;
     Thread& operator=(const Thread&) = delete;
 
+    static unsigned hardware_concurrency() {
+        SYSTEM_INFO info;
+        GetSystemInfo(&info);
+        return static_cast<unsigned>(info.dwNumberOfProcessors);
+    }
+
     bool joinable() const { return handle_ != NULL; }
     void join() {
         if (joinable()) {
@@ -231,6 +264,7 @@ private:
 // ════════════════════════════════════════════════════════════════════
 
 #include <mutex>
+#include <shared_mutex>
 #include <thread>
 #include <condition_variable>
 #include <atomic>
@@ -239,6 +273,7 @@ namespace dcs {
 namespace compat {
 
 using Mutex = std::mutex;
+using SharedMutex = std::shared_mutex;
 
 template<class T>
 using LockGuard = std::lock_guard<T>;
@@ -246,6 +281,9 @@ using LockGuard = std::lock_guard<T>;
 template<class T>
 using UniqueLock = std::unique_lock<T>;
 
+template<class T>
+using SharedLock = std::shared_lock<T>;
+
 using CondVar = std::condition_variable;
 using Thread = std::thread;
 
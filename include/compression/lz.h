@@ -0,0 +1,156 @@
+#pragma once
+// ────────────────────────────────────────────────────────────────
+// LZ: small dependency-free LZ77 codec in the LZ4 block style.
+// Used for SSTable blocks; favours speed over ratio.
+//
+// Stream = sequences of
+//   [token][literal-len ext][literals][offset u16 LE][match-len ext]
+// token high nibble = literal length, low nibble = match length - 4;
+// a nibble of 15 is followed by 255-continued extension bytes.  The
+// final sequence carries literals only, and the last 5 input bytes
+// are always emitted as literals.
+// ────────────────────────────────────────────────────────────────
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace dcs {
+namespace compression {
+
+namespace lz_detail {
+
+constexpr size_t   kMinMatch     = 4;
+constexpr size_t   kLastLiterals = 5;
+constexpr size_t   kMinInput     = 13;   // shorter inputs are stored as one literal run
+constexpr size_t   kMaxOffset    = 0xFFFF;
+constexpr uint32_t kHashBits     = 12;
+
+inline uint32_t Load32(const uint8_t* p) {
+    uint32_t v;
+    std::memcpy(&v, p, 4);
+    return v;
+}
+
+inline uint32_t Hash(uint32_t seq) {
+    return (seq * 2654435761u) >> (32 - kHashBits);
+}
+
+inline void WriteLength(std::string& out, size_t len) {
+    while (len >= 255) {
+        out.push_back(static_cast<char>(255));
+        len -= 255;
+    }
+    out.push_back(static_cast<char>(len));
+}
+
+inline void EmitSequence(std::string& out, const uint8_t* lit, size_t lit_len,
+                         size_t offset, size_t match_len) {
+    size_t ml = match_len - kMinMatch;
+    uint8_t token = static_cast<uint8_t>(((lit_len < 15 ? lit_len : 15) << 4) |
+                                         (ml < 15 ? ml : 15));
+    out.push_back(static_cast<char>(token));
+    if (lit_len >= 15) WriteLength(out, lit_len - 15);
+    out.append(reinterpret_cast<const char*>(lit), lit_len);
+    out.push_back(static_cast<char>(offset & 0xFF));
+    out.push_back(static_cast<char>(offset >> 8));
+    if (ml >= 15) WriteLength(out, ml - 15);
+}
+
+inline void EmitLastLiterals(std::string& out, const uint8_t* lit, size_t lit_len) {
+    out.push_back(static_cast<char>((lit_len < 15 ? lit_len : 15) << 4));
+    if (lit_len >= 15) WriteLength(out, lit_len - 15);
+    out.append(reinterpret_cast<const char*>(lit), lit_len);
+}
+
+// Reads a 255-continued extension; fails on truncation or if the total
+// exceeds `limit` (no valid stream can).
+inline bool ReadLength(std::string_view in, size_t& pos, size_t& len, size_t limit) {
+    for (;;) {
+        if (pos >= in.size()) return false;
+        uint8_t b = static_cast<uint8_t>(in[pos++]);
+        len += b;
+        if (len > limit) return false;
+        if (b != 255) return true;
+    }
+}
+
+}  // namespace lz_detail
+
+/** Compress `in`; the result is never larger than in.size() + in.size()/255 + 16. */
+inline std::string Compress(std::string_view in) {
+    using namespace lz_detail;
+    const uint8_t* src = reinterpret_cast<const uint8_t*>(in.data());
+    const size_t n = in.size();
+    std::string out;
+    out.reserve(n + n / 255 + 16);
+
+    size_t anchor = 0;
+    if (n >= kMinInput) {
+        std::vector<uint32_t> table(size_t(1) << kHashBits, 0);   // position + 1
+        const size_t match_limit = n - kLastLiterals;
+        const size_t search_limit = n - kMinInput + 1;
+        size_t ip = 0;
+        while (ip < search_limit) {
+            uint32_t seq = Load32(src + ip);
+            uint32_t h = Hash(seq);
+            size_t cand = table[h];
+            table[h] = static_cast<uint32_t>(ip + 1);
+            if (cand == 0 || ip - (cand - 1) > kMaxOffset || Load32(src + cand - 1) != seq) {
+                ++ip;
+                continue;
+            }
+            size_t ref = cand - 1;
+            size_t len = kMinMatch;
+            while (ip + len < match_limit && src[ref + len] == src[ip + len]) ++len;
+            EmitSequence(out, src + anchor, ip - anchor, ip - ref, len);
+            ip += len;
+            anchor = ip;
+        }
+    }
+    EmitLastLiterals(out, src + anchor, n - anchor);
+    return out;
+}
+
+/**
+ * Decompress `in`, which must expand to exactly `raw_size` bytes.
+ * Every length and offset is bounds-checked; returns false on any
+ * malformed input instead of reading or writing out of range.
+ */
+inline bool Decompress(std::string_view in, size_t raw_size, std::string& out) {
+    using namespace lz_detail;
+    out.clear();
+    out.reserve(raw_size);
+    size_t pos = 0;
+    while (pos < in.size()) {
+        uint8_t token = static_cast<uint8_t>(in[pos++]);
+
+        size_t lit = token >> 4;
+        if (lit == 15 && !ReadLength(in, pos, lit, raw_size)) return false;
+        if (lit > in.size() - pos || lit > raw_size - out.size()) return false;
+        out.append(in.data() + pos, lit);
+        pos += lit;
+        if (pos == in.size()) break;   // final literal-only sequence
+
+        if (in.size() - pos < 2) return false;
+        size_t offset = static_cast<uint8_t>(in[pos]) |
+                        (static_cast<size_t>(static_cast<uint8_t>(in[pos + 1])) << 8);
+        pos += 2;
+        if (offset == 0 || offset > out.size()) return false;
+
+        size_t len = token & 15;
+        if (len == 15 && !ReadLength(in, pos, len, raw_size)) return false;
+        len += kMinMatch;
+        if (len > raw_size - out.size()) return false;
+        // Byte-wise copy: source and destination may overlap (runs).
+        size_t from = out.size() - offset;
+        for (size_t i = 0; i < len; ++i) out.push_back(out[from + i]);
+    }
+    return out.size() == raw_size;
+}
+
+}  // namespace compression
+}  // namespace dcs
@@ -0,0 +1,169 @@
+#pragma once
+// ────────────────────────────────────────────────────────────────
+// ValueCodec: per-value compression applied once, when a value is
+// written, so the cache, the WAL, the memtable and SSTable blocks all
+// hold the same packed bytes; values are unpacked only for a reader.
+//
+// Stored form:
+//   "\0DZ" 0x01 | u32 raw_size LE | LZ payload   — compressed
+//   "\0DZ" 0x00 | raw bytes                      — raw, escaped
+//   anything else                                — raw, verbatim
+// Only values that already begin with the magic are escaped, so a
+// value that isn't compressed costs nothing.  Decoding is always on:
+// data written with compression enabled stays readable after it is
+// turned off.
+//
+// The backend may wrap a stored form once more, for a key with a TTL:
+//   "\0DZ" 0x02 | u64 deadline LE (Unix ms) | stored form
+// Stored forms never begin with that tag (the escape above sees to
+// it), so the wrapper is unambiguous.
+// ────────────────────────────────────────────────────────────────
+
+#include "lz.h"
+#include "../compat/threading.h"
+#include "../metrics/latency.h"
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+
+namespace dcs {
+namespace compression {
+
+class ValueCodec {
+public:
+    static constexpr char   kMagic[3]   = {'\0', 'D', 'Z'};
+    static constexpr char   kTagRaw     = 0x00;
+    static constexpr char   kTagLZ      = 0x01;
+    static constexpr char   kTagDeadline = 0x02;
+    static constexpr size_t kHeaderSize = 4;                // magic + tag
+    static constexpr size_t kLZHeaderSize = kHeaderSize + 4;  // + raw size
+    static constexpr size_t kDeadlineHeaderSize = kHeaderSize + 8;  // + deadline
+
+    struct Stats {
+        compat::Atomic<uint64_t> compressed{0};     // values stored packed
+        compat::Atomic<uint64_t> skipped{0};        // tried, saved too little
+        compat::Atomic<uint64_t> raw_bytes{0};      // input of every attempt
+        compat::Atomic<uint64_t> stored_bytes{0};   // what those attempts stored
+        compat::Atomic<uint64_t> decompressed{0};
+        metrics::LatencyHistogram compress_latency;
+        metrics::LatencyHistogram decompress_latency;
+    };
+
+    /** Values of at least `min_size` bytes are compressed; 0 = never. */
+    explicit ValueCodec(size_t min_size = 0) : min_size_(min_size) {}
+
+    ValueCodec(const ValueCodec&) = delete;
+    ValueCodec& operator=(const ValueCodec&) = delete;
+
+    /**
+     * Stored form of `raw`.  Returns false when that is `raw` itself
+     * (leaving `out` untouched), so callers copy only when it differs.
+     * A compressed form is kept only if it saves at least 1/8, as for
+     * SSTable blocks.
+     */
+    bool Encode(std::string_view raw, std::string& out) {
+        if (min_size_ && raw.size() >= min_size_ && raw.size() <= UINT32_MAX) {
+            const uint64_t t0 = metrics::now_ns();
+            std::string packed = Compress(raw);
+            const bool keep = packed.size() + kLZHeaderSize < raw.size() - raw.size() / 8;
+            if (keep) {
+                out.assign(kMagic, sizeof(kMagic));
+                out.push_back(kTagLZ);
+                uint32_t n = static_cast<uint32_t>(raw.size());
+                out.append(reinterpret_cast<const char*>(&n), 4);
+                out.append(packed);
+            }
+            stats_.compress_latency.record_since(t0);
+            stats_.raw_bytes.fetch_add(raw.size());
+            if (keep) {
+                stats_.compressed++;
+                stats_.stored_bytes.fetch_add(out.size());
+                return true;
+            }
+            stats_.skipped++;
+            stats_.stored_bytes.fetch_add(raw.size() + (HasMagic(raw) ? kHeaderSize : 0));
+        }
+        if (!HasMagic(raw)) return false;
+        out.assign(kMagic, sizeof(kMagic));
+        out.push_back(kTagRaw);
+        out.append(raw.data(), raw.size());
+        return true;
+    }
+
+    /**
+     * Client-visible form of a stored value.  Returns false when that is
+     * `stored` itself.  A value carrying the magic but no valid frame is
+     * passed through unchanged.
+     */
+    bool Decode(std::string_view stored, std::string& out) {
+        if (!HasMagic(stored) || stored.size() < kHeaderSize) return false;
+        const char tag = stored[3];
+        if (tag == kTagRaw) {
+            out.assign(stored.data() + kHeaderSize, stored.size() - kHeaderSize);
+            return true;
+        }
+        if (tag != kTagLZ || stored.size() < kLZHeaderSize) return false;
+        uint32_t n;
+        std::memcpy(&n, stored.data() + kHeaderSize, 4);
+        const uint64_t t0 = metrics::now_ns();
+        std::string raw;
+        if (!Decompress(stored.substr(kLZHeaderSize), n, raw)) return false;
+        stats_.decompress_latency.record_since(t0);
+        stats_.decompressed++;
+        out.swap(raw);
+        return true;
+    }
+
+    /** Decode `value` where it lies. */
+    void DecodeInPlace(std::string& value) {
+        std::string raw;
+        if (Decode(value, raw)) value.swap(raw);
+    }
+
+    /** Backend form of `stored` for a key expiring at `unix_ms`. */
+    static std::string WrapDeadline(std::string_view stored, uint64_t unix_ms) {
+        std::string out;
+        out.reserve(kDeadlineHeaderSize + stored.size());
+        out.assign(kMagic, sizeof(kMagic));
+        out.push_back(kTagDeadline);
+        out.append(reinterpret_cast<const char*>(&unix_ms), 8);
+        out.append(stored.data(), stored.size());
+        return out;
+    }
+
+    /**
+     * Split a backend value into its stored form and deadline (Unix ms;
+     * 0 = none).  Returns false, leaving `stored` as the whole value,
+     * when it carries no deadline.
+     */
+    static bool UnwrapDeadline(std::string_view value, std::string_view& stored, uint64_t& unix_ms) {
+        stored = value;
+        unix_ms = 0;
+        if (!HasMagic(value) || value.size() < kDeadlineHeaderSize || value[3] != kTagDeadline) return false;
+        std::memcpy(&unix_ms, value.data() + kHeaderSize, 8);
+        stored = value.substr(kDeadlineHeaderSize);
+        return true;
+    }
+
+    static bool HasMagic(std::string_view v) {
+        return v.size() >= sizeof(kMagic) && std::memcmp(v.data(), kMagic, sizeof(kMagic)) == 0;
+    }
+
+    /** Stored bytes per raw byte over every compression attempt; 1 if none. */
+    double Ratio() const {
+        uint64_t in = stats_.raw_bytes.load();
+        return in ? static_cast<double>(stats_.stored_bytes.load()) / static_cast<double>(in) : 1.0;
+    }
+
+    size_t MinSize() const { return min_size_; }
+    const Stats& GetStats() const { return stats_; }
+
+private:
+    const size_t min_size_;
+    Stats stats_;
+};
+
+}  // namespace compression
+}  // namespace dcs
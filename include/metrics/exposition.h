@@ -0,0 +1,214 @@
+#pragma once
+
+#include "latency.h"
+#include "../compat/threading.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <initializer_list>
+#include <memory>
+#include <string>
+#include <type_traits>
+#include <utility>
+
+namespace dcs {
+namespace metrics {
+
+/**
+ * PrometheusWriter — builds a text exposition (format 0.0.4).  Declare
+ * a family once with its type and help, then append its samples:
+ *
+ *   w.family("dcs_cache_hits_total", "counter", "GET hits");
+ *   w.sample("dcs_cache_hits_total", hits);
+ *   w.sample("dcs_segment_keys", n, {{"segment", "3"}});
+ */
+class PrometheusWriter {
+public:
+    using Labels = std::initializer_list<std::pair<const char*, std::string>>;
+
+    void family(const char* name, const char* type, const char* help) {
+        out_ += "# HELP ";
+        out_ += name;
+        out_ += ' ';
+        out_ += help;
+        out_ += "\n# TYPE ";
+        out_ += name;
+        out_ += ' ';
+        out_ += type;
+        out_ += '\n';
+    }
+
+    template <class T>
+    void sample(const std::string& name, T value, Labels labels = {}) {
+        out_ += name;
+        if (labels.size()) {
+            out_ += '{';
+            bool first = true;
+            for (const auto& l : labels) {
+                if (!first) out_ += ',';
+                first = false;
+                out_ += l.first;
+                out_ += "=\"";
+                append_escaped(l.second);
+                out_ += '"';
+            }
+            out_ += '}';
+        }
+        out_ += ' ';
+        append_value(value);
+        out_ += '\n';
+    }
+
+    template <class T>
+    void counter(const char* name, const char* help, T value) {
+        family(name, "counter", help);
+        sample(name, value);
+    }
+
+    template <class T>
+    void gauge(const char* name, const char* help, T value) {
+        family(name, "gauge", help);
+        sample(name, value);
+    }
+
+    /**
+     * One summary family over a LatencyReport: p50/p99/p99.9 quantiles,
+     * _sum and _count per entry, labelled op="<entry name>", in seconds.
+     */
+    void latency_summary(const char* name, const char* help, const LatencyReport& report) {
+        family(name, "summary", help);
+        const std::string base(name);
+        static const std::pair<double, const char*> kQuantiles[] = {{0.50, "0.5"}, {0.99, "0.99"}, {0.999, "0.999"}};
+        for (const auto& entry : report) {
+            const LatencySnapshot& s = entry.second;
+            for (const auto& q : kQuantiles) {
+                double v = s.count ? s.percentile_ns(q.first) / 1e9 : NAN;
+                sample(base, v, {{"op", entry.first}, {"quantile", q.second}});
+            }
+            sample(base + "_sum", static_cast<double>(s.sum_ns) / 1e9, {{"op", entry.first}});
+            sample(base + "_count", s.count, {{"op", entry.first}});
+        }
+    }
+
+    const std::string& str() const { return out_; }
+    std::string take() { return std::move(out_); }
+
+private:
+    void append_escaped(const std::string& v) {
+        for (char c : v) {
+            if (c == '\\' || c == '"') { out_ += '\\'; out_ += c; }
+            else if (c == '\n') out_ += "\\n";
+            else out_ += c;
+        }
+    }
+
+    template <class T>
+    void append_value(T v) {
+        if constexpr (std::is_integral<T>::value) {
+            out_ += std::to_string(v);
+        } else {
+            double d = static_cast<double>(v);
+            if (std::isnan(d)) { out_ += "NaN"; return; }
+            if (std::isinf(d)) { out_ += d > 0 ? "+Inf" : "-Inf"; return; }
+            char buf[32];
+            std::snprintf(buf, sizeof(buf), "%.9g", d);
+            out_ += buf;
+        }
+    }
+
+    std::string out_;
+};
+
+/** One sampling pass, rendered for both consumers from the same readings. */
+struct MetricsPage {
+    std::string json;         // dashboard, /api/metrics
+    std::string prometheus;   // /metrics
+    uint64_t    sampled_at_ms = 0;
+};
+
+/**
+ * MetricsPublisher — renders a MetricsPage every `interval` on its own
+ * thread and publishes it by swapping a shared_ptr.  Readers (HTTP
+ * scrapes) only copy that pointer, so however often they come they never
+ * reach the cache, storage or Raft locks the sampler takes; they see data
+ * at most one interval old.
+ */
+class MetricsPublisher {
+public:
+    using Sampler = std::function<MetricsPage()>;
+
+    MetricsPublisher(std::chrono::milliseconds interval, Sampler sampler)
+        : interval_(interval)
+        , sampler_(std::move(sampler))
+        , current_(std::make_shared<const MetricsPage>())
+        , running_(false) {}
+
+    ~MetricsPublisher() {
+        stop();
+    }
+
+    MetricsPublisher(const MetricsPublisher&) = delete;
+    MetricsPublisher& operator=(const MetricsPublisher&) = delete;
+
+    /** Publish a first page synchronously, then keep refreshing. */
+    void start() {
+        if (running_.exchange(true)) return;
+        refresh();
+        thread_ = compat::Thread([this] { run_loop(); });
+    }
+
+    void stop() {
+        if (!running_.exchange(false)) return;
+        cv_.notify_all();
+        if (thread_.joinable()) thread_.join();
+    }
+
+    /** Sample now and publish the result. */
+    void refresh() {
+        auto page = std::make_shared<MetricsPage>(sampler_());
+        page->sampled_at_ms = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count());
+        std::shared_ptr<const MetricsPage> old;
+        {
+            compat::LockGuard<compat::Mutex> lock(page_mu_);
+            old = std::move(current_);
+            current_ = std::move(page);
+        }
+        pages_++;
+    }   // `old` is released outside the lock
+
+    /** The latest page; never null. */
+    std::shared_ptr<const MetricsPage> current() const {
+        compat::LockGuard<compat::Mutex> lock(page_mu_);
+        return current_;
+    }
+
+    uint64_t pages_published() const { return pages_.load(); }
+
+private:
+    void run_loop() {
+        while (running_.load()) {
+            compat::UniqueLock<compat::Mutex> lock(mu_);
+            cv_.wait_for(lock, interval_, [this] { return !running_.load(); });
+            if (!running_.load()) break;
+            lock.unlock();
+            refresh();
+        }
+    }
+
+    std::chrono::milliseconds interval_;
+    Sampler sampler_;
+    mutable compat::Mutex page_mu_;   // leaf lock: guards only the pointer swap
+    std::shared_ptr<const MetricsPage> current_;
+    compat::Atomic<uint64_t> pages_{0};
+    compat::Atomic<bool> running_;
+    compat::Thread thread_;
+    compat::Mutex mu_;
+    compat::CondVar cv_;
+};
+
+}  // namespace metrics
+}  // namespace dcs
@@ -0,0 +1,262 @@
+#pragma once
+
+#include "../compat/threading.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <utility>
+#include <vector>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace dcs {
+namespace metrics {
+
+inline uint64_t now_ns() {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+/**
+ * HDR-style bucketing: values below 2^kSubBits nanoseconds get a bucket
+ * each; above that every power of two is split into 2^kSubBits linear
+ * sub-buckets, so a bucket is never wider than 1/32 of its value (~3%).
+ * Values beyond 2^kMaxBits ns (~9 minutes) land in the last bucket.
+ */
+constexpr int      kSubBits    = 5;
+constexpr int      kMaxBits    = 39;
+constexpr uint64_t kSubBuckets = uint64_t(1) << kSubBits;
+constexpr size_t   kBuckets    = static_cast<size_t>((kMaxBits - kSubBits + 2) * kSubBuckets);
+
+inline int highest_bit(uint64_t v) {   // v != 0
+#if defined(_MSC_VER) && defined(_M_X64)
+    unsigned long i;
+    _BitScanReverse64(&i, v);
+    return static_cast<int>(i);
+#elif defined(__GNUC__) || defined(__clang__)
+    return 63 - __builtin_clzll(v);
+#else
+    int msb = 63;
+    while (!(v >> msb)) --msb;
+    return msb;
+#endif
+}
+
+inline size_t bucket_of(uint64_t ns) {
+    if (ns < kSubBuckets) return static_cast<size_t>(ns);
+    int msb = highest_bit(ns);
+    if (msb > kMaxBits) return kBuckets - 1;
+    int shift = msb - kSubBits;
+    return static_cast<size_t>((shift + 1) * kSubBuckets + ((ns >> shift) - kSubBuckets));
+}
+
+/** Midpoint of bucket `b`, in nanoseconds. */
+inline double bucket_value(size_t b) {
+    if (b < kSubBuckets) return static_cast<double>(b);
+    int shift = static_cast<int>(b / kSubBuckets) - 1;
+    uint64_t mantissa = kSubBuckets + b % kSubBuckets;
+    return (static_cast<double>(mantissa) + 0.5) * static_cast<double>(uint64_t(1) << shift);
+}
+
+/** A merged view of a histogram, or the difference of two views. */
+struct LatencySnapshot {
+    uint64_t count  = 0;
+    uint64_t sum_ns = 0;
+    uint64_t max_ns = 0;
+    std::vector<uint64_t> buckets = std::vector<uint64_t>(kBuckets, 0);
+
+    double mean_ns() const { return count ? static_cast<double>(sum_ns) / static_cast<double>(count) : 0.0; }
+
+    /** Value at quantile q (0..1), in nanoseconds; 0 when empty. */
+    double percentile_ns(double q) const {
+        if (!count) return 0.0;
+        uint64_t rank = static_cast<uint64_t>(q * static_cast<double>(count - 1)) + 1;
+        uint64_t seen = 0;
+        for (size_t b = 0; b < kBuckets; ++b) {
+            seen += buckets[b];
+            if (seen >= rank) return std::min(bucket_value(b), static_cast<double>(max_ns));
+        }
+        return static_cast<double>(max_ns);
+    }
+
+    /** Samples recorded after `earlier` (a previous snapshot of the same histogram). */
+    LatencySnapshot since(const LatencySnapshot& earlier) const {
+        LatencySnapshot d;
+        d.count  = count - earlier.count;
+        d.sum_ns = sum_ns - earlier.sum_ns;
+        d.max_ns = max_ns;   // lifetime max: per-interval max isn't tracked
+        for (size_t b = 0; b < kBuckets; ++b) d.buckets[b] = buckets[b] - earlier.buckets[b];
+        return d;
+    }
+
+    void merge(const LatencySnapshot& o) {
+        count += o.count;
+        sum_ns += o.sum_ns;
+        max_ns = std::max(max_ns, o.max_ns);
+        for (size_t b = 0; b < kBuckets; ++b) buckets[b] += o.buckets[b];
+    }
+};
+
+namespace detail {
+
+constexpr size_t kMaxSlots = 128;   // threads with a private shard; later ones share one
+
+/**
+ * Process-wide slot per live thread.  A thread takes the lowest free
+ * slot on its first record and returns it on exit, so a thread-per-
+ * client server reuses shards instead of growing one per connection.
+ */
+class ThreadSlots {
+public:
+    static size_t mine() {
+        thread_local Holder holder;
+        return holder.slot;
+    }
+
+private:
+    struct Registry {
+        compat::Mutex mu;
+        std::vector<bool> used = std::vector<bool>(kMaxSlots, false);
+    };
+
+    static Registry& registry() {
+        static Registry* r = new Registry();   // outlives thread_local holders at exit
+        return *r;
+    }
+
+    struct Holder {
+        size_t slot = kMaxSlots;
+        Holder() {
+            Registry& r = registry();
+            compat::LockGuard<compat::Mutex> lock(r.mu);
+            for (size_t i = 0; i < kMaxSlots; ++i) {
+                if (!r.used[i]) {
+                    r.used[i] = true;
+                    slot = i;
+                    break;
+                }
+            }
+        }
+        ~Holder() {
+            if (slot == kMaxSlots) return;
+            Registry& r = registry();
+            compat::LockGuard<compat::Mutex> lock(r.mu);
+            r.used[slot] = false;
+        }
+    };
+};
+
+}  // namespace detail
+
+/**
+ * LatencyHistogram — lock-free latency recording with one shard per
+ * thread.  record() touches only the calling thread's shard (allocated
+ * on first use) with relaxed loads and stores, so the hot path has no
+ * shared cache lines and no read-modify-write instructions.  Threads
+ * past detail::kMaxSlots share an overflow shard and use fetch_add.
+ * snapshot() merges all shards; it may miss records in flight.
+ */
+class LatencyHistogram {
+public:
+    LatencyHistogram() {
+        for (auto& s : shards_) s.store(nullptr, std::memory_order_relaxed);
+    }
+
+    ~LatencyHistogram() {
+        for (auto& s : shards_) delete s.load(std::memory_order_acquire);
+    }
+
+    LatencyHistogram(const LatencyHistogram&) = delete;
+    LatencyHistogram& operator=(const LatencyHistogram&) = delete;
+
+    void record_ns(uint64_t ns) {
+        size_t slot = detail::ThreadSlots::mine();
+        Shard* s = shard(slot);
+        size_t b = bucket_of(ns);
+        if (slot < detail::kMaxSlots) {
+            bump(s->buckets[b], 1);
+            bump(s->sum_ns, ns);
+            if (ns > s->max_ns.load(std::memory_order_relaxed)) s->max_ns.store(ns, std::memory_order_relaxed);
+        } else {
+            s->buckets[b].fetch_add(1, std::memory_order_relaxed);
+            s->sum_ns.fetch_add(ns, std::memory_order_relaxed);
+            uint64_t m = s->max_ns.load(std::memory_order_relaxed);
+            while (ns > m && !s->max_ns.compare_exchange_weak(m, ns, std::memory_order_relaxed)) {}
+        }
+    }
+
+    /** Record the time since `start_ns` (a now_ns() reading). */
+    void record_since(uint64_t start_ns) { record_ns(now_ns() - start_ns); }
+
+    LatencySnapshot snapshot() const {
+        LatencySnapshot out;
+        for (const auto& p : shards_) {
+            const Shard* s = p.load(std::memory_order_acquire);
+            if (!s) continue;
+            out.sum_ns += s->sum_ns.load(std::memory_order_relaxed);
+            out.max_ns = std::max(out.max_ns, s->max_ns.load(std::memory_order_relaxed));
+            for (size_t b = 0; b < kBuckets; ++b) out.buckets[b] += s->buckets[b].load(std::memory_order_relaxed);
+        }
+        for (uint64_t c : out.buckets) out.count += c;
+        return out;
+    }
+
+private:
+    struct Shard {
+        std::atomic<uint64_t> buckets[kBuckets];
+        std::atomic<uint64_t> sum_ns{0};
+        std::atomic<uint64_t> max_ns{0};
+        Shard() {
+            for (auto& b : buckets) b.store(0, std::memory_order_relaxed);
+        }
+    };
+
+    static void bump(std::atomic<uint64_t>& a, uint64_t v) {
+        a.store(a.load(std::memory_order_relaxed) + v, std::memory_order_relaxed);
+    }
+
+    Shard* shard(size_t slot) {
+        Shard* s = shards_[slot].load(std::memory_order_acquire);
+        if (s) return s;
+        Shard* fresh = new Shard();
+        if (shards_[slot].compare_exchange_strong(s, fresh, std::memory_order_acq_rel)) return fresh;
+        delete fresh;   // only the overflow slot is ever raced for
+        return s;
+    }
+
+    std::atomic<Shard*> shards_[detail::kMaxSlots + 1];
+};
+
+/** Times a scope into a histogram. */
+class ScopedLatency {
+public:
+    explicit ScopedLatency(LatencyHistogram& h) : h_(h), start_(now_ns()) {}
+    ~ScopedLatency() { h_.record_since(start_); }
+
+    ScopedLatency(const ScopedLatency&) = delete;
+    ScopedLatency& operator=(const ScopedLatency&) = delete;
+
+private:
+    LatencyHistogram& h_;
+    uint64_t start_;
+};
+
+/** Named snapshots, in the order a subsystem reports them. */
+using LatencyReport = std::vector<std::pair<std::string, LatencySnapshot>>;
+
+/** "p50=1.003,p99=3.007,p99.9=8.015" in microseconds, as Redis INFO latencystats. */
+inline std::string format_percentiles_us(const LatencySnapshot& s) {
+    char buf[96];
+    std::snprintf(buf, sizeof(buf), "p50=%.3f,p99=%.3f,p99.9=%.3f",
+                  s.percentile_ns(0.50) / 1e3, s.percentile_ns(0.99) / 1e3, s.percentile_ns(0.999) / 1e3);
+    return buf;
+}
+
+}  // namespace metrics
+}  // namespace dcs
@@ -0,0 +1,335 @@
+#pragma once
+// ────────────────────────────────────────────────────────────────
+// Kernels: the dense float loops behind Tensor — blocked GEMM and
+// fused bias+tanh — with AVX2/FMA and NEON variants picked once at
+// runtime.  Everything is row-major with explicit leading dimensions.
+// ────────────────────────────────────────────────────────────────
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+    #define DCS_ML_X86 1
+    #include <immintrin.h>
+    #if defined(_MSC_VER) && !defined(__clang__)
+        #include <intrin.h>
+        #define DCS_ML_TARGET_AVX2
+    #else
+        #define DCS_ML_TARGET_AVX2 __attribute__((target("avx2,fma")))
+    #endif
+#elif defined(__aarch64__) || defined(_M_ARM64)
+    #define DCS_ML_NEON 1
+    #include <arm_neon.h>
+#endif
+
+#if defined(_MSC_VER)
+    #define DCS_ML_RESTRICT __restrict
+#else
+    #define DCS_ML_RESTRICT __restrict__
+#endif
+
+namespace dcs {
+namespace ml {
+namespace kernels {
+
+// C (+)= A·B with A: M×K, B: K×N, C: M×N.
+using GemmFn = void (*)(size_t M, size_t N, size_t K,
+                        const float* A, size_t lda, const float* B, size_t ldb,
+                        float* C, size_t ldc, bool accumulate);
+// C[r][j] = tanh(C[r][j] + bias[j]) in place.
+using BiasTanhFn = void (*)(float* C, size_t rows, size_t cols, size_t ldc, const float* bias);
+
+// Blocking: a KC×NC panel of B (256×256 floats = 256 KB) stays in L2
+// while every row block of A streams past it.
+constexpr size_t kBlockK = 256;
+constexpr size_t kBlockN = 256;
+
+// Rational tanh (the minimax fit Eigen uses), within ~2 ulp on the
+// clamped range and exactly ±1 beyond it.  Shared by all variants so
+// their results agree up to FMA rounding.
+constexpr float kTanhClamp = 7.90531110763549805f;
+constexpr float kTanhA[7] = {4.89352455891786e-03f, 6.37261928875436e-04f, 1.48572235717979e-05f,
+                             5.12229709037114e-08f, -8.60467152213735e-11f, 2.00018790482477e-13f,
+                             -2.76076847742355e-16f};
+constexpr float kTanhB[4] = {4.89352518554385e-03f, 2.26843463243900e-03f, 1.18534705686654e-04f,
+                             1.19825839466702e-06f};
+
+inline float FastTanh(float x) {
+    x = std::min(kTanhClamp, std::max(-kTanhClamp, x));
+    float x2 = x * x;
+    float p = kTanhA[6];
+    for (int i = 5; i >= 0; --i) p = p * x2 + kTanhA[i];
+    float q = kTanhB[3];
+    for (int i = 2; i >= 0; --i) q = q * x2 + kTanhB[i];
+    return x * p / q;
+}
+
+// ─── Scalar ────────────────────────────────────────────────────
+
+inline void GemmScalar(size_t M, size_t N, size_t K, const float* A, size_t lda,
+                       const float* B, size_t ldb, float* C, size_t ldc, bool accumulate) {
+    if (!accumulate) {
+        for (size_t i = 0; i < M; ++i) std::fill(C + i * ldc, C + i * ldc + N, 0.0f);
+    }
+    for (size_t jc = 0; jc < N; jc += kBlockN) {
+        size_t nb = std::min(kBlockN, N - jc);
+        for (size_t pc = 0; pc < K; pc += kBlockK) {
+            size_t kb = std::min(kBlockK, K - pc);
+            for (size_t i = 0; i < M; ++i) {
+                float* DCS_ML_RESTRICT c = C + i * ldc + jc;
+                for (size_t k = pc; k < pc + kb; ++k) {
+                    float a = A[i * lda + k];
+                    const float* DCS_ML_RESTRICT b = B + k * ldb + jc;
+                    for (size_t j = 0; j < nb; ++j) c[j] += a * b[j];
+                }
+            }
+        }
+    }
+}
+
+inline void BiasTanhScalar(float* C, size_t rows, size_t cols, size_t ldc, const float* bias) {
+    for (size_t r = 0; r < rows; ++r) {
+        float* c = C + r * ldc;
+        for (size_t j = 0; j < cols; ++j) c[j] = FastTanh(c[j] + bias[j]);
+    }
+}
+
+// ─── AVX2 + FMA ────────────────────────────────────────────────
+
+#if DCS_ML_X86
+namespace avx2 {
+
+// MR rows × 16 columns of C held in 2·MR registers across the k loop.
+template <int MR>
+DCS_ML_TARGET_AVX2 inline void Micro16(size_t kb, const float* A, size_t lda,
+                                       const float* B, size_t ldb, float* C, size_t ldc, bool load) {
+    __m256 acc[MR][2];
+    for (int r = 0; r < MR; ++r) {
+        acc[r][0] = load ? _mm256_loadu_ps(C + r * ldc) : _mm256_setzero_ps();
+        acc[r][1] = load ? _mm256_loadu_ps(C + r * ldc + 8) : _mm256_setzero_ps();
+    }
+    for (size_t k = 0; k < kb; ++k) {
+        __m256 b0 = _mm256_loadu_ps(B + k * ldb);
+        __m256 b1 = _mm256_loadu_ps(B + k * ldb + 8);
+        for (int r = 0; r < MR; ++r) {
+            __m256 a = _mm256_broadcast_ss(A + r * lda + k);
+            acc[r][0] = _mm256_fmadd_ps(a, b0, acc[r][0]);
+            acc[r][1] = _mm256_fmadd_ps(a, b1, acc[r][1]);
+        }
+    }
+    for (int r = 0; r < MR; ++r) {
+        _mm256_storeu_ps(C + r * ldc, acc[r][0]);
+        _mm256_storeu_ps(C + r * ldc + 8, acc[r][1]);
+    }
+}
+
+template <int MR>
+DCS_ML_TARGET_AVX2 inline void Micro8(size_t kb, const float* A, size_t lda,
+                                      const float* B, size_t ldb, float* C, size_t ldc, bool load) {
+    __m256 acc[MR];
+    for (int r = 0; r < MR; ++r) acc[r] = load ? _mm256_loadu_ps(C + r * ldc) : _mm256_setzero_ps();
+    for (size_t k = 0; k < kb; ++k) {
+        __m256 b = _mm256_loadu_ps(B + k * ldb);
+        for (int r = 0; r < MR; ++r) acc[r] = _mm256_fmadd_ps(_mm256_broadcast_ss(A + r * lda + k), b, acc[r]);
+    }
+    for (int r = 0; r < MR; ++r) _mm256_storeu_ps(C + r * ldc, acc[r]);
+}
+
+// One MR-row strip of a KC×NC block: vector columns, then a scalar tail.
+template <int MR>
+DCS_ML_TARGET_AVX2 inline void Strip(size_t nb, size_t kb, const float* A, size_t lda,
+                                     const float* B, size_t ldb, float* C, size_t ldc, bool load) {
+    size_t j = 0;
+    for (; j + 16 <= nb; j += 16) Micro16<MR>(kb, A, lda, B + j, ldb, C + j, ldc, load);
+    for (; j + 8 <= nb; j += 8) Micro8<MR>(kb, A, lda, B + j, ldb, C + j, ldc, load);
+    for (; j < nb; ++j) {
+        for (int r = 0; r < MR; ++r) {
+            float s = load ? C[r * ldc + j] : 0.0f;
+            for (size_t k = 0; k < kb; ++k) s += A[r * lda + k] * B[k * ldb + j];
+            C[r * ldc + j] = s;
+        }
+    }
+}
+
+DCS_ML_TARGET_AVX2 inline void Gemm(size_t M, size_t N, size_t K, const float* A, size_t lda,
+                                    const float* B, size_t ldb, float* C, size_t ldc, bool accumulate) {
+    if (K == 0) {
+        if (!accumulate) for (size_t i = 0; i < M; ++i) std::fill(C + i * ldc, C + i * ldc + N, 0.0f);
+        return;
+    }
+    for (size_t jc = 0; jc < N; jc += kBlockN) {
+        size_t nb = std::min(kBlockN, N - jc);
+        for (size_t pc = 0; pc < K; pc += kBlockK) {
+            size_t kb = std::min(kBlockK, K - pc);
+            bool load = accumulate || pc > 0;
+            const float* b = B + pc * ldb + jc;
+            size_t i = 0;
+            for (; i + 4 <= M; i += 4) Strip<4>(nb, kb, A + i * lda + pc, lda, b, ldb, C + i * ldc + jc, ldc, load);
+            switch (M - i) {
+                case 3: Strip<3>(nb, kb, A + i * lda + pc, lda, b, ldb, C + i * ldc + jc, ldc, load); break;
+                case 2: Strip<2>(nb, kb, A + i * lda + pc, lda, b, ldb, C + i * ldc + jc, ldc, load); break;
+                case 1: Strip<1>(nb, kb, A + i * lda + pc, lda, b, ldb, C + i * ldc + jc, ldc, load); break;
+                default: break;
+            }
+        }
+    }
+}
+
+DCS_ML_TARGET_AVX2 inline __m256 Tanh8(__m256 x) {
+    x = _mm256_min_ps(_mm256_set1_ps(kTanhClamp), _mm256_max_ps(_mm256_set1_ps(-kTanhClamp), x));
+    __m256 x2 = _mm256_mul_ps(x, x);
+    __m256 p = _mm256_set1_ps(kTanhA[6]);
+    for (int i = 5; i >= 0; --i) p = _mm256_fmadd_ps(p, x2, _mm256_set1_ps(kTanhA[i]));
+    __m256 q = _mm256_set1_ps(kTanhB[3]);
+    for (int i = 2; i >= 0; --i) q = _mm256_fmadd_ps(q, x2, _mm256_set1_ps(kTanhB[i]));
+    return _mm256_div_ps(_mm256_mul_ps(x, p), q);
+}
+
+DCS_ML_TARGET_AVX2 inline void BiasTanh(float* C, size_t rows, size_t cols, size_t ldc, const float* bias) {
+    for (size_t r = 0; r < rows; ++r) {
+        float* c = C + r * ldc;
+        size_t j = 0;
+        for (; j + 8 <= cols; j += 8) {
+            __m256 v = _mm256_add_ps(_mm256_loadu_ps(c + j), _mm256_loadu_ps(bias + j));
+            _mm256_storeu_ps(c + j, Tanh8(v));
+        }
+        for (; j < cols; ++j) c[j] = FastTanh(c[j] + bias[j]);
+    }
+}
+
+inline bool Supported() {
+#if defined(_MSC_VER) && !defined(__clang__)
+    int info[4];
+    __cpuid(info, 1);
+    bool fma = (info[2] & (1 << 12)) != 0;
+    bool osxsave = (info[2] & (1 << 27)) != 0;
+    if (!fma || !osxsave || (_xgetbv(0) & 6) != 6) return false;
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#else
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+#endif
+}
+
+}  // namespace avx2
+#endif  // DCS_ML_X86
+
+// ─── NEON (always present on AArch64) ──────────────────────────
+
+#if DCS_ML_NEON
+namespace neon {
+
+template <int MR>
+inline void Micro8(size_t kb, const float* A, size_t lda, const float* B, size_t ldb,
+                   float* C, size_t ldc, bool load) {
+    float32x4_t acc[MR][2];
+    for (int r = 0; r < MR; ++r) {
+        acc[r][0] = load ? vld1q_f32(C + r * ldc) : vdupq_n_f32(0.0f);
+        acc[r][1] = load ? vld1q_f32(C + r * ldc + 4) : vdupq_n_f32(0.0f);
+    }
+    for (size_t k = 0; k < kb; ++k) {
+        float32x4_t b0 = vld1q_f32(B + k * ldb);
+        float32x4_t b1 = vld1q_f32(B + k * ldb + 4);
+        for (int r = 0; r < MR; ++r) {
+            float32x4_t a = vdupq_n_f32(A[r * lda + k]);
+            acc[r][0] = vfmaq_f32(acc[r][0], a, b0);
+            acc[r][1] = vfmaq_f32(acc[r][1], a, b1);
+        }
+    }
+    for (int r = 0; r < MR; ++r) {
+        vst1q_f32(C + r * ldc, acc[r][0]);
+        vst1q_f32(C + r * ldc + 4, acc[r][1]);
+    }
+}
+
+template <int MR>
+inline void Strip(size_t nb, size_t kb, const float* A, size_t lda, const float* B, size_t ldb,
+                  float* C, size_t ldc, bool load) {
+    size_t j = 0;
+    for (; j + 8 <= nb; j += 8) Micro8<MR>(kb, A, lda, B + j, ldb, C + j, ldc, load);
+    for (; j < nb; ++j) {
+        for (int r = 0; r < MR; ++r) {
+            float s = load ? C[r * ldc + j] : 0.0f;
+            for (size_t k = 0; k < kb; ++k) s += A[r * lda + k] * B[k * ldb + j];
+            C[r * ldc + j] = s;
+        }
+    }
+}
+
+inline void Gemm(size_t M, size_t N, size_t K, const float* A, size_t lda,
+                 const float* B, size_t ldb, float* C, size_t ldc, bool accumulate) {
+    if (K == 0) {
+        if (!accumulate) for (size_t i = 0; i < M; ++i) std::fill(C + i * ldc, C + i * ldc + N, 0.0f);
+        return;
+    }
+    for (size_t jc = 0; jc < N; jc += kBlockN) {
+        size_t nb = std::min(kBlockN, N - jc);
+        for (size_t pc = 0; pc < K; pc += kBlockK) {
+            size_t kb = std::min(kBlockK, K - pc);
+            bool load = accumulate || pc > 0;
+            const float* b = B + pc * ldb + jc;
+            size_t i = 0;
+            for (; i + 4 <= M; i += 4) Strip<4>(nb, kb, A + i * lda + pc, lda, b, ldb, C + i * ldc + jc, ldc, load);
+            for (; i < M; ++i) Strip<1>(nb, kb, A + i * lda + pc, lda, b, ldb, C + i * ldc + jc, ldc, load);
+        }
+    }
+}
+
+inline void BiasTanh(float* C, size_t rows, size_t cols, size_t ldc, const float* bias) {
+    for (size_t r = 0; r < rows; ++r) {
+        float* c = C + r * ldc;
+        size_t j = 0;
+        for (; j + 4 <= cols; j += 4) {
+            float32x4_t x = vaddq_f32(vld1q_f32(c + j), vld1q_f32(bias + j));
+            x = vminq_f32(vdupq_n_f32(kTanhClamp), vmaxq_f32(vdupq_n_f32(-kTanhClamp), x));
+            float32x4_t x2 = vmulq_f32(x, x);
+            float32x4_t p = vdupq_n_f32(kTanhA[6]);
+            for (int i = 5; i >= 0; --i) p = vfmaq_f32(vdupq_n_f32(kTanhA[i]), p, x2);
+            float32x4_t q = vdupq_n_f32(kTanhB[3]);
+            for (int i = 2; i >= 0; --i) q = vfmaq_f32(vdupq_n_f32(kTanhB[i]), q, x2);
+            vst1q_f32(c + j, vdivq_f32(vmulq_f32(x, p), q));
+        }
+        for (; j < cols; ++j) c[j] = FastTanh(c[j] + bias[j]);
+    }
+}
+
+}  // namespace neon
+#endif  // DCS_ML_NEON
+
+// ─── Dispatch ──────────────────────────────────────────────────
+
+struct KernelSet {
+    const char* isa;
+    GemmFn      gemm;
+    BiasTanhFn  bias_tanh;
+};
+
+/** Fastest variant this CPU runs; resolved on first use. */
+inline const KernelSet& Active() {
+    static const KernelSet set = [] {
+#if DCS_ML_X86
+        if (avx2::Supported()) return KernelSet{"avx2", &avx2::Gemm, &avx2::BiasTanh};
+#elif DCS_ML_NEON
+        return KernelSet{"neon", &neon::Gemm, &neon::BiasTanh};
+#endif
+        return KernelSet{"scalar", &GemmScalar, &BiasTanhScalar};
+    }();
+    return set;
+}
+
+inline const char* ActiveIsa() { return Active().isa; }
+
+inline void Gemm(size_t M, size_t N, size_t K, const float* A, size_t lda,
+                 const float* B, size_t ldb, float* C, size_t ldc, bool accumulate = false) {
+    Active().gemm(M, N, K, A, lda, B, ldb, C, ldc, accumulate);
+}
+
+inline void BiasTanh(float* C, size_t rows, size_t cols, size_t ldc, const float* bias) {
+    Active().bias_tanh(C, rows, cols, ldc, bias);
+}
+
+}  // namespace kernels
+}  // namespace ml
+}  // namespace dcs
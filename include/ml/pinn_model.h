@@ -42,24 +42,34 @@ public:
 
     // Input: Nx2 tensor (x, t pairs)
     // Output: Nx1 tensor (predicted load)
+    // Keeps every layer's activations for TrainStep; the buffers are
+    // reused across calls.
     Tensor Forward(const Tensor& input) {
-        // Layer 0: input → hidden
-        activations_.clear();
-        activations_.push_back(input);
-
-        Tensor h = input.MatMul(weights_[0]).AddBias(biases_[0]).Tanh();
-        activations_.push_back(h);
-
-        // Hidden layers
-        for (int i = 1; i < config_.num_layers; i++) {
-            h = h.MatMul(weights_[i]).AddBias(biases_[i]).Tanh();
-            activations_.push_back(h);
+        size_t layers = weights_.size();
+        activations_.resize(layers + 1);
+        activations_[0] = input;
+        for (size_t i = 0; i < layers; i++) {
+            activations_[i].MatMulInto(weights_[i], activations_[i + 1]);
+            if (i + 1 < layers) activations_[i + 1].AddBiasTanhInPlace(biases_[i]);
+            else                activations_[i + 1].AddBiasInPlace(biases_[i]);
         }
+        return activations_.back();
+    }
 
-        // Output layer
-        Tensor out = h.MatMul(weights_.back()).AddBias(biases_.back());
-        activations_.push_back(out);
-        return out;
+    // Inference-only forward pass: ping-pongs between two workspace
+    // tensors, so once warm it allocates nothing.  The result is valid
+    // until the next call.
+    const Tensor& Infer(const Tensor& input) {
+        size_t layers = weights_.size();
+        const Tensor* in = &input;
+        for (size_t i = 0; i < layers; i++) {
+            Tensor& out = infer_ws_[i % 2];
+            in->MatMulInto(weights_[i], out);
+            if (i + 1 < layers) out.AddBiasTanhInPlace(biases_[i]);
+            else                out.AddBiasInPlace(biases_[i]);
+            in = &out;
+        }
+        return *in;
     }
 
     // ─── Training Step ─────────────────────────────────────────
@@ -90,7 +100,6 @@ public:
 
         for (int i = num_weight_layers - 1; i >= 0; i--) {
             Tensor& act_input = activations_[i];
-            Tensor& pre_act = activations_[i + 1];
 
             // Gradient w.r.t. weights
             Tensor grad_w = act_input.Transpose().MatMul(grad);
@@ -103,18 +112,11 @@ public:
             // Propagate gradient to previous layer
             if (i > 0) {
                 grad = grad.MatMul(weights_[i].Transpose());
-                // Tanh gradient
-                Tensor tanh_grad = activations_[i].TanhGrad();
-                // activations_[i] is post-tanh, need pre-tanh for gradient
-                // Approximate: 1 - tanh²(x) where tanh(x) = activations_[i]
-                Tensor one_minus_sq(tanh_grad.Rows(), tanh_grad.Cols(), 1.0f);
-                for (size_t r = 0; r < activations_[i].Rows(); r++) {
-                    for (size_t c = 0; c < activations_[i].Cols(); c++) {
-                        float t = activations_[i](r, c);
-                        one_minus_sq(r, c) = 1.0f - t * t;
-                    }
-                }
-                grad = grad * one_minus_sq;
+                // Tanh gradient: activations_[i] is post-tanh, so
+                // d tanh = 1 - activations_[i]²
+                float* g = grad.Data();
+                const float* a = activations_[i].Data();
+                for (size_t k = 0; k < grad.Size(); k++) g[k] *= 1.0f - a[k] * a[k];
             }
         }
 
@@ -125,22 +127,21 @@ public:
 
     // Predict load for a single (shard_id, time) pair
     float Predict(float shard_id, float time) {
-        Tensor input(1, 2);
-        input(0, 0) = shard_id;
-        input(0, 1) = time;
-        Tensor out = Forward(input);
-        return out(0, 0);
+        infer_in_.Resize(1, 2);
+        infer_in_(0, 0) = shard_id;
+        infer_in_(0, 1) = time;
+        return Infer(infer_in_)(0, 0);
     }
 
-    // Predict loads for all shards at a given time
+    // Predict loads for all shards at a given time: one batched pass
     std::vector<float> PredictAllShards(int num_shards, float time) {
         std::vector<float> predictions(num_shards);
-        Tensor input(num_shards, 2);
+        infer_in_.Resize(num_shards, 2);
         for (int i = 0; i < num_shards; i++) {
-            input(i, 0) = static_cast<float>(i) / static_cast<float>(num_shards);
-            input(i, 1) = time;
+            infer_in_(i, 0) = static_cast<float>(i) / static_cast<float>(num_shards);
+            infer_in_(i, 1) = time;
         }
-        Tensor out = Forward(input);
+        const Tensor& out = Infer(infer_in_);
         for (int i = 0; i < num_shards; i++) {
             predictions[i] = std::max(0.0f, out(i, 0));
         }
@@ -201,29 +202,35 @@ private:
 
     float ComputePDEResidual(const Tensor& input) {
         // Burgers' equation: ∂u/∂t + u·∂u/∂x = ν·∂²u/∂x²
-        // Use finite differences to approximate derivatives
+        // Use finite differences to approximate derivatives.  The five
+        // stencil points of every sample go through one batched pass.
         float dx = config_.dx;
-        float residual = 0.0f;
         size_t N = input.Rows();
         if (N == 0) return 0.0f;
 
+        // Rows 5i..5i+4: (x,t), (x,t+dx), (x,t-dx), (x+dx,t), (x-dx,t)
+        static const float kStencil[5][2] = {{0, 0}, {0, 1}, {0, -1}, {1, 0}, {-1, 0}};
+        pde_in_.Resize(5 * N, 2);
         for (size_t i = 0; i < N; i++) {
-            float x = input(i, 0);
-            float t = input(i, 1);
+            for (size_t s = 0; s < 5; s++) {
+                pde_in_(5 * i + s, 0) = input(i, 0) + kStencil[s][0] * dx;
+                pde_in_(5 * i + s, 1) = input(i, 1) + kStencil[s][1] * dx;
+            }
+        }
+        const Tensor& u_all = Infer(pde_in_);
 
-            // u at (x, t)
-            float u = Predict_Internal(x, t);
+        float residual = 0.0f;
+        for (size_t i = 0; i < N; i++) {
+            float u    = u_all(5 * i, 0);
+            float u_tp = u_all(5 * i + 1, 0);
+            float u_tm = u_all(5 * i + 2, 0);
+            float u_xp = u_all(5 * i + 3, 0);
+            float u_xm = u_all(5 * i + 4, 0);
 
             // ∂u/∂t ≈ (u(x, t+dt) - u(x, t-dt)) / 2dt
-            float u_tp = Predict_Internal(x, t + dx);
-            float u_tm = Predict_Internal(x, t - dx);
             float du_dt = (u_tp - u_tm) / (2.0f * dx);
-
             // ∂u/∂x ≈ (u(x+dx, t) - u(x-dx, t)) / 2dx
-            float u_xp = Predict_Internal(x + dx, t);
-            float u_xm = Predict_Internal(x - dx, t);
             float du_dx = (u_xp - u_xm) / (2.0f * dx);
-
             // ∂²u/∂x² ≈ (u(x+dx, t) - 2u(x, t) + u(x-dx, t)) / dx²
             float d2u_dx2 = (u_xp - 2.0f * u + u_xm) / (dx * dx);
 
@@ -234,25 +241,15 @@ private:
         return residual / static_cast<float>(N);
     }
 
-    float Predict_Internal(float x, float t) {
-        Tensor input(1, 2);
-        input(0, 0) = x;
-        input(0, 1) = t;
-        // Quick forward without storing activations
-        Tensor h = input.MatMul(weights_[0]).AddBias(biases_[0]).Tanh();
-        for (int i = 1; i < config_.num_layers; i++) {
-            h = h.MatMul(weights_[i]).AddBias(biases_[i]).Tanh();
-        }
-        Tensor out = h.MatMul(weights_.back()).AddBias(biases_.back());
-        return out(0, 0);
-    }
-
     PINNConfig config_;
     std::vector<Tensor>               weights_;
     std::vector<Tensor>               biases_;
     std::vector<AdamState>    adam_w_;
     std::vector<AdamState>    adam_b_;
     std::vector<Tensor>               activations_;
+    Tensor infer_ws_[2];   // Infer() ping-pong buffers
+    Tensor infer_in_;      // Predict / PredictAllShards input
+    Tensor pde_in_;        // stencil points for the PDE residual
 
     float total_loss_;
     float data_loss_;
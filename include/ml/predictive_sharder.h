@@ -43,7 +43,7 @@ public:
     explicit PredictiveSharder(int num_shards, const PINNConfig& config = PINNConfig())
         : num_shards_(num_shards), pinn_(config), running_(false),
           start_time_(std::chrono::steady_clock::now()),
-          telemetry_head_(0), telemetry_count_(0) {
+          telemetry_head_(0), telemetry_count_(0), train_micros_(0) {
         telemetry_.resize(kRingBufferSize);
     }
 
@@ -73,13 +73,13 @@ public:
     // ─── Predictions ───────────────────────────────────────────
 
     std::vector<float> PredictLoads(float future_time_offset = 0.0f) {
-        compat::LockGuard<compat::Mutex> lock(mu_);
+        compat::LockGuard<compat::Mutex> lock(model_mu_);
         float t = CurrentTime() + future_time_offset;
         return pinn_.PredictAllShards(num_shards_, t);
     }
 
     float PredictShardLoad(int shard_id, float future_time_offset = 0.0f) {
-        compat::LockGuard<compat::Mutex> lock(mu_);
+        compat::LockGuard<compat::Mutex> lock(model_mu_);
         float t = CurrentTime() + future_time_offset;
         float x = static_cast<float>(shard_id) / static_cast<float>(num_shards_);
         return pinn_.Predict(x, t);
@@ -122,6 +122,7 @@ public:
         float pde_loss;
         int   num_parameters;
         size_t telemetry_count;
+        uint64_t train_us_total;   // time spent in TrainStep so far
     };
 
     SharderStats GetStats() const {
@@ -132,7 +133,8 @@ public:
             pinn_stats.data_loss,
             pinn_stats.pde_loss,
             pinn_stats.num_parameters,
-            telemetry_count_
+            telemetry_count_,
+            train_micros_.load()
         };
     }
 
@@ -141,25 +143,34 @@ private:
         while (running_) {
             compat::this_thread::sleep_for(std::chrono::seconds(5));
 
-            compat::LockGuard<compat::Mutex> lock(mu_);
-            size_t count = std::min(telemetry_count_, static_cast<size_t>(kTrainBatchSize));
-            if (count < 8) continue;  // need minimum data
-
-            // Build training batch from telemetry ring buffer
-            Tensor data_x(count, 2);
-            Tensor data_y(count, 1);
-
-            size_t start = (telemetry_head_ > count) ? telemetry_head_ - count : 0;
-            for (size_t i = 0; i < count; i++) {
-                size_t idx = (start + i) % kRingBufferSize;
-                const auto& t = telemetry_[idx];
-                data_x(i, 0) = static_cast<float>(t.shard_id) /
-                               static_cast<float>(num_shards_);
-                data_x(i, 1) = t.timestamp;
-                data_y(i, 0) = t.load;
+            Tensor data_x, data_y;
+            {
+                compat::LockGuard<compat::Mutex> lock(mu_);
+                size_t count = std::min(telemetry_count_, static_cast<size_t>(kTrainBatchSize));
+                if (count < 8) continue;  // need minimum data
+
+                // Build training batch from telemetry ring buffer
+                data_x = Tensor(count, 2);
+                data_y = Tensor(count, 1);
+
+                size_t start = (telemetry_head_ > count) ? telemetry_head_ - count : 0;
+                for (size_t i = 0; i < count; i++) {
+                    size_t idx = (start + i) % kRingBufferSize;
+                    const auto& t = telemetry_[idx];
+                    data_x(i, 0) = static_cast<float>(t.shard_id) /
+                                   static_cast<float>(num_shards_);
+                    data_x(i, 1) = t.timestamp;
+                    data_y(i, 0) = t.load;
+                }
             }
 
+            // Telemetry keeps flowing while the model trains
+            compat::LockGuard<compat::Mutex> lock(model_mu_);
+            auto t0 = std::chrono::steady_clock::now();
             pinn_.TrainStep(data_x, data_y);
+            train_micros_.fetch_add(static_cast<uint64_t>(
+                std::chrono::duration_cast<std::chrono::microseconds>(
+                    std::chrono::steady_clock::now() - t0).count()));
         }
     }
 
@@ -180,7 +191,10 @@ private:
     size_t       telemetry_head_;
     size_t       telemetry_count_;
 
-    compat::Mutex mu_;
+    compat::Atomic<uint64_t> train_micros_;
+
+    compat::Mutex mu_;         // telemetry ring
+    compat::Mutex model_mu_;   // pinn_
     compat::Thread   trainer_thread_;
 };
 
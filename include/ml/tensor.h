@@ -2,7 +2,8 @@
 // ────────────────────────────────────────────────────────────────
 // Tensor: Minimal 2D matrix for neural network computations.
 // Supports MatMul, element-wise ops, Tanh, Xavier init, SGD/Adam.
-// Pure C++ — no external dependencies.
+// Pure C++ — no external dependencies; MatMul and the fused bias+tanh
+// run on the SIMD kernels in kernels.h.
 // ────────────────────────────────────────────────────────────────
 
 #include <algorithm>
@@ -12,6 +13,8 @@
 #include <random>
 #include <vector>
 
+#include "kernels.h"
+
 namespace dcs {
 namespace ml {
 
@@ -54,22 +57,32 @@ public:
     float* Data()       { return data_.data(); }
     const float* Data() const { return data_.data(); }
 
+    // Reshape, keeping the allocation when it is large enough, so a
+    // tensor reused as a workspace stops allocating once warm.
+    // Contents are unspecified afterwards.
+    void Resize(size_t r, size_t c) {
+        rows_ = r;
+        cols_ = c;
+        data_.resize(r * c);
+    }
+
     // ─── Matrix Operations ─────────────────────────────────────
 
     Tensor MatMul(const Tensor& b) const {
-        assert(cols_ == b.rows_);
-        Tensor out(rows_, b.cols_);
-        for (size_t i = 0; i < rows_; i++) {
-            for (size_t k = 0; k < cols_; k++) {
-                float a_ik = data_[i * cols_ + k];
-                for (size_t j = 0; j < b.cols_; j++) {
-                    out.data_[i * b.cols_ + j] += a_ik * b.data_[k * b.cols_ + j];
-                }
-            }
-        }
+        Tensor out;
+        MatMulInto(b, out);
         return out;
     }
 
+    // out = this · b, reusing out's storage.  out must not alias either operand.
+    void MatMulInto(const Tensor& b, Tensor& out) const {
+        assert(cols_ == b.rows_);
+        assert(&out != this && &out != &b);
+        out.Resize(rows_, b.cols_);
+        kernels::Gemm(rows_, b.cols_, cols_, data_.data(), cols_,
+                      b.data_.data(), b.cols_, out.data_.data(), b.cols_);
+    }
+
     Tensor Transpose() const {
         Tensor out(cols_, rows_);
         for (size_t i = 0; i < rows_; i++)
@@ -121,6 +134,19 @@ public:
         return out;
     }
 
+    void AddBiasInPlace(const Tensor& bias) {
+        assert(bias.rows_ == 1 && bias.cols_ == cols_);
+        for (size_t i = 0; i < rows_; i++)
+            for (size_t j = 0; j < cols_; j++)
+                data_[i * cols_ + j] += bias.data_[j];
+    }
+
+    // Fused tanh(x + bias) in place: one pass over the layer output
+    void AddBiasTanhInPlace(const Tensor& bias) {
+        assert(bias.rows_ == 1 && bias.cols_ == cols_);
+        kernels::BiasTanh(data_.data(), rows_, cols_, cols_, bias.data_.data());
+    }
+
     // ─── Activation Functions ──────────────────────────────────
 
     Tensor Tanh() const {
@@ -1,12 +1,19 @@
 #pragma once
 
+#include "../cluster/cluster.h"   // first: pulls in winsock before windows.h
+#include "glob.h"
 #include "resp_parser.h"
 #include "../sync/cache_manager.h"
 
 #include <string>
+#include <string_view>
 #include <vector>
+#include <initializer_list>
 #include <algorithm>
 #include <cctype>
+#include <cstdio>
+#include <charconv>
+#include <functional>
 #include <iostream>
 
 namespace dcs {
@@ -17,22 +24,74 @@ namespace network {
  *
  * Supported commands:
  *   GET <key>                -> Bulk string or Null
- *   SET <key> <value>        -> +OK
+ *   SET <key> <value> [EX s|PX ms|KEEPTTL]  -> +OK
+ *   SETEX <key> <s> <value>  -> +OK
+ *   EXPIRE/PEXPIRE <key> <t> -> :1 if the TTL was set, :0 if no such key
+ *   TTL/PTTL <key>           -> :<remaining> | :-1 no TTL | :-2 no key
+ *   PERSIST <key>            -> :1 if a TTL was removed
+ *   MGET <key> [key ...]     -> Array of bulk strings / nulls
+ *   MSET <key> <value> [...] -> +OK
  *   DEL <key> [key ...]      -> :<count>
- *   EXISTS <key>             -> :0 or :1
- *   KEYS *                   -> Array of bulk strings
+ *   EXISTS <key> [key ...]   -> :<count of keys that exist>
+ *   KEYS <pattern>           -> Array of bulk strings
+ *   SCAN <cursor> [MATCH p] [COUNT n] -> [next cursor, [keys...]]
  *   DBSIZE                   -> :<count>
  *   FLUSHALL                 -> +OK
+ *   HOTKEYS [COUNT n]        -> [[key, est. GETs, segment, replicated 0|1], ...]
  *   PING [message]           -> +PONG or bulk string
  *   INFO                     -> Bulk string with stats
+ *   HELLO [2|3]              -> server info (a map under RESP3); picks the protocol
+ *   CLIENT ID                -> :<connection id>
+ *   CLIENT TRACKING ON|OFF [BCAST] [PREFIX p ...]  -> +OK (RESP3 only)
  *   COMMAND                  -> +OK  (stub for redis-cli handshake)
  *   QUIT                     -> +OK  (signals disconnect)
  *   CONFIG GET <param>       -> Array (stub for redis-cli compat)
+ *
+ * With tracking on, a write to a key this connection has read (or, with
+ * BCAST, to any key under its prefixes) arrives as an out-of-band
+ * ">2 invalidate [keys]" push, so the client's near cache can drop it.
+ * Pushes go through the transport's set_push() hook.
+ *
+ * With a cluster::Cluster attached, keyed commands are routed first and
+ * may be answered with -MOVED / -ASK <slot> <host:port>, -CROSSSLOT or
+ * -TRYAGAIN instead (see Cluster::route).  Cluster commands:
+ *   ASKING                   -> +OK; the next command may use an importing slot
+ *   CLUSTER KEYSLOT <key>    -> :<slot>
+ *   CLUSTER MYID | INFO | NODES | SLOTS
+ *   CLUSTER SETSLOT <slot> IMPORTING <from> | MIGRATING <to> | NODE <id> | STABLE
+ *   CLUSTER IMPORT <slot> <key> <value> <ttl_ms> [...]  -> :<stored>
+ *   CLUSTER LOAD             -> :<requests served locally>
+ *   CLUSTER MIGRATE <first> <last> <node>  -> :<slots moved> (blocks until done)
  */
 class ClientHandler {
 public:
-    explicit ClientHandler(sync::CacheManager* manager)
-        : manager_(manager) {}
+    explicit ClientHandler(sync::CacheManager* manager, cluster::Cluster* cluster = nullptr)
+        : manager_(manager), cluster_(cluster), id_(next_client_id()) {}
+
+    ~ClientHandler() {
+        if (tracking_) manager_->tracking().unsubscribe(id_);
+    }
+
+    ClientHandler(const ClientHandler&) = delete;
+    ClientHandler& operator=(const ClientHandler&) = delete;
+
+    /** Sends one RESP3 frame to this connection; callable from any thread. */
+    using PushFn = std::function<void(std::string frame)>;
+
+    /** Install the transport's push channel (required for CLIENT TRACKING). */
+    void set_push(PushFn push) { push_ = std::move(push); }
+
+    uint64_t id() const { return id_; }
+
+    /** ">2 invalidate [keys]"; no keys encodes "everything" (FLUSHALL). */
+    static std::string invalidation_frame(const std::vector<std::string>& keys) {
+        std::string f;
+        RESPParser::append_push_header(f, 2);
+        RESPParser::append_bulk_string(f, "invalidate");
+        if (keys.empty()) RESPParser::append_resp3_null(f);
+        else              RESPParser::append_array(f, keys);
+        return f;
+    }
 
     struct Response {
         std::string data;
@@ -40,107 +99,695 @@ public:
     };
 
     /**
-     * Execute a single tokenized command and return the RESP-encoded response.
+     * Execute a single tokenized command, appending its RESP-encoded reply
+     * to `out`.  Returns true when the connection should close afterwards.
+     * Tokens are views into the connection's input buffer (see RESPStream)
+     * and only need to stay valid for the duration of the call.
+     * Timed into the command's latency histogram (see INFO latencystats).
      */
-    Response execute(const std::vector<std::string>& tokens) {
+    bool execute_into(const std::vector<std::string_view>& tokens, std::string& out) {
+        const uint64_t t0 = metrics::now_ns();
+        bool close = dispatch(tokens, out);
+        command_latency()[command_index(tokens.empty() ? std::string_view() : tokens[0])].record_since(t0);
+        return close;
+    }
+
+    /** Per-command latency, process-wide, for commands that have run. */
+    static void collect_command_latency(metrics::LatencyReport& out) {
+        for (size_t i = 0; i < kCommandCount; ++i) {
+            metrics::LatencySnapshot snap = command_latency()[i].snapshot();
+            if (!snap.count) continue;
+            std::string name = "cmd_";
+            for (const char* c = kCommandNames[i]; *c; ++c) name += static_cast<char>(std::tolower(static_cast<unsigned char>(*c)));
+            out.emplace_back(std::move(name), std::move(snap));
+        }
+    }
+
+private:
+    // ── Command latency ──────────────────────────────────────────
+    // Indexed by position in kCommandNames; the last slot ("other")
+    // takes unknown commands.
+
+    static constexpr const char* kCommandNames[] = {
+        "GET", "SET", "SETEX", "MGET", "MSET", "DEL", "EXISTS", "EXPIRE", "PEXPIRE",
+        "TTL", "PTTL", "PERSIST", "KEYS", "SCAN", "DBSIZE", "FLUSHALL", "PING", "INFO",
+        "COMMAND", "CONFIG", "CLIENT", "QUIT", "ASKING", "CLUSTER", "HOTKEYS", "HELLO",
+        "OTHER",
+    };
+    static constexpr size_t kCommandCount = sizeof(kCommandNames) / sizeof(kCommandNames[0]);
+
+    static metrics::LatencyHistogram* command_latency() {
+        static metrics::LatencyHistogram* table = new metrics::LatencyHistogram[kCommandCount];   // outlives the server threads
+        return table;
+    }
+
+    static uint64_t next_client_id() {
+        static compat::Atomic<uint64_t> next{1};
+        return next++;
+    }
+
+    static size_t command_index(std::string_view cmd) {
+        for (size_t i = 0; i + 1 < kCommandCount; ++i) {
+            if (iequals(cmd, kCommandNames[i])) return i;
+        }
+        return kCommandCount - 1;
+    }
+
+    bool dispatch(const std::vector<std::string_view>& tokens, std::string& out) {
         if (tokens.empty()) {
-            return {RESPParser::encode_error("empty command")};
+            RESPParser::append_error(out, "empty command");
+            return false;
         }
 
-        std::string cmd = to_upper(tokens[0]);
+        std::string_view cmd = tokens[0];
+
+        // ── Cluster routing ──────────────────────────────────────
+        if (cluster_) {
+            if (iequals(cmd, "ASKING")) {
+                asking_ = true;
+                RESPParser::append_simple_string(out, "OK");
+                return false;
+            }
+            bool asking = asking_;
+            asking_ = false;
+            if (iequals(cmd, "CLUSTER")) return cluster_command(tokens, out);
+            if (!routed_here(tokens, asking, out)) return false;
+        }
 
         // ── Core Data Commands ───────────────────────────────────
-        if (cmd == "GET") {
-            if (tokens.size() < 2) return {RESPParser::encode_error("wrong number of arguments for 'GET'")};
+        if (iequals(cmd, "GET")) {
+            if (tokens.size() < 2) return wrong_args(out, "GET");
+            if (tracking_ && !bcast_) manager_->tracking().track(id_, tokens[1]);   // before the read
             auto result = manager_->get(tokens[1]);
-            if (result.hit) return {RESPParser::encode_bulk_string(result.value)};
-            return {RESPParser::encode_null()};
+            if (result.hit) RESPParser::append_bulk_string(out, result.value);
+            else            RESPParser::append_null(out);
+            return false;
         }
 
-        if (cmd == "SET") {
-            if (tokens.size() < 3) return {RESPParser::encode_error("wrong number of arguments for 'SET'")};
+        if (iequals(cmd, "SET")) {
+            if (tokens.size() < 3) return wrong_args(out, "SET");
+            // Trailing EX/PX/KEEPTTL options; everything before is the value
+            size_t end = tokens.size();
+            uint64_t expire_at = 0;
+            while (end > 3) {
+                if (iequals(tokens[end - 1], "KEEPTTL")) {
+                    expire_at = cache::kKeepTTL;
+                    --end;
+                    continue;
+                }
+                bool ex = end > 4 && iequals(tokens[end - 2], "EX");
+                bool px = end > 4 && iequals(tokens[end - 2], "PX");
+                if (!ex && !px) break;
+                int64_t ttl;
+                if (!parse_int(tokens[end - 1], ttl)) return not_an_integer(out);
+                if (ttl <= 0) {
+                    RESPParser::append_error(out, "invalid expire time in 'set' command");
+                    return false;
+                }
+                expire_at = deadline(ttl, ex ? 1000 : 1);
+                end -= 2;
+            }
             // Concatenate remaining tokens for values with spaces (inline mode)
-            std::string value = tokens[2];
-            for (size_t i = 3; i < tokens.size(); ++i) {
-                value += " " + tokens[i];
+            std::string value(tokens[2]);
+            for (size_t i = 3; i < end; ++i) {
+                value += ' ';
+                value.append(tokens[i].data(), tokens[i].size());
+            }
+            manager_->put(std::string(tokens[1]), value, expire_at);
+            RESPParser::append_simple_string(out, "OK");
+            return false;
+        }
+
+        if (iequals(cmd, "SETEX")) {
+            if (tokens.size() != 4) return wrong_args(out, "SETEX");
+            int64_t ttl;
+            if (!parse_int(tokens[2], ttl)) return not_an_integer(out);
+            if (ttl <= 0) {
+                RESPParser::append_error(out, "invalid expire time in 'setex' command");
+                return false;
             }
-            manager_->put(tokens[1], value);
-            return {RESPParser::encode_simple_string("OK")};
+            manager_->put(std::string(tokens[1]), std::string(tokens[3]), deadline(ttl, 1000));
+            RESPParser::append_simple_string(out, "OK");
+            return false;
         }
 
-        if (cmd == "DEL") {
-            if (tokens.size() < 2) return {RESPParser::encode_error("wrong number of arguments for 'DEL'")};
-            int64_t count = 0;
-            for (size_t i = 1; i < tokens.size(); ++i) {
-                if (manager_->del(tokens[i])) ++count;
+        if (iequals(cmd, "EXPIRE") || iequals(cmd, "PEXPIRE")) {
+            bool secs = iequals(cmd, "EXPIRE");
+            if (tokens.size() != 3) return wrong_args(out, secs ? "EXPIRE" : "PEXPIRE");
+            int64_t ttl;
+            if (!parse_int(tokens[2], ttl)) return not_an_integer(out);
+            std::string key(tokens[1]);
+            bool ok;
+            if (ttl > 0) {
+                ok = manager_->expire(key, deadline(ttl, secs ? 1000 : 1));
+            } else {
+                // A non-positive TTL deletes the key right away
+                ok = manager_->ttl_ms(key) != -2;
+                if (ok) manager_->del(key);
             }
-            return {RESPParser::encode_integer(count)};
+            RESPParser::append_integer(out, ok ? 1 : 0);
+            return false;
         }
 
-        if (cmd == "EXISTS") {
-            if (tokens.size() < 2) return {RESPParser::encode_error("wrong number of arguments for 'EXISTS'")};
-            return {RESPParser::encode_integer(manager_->exists(tokens[1]) ? 1 : 0)};
+        if (iequals(cmd, "TTL") || iequals(cmd, "PTTL")) {
+            bool secs = iequals(cmd, "TTL");
+            if (tokens.size() != 2) return wrong_args(out, secs ? "TTL" : "PTTL");
+            int64_t ttl = manager_->ttl_ms(std::string(tokens[1]));
+            if (ttl > 0 && secs) ttl = (ttl + 500) / 1000;
+            RESPParser::append_integer(out, ttl);
+            return false;
         }
 
-        if (cmd == "KEYS") {
-            auto all_keys = manager_->keys();
-            return {RESPParser::encode_array(all_keys)};
+        if (iequals(cmd, "PERSIST")) {
+            if (tokens.size() != 2) return wrong_args(out, "PERSIST");
+            RESPParser::append_integer(out, manager_->persist(std::string(tokens[1])) ? 1 : 0);
+            return false;
         }
 
-        if (cmd == "DBSIZE") {
-            return {RESPParser::encode_integer(static_cast<int64_t>(manager_->size()))};
+        // Multi-key commands: one grouped pass per segment (CacheManager::*_many)
+        if (iequals(cmd, "MGET")) {
+            if (tokens.size() < 2) return wrong_args(out, "MGET");
+            if (tracking_ && !bcast_) {
+                for (size_t i = 1; i < tokens.size(); ++i) manager_->tracking().track(id_, tokens[i]);
+            }
+            auto results = manager_->get_many(
+                std::vector<std::string_view>(tokens.begin() + 1, tokens.end()));
+            RESPParser::append_array_header(out, results.size());
+            for (const auto& r : results) {
+                if (r.hit) RESPParser::append_bulk_string(out, r.value);
+                else       RESPParser::append_null(out);
+            }
+            return false;
+        }
+
+        if (iequals(cmd, "MSET")) {
+            if (tokens.size() < 3 || tokens.size() % 2 == 0) return wrong_args(out, "MSET");
+            std::vector<std::pair<std::string_view, std::string_view>> entries;
+            entries.reserve(tokens.size() / 2);
+            for (size_t i = 1; i + 1 < tokens.size(); i += 2) entries.emplace_back(tokens[i], tokens[i + 1]);
+            manager_->put_many(entries);
+            RESPParser::append_simple_string(out, "OK");
+            return false;
+        }
+
+        if (iequals(cmd, "DEL")) {
+            if (tokens.size() < 2) return wrong_args(out, "DEL");
+            size_t count = manager_->del_many(
+                std::vector<std::string_view>(tokens.begin() + 1, tokens.end()));
+            RESPParser::append_integer(out, static_cast<int64_t>(count));
+            return false;
+        }
+
+        if (iequals(cmd, "EXISTS")) {
+            if (tokens.size() < 2) return wrong_args(out, "EXISTS");
+            size_t count = manager_->exists_many(
+                std::vector<std::string_view>(tokens.begin() + 1, tokens.end()));
+            RESPParser::append_integer(out, static_cast<int64_t>(count));
+            return false;
+        }
+
+        if (iequals(cmd, "KEYS")) {
+            auto keys = manager_->keys();
+            if (tokens.size() >= 2 && tokens[1] != "*") {
+                keys.erase(std::remove_if(keys.begin(), keys.end(),
+                    [&](const std::string& k) { return !glob_match(tokens[1], k); }), keys.end());
+            }
+            RESPParser::append_array(out, keys);
+            return false;
+        }
+
+        if (iequals(cmd, "SCAN")) {
+            if (tokens.size() < 2 || tokens.size() % 2 != 0) return wrong_args(out, "SCAN");
+            std::string_view pattern = "*";
+            int64_t count = 10;
+            for (size_t i = 2; i + 1 < tokens.size(); i += 2) {
+                if (iequals(tokens[i], "MATCH")) {
+                    pattern = tokens[i + 1];
+                } else if (iequals(tokens[i], "COUNT")) {
+                    if (!parse_int(tokens[i + 1], count)) return not_an_integer(out);
+                    if (count < 1) {
+                        RESPParser::append_error(out, "syntax error");
+                        return false;
+                    }
+                } else {
+                    RESPParser::append_error(out, "syntax error");
+                    return false;
+                }
+            }
+            // COUNT bounds the keys examined; MATCH filters them afterwards,
+            // so a batch may come back empty with a non-zero cursor.
+            auto page = manager_->scan(tokens[1], glob_literal_prefix(pattern), static_cast<size_t>(count));
+            if (!page.valid) {
+                RESPParser::append_error(out, "invalid cursor");
+                return false;
+            }
+            RESPParser::append_array_header(out, 2);
+            RESPParser::append_bulk_string(out, page.cursor);
+            size_t matched = page.keys.size();
+            if (pattern != "*") {
+                auto end = std::remove_if(page.keys.begin(), page.keys.end(),
+                    [&](const std::string& k) { return !glob_match(pattern, k); });
+                matched = static_cast<size_t>(end - page.keys.begin());
+            }
+            RESPParser::append_array_header(out, matched);
+            for (size_t i = 0; i < matched; ++i) RESPParser::append_bulk_string(out, page.keys[i]);
+            return false;
+        }
+
+        if (iequals(cmd, "DBSIZE")) {
+            RESPParser::append_integer(out, static_cast<int64_t>(manager_->size()));
+            return false;
         }
 
         // ── Admin Commands ───────────────────────────────────────
-        if (cmd == "FLUSHALL" || cmd == "FLUSHDB") {
+        if (iequals(cmd, "FLUSHALL") || iequals(cmd, "FLUSHDB")) {
             manager_->flush_all();
-            return {RESPParser::encode_simple_string("OK")};
+            RESPParser::append_simple_string(out, "OK");
+            return false;
+        }
+
+        if (iequals(cmd, "HOTKEYS")) {
+            int64_t count = 10;
+            if (tokens.size() == 3 && iequals(tokens[1], "COUNT")) {
+                if (!parse_int(tokens[2], count)) return not_an_integer(out);
+                if (count < 1) {
+                    RESPParser::append_error(out, "syntax error");
+                    return false;
+                }
+            } else if (tokens.size() != 1) {
+                return wrong_args(out, "HOTKEYS");
+            }
+            auto hot = manager_->hottest_keys(static_cast<size_t>(count));
+            auto replicated = manager_->replicated_keys();
+            RESPParser::append_array_header(out, hot.size());
+            for (const auto& h : hot) {
+                RESPParser::append_array_header(out, 4);
+                RESPParser::append_bulk_string(out, h.key);
+                RESPParser::append_integer(out, static_cast<int64_t>(h.hits));
+                RESPParser::append_integer(out, static_cast<int64_t>(h.segment));
+                RESPParser::append_integer(out, std::binary_search(replicated.begin(), replicated.end(), h.key) ? 1 : 0);
+            }
+            return false;
         }
 
-        if (cmd == "PING") {
-            if (tokens.size() >= 2) return {RESPParser::encode_bulk_string(tokens[1])};
-            return {RESPParser::encode_simple_string("PONG")};
+        if (iequals(cmd, "PING")) {
+            if (tokens.size() >= 2) RESPParser::append_bulk_string(out, tokens[1]);
+            else                    RESPParser::append_simple_string(out, "PONG");
+            return false;
         }
 
-        if (cmd == "QUIT") {
-            return {RESPParser::encode_simple_string("OK"), true};
+        if (iequals(cmd, "QUIT")) {
+            RESPParser::append_simple_string(out, "OK");
+            return true;
         }
 
-        if (cmd == "INFO") {
-            return {RESPParser::encode_bulk_string(build_info())};
+        if (iequals(cmd, "INFO")) {
+            RESPParser::append_bulk_string(out, build_info());
+            return false;
         }
 
+        if (iequals(cmd, "HELLO")) return hello(tokens, out);
+
         // ── redis-cli compatibility stubs ────────────────────────
-        if (cmd == "COMMAND") {
+        if (iequals(cmd, "COMMAND")) {
             // redis-cli sends "COMMAND DOCS" on connect — just return empty array
-            return {RESPParser::encode_simple_string("OK")};
+            RESPParser::append_simple_string(out, "OK");
+            return false;
         }
 
-        if (cmd == "CONFIG") {
+        if (iequals(cmd, "CONFIG")) {
             // redis-cli sends CONFIG GET save, CONFIG GET appendonly, etc.
-            if (tokens.size() >= 3 && to_upper(tokens[1]) == "GET") {
+            if (tokens.size() >= 3 && iequals(tokens[1], "GET")) {
                 // Return empty array (no matching config)
-                return {"*2\r\n" + RESPParser::encode_bulk_string(tokens[2])
-                        + RESPParser::encode_bulk_string("")};
+                RESPParser::append_array_header(out, 2);
+                RESPParser::append_bulk_string(out, tokens[2]);
+                RESPParser::append_bulk_string(out, "");
+                return false;
             }
-            return {RESPParser::encode_simple_string("OK")};
+            RESPParser::append_simple_string(out, "OK");
+            return false;
+        }
+
+        if (iequals(cmd, "CLUSTER") || iequals(cmd, "ASKING")) {
+            RESPParser::append_error(out, "This instance has cluster support disabled");
+            return false;
         }
 
-        if (cmd == "CLIENT") {
+        if (iequals(cmd, "CLIENT")) {
+            if (tokens.size() == 2 && iequals(tokens[1], "ID")) {
+                RESPParser::append_integer(out, static_cast<int64_t>(id_));
+                return false;
+            }
+            if (tokens.size() >= 2 && iequals(tokens[1], "TRACKING")) return client_tracking(tokens, out);
             // redis-cli sends CLIENT SETNAME, CLIENT GETNAME, etc.
-            return {RESPParser::encode_simple_string("OK")};
+            RESPParser::append_simple_string(out, "OK");
+            return false;
         }
 
         // ── Unknown command ──────────────────────────────────────
-        return {RESPParser::encode_error("unknown command '" + tokens[0] + "'")};
+        RESPParser::append_error(out, "unknown command '" + std::string(cmd) + "'");
+        return false;
+    }
+
+public:
+    /** Execute a single command and return its reply as a standalone Response. */
+    Response execute(const std::vector<std::string_view>& tokens) {
+        Response r;
+        r.close_connection = execute_into(tokens, r.data);
+        return r;
+    }
+
+    /** Owning-token overload (legacy RESPParser::parse output). */
+    Response execute(const std::vector<std::string>& tokens) {
+        std::vector<std::string_view> views(tokens.begin(), tokens.end());
+        return execute(views);
+    }
+
+    /** Convenience overload: handler.execute({"SET", "k", "v"}). */
+    Response execute(std::initializer_list<std::string_view> tokens) {
+        return execute(std::vector<std::string_view>(tokens));
     }
 
 private:
-    static std::string to_upper(const std::string& s) {
-        std::string result = s;
-        std::transform(result.begin(), result.end(), result.begin(),
-                       [](unsigned char c) { return std::toupper(c); });
-        return result;
+    static bool wrong_args(std::string& out, const char* cmd) {
+        RESPParser::append_error(out, std::string("wrong number of arguments for '") + cmd + "'");
+        return false;
+    }
+
+    static bool not_an_integer(std::string& out) {
+        RESPParser::append_error(out, "value is not an integer or out of range");
+        return false;
+    }
+
+    static bool parse_int(std::string_view s, int64_t& v) {
+        auto r = std::from_chars(s.data(), s.data() + s.size(), v);
+        return r.ec == std::errc() && r.ptr == s.data() + s.size();
+    }
+
+    /** Absolute expiry deadline for a relative TTL of `ttl` × `unit_ms`. */
+    static uint64_t deadline(int64_t ttl, int64_t unit_ms) {
+        const int64_t kMaxTTL = int64_t(1) << 46;   // ~2230 years in ms
+        int64_t ms = ttl > kMaxTTL / unit_ms ? kMaxTTL : ttl * unit_ms;
+        return cache::steady_now_ms() + static_cast<uint64_t>(ms);
+    }
+
+    // ── Protocol & tracking ──────────────────────────────────────
+
+    bool hello(const std::vector<std::string_view>& tokens, std::string& out) {
+        if (tokens.size() > 2) {
+            RESPParser::append_error(out, "syntax error: HELLO options are not supported");
+            return false;
+        }
+        if (tokens.size() == 2) {
+            int64_t v;
+            if (!parse_int(tokens[1], v)) {
+                RESPParser::append_error(out, "Protocol version is not an integer or out of range");
+                return false;
+            }
+            if (v != 2 && v != 3) {
+                RESPParser::append_coded_error(out, "NOPROTO unsupported protocol version");
+                return false;
+            }
+            protocol_ = static_cast<int>(v);
+            if (protocol_ == 2) stop_tracking();   // RESP2 can't carry pushes
+        }
+        if (protocol_ == 3) RESPParser::append_map_header(out, 6);
+        else                RESPParser::append_array_header(out, 12);
+        RESPParser::append_bulk_string(out, "server");
+        RESPParser::append_bulk_string(out, "distributed-cache");
+        RESPParser::append_bulk_string(out, "version");
+        RESPParser::append_bulk_string(out, "1.0.0");
+        RESPParser::append_bulk_string(out, "proto");
+        RESPParser::append_integer(out, protocol_);
+        RESPParser::append_bulk_string(out, "id");
+        RESPParser::append_integer(out, static_cast<int64_t>(id_));
+        RESPParser::append_bulk_string(out, "mode");
+        RESPParser::append_bulk_string(out, cluster_ ? "cluster" : "standalone");
+        RESPParser::append_bulk_string(out, "role");
+        RESPParser::append_bulk_string(out, "master");
+        return false;
+    }
+
+    /** CLIENT TRACKING ON|OFF [BCAST] [PREFIX p ...] */
+    bool client_tracking(const std::vector<std::string_view>& tokens, std::string& out) {
+        if (tokens.size() < 3) return wrong_args(out, "CLIENT TRACKING");
+        bool on = iequals(tokens[2], "ON");
+        if (!on && !iequals(tokens[2], "OFF")) {
+            RESPParser::append_error(out, "syntax error");
+            return false;
+        }
+        bool bcast = false;
+        std::vector<std::string> prefixes;
+        for (size_t i = 3; i < tokens.size(); ++i) {
+            if (iequals(tokens[i], "BCAST")) {
+                bcast = true;
+            } else if (iequals(tokens[i], "PREFIX") && i + 1 < tokens.size()) {
+                prefixes.emplace_back(tokens[++i]);
+            } else if (iequals(tokens[i], "REDIRECT") || iequals(tokens[i], "OPTIN") ||
+                       iequals(tokens[i], "OPTOUT") || iequals(tokens[i], "NOLOOP")) {
+                RESPParser::append_error(out, "CLIENT TRACKING " + std::string(tokens[i]) + " is not supported");
+                return false;
+            } else {
+                RESPParser::append_error(out, "syntax error");
+                return false;
+            }
+        }
+        if (!on) {
+            stop_tracking();
+            RESPParser::append_simple_string(out, "OK");
+            return false;
+        }
+        if (!prefixes.empty() && !bcast) {
+            RESPParser::append_error(out, "PREFIX option requires BCAST mode to be enabled");
+            return false;
+        }
+        if (!push_) {
+            RESPParser::append_error(out, "CLIENT TRACKING needs the event-loop I/O model");
+            return false;
+        }
+        if (protocol_ != 3) {
+            RESPParser::append_error(out, "CLIENT TRACKING needs RESP3 (HELLO 3); REDIRECT is not supported");
+            return false;
+        }
+        PushFn push = push_;
+        manager_->tracking().subscribe(id_, [push](const std::vector<std::string>& keys) {
+            push(invalidation_frame(keys));
+        }, bcast, std::move(prefixes));
+        tracking_ = true;
+        bcast_ = bcast;
+        RESPParser::append_simple_string(out, "OK");
+        return false;
+    }
+
+    void stop_tracking() {
+        if (!tracking_) return;
+        manager_->tracking().unsubscribe(id_);
+        tracking_ = bcast_ = false;
+    }
+
+    // ── Cluster ──────────────────────────────────────────────────
+
+    /** The keys a data command touches; empty for keyless commands. */
+    static std::vector<std::string_view> command_keys(const std::vector<std::string_view>& tokens) {
+        std::vector<std::string_view> keys;
+        std::string_view cmd = tokens[0];
+        if (tokens.size() < 2) return keys;
+        static const char* const kSingle[] = {"GET", "SET", "SETEX", "EXPIRE", "PEXPIRE",
+                                              "TTL", "PTTL", "PERSIST"};
+        for (const char* c : kSingle) {
+            if (iequals(cmd, c)) {
+                keys.push_back(tokens[1]);
+                return keys;
+            }
+        }
+        if (iequals(cmd, "MGET") || iequals(cmd, "DEL") || iequals(cmd, "EXISTS")) {
+            keys.assign(tokens.begin() + 1, tokens.end());
+        } else if (iequals(cmd, "MSET")) {
+            for (size_t i = 1; i < tokens.size(); i += 2) keys.push_back(tokens[i]);
+        }
+        return keys;
+    }
+
+    /** Route a data command; false (with the redirect in `out`) when it runs elsewhere. */
+    bool routed_here(const std::vector<std::string_view>& tokens, bool asking, std::string& out) {
+        auto keys = command_keys(tokens);
+        if (keys.empty()) return true;
+        auto d = cluster_->route(keys, asking);
+        std::string slot = std::to_string(d.slot);
+        switch (d.verdict) {
+            case cluster::Cluster::Verdict::Local:
+                return true;
+            case cluster::Cluster::Verdict::Moved:
+                RESPParser::append_coded_error(out, "MOVED " + slot + " " + d.endpoint);
+                break;
+            case cluster::Cluster::Verdict::Ask:
+                RESPParser::append_coded_error(out, "ASK " + slot + " " + d.endpoint);
+                break;
+            case cluster::Cluster::Verdict::CrossSlot:
+                RESPParser::append_coded_error(out, "CROSSSLOT Keys in request don't hash to the same slot");
+                break;
+            case cluster::Cluster::Verdict::TryAgain:
+                RESPParser::append_coded_error(out, "TRYAGAIN Multiple keys request during rehashing of slot");
+                break;
+            case cluster::Cluster::Verdict::Down:
+                RESPParser::append_coded_error(out, "CLUSTERDOWN Hash slot not served");
+                break;
+        }
+        return false;
+    }
+
+    static bool parse_slot(std::string_view s, uint16_t& slot) {
+        int64_t v;
+        if (!parse_int(s, v) || v < 0 || v >= cluster::kSlotCount) return false;
+        slot = static_cast<uint16_t>(v);
+        return true;
+    }
+
+    bool cluster_command(const std::vector<std::string_view>& tokens, std::string& out) {
+        if (tokens.size() < 2) return wrong_args(out, "CLUSTER");
+        std::string_view sub = tokens[1];
+        auto& map = cluster_->slots();
+
+        if (iequals(sub, "KEYSLOT")) {
+            if (tokens.size() != 3) return wrong_args(out, "CLUSTER KEYSLOT");
+            RESPParser::append_integer(out, cluster::key_slot(tokens[2]));
+            return false;
+        }
+
+        if (iequals(sub, "MYID")) {
+            RESPParser::append_bulk_string(out, std::to_string(cluster_->self()));
+            return false;
+        }
+
+        if (iequals(sub, "LOAD")) {
+            RESPParser::append_integer(out, static_cast<int64_t>(cluster_->ops()));
+            return false;
+        }
+
+        if (iequals(sub, "INFO")) {
+            size_t assigned = 0;
+            for (const auto& r : map.ranges()) assigned += r.last - r.first + 1u;
+            std::string info;
+            info += "cluster_state:" + std::string(assigned == cluster::kSlotCount ? "ok" : "fail") + "\r\n";
+            info += "cluster_slots_assigned:" + std::to_string(assigned) + "\r\n";
+            info += "cluster_known_nodes:" + std::to_string(map.nodes().size()) + "\r\n";
+            info += "cluster_current_epoch:" + std::to_string(map.epoch()) + "\r\n";
+            info += "cluster_my_slots:" + std::to_string(map.slots_of(cluster_->self()).size()) + "\r\n";
+            info += "cluster_slots_moved:" + std::to_string(cluster_->slots_moved()) + "\r\n";
+            info += "cluster_keys_moved:" + std::to_string(cluster_->keys_moved()) + "\r\n";
+            RESPParser::append_bulk_string(out, info);
+            return false;
+        }
+
+        if (iequals(sub, "SLOTS")) {
+            auto ranges = map.ranges();
+            RESPParser::append_array_header(out, ranges.size());
+            for (const auto& r : ranges) {
+                cluster::NodeAddress n;
+                map.node(r.owner, n);
+                RESPParser::append_array_header(out, 3);
+                RESPParser::append_integer(out, r.first);
+                RESPParser::append_integer(out, r.last);
+                RESPParser::append_array_header(out, 3);
+                RESPParser::append_bulk_string(out, n.host);
+                RESPParser::append_integer(out, n.port);
+                RESPParser::append_bulk_string(out, std::to_string(r.owner));
+            }
+            return false;
+        }
+
+        if (iequals(sub, "NODES")) {
+            auto ranges = map.ranges();
+            std::string text;
+            for (const auto& n : map.nodes()) {
+                text += std::to_string(n.id) + " " + n.endpoint() + " " +
+                        (n.id == cluster_->self() ? "myself,master" : "master") +
+                        " - 0 0 " + std::to_string(map.epoch()) + " connected";
+                for (const auto& r : ranges) {
+                    if (r.owner != n.id) continue;
+                    text += " " + std::to_string(r.first);
+                    if (r.last != r.first) text += "-" + std::to_string(r.last);
+                }
+                text += "\n";
+            }
+            RESPParser::append_bulk_string(out, text);
+            return false;
+        }
+
+        if (iequals(sub, "SETSLOT")) {
+            if (tokens.size() < 4) return wrong_args(out, "CLUSTER SETSLOT");
+            uint16_t slot;
+            if (!parse_slot(tokens[2], slot)) {
+                RESPParser::append_error(out, "Invalid or out of range slot");
+                return false;
+            }
+            std::string_view how = tokens[3];
+            bool ok;
+            if (iequals(how, "STABLE") && tokens.size() == 4) {
+                map.set_stable(slot);
+                ok = true;
+            } else if (tokens.size() == 5) {
+                int64_t node;
+                if (!parse_int(tokens[4], node)) return not_an_integer(out);
+                int id = static_cast<int>(node);
+                if (iequals(how, "IMPORTING"))      ok = map.set_importing(slot, id);
+                else if (iequals(how, "MIGRATING")) ok = map.set_migrating(slot, id);
+                else if (iequals(how, "NODE"))      ok = map.set_owner(slot, id);
+                else return wrong_args(out, "CLUSTER SETSLOT");
+            } else {
+                return wrong_args(out, "CLUSTER SETSLOT");
+            }
+            if (ok) RESPParser::append_simple_string(out, "OK");
+            else    RESPParser::append_error(out, "slot state change refused");
+            return false;
+        }
+
+        if (iequals(sub, "IMPORT")) {
+            if (tokens.size() < 3 || (tokens.size() - 3) % 3 != 0) return wrong_args(out, "CLUSTER IMPORT");
+            uint16_t slot;
+            if (!parse_slot(tokens[2], slot)) {
+                RESPParser::append_error(out, "Invalid or out of range slot");
+                return false;
+            }
+            std::vector<cluster::MovedEntry> batch((tokens.size() - 3) / 3);
+            for (size_t i = 0; i < batch.size(); ++i) {
+                batch[i].key.assign(tokens[3 + i * 3].data(), tokens[3 + i * 3].size());
+                batch[i].value.assign(tokens[4 + i * 3].data(), tokens[4 + i * 3].size());
+                if (!parse_int(tokens[5 + i * 3], batch[i].ttl_ms)) return not_an_integer(out);
+            }
+            int64_t stored = cluster_->import(slot, batch);
+            if (stored < 0) RESPParser::append_error(out, "slot is not importing here");
+            else            RESPParser::append_integer(out, stored);
+            return false;
+        }
+
+        if (iequals(sub, "MIGRATE")) {
+            if (tokens.size() != 5) return wrong_args(out, "CLUSTER MIGRATE");
+            uint16_t first, last;
+            int64_t node;
+            if (!parse_slot(tokens[2], first) || !parse_slot(tokens[3], last) || first > last) {
+                RESPParser::append_error(out, "Invalid or out of range slot");
+                return false;
+            }
+            if (!parse_int(tokens[4], node)) return not_an_integer(out);
+            std::vector<uint16_t> slots;
+            for (uint32_t s = first; s <= last; ++s) slots.push_back(static_cast<uint16_t>(s));
+            auto moved = cluster_->migrate_slots(slots, static_cast<int>(node));
+            RESPParser::append_integer(out, static_cast<int64_t>(moved.size()));
+            return false;
+        }
+
+        RESPParser::append_error(out, "unknown CLUSTER subcommand '" + std::string(sub) + "'");
+        return false;
+    }
+
+    /** ASCII case-insensitive compare; `upper` must already be upper-case. */
+    static bool iequals(std::string_view s, std::string_view upper) {
+        if (s.size() != upper.size()) return false;
+        for (size_t i = 0; i < s.size(); ++i) {
+            if (std::toupper(static_cast<unsigned char>(s[i])) != upper[i]) return false;
+        }
+        return true;
     }
 
     std::string build_info() const {
@@ -151,17 +798,73 @@ private:
         info += "# Server\r\n";
         info += "distributed_cache_version:1.0.0\r\n";
         info += "write_mode:" + mode + "\r\n";
+        info += "eviction_policy:" + std::string(cache::policy_name(manager_->eviction_policy())) + "\r\n";
         info += "\r\n# Stats\r\n";
         info += "cache_hits:" + std::to_string(s.cache_hits.load()) + "\r\n";
         info += "cache_misses:" + std::to_string(s.cache_misses.load()) + "\r\n";
+        uint64_t lookups = s.cache_hits.load() + s.cache_misses.load();
+        char hit_rate[16];
+        std::snprintf(hit_rate, sizeof(hit_rate), "%.4f",
+                      lookups ? static_cast<double>(s.cache_hits.load()) / lookups : 0.0);
+        info += "hit_rate:" + std::string(hit_rate) + "\r\n";
+        info += "admission_rejections:" + std::to_string(manager_->admission_rejections()) + "\r\n";
+        info += "expired_keys:" + std::to_string(manager_->expired_count()) + "\r\n";
         info += "write_through_ops:" + std::to_string(s.write_through_count.load()) + "\r\n";
         info += "write_back_ops:" + std::to_string(s.write_back_count.load()) + "\r\n";
+        info += "dirty_keys:" + std::to_string(manager_->dirty_count()) + "\r\n";
+        info += "flush_lag_ms:" + std::to_string(manager_->flush_lag_ms()) + "\r\n";
+        info += "flushed_keys:" + std::to_string(manager_->flushed_entries()) + "\r\n";
+        size_t keys = manager_->size();
+        size_t mem  = manager_->memory_bytes();
+        info += "\r\n# Memory\r\n";
+        info += "used_memory_cache:" + std::to_string(mem) + "\r\n";
+        info += "used_memory_payload:" + std::to_string(manager_->payload_bytes()) + "\r\n";
+        info += "bytes_per_entry:" + std::to_string(keys ? mem / keys : 0) + "\r\n";
+        info += "used_memory:" + std::to_string(manager_->used_memory()) + "\r\n";
+        info += "maxmemory:" + std::to_string(manager_->max_memory()) + "\r\n";
+        info += "evicted_keys:" + std::to_string(manager_->budget_evictions()) + "\r\n";
+        const auto& codec = manager_->value_codec();
+        const auto& cs = codec.GetStats();
+        char ratio[16];
+        std::snprintf(ratio, sizeof(ratio), "%.4f", codec.Ratio());
+        info += "\r\n# Compression\r\n";
+        info += "value_compression_min:" + std::to_string(codec.MinSize()) + "\r\n";
+        info += "values_compressed:" + std::to_string(cs.compressed.load()) + "\r\n";
+        info += "values_compress_skipped:" + std::to_string(cs.skipped.load()) + "\r\n";
+        info += "values_decompressed:" + std::to_string(cs.decompressed.load()) + "\r\n";
+        info += "value_bytes_raw:" + std::to_string(cs.raw_bytes.load()) + "\r\n";
+        info += "value_bytes_stored:" + std::to_string(cs.stored_bytes.load()) + "\r\n";
+        info += "value_compression_ratio:" + std::string(ratio) + "\r\n";
         info += "\r\n# Keyspace\r\n";
-        info += "keys:" + std::to_string(manager_->size()) + "\r\n";
+        info += "keys:" + std::to_string(keys) + "\r\n";
+        info += "expires:" + std::to_string(manager_->volatile_count()) + "\r\n";
+        info += "\r\n# Cluster\r\n";
+        info += "cluster_enabled:" + std::string(cluster_ ? "1" : "0") + "\r\n";
+        info += "\r\n# Hotkeys\r\n";
+        info += "hot_keys_replicated:" + std::to_string(manager_->replicated_keys().size()) + "\r\n";
+        info += "tracking_clients:" + std::to_string(manager_->tracking().clients()) + "\r\n";
+        info += "tracking_keys:" + std::to_string(manager_->tracking().tracked_keys()) + "\r\n";
+        info += "tracking_invalidations:" + std::to_string(manager_->tracking().invalidations_sent()) + "\r\n";
+        metrics::LatencyReport latency;
+        collect_command_latency(latency);
+        manager_->collect_latency(latency);
+        info += "\r\n# Latencystats\r\n";
+        for (const auto& entry : latency) {
+            if (!entry.second.count) continue;
+            info += "latency_percentiles_usec_" + entry.first + ":" +
+                    metrics::format_percentiles_us(entry.second) + "\r\n";
+        }
         return info;
     }
 
     sync::CacheManager* manager_;
+    cluster::Cluster* cluster_;
+    bool asking_ = false;   // ASKING seen; applies to the next command only
+    const uint64_t id_;      // CLIENT ID; also the tracking subscriber id
+    PushFn push_;
+    int  protocol_ = 2;      // RESP version chosen with HELLO
+    bool tracking_ = false;
+    bool bcast_ = false;
 };
 
 }  // namespace network
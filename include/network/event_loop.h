@@ -0,0 +1,412 @@
+#pragma once
+// ────────────────────────────────────────────────────────────────
+// Event Loop: epoll-based reactor for the RESP front end.
+// Each Reactor owns one epoll instance, one thread, and every
+// connection the acceptor hands to it.  Connections keep their own
+// read/write buffers so a reactor never blocks on a slow client.
+// Linux only — other platforms use TCPServer's thread-per-client mode.
+// ────────────────────────────────────────────────────────────────
+
+#if defined(__linux__)
+    #define DCS_HAVE_EPOLL 1
+#else
+    #define DCS_HAVE_EPOLL 0
+#endif
+
+#if DCS_HAVE_EPOLL
+
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+
+#include "client_handler.h"
+#include "resp_parser.h"
+#include "../sync/cache_manager.h"
+#include "../compat/threading.h"
+
+#include <algorithm>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace dcs {
+namespace network {
+
+/**
+ * Reactor — one event-loop thread multiplexing many client sockets.
+ *
+ * The acceptor calls adopt() from its own thread; the fd is queued and
+ * the reactor is woken through an eventfd, so the connection table is
+ * only ever touched by the reactor thread itself.
+ *
+ * Replies to every command parsed from one read are appended to the
+ * connection's output buffer and written with a single send().  Once
+ * `max_output_buffer` bytes are waiting on a slow reader the connection
+ * stops parsing and drops EPOLLIN until the backlog drains.  Input is
+ * bounded the same way: at most kMaxReadPerEvent bytes are read per
+ * readiness event before they are executed, and epoll (level-triggered)
+ * reports the rest on the next turn, after the reactor's other
+ * connections have had theirs.
+ *
+ * CLIENT TRACKING invalidations are produced by whichever thread made
+ * the write; they are queued on the connection's PushQueue and the
+ * reactor is woken to splice them into the output between replies.  A
+ * client that leaves more than kPushBacklogFactor × max_output_buffer of
+ * pushes unread is disconnected.
+ *
+ * A connection that fails part-way through an epoll batch is only
+ * marked dead and queued on retired_: later events in the same batch
+ * may still point at it, so it is closed and freed once the batch ends.
+ */
+class Reactor {
+public:
+    static constexpr size_t kPushBacklogFactor = 16;
+    static constexpr size_t kReadChunk = 16384;
+    static constexpr size_t kMaxReadPerEvent = 4 * kReadChunk;
+
+    explicit Reactor(sync::CacheManager* manager, size_t max_output_buffer = 64 * 1024,
+                     cluster::Cluster* cluster = nullptr)
+        : manager_(manager)
+        , cluster_(cluster)
+        , max_output_(max_output_buffer)
+        , epoll_fd_(-1)
+        , wake_fd_(-1)
+        , running_(false)
+        , active_(0) {}
+
+    ~Reactor() { stop(); }
+
+    Reactor(const Reactor&) = delete;
+    Reactor& operator=(const Reactor&) = delete;
+
+    bool start() {
+        epoll_fd_ = epoll_create1(EPOLL_CLOEXEC);
+        if (epoll_fd_ < 0) {
+            std::cerr << "[Reactor] epoll_create1() failed\n";
+            return false;
+        }
+        wake_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (wake_fd_ < 0) {
+            std::cerr << "[Reactor] eventfd() failed\n";
+            close(epoll_fd_);
+            epoll_fd_ = -1;
+            return false;
+        }
+        epoll_event ev{};
+        ev.events = EPOLLIN;
+        ev.data.ptr = nullptr;  // nullptr marks the wake-up fd
+        epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, wake_fd_, &ev);
+
+        running_ = true;
+        thread_ = compat::Thread([this] { run(); });
+        return true;
+    }
+
+    void stop() {
+        if (!running_.exchange(false)) return;
+        wake();
+        if (thread_.joinable()) thread_.join();
+
+        for (auto& kv : conns_) close(kv.first);
+        conns_.clear();
+        {
+            compat::LockGuard<compat::Mutex> lock(pending_mu_);
+            for (auto& p : pending_) close(p.first);
+            pending_.clear();
+        }
+        close(wake_fd_);
+        close(epoll_fd_);
+        wake_fd_ = epoll_fd_ = -1;
+    }
+
+    /** Hand a freshly accepted socket to this reactor (any thread). */
+    void adopt(int fd, std::string ip) {
+        {
+            compat::LockGuard<compat::Mutex> lock(pending_mu_);
+            pending_.emplace_back(fd, std::move(ip));
+        }
+        wake();
+    }
+
+    /** Connections currently owned by this reactor. */
+    uint32_t active_connections() const { return active_.load(); }
+
+private:
+    /** Out-of-band frames for one connection, filled from any thread. */
+    struct PushQueue {
+        compat::Mutex mu;
+        std::string frames;
+        bool posted = false;     // fd is on pushed_, a wake-up is on its way
+        bool overflow = false;   // backlog limit hit: close the connection
+    };
+
+    struct Connection {
+        int         fd;
+        std::string ip;
+        ClientHandler handler;
+        RESPStream  in;        // bytes received but not yet executed
+        std::string out;       // encoded responses not yet written
+        size_t      out_off = 0;
+        bool        want_write = false;
+        bool        paused = false;    // output backlog full: not reading/parsing
+        bool        closing = false;   // QUIT seen: close once out drains
+        bool        dead = false;      // retired this batch: ignore further events
+        uint32_t    events = EPOLLIN | EPOLLRDHUP;  // current epoll interest
+        std::shared_ptr<PushQueue> push = std::make_shared<PushQueue>();
+
+        Connection(int f, std::string addr, sync::CacheManager* m, cluster::Cluster* c)
+            : fd(f), ip(std::move(addr)), handler(m, c) {}
+    };
+
+    void wake() {
+        if (wake_fd_ < 0) return;
+        uint64_t one = 1;
+        ssize_t n = write(wake_fd_, &one, sizeof(one));
+        (void)n;
+    }
+
+    void run() {
+        const int kMaxEvents = 256;
+        epoll_event events[kMaxEvents];
+        while (running_) {
+            int n = epoll_wait(epoll_fd_, events, kMaxEvents, -1);
+            if (n < 0) {
+                if (errno == EINTR) continue;
+                std::cerr << "[Reactor] epoll_wait() failed\n";
+                break;
+            }
+            for (int i = 0; i < n; ++i) {
+                auto* conn = static_cast<Connection*>(events[i].data.ptr);
+                if (!conn) {
+                    drain_wakeups();
+                    continue;
+                }
+                if (conn->dead) continue;
+                uint32_t ev = events[i].events;
+                bool alive = true;
+                if (ev & (EPOLLIN | EPOLLHUP | EPOLLERR)) alive = on_readable(*conn);
+                if (alive && (ev & EPOLLOUT))             alive = on_writable(*conn);
+                if (!alive) retire(*conn);
+            }
+            for (int fd : retired_) close_connection(fd);
+            retired_.clear();
+        }
+    }
+
+    void drain_wakeups() {
+        uint64_t v;
+        while (read(wake_fd_, &v, sizeof(v)) > 0) {}
+
+        std::vector<std::pair<int, std::string>> incoming;
+        std::vector<int> pushed;
+        {
+            compat::LockGuard<compat::Mutex> lock(pending_mu_);
+            incoming.swap(pending_);
+            pushed.swap(pushed_);
+        }
+        for (auto& p : incoming) register_connection(p.first, std::move(p.second));
+        for (int fd : pushed) deliver_pushes(fd);
+    }
+
+    /** Queue a push for `fd` (any thread) and wake the reactor if needed. */
+    void post_push(int fd, PushQueue& q, std::string frame) {
+        {
+            compat::LockGuard<compat::Mutex> lock(q.mu);
+            if (q.frames.size() + frame.size() > kPushBacklogFactor * max_output_) q.overflow = true;
+            else q.frames += frame;
+            if (q.posted) return;
+            q.posted = true;
+        }
+        {
+            compat::LockGuard<compat::Mutex> lock(pending_mu_);
+            pushed_.push_back(fd);
+        }
+        wake();
+    }
+
+    /** Move queued pushes into the output buffer and flush. */
+    void deliver_pushes(int fd) {
+        auto it = conns_.find(fd);
+        if (it == conns_.end()) return;   // closed since; its queue went with it
+        Connection& c = *it->second;
+        if (c.dead) return;
+        bool overflow;
+        {
+            compat::LockGuard<compat::Mutex> lock(c.push->mu);
+            c.out += c.push->frames;
+            c.push->frames.clear();
+            c.push->posted = false;
+            overflow = c.push->overflow;
+        }
+        if (overflow || !pump(c) || (c.closing && c.out.empty())) retire(c);
+    }
+
+    void register_connection(int fd, std::string ip) {
+        int flags = fcntl(fd, F_GETFL, 0);
+        fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+        auto conn = std::make_unique<Connection>(fd, std::move(ip), manager_, cluster_);
+        std::shared_ptr<PushQueue> queue = conn->push;
+        conn->handler.set_push([this, fd, queue](std::string frame) {
+            post_push(fd, *queue, std::move(frame));
+        });
+        epoll_event ev{};
+        ev.events = EPOLLIN | EPOLLRDHUP;
+        ev.data.ptr = conn.get();
+        if (epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd, &ev) != 0) {
+            std::cerr << "[Reactor] epoll_ctl(ADD) failed\n";
+            close(fd);
+            return;
+        }
+        conns_[fd] = std::move(conn);
+        active_++;
+    }
+
+    /**
+     * Read up to kMaxReadPerEvent bytes, execute complete commands, write
+     * back.  Anything left in the socket keeps EPOLLIN ready and is read
+     * on a later turn of the loop.
+     */
+    bool on_readable(Connection& c) {
+        bool peer_closed = false;
+        size_t budget = kMaxReadPerEvent;
+        while (!c.paused && budget > 0) {
+            const size_t want = std::min(kReadChunk, budget);
+            ssize_t n = recv(c.fd, c.in.prepare(want), want, 0);
+            if (n > 0) {
+                c.in.commit(static_cast<size_t>(n));
+                budget -= static_cast<size_t>(n);
+                if (static_cast<size_t>(n) < want) break;
+                continue;
+            }
+            if (n == 0) { peer_closed = true; break; }
+            if (errno == EINTR) continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+            return false;
+        }
+
+        if (!pump(c)) return false;
+        if (peer_closed) return false;
+        return !(c.closing && c.out.empty());
+    }
+
+    bool on_writable(Connection& c) {
+        if (!pump(c)) return false;
+        return !(c.closing && c.out.empty());
+    }
+
+    /** Execute buffered commands and flush, resuming whenever the backlog drains. */
+    bool pump(Connection& c) {
+        while (true) {
+            if (!c.closing && !c.paused) process_input(c);
+            if (!flush(c)) return false;
+            if (c.paused && c.out.empty()) {
+                c.paused = false;
+                continue;
+            }
+            break;
+        }
+        update_interest(c);
+        return true;
+    }
+
+    void process_input(Connection& c) {
+        RESPStream::Status st;
+        while ((st = c.in.next(argv_)) == RESPStream::Status::Ok) {
+            if (c.handler.execute_into(argv_, c.out)) {
+                c.closing = true;
+                return;
+            }
+            if (c.out.size() - c.out_off >= max_output_) {
+                c.paused = true;
+                return;
+            }
+        }
+        if (st == RESPStream::Status::Error) {
+            RESPParser::append_error(c.out, "Protocol error: " + c.in.error());
+            c.closing = true;
+        }
+    }
+
+    /** Write as much of c.out as the socket accepts; want_write if short. */
+    bool flush(Connection& c) {
+        while (c.out_off < c.out.size()) {
+            ssize_t n = send(c.fd, c.out.data() + c.out_off,
+                             c.out.size() - c.out_off, MSG_NOSIGNAL);
+            if (n > 0) { c.out_off += static_cast<size_t>(n); continue; }
+            if (n < 0 && errno == EINTR) continue;
+            if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+                c.want_write = true;
+                return true;
+            }
+            return false;
+        }
+        c.out.clear();  // keeps capacity for the next batch
+        c.out_off = 0;
+        c.want_write = false;
+        return true;
+    }
+
+    void update_interest(Connection& c) {
+        uint32_t want = (c.paused ? 0u : (EPOLLIN | EPOLLRDHUP)) | (c.want_write ? EPOLLOUT : 0u);
+        if (want == c.events) return;
+        epoll_event ev{};
+        ev.events = want;
+        ev.data.ptr = &c;
+        epoll_ctl(epoll_fd_, EPOLL_CTL_MOD, c.fd, &ev);
+        c.events = want;
+    }
+
+    /**
+     * Mark `c` for closing at the end of the current batch.  Its fd stays
+     * open until then, so a connection adopted meanwhile cannot reuse the
+     * number and replace the entry in conns_.
+     */
+    void retire(Connection& c) {
+        if (c.dead) return;
+        c.dead = true;
+        retired_.push_back(c.fd);
+    }
+
+    void close_connection(int fd) {
+        auto it = conns_.find(fd);
+        if (it == conns_.end()) return;
+        epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, fd, nullptr);
+        std::cout << "[TCP] Client disconnected: " << it->second->ip << "\n";
+        close(fd);
+        conns_.erase(it);
+        active_.fetch_sub(1);
+    }
+
+    sync::CacheManager* manager_;
+    cluster::Cluster* cluster_;
+    size_t max_output_;
+    int  epoll_fd_;
+    int  wake_fd_;
+    compat::Atomic<bool>     running_;
+    compat::Atomic<uint32_t> active_;
+    compat::Thread thread_;
+
+    std::unordered_map<int, std::unique_ptr<Connection>> conns_;  // reactor thread only
+    std::vector<std::string_view> argv_;                           // reused per command
+    std::vector<std::pair<int, std::string>> pending_;
+    std::vector<int> pushed_;                                      // fds with queued pushes
+    std::vector<int> retired_;                                     // closed after the batch
+    compat::Mutex pending_mu_;
+};
+
+}  // namespace network
+}  // namespace dcs
+
+#endif  // DCS_HAVE_EPOLL
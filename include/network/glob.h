@@ -0,0 +1,87 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+namespace dcs {
+namespace network {
+
+/**
+ * Redis-style glob match used by KEYS and SCAN MATCH.
+ *
+ *   *        any run of bytes (including none)
+ *   ?        any single byte
+ *   [abc]    one of the listed bytes; [^abc] negates, [a-z] is a range
+ *   \x       the byte x literally
+ */
+inline bool glob_match(std::string_view pattern, std::string_view str) {
+    size_t p = 0, s = 0;
+    size_t star_p = std::string_view::npos, star_s = 0;
+    while (s < str.size()) {
+        if (p < pattern.size()) {
+            char c = pattern[p];
+            if (c == '*') {
+                // Remember the star and first try matching it empty
+                star_p = p++;
+                star_s = s;
+                continue;
+            }
+            if (c == '?') { ++p; ++s; continue; }
+            if (c == '[') {
+                size_t q = p + 1;
+                bool negate = q < pattern.size() && pattern[q] == '^';
+                if (negate) ++q;
+                bool matched = false;
+                while (q < pattern.size() && pattern[q] != ']') {
+                    if (pattern[q] == '\\' && q + 1 < pattern.size()) {
+                        ++q;
+                        if (pattern[q] == str[s]) matched = true;
+                    } else if (q + 2 < pattern.size() && pattern[q + 1] == '-' && pattern[q + 2] != ']') {
+                        unsigned char lo = static_cast<unsigned char>(pattern[q]);
+                        unsigned char hi = static_cast<unsigned char>(pattern[q + 2]);
+                        if (lo > hi) { unsigned char t = lo; lo = hi; hi = t; }
+                        unsigned char ch = static_cast<unsigned char>(str[s]);
+                        if (ch >= lo && ch <= hi) matched = true;
+                        q += 2;
+                    } else if (pattern[q] == str[s]) {
+                        matched = true;
+                    }
+                    ++q;
+                }
+                if (matched != negate) {
+                    p = q < pattern.size() ? q + 1 : q;   // unterminated class runs to the end
+                    ++s;
+                    continue;
+                }
+            } else {
+                if (c == '\\' && p + 1 < pattern.size()) c = pattern[++p];
+                if (c == str[s]) { ++p; ++s; continue; }
+            }
+        }
+        // Mismatch: let the last star swallow one more byte
+        if (star_p == std::string_view::npos) return false;
+        p = star_p + 1;
+        s = ++star_s;
+    }
+    while (p < pattern.size() && pattern[p] == '*') ++p;
+    return p == pattern.size();
+}
+
+/** Bytes every match must start with, so scans can seek past the rest. */
+inline std::string glob_literal_prefix(std::string_view pattern) {
+    std::string prefix;
+    for (size_t i = 0; i < pattern.size(); ++i) {
+        char c = pattern[i];
+        if (c == '*' || c == '?' || c == '[') break;
+        if (c == '\\') {
+            if (i + 1 == pattern.size()) break;
+            c = pattern[++i];
+        }
+        prefix += c;
+    }
+    return prefix;
+}
+
+}  // namespace network
+}  // namespace dcs
@@ -1,7 +1,8 @@
 #pragma once
 // ────────────────────────────────────────────────────────────────
 // HTTP Server: Minimal embedded HTTP server for serving the
-// dashboard and JSON metrics API. Replaces the PowerShell script.
+// dashboard, the JSON metrics API (/api/metrics) and a Prometheus
+// text exposition (/metrics). Replaces the PowerShell script.
 // Runs on port 8080 alongside the RESP TCP server on 6379.
 // ────────────────────────────────────────────────────────────────
 
@@ -57,6 +58,7 @@ public:
     ~HTTPServer() { stop(); }
 
     void setMetricsCallback(MetricsCallback cb) { metrics_cb_ = std::move(cb); }
+    void setPrometheusCallback(MetricsCallback cb) { prometheus_cb_ = std::move(cb); }
 
     // Register custom API endpoints: path → handler returning JSON
     void addEndpoint(const std::string& path,
@@ -219,8 +221,10 @@ private:
         }
 
         // Route request
-        if (path == "/metrics" || path == "/api/metrics") {
+        if (path == "/api/metrics") {
             serveMetrics(sock, cors_headers);
+        } else if (path == "/metrics") {
+            servePrometheus(sock, cors_headers);
         } else if (path == "/api/start") {
             serveJSON(sock, R"({"status":"running"})", cors_headers);
         } else if (path == "/api/stop") {
@@ -260,6 +264,17 @@ private:
         serveJSON(sock, json, cors);
     }
 
+    void servePrometheus(http_socket_t sock, const std::string& cors) {
+        std::string body = prometheus_cb_ ? prometheus_cb_() : std::string();
+        std::string response =
+            "HTTP/1.1 200 OK\r\n"
+            "Content-Type: text/plain; version=0.0.4; charset=utf-8\r\n" +
+            cors +
+            "Content-Length: " + std::to_string(body.size()) + "\r\n"
+            "Connection: close\r\n\r\n" + body;
+        sendAll(sock, response);
+    }
+
     void serveJSON(http_socket_t sock, const std::string& json,
                    const std::string& cors) {
         std::string response =
@@ -375,6 +390,7 @@ private:
     compat::Atomic<bool> running_;
     http_socket_t    listen_sock_;
     MetricsCallback  metrics_cb_;
+    MetricsCallback  prometheus_cb_;
 
     std::unordered_map<std::string, std::function<std::string(const std::string&)>> endpoints_;
     compat::Mutex    mu_;
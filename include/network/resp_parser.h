@@ -1,6 +1,12 @@
 #pragma once
 
+#include <algorithm>
+#include <charconv>
+#include <cstdint>
+#include <cstring>
+#include <memory>
 #include <string>
+#include <string_view>
 #include <vector>
 #include <sstream>
 #include <stdexcept>
@@ -23,22 +29,105 @@ namespace network {
  */
 class RESPParser {
 public:
-    // ── Encoding helpers (server -> client) ─────────────────────────
+    // ── Encoding into a caller buffer (server -> client) ───────────
+    // The server appends every response of a pipelined batch to one
+    // per-connection output buffer and writes it with a single send().
 
-    static std::string encode_simple_string(const std::string& s) {
-        return "+" + s + "\r\n";
+    static void append_simple_string(std::string& out, std::string_view s) {
+        out += '+';
+        out.append(s.data(), s.size());
+        out += "\r\n";
     }
 
-    static std::string encode_error(const std::string& msg) {
-        return "-ERR " + msg + "\r\n";
+    static void append_error(std::string& out, std::string_view msg) {
+        out += "-ERR ";
+        out.append(msg.data(), msg.size());
+        out += "\r\n";
+    }
+
+    /** Error reply with its own code word, e.g. "MOVED 3999 10.0.0.2:6379". */
+    static void append_coded_error(std::string& out, std::string_view code_and_msg) {
+        out += '-';
+        out.append(code_and_msg.data(), code_and_msg.size());
+        out += "\r\n";
+    }
+
+    static void append_integer(std::string& out, int64_t n) {
+        out += ':';
+        append_decimal(out, n);
+        out += "\r\n";
+    }
+
+    static void append_bulk_string(std::string& out, std::string_view s) {
+        out += '$';
+        append_decimal(out, static_cast<int64_t>(s.size()));
+        out += "\r\n";
+        out.append(s.data(), s.size());
+        out += "\r\n";
+    }
+
+    static void append_null(std::string& out) {
+        out += "$-1\r\n";
+    }
+
+    static void append_array_header(std::string& out, size_t count) {
+        out += '*';
+        append_decimal(out, static_cast<int64_t>(count));
+        out += "\r\n";
+    }
+
+    static void append_array(std::string& out, const std::vector<std::string>& items) {
+        append_array_header(out, items.size());
+        for (auto& item : items) {
+            append_bulk_string(out, item);
+        }
+    }
+
+    // RESP3 types, sent only to clients that switched with HELLO 3.
+
+    /** Out-of-band push ("invalidate" messages of CLIENT TRACKING). */
+    static void append_push_header(std::string& out, size_t count) {
+        out += '>';
+        append_decimal(out, static_cast<int64_t>(count));
+        out += "\r\n";
+    }
+
+    /** Map of `pairs` key/value pairs (2 × pairs elements follow). */
+    static void append_map_header(std::string& out, size_t pairs) {
+        out += '%';
+        append_decimal(out, static_cast<int64_t>(pairs));
+        out += "\r\n";
+    }
+
+    static void append_resp3_null(std::string& out) {
+        out += "_\r\n";
+    }
+
+    // ── Encoding helpers (return a fresh string) ───────────────────
+
+    static std::string encode_simple_string(std::string_view s) {
+        std::string out;
+        append_simple_string(out, s);
+        return out;
+    }
+
+    static std::string encode_error(std::string_view msg) {
+        std::string out;
+        append_error(out, msg);
+        return out;
     }
 
     static std::string encode_integer(int64_t n) {
-        return ":" + std::to_string(n) + "\r\n";
+        std::string out;
+        append_integer(out, n);
+        return out;
     }
 
-    static std::string encode_bulk_string(const std::string& s) {
-        return "$" + std::to_string(s.size()) + "\r\n" + s + "\r\n";
+    static std::string encode_bulk_string(std::string_view s) {
+        std::string out;
+        out.reserve(s.size() + 16);
+        append_bulk_string(out, s);
+        return out;
     }
 
     static std::string encode_null() {
@@ -46,10 +135,8 @@ public:
     }
 
     static std::string encode_array(const std::vector<std::string>& items) {
-        std::string out = "*" + std::to_string(items.size()) + "\r\n";
-        for (auto& item : items) {
-            out += encode_bulk_string(item);
-        }
+        std::string out;
+        append_array(out, items);
         return out;
     }
 
@@ -149,6 +236,245 @@ private:
         }
         return tokens;
     }
+
+    static void append_decimal(std::string& out, int64_t n) {
+        char digits[24];
+        auto res = std::to_chars(digits, digits + sizeof(digits), n);
+        out.append(digits, res.ptr);
+    }
+};
+
+/**
+ * RESPStream — Incremental, zero-copy RESP request reader.
+ *
+ * Owns one reusable input buffer per connection.  Bytes are received
+ * straight into it (prepare() + commit()), and next() hands back each
+ * complete command as std::string_view tokens pointing into that buffer.
+ * The scan position survives partial reads, so a command split across
+ * many recv() calls is never re-parsed from its first byte, and consumed
+ * bytes are reclaimed by one memmove per refill instead of an erase per
+ * command.
+ *
+ * Tokens stay valid until the next prepare()/append() — i.e. for the
+ * whole batch of commands parsed out of one read.
+ *
+ * Usage:
+ *   char* p = stream.prepare(4096);
+ *   stream.commit(recv(fd, p, 4096, 0));
+ *   std::vector<std::string_view> argv;
+ *   while (stream.next(argv) == RESPStream::Status::Ok) execute(argv);
+ */
+class RESPStream {
+public:
+    enum class Status { Ok, NeedMore, Error };
+
+    static constexpr size_t kInitialCapacity = 16 * 1024;
+    static constexpr int64_t kMaxBulkLength  = 512LL * 1024 * 1024;  // Redis proto-max-bulk-len
+    static constexpr int64_t kMaxArgs        = 1024 * 1024;
+    static constexpr size_t kMaxInlineLength = 64 * 1024;
+    // Arguments reserved from an array header; more grow as they arrive,
+    // so a bare "*1048576\r\n" cannot pin megabytes per connection.
+    static constexpr int64_t kReserveArgs    = 64;
+
+    RESPStream() : cap_(0), rpos_(0), wpos_(0) { reset_command(); }
+
+    RESPStream(const RESPStream&) = delete;
+    RESPStream& operator=(const RESPStream&) = delete;
+
+    /**
+     * Make room for at least `n` more bytes and return where to write them.
+     * May move buffered bytes, which invalidates previously returned tokens.
+     */
+    char* prepare(size_t n) {
+        if (cap_ - wpos_ >= n) return buf_.get() + wpos_;
+
+        // Reclaim consumed bytes first; only grow if that is not enough.
+        size_t live = wpos_ - rpos_;
+        if (rpos_ > 0 && cap_ - live >= n) {
+            std::memmove(buf_.get(), buf_.get() + rpos_, live);
+        } else {
+            size_t new_cap = cap_ ? cap_ : kInitialCapacity;
+            while (new_cap - live < n) new_cap *= 2;
+            std::unique_ptr<char[]> grown(new char[new_cap]);
+            if (live) std::memcpy(grown.get(), buf_.get() + rpos_, live);
+            buf_ = std::move(grown);
+            cap_ = new_cap;
+        }
+        scan_ -= rpos_;
+        wpos_ = live;
+        rpos_ = 0;
+        return buf_.get() + wpos_;
+    }
+
+    /** Mark `n` bytes written at the pointer returned by prepare(). */
+    void commit(size_t n) { wpos_ += n; }
+
+    void append(const char* data, size_t n) {
+        std::memcpy(prepare(n), data, n);
+        commit(n);
+    }
+
+    void append(std::string_view s) { append(s.data(), s.size()); }
+
+    /**
+     * Parse the next complete command into `argv`.
+     *   Ok       — argv holds the command; its bytes are consumed.
+     *   NeedMore — the buffered bytes end mid-command; state is kept.
+     *   Error    — protocol violation; see error().  The stream is unusable.
+     */
+    Status next(std::vector<std::string_view>& argv) {
+        argv.clear();
+        if (!error_.empty()) return Status::Error;
+
+        // Blank inline lines and "*0" / "*-1" frames carry no command and
+        // are skipped here, iteratively: a client can queue any number.
+        while (argv.empty()) {
+            if (state_ == State::Start) {
+                if (scan_ >= wpos_) return Status::NeedMore;
+                state_ = (buf_[scan_] == '*') ? State::ArrayHeader : State::Inline;
+            }
+
+            Status st = (state_ == State::Inline) ? parse_inline() : parse_array();
+            if (st != Status::Ok) return st;
+
+            const char* base = buf_.get() + rpos_;
+            for (size_t i = 0; i < spans_.size(); ++i) {
+                argv.emplace_back(base + spans_[i].first, spans_[i].second);
+            }
+            rpos_ = scan_;
+            reset_command();
+        }
+        return Status::Ok;
+    }
+
+    /** Bytes received but not yet returned as a complete command. */
+    size_t buffered() const { return wpos_ - rpos_; }
+    size_t capacity() const { return cap_; }
+    /** Argument slots allocated for the command being parsed. */
+    size_t arg_capacity() const { return spans_.capacity(); }
+    const std::string& error() const { return error_; }
+
+private:
+    enum class State { Start, ArrayHeader, BulkHeader, BulkData, Inline };
+
+    void reset_command() {
+        state_ = State::Start;
+        scan_ = rpos_;
+        args_left_ = 0;
+        bulk_len_ = 0;
+        spans_.clear();
+    }
+
+    Status fail(const char* msg) {
+        error_ = msg;
+        return Status::Error;
+    }
+
+    /**
+     * Read an integer line "<digits>\r\n" starting at scan_ + skip.
+     * On success advances scan_ past the CRLF.
+     */
+    Status read_number(size_t skip, int64_t& out) {
+        size_t p = scan_ + skip;
+        bool neg = false;
+        if (p < wpos_ && buf_[p] == '-') { neg = true; ++p; }
+        int64_t v = 0;
+        size_t digits = 0;
+        while (p < wpos_ && buf_[p] >= '0' && buf_[p] <= '9') {
+            v = v * 10 + (buf_[p] - '0');
+            if (v > kMaxBulkLength) return fail("invalid length");
+            ++p; ++digits;
+        }
+        if (p + 1 >= wpos_) return Status::NeedMore;
+        if (digits == 0 || buf_[p] != '\r' || buf_[p + 1] != '\n') {
+            return fail("invalid length");
+        }
+        out = neg ? -v : v;
+        scan_ = p + 2;
+        return Status::Ok;
+    }
+
+    Status parse_array() {
+        if (state_ == State::ArrayHeader) {
+            int64_t n = 0;
+            Status st = read_number(1, n);
+            if (st != Status::Ok) return st;
+            if (n > kMaxArgs) return fail("invalid multibulk length");
+            args_left_ = n > 0 ? n : 0;
+            spans_.reserve(static_cast<size_t>(std::min(args_left_, kReserveArgs)));
+            state_ = State::BulkHeader;
+        }
+
+        while (args_left_ > 0) {
+            if (state_ == State::BulkHeader) {
+                if (scan_ >= wpos_) return Status::NeedMore;
+                if (buf_[scan_] != '$') {
+                    // Non-bulk element (+simple / :int) — take the line as a token
+                    const void* lf = std::memchr(buf_.get() + scan_, '\n', wpos_ - scan_);
+                    if (!lf) return Status::NeedMore;
+                    size_t end = static_cast<const char*>(lf) - buf_.get();
+                    size_t tok_end = (end > scan_ && buf_[end - 1] == '\r') ? end - 1 : end;
+                    spans_.emplace_back(scan_ + 1 - rpos_, tok_end - scan_ - 1);
+                    scan_ = end + 1;
+                    --args_left_;
+                    continue;
+                }
+                Status st = read_number(1, bulk_len_);
+                if (st != Status::Ok) return st;
+                if (bulk_len_ < 0) {             // null bulk string
+                    spans_.emplace_back(scan_ - rpos_, 0);
+                    --args_left_;
+                    continue;
+                }
+                state_ = State::BulkData;
+            }
+
+            // State::BulkData — wait for <len> bytes plus CRLF
+            size_t len = static_cast<size_t>(bulk_len_);
+            if (wpos_ - scan_ < len + 2) return Status::NeedMore;
+            if (buf_[scan_ + len] != '\r' || buf_[scan_ + len + 1] != '\n') {
+                return fail("bulk string not terminated by CRLF");
+            }
+            spans_.emplace_back(scan_ - rpos_, len);
+            scan_ += len + 2;
+            --args_left_;
+            state_ = State::BulkHeader;
+        }
+        return Status::Ok;
+    }
+
+    Status parse_inline() {
+        const void* lf = std::memchr(buf_.get() + scan_, '\n', wpos_ - scan_);
+        if (!lf) {
+            scan_ = wpos_;  // nothing before here can hold the newline
+            if (wpos_ - rpos_ > kMaxInlineLength) return fail("too big inline request");
+            return Status::NeedMore;
+        }
+        size_t end = static_cast<const char*>(lf) - buf_.get();
+        size_t line_end = (end > rpos_ && buf_[end - 1] == '\r') ? end - 1 : end;
+
+        size_t p = rpos_;
+        while (p < line_end) {
+            while (p < line_end && (buf_[p] == ' ' || buf_[p] == '\t')) ++p;
+            size_t start = p;
+            while (p < line_end && buf_[p] != ' ' && buf_[p] != '\t') ++p;
+            if (p > start) spans_.emplace_back(start - rpos_, p - start);
+        }
+        scan_ = end + 1;
+        return Status::Ok;
+    }
+
+    std::unique_ptr<char[]> buf_;
+    size_t cap_;
+    size_t rpos_;    // first byte of the command being parsed
+    size_t wpos_;    // end of received data
+    size_t scan_;    // resume point inside the current command
+
+    State   state_;
+    int64_t args_left_;
+    int64_t bulk_len_;
+    std::vector<std::pair<size_t, size_t>> spans_;  // (offset from rpos_, length)
+    std::string error_;
 };
 
 }  // namespace network
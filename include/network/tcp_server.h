@@ -22,6 +22,7 @@
 #endif
 
 #include "client_handler.h"
+#include "event_loop.h"
 #include "resp_parser.h"
 #include "../sync/cache_manager.h"
 #include "../compat/threading.h"
@@ -30,30 +31,66 @@
 #include <vector>
 #include <iostream>
 #include <functional>
+#include <memory>
 #include <cstring>
 
 namespace dcs {
 namespace network {
 
+/**
+ * I/O model for client connections.
+ *   EventLoop       — N epoll reactors (one per core by default), Linux only.
+ *   ThreadPerClient — one blocking thread per connection; portable fallback.
+ */
+enum class IOModel {
+    EventLoop,
+    ThreadPerClient
+};
+
 /**
  * TCPServer — Multi-threaded TCP server speaking the RESP protocol.
  *
  * Compatible with redis-cli, any Redis client library, or plain telnet.
- * One thread per client (simple model; could be upgraded to epoll/io_uring).
+ * The accept loop runs on the caller's thread and hands each connection
+ * to a reactor (EventLoop) or to a dedicated thread (ThreadPerClient).
  *
  * Usage:
  *   TCPServer server(6379, &cache_manager);
  *   server.start();   // blocks in accept loop
  *   // ... from another thread: server.stop();
+ *
+ * The accept thread owns the reactors and the listen socket: stop()
+ * only shuts the socket down and waits for start() to return, which
+ * tears them down once accept() can no longer hand out a connection.
  */
 class TCPServer {
 public:
+    struct Config {
+        IOModel io_model       = IOModel::EventLoop;
+        size_t  reactor_threads = 0;   // 0 = hardware_concurrency()
+        size_t  max_output_buffer = 64 * 1024;  // per-connection reply bytes before back-pressure
+        cluster::Cluster* cluster = nullptr;     // slot routing; null = standalone node
+    };
+
     TCPServer(uint16_t port, sync::CacheManager* manager)
+        : TCPServer(port, manager, Config()) {}
+
+    TCPServer(uint16_t port, sync::CacheManager* manager, Config cfg)
         : port_(port)
         , manager_(manager)
+        , config_(cfg)
         , running_(false)
         , listen_fd_(SOCKET_INVALID)
-        , client_count_(0) {}
+        , client_count_(0)
+        , next_reactor_(0) {
+#if !DCS_HAVE_EPOLL
+        if (config_.io_model == IOModel::EventLoop) {
+            std::cerr << "[TCP] Event loop unavailable on this platform; "
+                         "using thread-per-client\n";
+            config_.io_model = IOModel::ThreadPerClient;
+        }
+#endif
+    }
 
     ~TCPServer() {
         stop();
@@ -62,30 +99,56 @@ public:
     /** Start the server (blocking — call from dedicated thread or main). */
     void start() {
         if (!init_socket()) return;
+        if (config_.io_model == IOModel::EventLoop && !start_reactors()) {
+            std::cerr << "[TCP] Reactor start failed; using thread-per-client\n";
+            config_.io_model = IOModel::ThreadPerClient;
+        }
         running_ = true;
 
         std::cout << "=== Distributed Cache Server ===\n";
-        std::cout << "Listening on port " << port_ << "\n";
+        std::cout << "Listening on port " << port_ << " ("
+                  << (config_.io_model == IOModel::EventLoop
+                      ? std::to_string(reactor_count()) + " event-loop reactors"
+                      : std::string("thread-per-client")) << ")\n";
         std::cout << "Compatible with redis-cli: redis-cli -p " << port_ << "\n";
         std::cout << "Press Ctrl+C to stop.\n\n";
 
+        {
+            compat::LockGuard<compat::Mutex> lock(accept_mu_);
+            accepting_ = true;
+        }
+        acceptor() = this;
         accept_loop();
+        acceptor() = nullptr;
+        shutdown_io();
+        {
+            compat::LockGuard<compat::Mutex> lock(accept_mu_);
+            accepting_ = false;
+        }
+        accept_cv_.notify_all();
     }
 
-    /** Signal the server to stop accepting new connections. */
+    /**
+     * Stop accepting connections and wait for the accept loop to wind
+     * down.  Called on the accept thread itself (a signal handler) it
+     * only signals; start() finishes the shutdown when accept() returns.
+     */
     void stop() {
-        running_ = false;
-        if (listen_fd_ != SOCKET_INVALID) {
-            CLOSE_SOCKET(listen_fd_);
-            listen_fd_ = SOCKET_INVALID;
-        }
-
-        // Join all client threads
-        compat::LockGuard<compat::Mutex> lock(threads_mu_);
-        for (auto& t : client_threads_) {
-            if (t.joinable()) t.join();
+        {
+            compat::UniqueLock<compat::Mutex> lock(accept_mu_);
+            running_ = false;
+            if (listen_fd_ != SOCKET_INVALID) {
+#ifdef _WIN32
+                CLOSE_SOCKET(listen_fd_);   // the only way to wake accept() here
+                listen_fd_ = SOCKET_INVALID;
+#else
+                shutdown(listen_fd_, SHUT_RDWR);   // accept() returns; the fd stays ours
+#endif
+            }
+            if (acceptor() == this) return;
+            accept_cv_.wait(lock, [this] { return !accepting_; });
         }
-        client_threads_.clear();
+        shutdown_io();
 
 #ifdef _WIN32
         WSACleanup();
@@ -93,8 +156,65 @@ public:
     }
 
     uint32_t client_count() const { return client_count_.load(); }
+    IOModel io_model() const { return config_.io_model; }
+
+    size_t reactor_count() const {
+#if DCS_HAVE_EPOLL
+        return reactors_.size();
+#else
+        return 0;
+#endif
+    }
 
 private:
+    /** The server whose accept loop runs on the calling thread, if any. */
+    static TCPServer*& acceptor() {
+        static thread_local TCPServer* current = nullptr;
+        return current;
+    }
+
+    /** Close the listener, stop the reactors and join client threads (idempotent). */
+    void shutdown_io() {
+        {
+            compat::LockGuard<compat::Mutex> lock(accept_mu_);
+            if (listen_fd_ != SOCKET_INVALID) {
+                CLOSE_SOCKET(listen_fd_);
+                listen_fd_ = SOCKET_INVALID;
+            }
+        }
+
+#if DCS_HAVE_EPOLL
+        for (auto& r : reactors_) r->stop();
+        reactors_.clear();
+#endif
+
+        // Join all client threads
+        compat::LockGuard<compat::Mutex> lock(threads_mu_);
+        for (auto& c : client_threads_) {
+            if (c.thread.joinable()) c.thread.join();
+        }
+        client_threads_.clear();
+    }
+
+    bool start_reactors() {
+#if DCS_HAVE_EPOLL
+        size_t n = config_.reactor_threads;
+        if (n == 0) n = std::max(1u, compat::Thread::hardware_concurrency());
+        for (size_t i = 0; i < n; ++i) {
+            auto r = std::make_unique<Reactor>(manager_, config_.max_output_buffer, config_.cluster);
+            if (!r->start()) {
+                for (auto& started : reactors_) started->stop();
+                reactors_.clear();
+                return false;
+            }
+            reactors_.push_back(std::move(r));
+        }
+        return true;
+#else
+        return false;
+#endif
+    }
+
     bool init_socket() {
 #ifdef _WIN32
         WSADATA wsa;
@@ -142,6 +262,7 @@ private:
     }
 
     void accept_loop() {
+        const socket_t listen_fd = listen_fd_;
         while (running_) {
             sockaddr_in client_addr{};
 #ifdef _WIN32
@@ -149,7 +270,7 @@ private:
 #else
             socklen_t addr_len = sizeof(client_addr);
 #endif
-            socket_t client_fd = accept(listen_fd_,
+            socket_t client_fd = accept(listen_fd,
                                         reinterpret_cast<sockaddr*>(&client_addr),
                                         &addr_len);
             if (client_fd == SOCKET_INVALID) {
@@ -158,56 +279,91 @@ private:
                 }
                 continue;
             }
+            if (!running_) {   // raced stop(): the reactors are about to go
+                CLOSE_SOCKET(client_fd);
+                break;
+            }
 
             client_count_++;
             std::string ip = inet_ntoa(client_addr.sin_addr);
             std::cout << "[TCP] Client connected: " << ip
                       << ":" << ntohs(client_addr.sin_port) << "\n";
 
-            // Spawn a thread for this client
+#if DCS_HAVE_EPOLL
+            if (config_.io_model == IOModel::EventLoop) {
+                size_t idx = next_reactor_++ % reactors_.size();
+                reactors_[idx]->adopt(client_fd, ip);
+                continue;
+            }
+#endif
+
+            // Spawn a thread for this client, reaping ones that have exited
             compat::LockGuard<compat::Mutex> lock(threads_mu_);
-            client_threads_.push_back(compat::Thread([this, client_fd, ip]() {
+            reap_finished_threads();
+            auto done = std::make_shared<compat::Atomic<bool>>(false);
+            client_threads_.push_back({compat::Thread([this, client_fd, ip, done]() {
                 handle_client(client_fd, ip);
-            }));
+                done->store(true);
+            }), done});
         }
     }
 
+    /** Join and drop threads whose client already disconnected (threads_mu_ held). */
+    void reap_finished_threads() {
+        size_t kept = 0;
+        for (size_t i = 0; i < client_threads_.size(); ++i) {
+            if (client_threads_[i].done->load()) {
+                client_threads_[i].thread.join();
+            } else {
+                if (kept != i) client_threads_[kept] = std::move(client_threads_[i]);
+                ++kept;
+            }
+        }
+        client_threads_.resize(kept);
+    }
+
     void handle_client(socket_t fd, std::string ip) {
-        ClientHandler handler(manager_);
-        std::string buffer;
-        char recv_buf[4096];
+        ClientHandler handler(manager_, config_.cluster);
+        RESPStream stream;
+        std::vector<std::string_view> argv;
+        std::string out;  // replies for the current recv batch
+        const size_t kReadChunk = 4096;
 
         while (running_) {
+            char* dst = stream.prepare(kReadChunk);
 #ifdef _WIN32
-            int n = recv(fd, recv_buf, sizeof(recv_buf), 0);
+            int n = recv(fd, dst, static_cast<int>(kReadChunk), 0);
 #else
-            ssize_t n = recv(fd, recv_buf, sizeof(recv_buf), 0);
+            ssize_t n = recv(fd, dst, kReadChunk, 0);
 #endif
             if (n <= 0) break;  // client disconnected or error
 
-            buffer.append(recv_buf, n);
-
-            // Process all complete commands in the buffer
-            while (!buffer.empty()) {
-                size_t consumed = 0;
-                auto tokens = RESPParser::parse(buffer, consumed);
-
-                if (tokens.empty() || consumed == 0) break;  // need more data
-
-                auto response = handler.execute(tokens);
-
-                // Send response
-                send_all(fd, response.data);
-
-                // Remove consumed bytes
-                buffer.erase(0, consumed);
-
-                if (response.close_connection) {
-                    CLOSE_SOCKET(fd);
-                    std::cout << "[TCP] Client disconnected (QUIT): " << ip << "\n";
-                    return;
+            stream.commit(static_cast<size_t>(n));
+
+            // Execute every complete command; replies are coalesced into one send
+            RESPStream::Status st;
+            bool quit = false;
+            while (!quit && (st = stream.next(argv)) == RESPStream::Status::Ok) {
+                quit = handler.execute_into(argv, out);
+                // Back-pressure: a blocking send drains the buffer before parsing on
+                if (out.size() >= config_.max_output_buffer) {
+                    send_all(fd, out);
+                    out.clear();
                 }
             }
+            if (!quit && st == RESPStream::Status::Error) {
+                RESPParser::append_error(out, "Protocol error: " + stream.error());
+                quit = true;
+            }
+            if (!out.empty()) {
+                send_all(fd, out);
+                out.clear();
+            }
+            if (quit) {
+                CLOSE_SOCKET(fd);
+                std::cout << "[TCP] Client disconnected (QUIT): " << ip << "\n";
+                return;
+            }
         }
 
         CLOSE_SOCKET(fd);
@@ -229,12 +385,25 @@ private:
         }
     }
 
+    struct ClientThread {
+        compat::Thread thread;
+        std::shared_ptr<compat::Atomic<bool>> done;
+    };
+
     uint16_t port_;
     sync::CacheManager* manager_;
+    Config config_;
     compat::Atomic<bool> running_;
-    socket_t listen_fd_;
+    socket_t listen_fd_;                 // guarded by accept_mu_ once start() runs
+    compat::Mutex accept_mu_;
+    compat::CondVar accept_cv_;
+    bool accepting_ = false;             // start() is in or tearing down the accept loop
     compat::Atomic<uint32_t> client_count_;
-    std::vector<compat::Thread> client_threads_;
+    size_t next_reactor_;
+#if DCS_HAVE_EPOLL
+    std::vector<std::unique_ptr<Reactor>> reactors_;
+#endif
+    std::vector<ClientThread> client_threads_;
     compat::Mutex threads_mu_;
 };
 
@@ -1,100 +1,602 @@
 #pragma once
+// ────────────────────────────────────────────────────────────────
+// FileStorage: append-only log backend with an in-memory key index.
+//
+// Bitcask layout: every store/remove appends one length-prefixed,
+// checksummed record to the active data file (<path>.<n>), and an
+// in-memory index maps each live key to the record holding its value.
+// A load is one positioned read; a store is one append, and a batch is
+// one write() for all of its records.  The active file rolls once it
+// passes max_file_bytes.  A background merger rewrites the older files
+// into one holding only live records once enough of them is garbage,
+// so disk use tracks the live data set rather than the write history.
+//
+// Record:  [CRC32:4][key_len:4][val_len:4][key][value]
+//          val_len == kTombstone marks a delete (no value bytes).
+//
+// A legacy "KEY\tVALUE\n" file at <path> is imported on first open.
+// ────────────────────────────────────────────────────────────────
 
 #include "storage_backend.h"
 #include "../compat/threading.h"
+#include "../storage/wal.h"
 
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
 #include <string>
 #include <unordered_map>
-#include <fstream>
-#include <sstream>
+#include <vector>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <dirent.h>
+#include <unistd.h>
+#endif
 
 namespace dcs {
 namespace persistence {
 
-/**
- * FileStorage — A simple JSON-like file-backed key-value store.
- *
- * Format on disk (one entry per line):  KEY\tVALUE\n
- * On startup the entire file is loaded into an in-memory map; writes
- * rewrite the full file (simple but correct for demonstration).
- *
- * Thread-safety: internal mutex protects file I/O.
- */
+struct FileStorageOptions {
+    size_t   max_file_bytes    = 64 * 1024 * 1024;   // roll the active file past this
+    double   merge_ratio       = 0.5;    // merge once this share of old files is garbage
+    size_t   merge_min_bytes   = 4 * 1024 * 1024;    // ...and at least this many bytes
+    uint32_t merge_interval_ms = 1000;   // background check period; 0 = no merger thread
+    bool     sync_writes       = false;  // fdatasync after every append
+};
+
+namespace file_storage_detail {
+
+inline uint32_t Crc32(const char* p, size_t n, uint32_t crc = 0) {
+    static const auto table = [] {
+        struct Table { uint32_t v[256]; } t;
+        for (uint32_t i = 0; i < 256; ++i) {
+            uint32_t c = i;
+            for (int k = 0; k < 8; ++k) c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            t.v[i] = c;
+        }
+        return t;
+    }();
+    crc = ~crc;
+    for (size_t i = 0; i < n; ++i) {
+        crc = table.v[(crc ^ static_cast<unsigned char>(p[i])) & 0xFF] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+#ifdef _WIN32
+inline int OpenRead(const std::string& path) { return _open(path.c_str(), _O_RDONLY | _O_BINARY); }
+inline bool ReadAt(int fd, uint64_t offset, size_t n, char* out) {
+    if (_lseeki64(fd, static_cast<__int64>(offset), SEEK_SET) < 0) return false;
+    while (n > 0) {
+        int got = _read(fd, out, static_cast<unsigned>(std::min<size_t>(n, 1u << 30)));
+        if (got <= 0) return false;
+        out += got;
+        n -= static_cast<size_t>(got);
+    }
+    return true;
+}
+#else
+inline int OpenRead(const std::string& path) { return ::open(path.c_str(), O_RDONLY); }
+inline bool ReadAt(int fd, uint64_t offset, size_t n, char* out) {
+    while (n > 0) {
+        ssize_t got = ::pread(fd, out, n, static_cast<off_t>(offset));
+        if (got < 0 && errno == EINTR) continue;
+        if (got <= 0) return false;
+        out += got;
+        offset += static_cast<uint64_t>(got);
+        n -= static_cast<size_t>(got);
+    }
+    return true;
+}
+#endif
+
+}  // namespace file_storage_detail
+
 class FileStorage : public StorageBackend {
 public:
-    explicit FileStorage(const std::string& filepath)
-        : filepath_(filepath) {
-        load_from_disk();
+    static constexpr uint32_t kTombstone = 0xFFFFFFFFu;
+    static constexpr size_t   kHeader    = 12;   // crc | key_len | val_len
+
+    explicit FileStorage(const std::string& filepath,
+                         const FileStorageOptions& options = FileStorageOptions())
+        : filepath_(filepath), options_(options) {
+        ensure_parent_dir(filepath_);
+        recover();
+        if (options_.merge_interval_ms > 0) {
+            merger_ = compat::Thread([this] { merge_loop(); });
+        }
     }
 
-    ~FileStorage() override = default;
+    ~FileStorage() override {
+        {
+            compat::LockGuard<compat::Mutex> lock(stop_mu_);
+            stopping_ = true;
+        }
+        stop_cv_.notify_all();
+        if (merger_.joinable()) merger_.join();
+        compat::LockGuard<compat::Mutex> lock(mu_);
+        if (append_fd_ >= 0) storage::wal_detail::CloseFd(append_fd_);
+        for (auto& f : files_) close_read(f.second);
+    }
+
+    FileStorage(const FileStorage&) = delete;
+    FileStorage& operator=(const FileStorage&) = delete;
 
     LoadResult load(const std::string& key) override {
         compat::LockGuard<compat::Mutex> lock(mu_);
-        auto it = data_.find(key);
-        if (it == data_.end()) return LoadResult::Miss();
-        return LoadResult::Hit(it->second);
+        std::string value;
+        return read_value(key, value) ? LoadResult::Hit(value) : LoadResult::Miss();
+    }
+
+    std::vector<LoadResult> batch_load(const std::vector<std::string>& keys) override {
+        compat::LockGuard<compat::Mutex> lock(mu_);
+        std::vector<LoadResult> out;
+        out.reserve(keys.size());
+        std::string value;
+        for (const auto& key : keys) {
+            out.push_back(read_value(key, value) ? LoadResult::Hit(value) : LoadResult::Miss());
+        }
+        return out;
     }
 
     bool store(const std::string& key, const std::string& value) override {
+        std::string rec;
+        encode(rec, key, &value);
         compat::LockGuard<compat::Mutex> lock(mu_);
-        data_[key] = value;
-        return flush_to_disk();
+        uint64_t at;
+        if (!append(rec, at)) return false;
+        index_put(key, Loc{active_id_, at, static_cast<uint32_t>(rec.size())});
+        maybe_roll();
+        return true;
     }
 
     bool remove(const std::string& key) override {
         compat::LockGuard<compat::Mutex> lock(mu_);
-        auto it = data_.find(key);
-        if (it == data_.end()) return false;
-        data_.erase(it);
-        return flush_to_disk();
+        auto it = index_.find(key);
+        if (it == index_.end()) return false;
+        std::string rec;
+        encode(rec, key, nullptr);
+        uint64_t at;
+        if (!append(rec, at)) return false;
+        files_[it->second.file].live_bytes -= it->second.size;
+        index_.erase(it);
+        maybe_roll();
+        return true;
     }
 
     bool batch_store(const std::vector<std::pair<std::string, std::string>>& entries) override {
+        if (entries.empty()) return true;
+        std::string buf;
+        std::vector<uint32_t> sizes;
+        sizes.reserve(entries.size());
+        for (const auto& e : entries) {
+            size_t before = buf.size();
+            encode(buf, e.first, &e.second);
+            sizes.push_back(static_cast<uint32_t>(buf.size() - before));
+        }
         compat::LockGuard<compat::Mutex> lock(mu_);
-        for (auto it = entries.begin(); it != entries.end(); ++it) {
-            data_[it->first] = it->second;
+        uint64_t at;
+        if (!append(buf, at)) return false;
+        for (size_t i = 0; i < entries.size(); ++i) {
+            index_put(entries[i].first, Loc{active_id_, at, sizes[i]});
+            at += sizes[i];
         }
-        return flush_to_disk();
+        maybe_roll();
+        return true;
     }
 
     bool ping() override {
-        return true;  // local file is always "available"
+        compat::LockGuard<compat::Mutex> lock(mu_);
+        return append_fd_ >= 0;
     }
 
     /** Return total keys stored on disk. */
     size_t disk_size() const {
         compat::LockGuard<compat::Mutex> lock(mu_);
-        return data_.size();
+        return index_.size();
+    }
+
+    /** Data files currently on disk (active one included). */
+    size_t file_count() const {
+        compat::LockGuard<compat::Mutex> lock(mu_);
+        return files_.size();
+    }
+
+    /** Bytes across all data files, and the share of them still live. */
+    uint64_t total_bytes() const {
+        compat::LockGuard<compat::Mutex> lock(mu_);
+        uint64_t total = 0;
+        for (const auto& f : files_) total += f.second.bytes;
+        return total;
+    }
+
+    uint64_t live_bytes() const {
+        compat::LockGuard<compat::Mutex> lock(mu_);
+        uint64_t live = 0;
+        for (const auto& f : files_) live += f.second.live_bytes;
+        return live;
+    }
+
+    uint64_t merge_count() const { return merges_.load(); }
+
+    /**
+     * Rewrite every file older than the active one into a single file
+     * of live records.  Writers and readers continue meanwhile; the
+     * index only swaps over at the end.  Returns false if there was
+     * nothing to merge or the rewrite failed (the old files then stay).
+     */
+    bool merge() {
+        compat::LockGuard<compat::Mutex> one(merge_mu_);
+        std::vector<uint32_t> ids;
+        {
+            compat::LockGuard<compat::Mutex> lock(mu_);
+            for (const auto& f : files_) {
+                if (f.first != active_id_) ids.push_back(f.first);
+            }
+        }
+        if (ids.empty()) return false;
+        std::sort(ids.begin(), ids.end());
+        uint32_t target = ids.back();
+
+        // Copy live records out of each file.  Files are read and checked
+        // unlocked; writers only wait while one file's records are looked
+        // up in the index.
+        struct Record { uint64_t off; uint32_t size; std::string key; };
+        struct Moved { std::string key; Loc from; uint64_t to; };
+        std::vector<Moved> moved;
+        std::string tmp = merge_path(target) + ".tmp";
+        std::remove(tmp.c_str());
+        int out = storage::wal_detail::OpenAppend(tmp);
+        if (out < 0) return false;
+        uint64_t out_bytes = 0;
+        bool ok = true;
+        for (uint32_t id : ids) {
+            std::string data = read_file(data_path(id));
+            std::vector<Record> records;
+            parse(data, [&](uint64_t off, uint32_t size, const std::string& key, bool tomb) {
+                // Tombstones go: every older record is in this merge too
+                if (!tomb) records.push_back({off, size, key});
+            });
+            std::string chunk;
+            {
+                compat::LockGuard<compat::Mutex> lock(mu_);
+                for (auto& r : records) {
+                    auto it = index_.find(r.key);
+                    if (it == index_.end() || it->second.file != id || it->second.offset != r.off) continue;
+                    moved.push_back({std::move(r.key), it->second, out_bytes + chunk.size()});
+                    chunk.append(data, static_cast<size_t>(r.off), r.size);
+                }
+            }
+            if (!chunk.empty() && !storage::wal_detail::WriteAll(out, chunk.data(), chunk.size())) {
+                ok = false;
+                break;
+            }
+            out_bytes += chunk.size();
+        }
+        ok = ok && storage::wal_detail::SyncFd(out);
+        storage::wal_detail::CloseFd(out);
+        if (!ok || std::rename(tmp.c_str(), merge_path(target).c_str()) != 0) {
+            std::remove(tmp.c_str());
+            return false;
+        }
+
+        // <target>.merge is complete: from here recovery finishes the swap.
+        compat::LockGuard<compat::Mutex> lock(mu_);
+        for (uint32_t id : ids) {
+            close_read(files_[id]);
+            files_.erase(id);
+            if (id != target) std::remove(data_path(id).c_str());
+        }
+        install_merge(target);
+        DataFile& merged = files_[target];
+        merged.bytes = out_bytes;
+        for (const auto& m : moved) {
+            auto it = index_.find(m.key);
+            if (it == index_.end() || it->second.file != m.from.file || it->second.offset != m.from.offset) {
+                continue;   // rewritten or removed while the merge ran
+            }
+            it->second = Loc{target, m.to, m.from.size};
+            merged.live_bytes += m.from.size;
+        }
+        merges_.fetch_add(1);
+        return true;
     }
 
 private:
-    void load_from_disk() {
-        std::ifstream in(filepath_);
-        if (!in.is_open()) return;  // file may not exist yet
+    struct Loc {
+        uint32_t file;
+        uint64_t offset;   // of the record
+        uint32_t size;     // whole record, header included
+    };
+
+    struct DataFile {
+        int      read_fd    = -1;
+        uint64_t bytes      = 0;
+        uint64_t live_bytes = 0;
+    };
+
+    static void encode(std::string& out, const std::string& key, const std::string* value) {
+        size_t start = out.size();
+        uint32_t key_len = static_cast<uint32_t>(key.size());
+        uint32_t val_len = value ? static_cast<uint32_t>(value->size()) : kTombstone;
+        out.resize(start + kHeader);
+        std::memcpy(&out[start + 4], &key_len, 4);
+        std::memcpy(&out[start + 8], &val_len, 4);
+        out += key;
+        if (value) out += *value;
+        uint32_t crc = file_storage_detail::Crc32(out.data() + start + 4, out.size() - start - 4);
+        std::memcpy(&out[start], &crc, 4);
+    }
 
-        std::string line;
+    /**
+     * Walk the whole records in `data`, calling fn(offset, size, key,
+     * tombstone) for each.  Returns the length of the valid prefix: a
+     * torn or corrupt record ends it.
+     */
+    template <typename Fn>
+    static size_t parse(const std::string& data, Fn&& fn) {
+        size_t pos = 0;
+        while (data.size() - pos >= kHeader) {
+            uint32_t crc, key_len, val_len;
+            std::memcpy(&crc, data.data() + pos, 4);
+            std::memcpy(&key_len, data.data() + pos + 4, 4);
+            std::memcpy(&val_len, data.data() + pos + 8, 4);
+            bool tomb = val_len == kTombstone;
+            uint64_t body = static_cast<uint64_t>(key_len) + (tomb ? 0 : val_len);
+            if (body > data.size() - pos - kHeader) break;
+            size_t size = kHeader + static_cast<size_t>(body);
+            if (file_storage_detail::Crc32(data.data() + pos + 4, size - 4) != crc) break;
+            fn(static_cast<uint64_t>(pos), static_cast<uint32_t>(size),
+               data.substr(pos + kHeader, key_len), tomb);
+            pos += size;
+        }
+        return pos;
+    }
+
+    bool read_value(const std::string& key, std::string& value) {
+        auto it = index_.find(key);
+        if (it == index_.end()) return false;
+        const Loc& loc = it->second;
+        std::string rec(loc.size, '\0');
+        if (!file_storage_detail::ReadAt(files_[loc.file].read_fd, loc.offset, loc.size, &rec[0])) {
+            return false;
+        }
+        uint32_t crc;
+        std::memcpy(&crc, rec.data(), 4);
+        if (file_storage_detail::Crc32(rec.data() + 4, rec.size() - 4) != crc) {
+            std::cerr << "[FileStorage] checksum mismatch for key: " << key << "\n";
+            return false;
+        }
+        value.assign(rec, kHeader + key.size(), std::string::npos);
+        return true;
+    }
+
+    bool append(const std::string& rec, uint64_t& at) {
+        if (append_fd_ < 0) return false;
+        DataFile& f = files_[active_id_];
+        at = f.bytes;
+        if (!storage::wal_detail::WriteAll(append_fd_, rec.data(), rec.size())) return false;
+        if (options_.sync_writes && !storage::wal_detail::SyncFd(append_fd_)) return false;
+        f.bytes += rec.size();
+        return true;
+    }
+
+    void index_put(const std::string& key, const Loc& loc) {
+        auto res = index_.emplace(key, loc);
+        if (!res.second) {
+            files_[res.first->second.file].live_bytes -= res.first->second.size;
+            res.first->second = loc;
+        }
+        files_[loc.file].live_bytes += loc.size;
+    }
+
+    void maybe_roll() {
+        if (files_[active_id_].bytes < options_.max_file_bytes) return;
+        storage::wal_detail::CloseFd(append_fd_);
+        open_active(active_id_ + 1);
+    }
+
+    void open_active(uint32_t id) {
+        active_id_ = id;
+        append_fd_ = storage::wal_detail::OpenAppend(data_path(id));
+        DataFile& f = files_[id];
+        if (f.read_fd < 0) f.read_fd = file_storage_detail::OpenRead(data_path(id));
+    }
+
+    // ──── Recovery ────────────────────────────────────────────────
+
+    void recover() {
+        std::vector<uint32_t> merged;
+        std::vector<uint32_t> ids = list_files(merged);
+        for (uint32_t target : merged) {   // finish a merge that reached its swap
+            ids.erase(std::remove_if(ids.begin(), ids.end(),
+                                     [&](uint32_t id) {
+                                         if (id >= target) return false;
+                                         std::remove(data_path(id).c_str());
+                                         return true;
+                                     }),
+                      ids.end());
+            install_merge(target);
+            if (std::find(ids.begin(), ids.end(), target) == ids.end()) ids.push_back(target);
+        }
+        std::sort(ids.begin(), ids.end());
+
+        for (uint32_t id : ids) {
+            std::string path = data_path(id);
+            std::string data = read_file(path);
+            DataFile& f = files_[id];
+            if (f.read_fd < 0) f.read_fd = file_storage_detail::OpenRead(path);
+            size_t valid = parse(data, [&](uint64_t off, uint32_t size, const std::string& key, bool tomb) {
+                if (!tomb) {
+                    index_put(key, Loc{id, off, size});
+                    return;
+                }
+                auto it = index_.find(key);
+                if (it == index_.end()) return;
+                files_[it->second.file].live_bytes -= it->second.size;
+                index_.erase(it);
+            });
+            f.bytes = valid;
+            if (valid < data.size()) {   // torn tail from a crash mid-append
+                std::cerr << "[FileStorage] truncating " << path << " at byte " << valid << "\n";
+                truncate_file(path, valid);
+            }
+        }
+        open_active(ids.empty() ? 1 : ids.back());
+        if (ids.empty()) import_legacy();
+    }
+
+    // The pre-log format: one "KEY\tVALUE\n" line per entry.
+    void import_legacy() {
+        std::ifstream in(filepath_);
+        if (!in.is_open()) return;
+        std::string line, buf;
+        std::vector<std::pair<std::string, std::string>> entries;
         while (std::getline(in, line)) {
             auto tab = line.find('\t');
             if (tab == std::string::npos) continue;
-            std::string key = line.substr(0, tab);
-            std::string val = line.substr(tab + 1);
-            data_[key] = val;
+            entries.emplace_back(line.substr(0, tab), line.substr(tab + 1));
+        }
+        in.close();
+        std::vector<uint32_t> sizes;
+        for (const auto& e : entries) {
+            size_t before = buf.size();
+            encode(buf, e.first, &e.second);
+            sizes.push_back(static_cast<uint32_t>(buf.size() - before));
+        }
+        uint64_t at = 0;
+        if (!buf.empty() && !(append(buf, at) && storage::wal_detail::SyncFd(append_fd_))) return;
+        for (size_t i = 0; i < entries.size(); ++i) {
+            index_put(entries[i].first, Loc{active_id_, at, sizes[i]});
+            at += sizes[i];
         }
+        std::remove(filepath_.c_str());
     }
 
-    bool flush_to_disk() {
-        // Ensure the parent directory exists (platform-agnostic)
-        ensure_parent_dir(filepath_);
+    std::vector<uint32_t> list_files(std::vector<uint32_t>& merged) const {
+        std::string dir = ".", base = filepath_;
+        size_t sep = filepath_.find_last_of("/\\");
+        if (sep != std::string::npos) {
+            dir = filepath_.substr(0, sep);
+            base = filepath_.substr(sep + 1);
+        }
+        std::vector<uint32_t> ids;
+        auto check = [&](const std::string& name) {
+            if (name.size() <= base.size() + 1 || name.compare(0, base.size(), base) != 0 ||
+                name[base.size()] != '.') {
+                return;
+            }
+            unsigned n = 0;
+            int used = 0;
+            const char* rest = name.c_str() + base.size() + 1;
+            if (std::sscanf(rest, "%u%n", &n, &used) != 1 || n == 0) return;
+            std::string tail = rest + used;
+            if (tail.empty()) ids.push_back(n);
+            else if (tail == ".merge") merged.push_back(n);
+            else if (tail == ".merge.tmp") std::remove((dir + "/" + name).c_str());   // unfinished
+        };
+#ifdef _WIN32
+        struct _finddata_t info;
+        intptr_t handle = _findfirst((filepath_ + ".*").c_str(), &info);
+        if (handle != -1) {
+            do { check(info.name); } while (_findnext(handle, &info) == 0);
+            _findclose(handle);
+        }
+#else
+        DIR* d = opendir(dir.c_str());
+        if (d) {
+            while (struct dirent* entry = readdir(d)) check(entry->d_name);
+            closedir(d);
+        }
+#endif
+        std::sort(ids.begin(), ids.end());
+        std::sort(merged.begin(), merged.end());
+        return ids;
+    }
+
+    // ──── Merge ───────────────────────────────────────────────────
+
+    void merge_loop() {
+        for (;;) {
+            {
+                compat::UniqueLock<compat::Mutex> lock(stop_mu_);
+                stop_cv_.wait_for(lock, std::chrono::milliseconds(options_.merge_interval_ms),
+                                  [this] { return stopping_; });
+                if (stopping_) return;
+            }
+            if (merge_due()) merge();
+        }
+    }
+
+    bool merge_due() const {
+        compat::LockGuard<compat::Mutex> lock(mu_);
+        uint64_t bytes = 0, live = 0;
+        for (const auto& f : files_) {
+            if (f.first == active_id_) continue;
+            bytes += f.second.bytes;
+            live += f.second.live_bytes;
+        }
+        uint64_t garbage = bytes - live;
+        return garbage >= options_.merge_min_bytes &&
+               static_cast<double>(garbage) >= options_.merge_ratio * static_cast<double>(bytes);
+    }
+
+    // Replace <target> with the finished <target>.merge.
+    void install_merge(uint32_t target) {
+        std::string path = data_path(target);
+#ifdef _WIN32
+        std::remove(path.c_str());
+#endif
+        std::rename(merge_path(target).c_str(), path.c_str());
+        DataFile& f = files_[target];
+        f.read_fd = file_storage_detail::OpenRead(path);
+    }
 
-        std::ofstream out(filepath_, std::ios::trunc);
-        if (!out.is_open()) return false;
+    // ──── Files ───────────────────────────────────────────────────
 
-        for (auto it = data_.begin(); it != data_.end(); ++it) {
-            out << it->first << '\t' << it->second << '\n';
+    std::string data_path(uint32_t id) const {
+        char suffix[16];
+        std::snprintf(suffix, sizeof(suffix), ".%06u", id);
+        return filepath_ + suffix;
+    }
+
+    std::string merge_path(uint32_t id) const { return data_path(id) + ".merge"; }
+
+    static std::string read_file(const std::string& path) {
+        std::string data;
+        std::ifstream f(path, std::ios::binary | std::ios::ate);
+        std::streamoff size = f.is_open() ? static_cast<std::streamoff>(f.tellg()) : 0;
+        if (size > 0) {
+            data.resize(static_cast<size_t>(size));
+            f.seekg(0);
+            f.read(&data[0], size);
+            data.resize(static_cast<size_t>(f.gcount()));
         }
-        out.flush();
-        return out.good();
+        return data;
+    }
+
+    static void close_read(DataFile& f) {
+        if (f.read_fd >= 0) storage::wal_detail::CloseFd(f.read_fd);
+        f.read_fd = -1;
+    }
+
+    static void truncate_file(const std::string& path, uint64_t size) {
+#ifdef _WIN32
+        int fd = _open(path.c_str(), _O_RDWR | _O_BINARY);
+        if (fd < 0) return;
+        _chsize_s(fd, static_cast<__int64>(size));
+        _close(fd);
+#else
+        int rc = ::truncate(path.c_str(), static_cast<off_t>(size));
+        (void)rc;   // best effort: the next open cuts it again
+#endif
     }
 
     static void ensure_parent_dir(const std::string& filepath) {
@@ -112,8 +614,19 @@ private:
     }
 
     std::string filepath_;
-    std::unordered_map<std::string, std::string> data_;
+    FileStorageOptions options_;
+    std::unordered_map<std::string, Loc> index_;   // live key -> its latest record
+    std::unordered_map<uint32_t, DataFile> files_;
+    uint32_t active_id_ = 1;
+    int append_fd_ = -1;
     mutable compat::Mutex mu_;
+    compat::Mutex merge_mu_;                        // one merge at a time
+    compat::Atomic<uint64_t> merges_{0};
+
+    compat::Thread merger_;
+    compat::Mutex stop_mu_;
+    compat::CondVar stop_cv_;
+    bool stopping_ = false;
 };
 
 }  // namespace persistence
@@ -4,6 +4,8 @@
 #include <vector>
 #include <utility>
 
+#include "../metrics/latency.h"
+
 namespace dcs {
 namespace persistence {
 
@@ -20,7 +22,8 @@ struct LoadResult {
 
 /**
  * Abstract interface for a durable storage backend.
- * Implementations: FileStorage (JSON on disk), or a future PostgreSQL adapter.
+ * Implementations: FileStorage (append-only log), storage::LSMEngine, or a
+ * future PostgreSQL adapter.
  */
 class StorageBackend {
 public:
@@ -29,6 +32,18 @@ public:
     /** Read a single key. Returns LoadResult::Miss() on miss. */
     virtual LoadResult load(const std::string& key) = 0;
 
+    /**
+     * Batch read — one result per key, in order.  Default implementation
+     * calls load() in a loop; backends override it to share lock and
+     * lookup work across the batch.
+     */
+    virtual std::vector<LoadResult> batch_load(const std::vector<std::string>& keys) {
+        std::vector<LoadResult> out;
+        out.reserve(keys.size());
+        for (size_t i = 0; i < keys.size(); ++i) out.push_back(load(keys[i]));
+        return out;
+    }
+
     /** Write a single key-value pair (upsert). */
     virtual bool store(const std::string& key, const std::string& value) = 0;
 
@@ -43,8 +58,24 @@ public:
         return true;
     }
 
+    /**
+     * Ordered key scan (SCAN).  Appends up to `limit` keys that begin
+     * with `prefix` and sort strictly after `after` ("" = from the
+     * start), ascending, and sets `done` once nothing further can match.
+     * Returns false if the backend can't iterate in key order; the
+     * default can't.
+     */
+    virtual bool scan(const std::string& after, const std::string& prefix, size_t limit,
+                      std::vector<std::string>& keys, bool& done) {
+        (void)after; (void)prefix; (void)limit; (void)keys; (void)done;
+        return false;
+    }
+
     /** Check if the backend is healthy / accessible. */
     virtual bool ping() = 0;
+
+    /** Append the backend's latency histograms (INFO, /api/metrics); none by default. */
+    virtual void collect_latency(metrics::LatencyReport& out) const { (void)out; }
 };
 
 }  // namespace persistence
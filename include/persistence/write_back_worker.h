@@ -3,10 +3,13 @@
 #include "storage_backend.h"
 #include "../compat/threading.h"
 
+#include <algorithm>
 #include <functional>
+#include <string>
 #include <chrono>
 #include <vector>
 #include <iostream>
+#include <unordered_set>
 
 namespace dcs {
 namespace persistence {
@@ -14,31 +17,56 @@ namespace persistence {
 /**
  * WriteBackWorker — Background thread for Write-Behind persistence.
  *
- * Periodically wakes up (every `interval` seconds) and calls a user-supplied
- * collector function to obtain all dirty entries, then batch-writes them to
- * the storage backend.  Also supports manual flush (for graceful shutdown).
+ * Periodically wakes up (every `interval` seconds) and drains the cache's
+ * dirty queues in bounded batches, batch-writing each to the storage
+ * backend.  The cache keeps dirty entries on per-segment FIFOs, so a pass
+ * costs O(dirty) rather than a scan of every entry, and each drain holds
+ * one segment lock for at most one batch.  Repeat writes to a key before
+ * its drain coalesce into a single store.  Also supports manual flush
+ * (for graceful shutdown).
+ *
+ * A drained entry stays in flight until its batch is stored, so the
+ * cache still treats it as unpersisted.  If it is evicted meanwhile,
+ * the cache persists it through store_now(), which is ordered against
+ * the batch: before the batch is written the key is struck from it (the
+ * eviction carries the newer value), after that it waits for the batch.
+ * remove_now() orders a backend remove the same way.
  *
  * Lifecycle:
- *   1. Construct with a StorageBackend*, interval, and dirty-entry collector.
+ *   1. Construct with a StorageBackend*, interval and the cache hooks.
  *   2. Call start().
  *   3. ...server runs...
  *   4. Call stop() — flushes remaining dirty data and joins the thread.
  */
 class WriteBackWorker {
 public:
-    using DirtyCollector = std::function<std::vector<std::pair<std::string, std::string>>()>;
-    using DirtyClearer  = std::function<void(const std::string& key)>;
+    using Entries      = std::vector<std::pair<std::string, std::string>>;
+    // Append up to `max` oldest dirty entries to `out`, marking them clean;
+    // returns how many left the dirty queue (0 when it is empty).
+    using DirtyDrainer = std::function<size_t(size_t max, Entries& out)>;
+    // Current dirty-queue depth; bounds a pass so writers can't extend it.
+    using DirtyDepth   = std::function<size_t()>;
+    // Called per drained key once its batch is stored (ok) or has failed;
+    // ends the key's in-flight state.
+    using DirtySettler = std::function<void(const std::string& key, bool ok)>;
+
+    // Entries per batch_store call (bounds peak memory, 32-bit safe).
+    static constexpr size_t kBatchLimit = 5000;
 
     WriteBackWorker(StorageBackend* backend,
                     std::chrono::seconds interval,
-                    DirtyCollector collector,
-                    DirtyClearer clearer)
+                    DirtyDrainer drainer,
+                    DirtyDepth depth,
+                    DirtySettler settler)
         : backend_(backend)
         , interval_(interval)
-        , collector_(std::move(collector))
-        , clearer_(std::move(clearer))
+        , drainer_(std::move(drainer))
+        , depth_(std::move(depth))
+        , settler_(std::move(settler))
         , running_(false)
-        , flush_count_(0) {}
+        , flush_count_(0)
+        , flushed_entries_(0)
+        , failed_batches_(0) {}
 
     ~WriteBackWorker() {
         stop();
@@ -58,32 +86,69 @@ public:
         flush();
     }
 
-    /** Force an immediate flush (e.g. before shutdown). */
+    /**
+     * Force an immediate flush (e.g. before shutdown).  Persists what was
+     * dirty when the pass began; writes arriving meanwhile wait for the
+     * next pass.  On a failed batch its keys go back to the cache's dirty
+     * queue and the pass stops.
+     */
     void flush() {
-        auto dirty = collector_();
-        if (dirty.empty()) return;
-
-        // Flush in smaller batches to limit peak memory usage (32-bit safe)
-        const size_t BATCH_LIMIT = 5000;
-        size_t offset = 0;
-        while (offset < dirty.size()) {
-            size_t end = std::min(offset + BATCH_LIMIT, dirty.size());
-            std::vector<std::pair<std::string, std::string>> batch(dirty.begin() + offset, dirty.begin() + end);
-            if (backend_->batch_store(batch)) {
-                for (size_t i = 0; i < batch.size(); ++i) {
-                    clearer_(batch[i].first);
-                }
-            } else {
+        compat::LockGuard<compat::Mutex> pass(flush_mu_);
+        size_t budget = depth_();
+        if (budget == 0) return;
+
+        size_t stored = 0;
+        Entries batch;
+        batch.reserve(std::min(budget, kBatchLimit));
+        while (budget > 0) {
+            batch.clear();
+            open_batch();
+            size_t taken = drainer_(std::min(budget, kBatchLimit), batch);
+            if (taken == 0) {
+                close_batch(batch);
+                break;
+            }
+            budget -= std::min(budget, taken);
+
+            bool ok = close_batch(batch);
+            for (const auto& e : batch) settler_(e.first, ok);
+            if (!ok) {
+                failed_batches_.fetch_add(1);
                 std::cerr << "[WriteBack] ERROR: batch_store failed!\n";
-                return;
+                break;
             }
-            offset = end;
+            stored += batch.size();
         }
+        if (stored == 0) return;
         flush_count_.fetch_add(1);
-        std::cout << "[WriteBack] Flushed " << dirty.size()
+        flushed_entries_.fetch_add(stored);
+        std::cout << "[WriteBack] Flushed " << stored
                   << " dirty entries to disk.\n";
     }
 
+    /**
+     * Store an entry evicted while it may be in a batch (from the cache's
+     * eviction callback, under the key's segment lock; batch drains never
+     * wait for this lock).  Supersedes the batch's copy if that isn't
+     * written yet, else waits for the batch to land first.
+     */
+    bool store_now(const std::string& key, const std::string& value) {
+        compat::LockGuard<compat::Mutex> lock(store_mu_);
+        if (batch_open_) superseded_.insert(key);
+        return backend_->store(key, value);
+    }
+
+    /**
+     * Remove a key that may be in a batch (e.g. taken out of the cache to
+     * move it elsewhere), ordered against the batch like store_now(), so
+     * an in-flight copy can't be written back after the remove.
+     */
+    bool remove_now(const std::string& key) {
+        compat::LockGuard<compat::Mutex> lock(store_mu_);
+        if (batch_open_) superseded_.insert(key);
+        return backend_->remove(key);
+    }
+
     /** Trigger an out-of-cycle flush (e.g. dirty set size exceeded). */
     void notify_flush() {
         cv_.notify_one();
@@ -93,7 +158,38 @@ public:
         return flush_count_.load();
     }
 
+    /** Entries persisted across all passes. */
+    uint64_t flushed_entries() const {
+        return flushed_entries_.load();
+    }
+
+    uint64_t failed_batches() const {
+        return failed_batches_.load();
+    }
+
 private:
+    void open_batch() {
+        compat::LockGuard<compat::Mutex> lock(store_mu_);
+        superseded_.clear();
+        batch_open_ = true;
+    }
+
+    /**
+     * Store `batch` minus the keys store_now() superseded since
+     * open_batch(); those are gone from it on return.
+     */
+    bool close_batch(Entries& batch) {
+        compat::LockGuard<compat::Mutex> lock(store_mu_);
+        batch_open_ = false;
+        if (!superseded_.empty()) {
+            batch.erase(std::remove_if(batch.begin(), batch.end(),
+                                       [this](const Entries::value_type& e) { return superseded_.count(e.first) != 0; }),
+                        batch.end());
+            superseded_.clear();
+        }
+        return batch.empty() || backend_->batch_store(batch);
+    }
+
     void run_loop() {
         while (running_.load()) {
             compat::UniqueLock<compat::Mutex> lock(mu_);
@@ -109,14 +205,21 @@ private:
 
     StorageBackend* backend_;
     std::chrono::seconds interval_;
-    DirtyCollector collector_;
-    DirtyClearer clearer_;
+    DirtyDrainer drainer_;
+    DirtyDepth depth_;
+    DirtySettler settler_;
 
     compat::Atomic<bool> running_;
     compat::Thread thread_;
     compat::Mutex mu_;
     compat::CondVar cv_;
+    compat::Mutex flush_mu_;   // one pass at a time (timer vs. manual flush)
+    compat::Mutex store_mu_;   // orders store_now() with the batch in flight
+    bool batch_open_ = false;  // a batch is drained or draining, not yet stored
+    std::unordered_set<std::string> superseded_;
     compat::Atomic<uint64_t> flush_count_;
+    compat::Atomic<uint64_t> flushed_entries_;
+    compat::Atomic<uint64_t> failed_batches_;
 };
 
 }  // namespace persistence
@@ -1,16 +1,36 @@
 #pragma once
 // ────────────────────────────────────────────────────────────────
 // Raft Log: Persistent log entries and voting state for Raft.
-// File-backed with append-only writes.
+//
+// Entries live in append-only segment files (raft_log_<n>.dat, or the
+// legacy single raft_log.dat as segment 0) written through one
+// long-lived descriptor; a batch of entries is one write() and one
+// sync.  A new segment starts once the active one passes
+// segment_bytes.  Everything up to the snapshot base (raft_log.meta)
+// has been folded into a state-machine snapshot: compaction just moves
+// the base and deletes segments wholly below it, it never rewrites
+// the entries that remain.
 // ────────────────────────────────────────────────────────────────
 
+#include <algorithm>
 #include <cstdint>
+#include <cstdio>
 #include <cstring>
 #include <fstream>
 #include <string>
 #include <vector>
 
+#ifdef _WIN32
+#include <direct.h>
+#include <io.h>
+#else
+#include <dirent.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
 #include "../compat/threading.h"
+#include "../storage/wal.h"
 
 namespace dcs {
 namespace raft {
@@ -28,13 +48,25 @@ struct PersistentState {
 
 class RaftLog {
 public:
-    explicit RaftLog(const std::string& data_dir = "data/raft")
-        : data_dir_(data_dir) {
+    static constexpr size_t kDefaultSegmentBytes = 4 * 1024 * 1024;
+
+    /** `sync_writes`: fsync each appended batch before returning. */
+    explicit RaftLog(const std::string& data_dir = "data/raft", bool sync_writes = true,
+                     size_t segment_bytes = kDefaultSegmentBytes)
+        : data_dir_(data_dir), sync_writes_(sync_writes), segment_bytes_(segment_bytes) {
         EnsureDir(data_dir_);
         LoadState();
-        LoadEntries();
+        LoadMeta();
+        LoadSegments();
     }
 
+    ~RaftLog() {
+        if (fd_ >= 0) storage::wal_detail::CloseFd(fd_);
+    }
+
+    RaftLog(const RaftLog&) = delete;
+    RaftLog& operator=(const RaftLog&) = delete;
+
     // ─── Persistent State ──────────────────────────────────────
 
     uint64_t CurrentTerm() const {
@@ -69,95 +101,207 @@ public:
 
     uint64_t LastIndex() const {
         compat::LockGuard<compat::Mutex> lock(const_cast<compat::Mutex&>(mu_));
-        if (entries_.empty()) return 0;
-        return entries_.back().index;
+        return LastIndexLocked();
     }
 
     uint64_t LastTerm() const {
         compat::LockGuard<compat::Mutex> lock(const_cast<compat::Mutex&>(mu_));
-        if (entries_.empty()) return 0;
-        return entries_.back().term;
+        return entries_.empty() ? base_term_ : entries_.back().term;
+    }
+
+    /** Last entry covered by the snapshot (0 = none); the log starts after it. */
+    uint64_t SnapshotIndex() const {
+        compat::LockGuard<compat::Mutex> lock(const_cast<compat::Mutex&>(mu_));
+        return base_index_;
+    }
+
+    uint64_t SnapshotTerm() const {
+        compat::LockGuard<compat::Mutex> lock(const_cast<compat::Mutex&>(mu_));
+        return base_term_;
     }
 
     bool GetEntry(uint64_t index, LogEntry& out) const {
         compat::LockGuard<compat::Mutex> lock(const_cast<compat::Mutex&>(mu_));
-        // After compaction, entries may not start at index 1
-        for (const auto& e : entries_) {
-            if (e.index == index) { out = e; return true; }
-        }
-        return false;
+        const LogEntry* e = Find(index);
+        if (!e) return false;
+        out = *e;
+        return true;
     }
 
+    /** Term of `index`: exact for the snapshot base, 0 if unknown. */
     uint64_t TermAt(uint64_t index) const {
         compat::LockGuard<compat::Mutex> lock(const_cast<compat::Mutex&>(mu_));
-        if (index == 0) return 0;
-        for (const auto& e : entries_) {
-            if (e.index == index) return e.term;
-        }
-        return 0;
+        if (index != 0 && index == base_index_) return base_term_;
+        const LogEntry* e = Find(index);
+        return e ? e->term : 0;
     }
 
-    void Append(const LogEntry& entry) {
-        compat::LockGuard<compat::Mutex> lock(mu_);
-        entries_.push_back(entry);
-        AppendEntryToFile(entry);
+    bool Append(const LogEntry& entry) {
+        return AppendBatch(std::vector<LogEntry>(1, entry));
     }
 
-    void AppendBatch(const std::vector<LogEntry>& batch) {
+    /** Appends `batch` with a single write and (if enabled) a single sync. */
+    bool AppendBatch(const std::vector<LogEntry>& batch) {
+        if (batch.empty()) return true;
         compat::LockGuard<compat::Mutex> lock(mu_);
+        if (segments_.empty() || segments_.back().bytes >= segment_bytes_) RollSegment();
+        Segment& seg = segments_.back();
+        std::string buf;
         for (const auto& entry : batch) {
-            entries_.push_back(entry);
-            AppendEntryToFile(entry);
+            offsets_.push_back(seg.bytes + buf.size());
+            EncodeEntry(buf, entry);
         }
+        entries_.insert(entries_.end(), batch.begin(), batch.end());
+        seg.bytes += buf.size();
+        if (fd_ < 0) return false;
+        bool ok = storage::wal_detail::WriteAll(fd_, buf.data(), buf.size());
+        if (ok && sync_writes_) ok = storage::wal_detail::SyncFd(fd_);
+        return ok;
     }
 
-    // Truncate log from index onwards (inclusive)
+    // Truncate log from index onwards (inclusive).  Cuts the segment that
+    // holds `index` at that entry and deletes the segments after it.
     void TruncateFrom(uint64_t index) {
         compat::LockGuard<compat::Mutex> lock(mu_);
-        if (index == 0 || index > entries_.size()) return;
-        entries_.resize(index - 1);
-        RewriteLog();
+        if (index <= base_index_ || index > LastIndexLocked()) return;
+        size_t pos = static_cast<size_t>(index - base_index_ - 1);
+        size_t seg = SegmentOf(index);
+        while (segments_.size() > seg + 1) {
+            std::remove(SegmentPath(segments_.back().number).c_str());
+            segments_.pop_back();
+        }
+        segments_[seg].bytes = offsets_[pos];
+        if (fd_ >= 0) storage::wal_detail::CloseFd(fd_);
+        TruncateFile(SegmentPath(segments_[seg].number), offsets_[pos]);
+        fd_ = storage::wal_detail::OpenAppend(SegmentPath(segments_[seg].number));
+        entries_.resize(pos);
+        offsets_.resize(pos);
     }
 
-    // Compact log: remove entries before compact_index (keep from compact_index onward)
-    void CompactBefore(uint64_t compact_index) {
+    /**
+     * A snapshot now covers everything through `index` (which must be in
+     * the log or be its base): drop those entries from memory, record
+     * the new base, and delete segments that hold nothing newer.
+     */
+    void CompactTo(uint64_t index, uint64_t term) {
         compat::LockGuard<compat::Mutex> lock(mu_);
-        if (compact_index <= 1 || entries_.empty()) return;
-        // Find how many entries to remove (entries are 1-indexed)
-        size_t remove_count = 0;
-        for (size_t i = 0; i < entries_.size(); i++) {
-            if (entries_[i].index < compact_index) remove_count++;
-            else break;
+        if (index <= base_index_) return;
+        if (index > LastIndexLocked()) {
+            ResetLocked(index, term);
+            return;
         }
-        if (remove_count == 0) return;
-        entries_.erase(entries_.begin(), entries_.begin() + remove_count);
-        // Shrink to fit to actually free memory
-        entries_.shrink_to_fit();
-        RewriteLog();
+        size_t drop = static_cast<size_t>(index - base_index_);
+        entries_.erase(entries_.begin(), entries_.begin() + drop);
+        offsets_.erase(offsets_.begin(), offsets_.begin() + drop);
+        base_index_ = index;
+        base_term_  = term;
+        SaveMeta();
+        // Segment i is dead once segment i+1 starts at or before the new
+        // base; the active segment always stays
+        size_t dead = 0;
+        while (dead + 1 < segments_.size() && segments_[dead + 1].first_index <= base_index_ + 1) dead++;
+        for (size_t i = 0; i < dead; i++) std::remove(SegmentPath(segments_[i].number).c_str());
+        segments_.erase(segments_.begin(), segments_.begin() + dead);
+    }
+
+    /** Discard the whole log: an installed snapshot replaces it. */
+    void ResetTo(uint64_t index, uint64_t term) {
+        compat::LockGuard<compat::Mutex> lock(mu_);
+        ResetLocked(index, term);
     }
 
     // Get entries from start_index to end (for replication), capped at max_entries
     std::vector<LogEntry> GetRange(uint64_t start_index, size_t max_entries = 500) const {
         compat::LockGuard<compat::Mutex> lock(const_cast<compat::Mutex&>(mu_));
         std::vector<LogEntry> result;
-        size_t count = 0;
-        for (size_t i = 0; i < entries_.size() && count < max_entries; i++) {
-            if (entries_[i].index >= start_index) {
-                result.push_back(entries_[i]);
-                count++;
-            }
-        }
+        if (entries_.empty() || start_index > entries_.back().index) return result;
+        size_t first = start_index > entries_.front().index
+                     ? static_cast<size_t>(start_index - entries_.front().index) : 0;
+        size_t last = std::min(entries_.size(), first + max_entries);
+        result.assign(entries_.begin() + first, entries_.begin() + last);
         return result;
     }
 
     bool MatchesAt(uint64_t index, uint64_t term) const {
         if (index == 0) return true;  // empty log matches anything
-        uint64_t t = TermAt(index);
-        if (t == 0) return true;  // entry was compacted, assume match
-        return t == term;
+        compat::LockGuard<compat::Mutex> lock(const_cast<compat::Mutex&>(mu_));
+        // Entries below the base were committed before they were
+        // snapshotted, and committed entries are the same on every log
+        if (index < base_index_) return true;
+        if (index == base_index_) return term == base_term_;
+        const LogEntry* e = Find(index);
+        return e && e->term == term;
+    }
+
+    size_t SegmentCount() const {
+        compat::LockGuard<compat::Mutex> lock(const_cast<compat::Mutex&>(mu_));
+        return segments_.size();
     }
 
 private:
+    struct Segment {
+        uint64_t number;        // file name; 0 is the legacy raft_log.dat
+        uint64_t first_index;   // first entry written to it
+        uint64_t bytes;
+    };
+
+    uint64_t LastIndexLocked() const {
+        return entries_.empty() ? base_index_ : entries_.back().index;
+    }
+
+    // Indices are contiguous from base_index_ + 1, so lookups are an
+    // offset rather than a scan.
+    const LogEntry* Find(uint64_t index) const {
+        if (index <= base_index_) return nullptr;
+        size_t pos = static_cast<size_t>(index - base_index_ - 1);
+        if (pos >= entries_.size()) return nullptr;
+        return &entries_[pos];
+    }
+
+    size_t SegmentOf(uint64_t index) const {
+        size_t seg = segments_.size() - 1;
+        while (seg > 0 && segments_[seg].first_index > index) seg--;
+        return seg;
+    }
+
+    std::string SegmentPath(uint64_t number) const {
+        if (number == 0) return data_dir_ + "/raft_log.dat";
+        char name[48];
+        std::snprintf(name, sizeof(name), "/raft_log_%08llu.dat", static_cast<unsigned long long>(number));
+        return data_dir_ + name;
+    }
+
+    void RollSegment() {
+        if (fd_ >= 0) storage::wal_detail::CloseFd(fd_);
+        uint64_t number = segments_.empty() ? 1 : segments_.back().number + 1;
+        segments_.push_back({number, LastIndexLocked() + 1, 0});
+        std::remove(SegmentPath(number).c_str());
+        fd_ = storage::wal_detail::OpenAppend(SegmentPath(number));
+    }
+
+    void ResetLocked(uint64_t index, uint64_t term) {
+        if (fd_ >= 0) storage::wal_detail::CloseFd(fd_);
+        fd_ = -1;
+        uint64_t next_number = segments_.empty() ? 1 : segments_.back().number + 1;
+        for (const auto& seg : segments_) std::remove(SegmentPath(seg.number).c_str());
+        segments_.clear();
+        entries_.clear();
+        offsets_.clear();
+        base_index_ = index;
+        base_term_  = term;
+        SaveMeta();
+        segments_.push_back({next_number, index + 1, 0});
+        fd_ = storage::wal_detail::OpenAppend(SegmentPath(next_number));
+    }
+
+    static void EncodeEntry(std::string& out, const LogEntry& entry) {
+        uint32_t cmd_len = static_cast<uint32_t>(entry.command.size());
+        out.append(reinterpret_cast<const char*>(&entry.term), 8);
+        out.append(reinterpret_cast<const char*>(&entry.index), 8);
+        out.append(reinterpret_cast<const char*>(&cmd_len), 4);
+        out.append(entry.command);
+    }
+
     void LoadState() {
         std::string path = data_dir_ + "/raft_state.dat";
         std::ifstream f(path, std::ios::binary);
@@ -172,46 +316,125 @@ private:
         f.flush();
     }
 
-    void LoadEntries() {
-        std::string path = data_dir_ + "/raft_log.dat";
-        std::ifstream f(path, std::ios::binary);
-        if (!f.is_open()) return;
-        while (f.good() && !f.eof()) {
-            LogEntry entry;
-            f.read(reinterpret_cast<char*>(&entry.term), 8);
-            f.read(reinterpret_cast<char*>(&entry.index), 8);
-            uint32_t cmd_len = 0;
-            f.read(reinterpret_cast<char*>(&cmd_len), 4);
-            if (!f.good() || cmd_len > 64 * 1024 * 1024) break;
-            entry.command.resize(cmd_len);
-            f.read(&entry.command[0], cmd_len);
-            if (f.good()) entries_.push_back(entry);
+    void LoadMeta() {
+        std::ifstream f(data_dir_ + "/raft_log.meta", std::ios::binary);
+        uint64_t meta[2];
+        if (f.read(reinterpret_cast<char*>(meta), sizeof(meta))) {
+            base_index_ = meta[0];
+            base_term_  = meta[1];
         }
     }
 
-    void AppendEntryToFile(const LogEntry& entry) {
-        std::string path = data_dir_ + "/raft_log.dat";
-        std::ofstream f(path, std::ios::binary | std::ios::app);
-        f.write(reinterpret_cast<const char*>(&entry.term), 8);
-        f.write(reinterpret_cast<const char*>(&entry.index), 8);
-        uint32_t cmd_len = static_cast<uint32_t>(entry.command.size());
-        f.write(reinterpret_cast<const char*>(&cmd_len), 4);
-        f.write(entry.command.data(), cmd_len);
-        f.flush();
+    // Written to a temp file, synced and renamed, so a crash leaves
+    // either the old base or the new one.
+    void SaveMeta() {
+        uint64_t meta[2] = {base_index_, base_term_};
+        std::string path = data_dir_ + "/raft_log.meta", tmp = path + ".tmp";
+        std::remove(tmp.c_str());
+        int fd = storage::wal_detail::OpenAppend(tmp);
+        if (fd < 0) return;
+        bool ok = storage::wal_detail::WriteAll(fd, reinterpret_cast<const char*>(meta), sizeof(meta)) &&
+                  storage::wal_detail::SyncFd(fd);
+        storage::wal_detail::CloseFd(fd);
+        if (!ok) return;
+#ifdef _WIN32
+        std::remove(path.c_str());
+#endif
+        std::rename(tmp.c_str(), path.c_str());
     }
 
-    void RewriteLog() {
-        // Rewrite entire log file after truncation
-        std::string path = data_dir_ + "/raft_log.dat";
-        std::ofstream f(path, std::ios::binary | std::ios::trunc);
-        for (const auto& entry : entries_) {
-            f.write(reinterpret_cast<const char*>(&entry.term), 8);
-            f.write(reinterpret_cast<const char*>(&entry.index), 8);
-            uint32_t cmd_len = static_cast<uint32_t>(entry.command.size());
-            f.write(reinterpret_cast<const char*>(&cmd_len), 4);
-            f.write(entry.command.data(), cmd_len);
+    std::vector<uint64_t> ListSegments() const {
+        std::vector<uint64_t> numbers;
+        auto parse = [&](const std::string& name) {
+            unsigned long long n = 0;
+            char tail = 0;
+            if (name == "raft_log.dat") numbers.push_back(0);
+            else if (std::sscanf(name.c_str(), "raft_log_%llu.da%c", &n, &tail) == 2 && tail == 't') numbers.push_back(n);
+        };
+#ifdef _WIN32
+        struct _finddata_t info;
+        intptr_t handle = _findfirst((data_dir_ + "/raft_log*.dat").c_str(), &info);
+        if (handle != -1) {
+            do { parse(info.name); } while (_findnext(handle, &info) == 0);
+            _findclose(handle);
         }
-        f.flush();
+#else
+        DIR* d = opendir(data_dir_.c_str());
+        if (d) {
+            while (struct dirent* entry = readdir(d)) parse(entry->d_name);
+            closedir(d);
+        }
+#endif
+        std::sort(numbers.begin(), numbers.end());
+        return numbers;
+    }
+
+    // One read per segment, then parse from memory: restarts don't pay a
+    // stream read per field.  Entries at or below the base are skipped.
+    // The first record that is torn (crash during an append) or out of
+    // sequence ends the log: its segment is cut there and any later
+    // segments are removed, so appends always follow a whole entry.
+    void LoadSegments() {
+        const size_t kHeader = 20;   // term | index | u32 command length
+        bool ended = false;
+        for (uint64_t number : ListSegments()) {
+            std::string path = SegmentPath(number);
+            if (ended) {
+                std::remove(path.c_str());
+                continue;
+            }
+            std::string data;
+            {
+                std::ifstream f(path, std::ios::binary | std::ios::ate);
+                std::streamoff size = f.is_open() ? static_cast<std::streamoff>(f.tellg()) : 0;
+                if (size > 0) {
+                    data.resize(static_cast<size_t>(size));
+                    f.seekg(0);
+                    f.read(&data[0], size);
+                    data.resize(static_cast<size_t>(f.gcount()));
+                }
+            }
+            Segment seg{number, LastIndexLocked() + 1, 0};
+            size_t pos = 0;
+            bool first = true;
+            while (data.size() - pos >= kHeader) {
+                LogEntry entry;
+                uint32_t cmd_len;
+                std::memcpy(&entry.term, data.data() + pos, 8);
+                std::memcpy(&entry.index, data.data() + pos + 8, 8);
+                std::memcpy(&cmd_len, data.data() + pos + 16, 4);
+                if (cmd_len > 64 * 1024 * 1024 || data.size() - pos - kHeader < cmd_len) break;
+                if (entry.index > base_index_ && entry.index != LastIndexLocked() + 1) break;
+                if (first) seg.first_index = entry.index;
+                first = false;
+                if (entry.index > base_index_) {
+                    entry.command.assign(data.data() + pos + kHeader, cmd_len);
+                    entries_.push_back(std::move(entry));
+                    offsets_.push_back(pos);
+                }
+                pos += kHeader + cmd_len;
+            }
+            seg.bytes = pos;
+            if (pos < data.size()) {
+                TruncateFile(path, pos);
+                ended = true;
+            }
+            segments_.push_back(seg);
+        }
+        if (segments_.empty()) segments_.push_back({1, LastIndexLocked() + 1, 0});
+        fd_ = storage::wal_detail::OpenAppend(SegmentPath(segments_.back().number));
+    }
+
+    static void TruncateFile(const std::string& path, uint64_t size) {
+#ifdef _WIN32
+        int fd = _open(path.c_str(), _O_RDWR | _O_BINARY);
+        if (fd < 0) return;
+        _chsize_s(fd, static_cast<__int64>(size));
+        _close(fd);
+#else
+        int rc = ::truncate(path.c_str(), static_cast<off_t>(size));
+        (void)rc;   // best effort: a failed cut is retried on the next load
+#endif
     }
 
     static void EnsureDir(const std::string& path) {
@@ -222,10 +445,17 @@ private:
 #endif
     }
 
-    std::string          data_dir_;
-    PersistentState      state_;
-    std::vector<LogEntry> entries_;
-    compat::Mutex        mu_;
+    std::string           data_dir_;
+    bool                  sync_writes_;
+    size_t                segment_bytes_;
+    int                   fd_ = -1;          // append handle on segments_.back()
+    PersistentState       state_;
+    uint64_t              base_index_ = 0;   // snapshot base
+    uint64_t              base_term_  = 0;
+    std::vector<LogEntry> entries_;          // base_index_ + 1 onward
+    std::vector<uint64_t> offsets_;          // entries_[i]'s offset in its segment
+    std::vector<Segment>  segments_;
+    compat::Mutex         mu_;
 };
 
 }  // namespace raft
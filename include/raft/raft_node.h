@@ -2,15 +2,41 @@
 // ────────────────────────────────────────────────────────────────
 // Raft Node: Full Raft consensus implementation with leader
 // election, log replication, and state machine application.
+//
+// Replication is batched and pipelined: proposals queue up and the
+// leader's replicator appends each batch to its log with one write and
+// one sync, then streams AppendEntries to every follower without
+// waiting for earlier ones to be acknowledged (up to kMaxInflight per
+// peer).  Heartbeats are just empty AppendEntries on the same path.
+//
+// Snapshots: once snapshot_threshold entries have been applied since
+// the last one, a background thread asks the state machine to write a
+// snapshot file, and the log is then compacted up to it.  A follower
+// that needs entries the leader has already compacted away is sent the
+// snapshot instead, in InstallSnapshot chunks.
+//
+// Reads: ReadBarrier() makes a local read linearizable on any node.  The
+// leader takes its commit index as the read index and confirms it is
+// still leader with one round of heartbeats (or, with lease_ms set,
+// skips the round while a quorum acknowledged it recently); a follower
+// asks the leader for that index.  Either then waits until it has
+// applied up to it, so reads can be spread over every replica.  This is
+// a library API for embedders whose state machine lives on each node;
+// the demo server keeps one shared CacheManager and does not route its
+// reads through Raft.
 // ────────────────────────────────────────────────────────────────
 
 #include <algorithm>
 #include <chrono>
 #include <cstdint>
+#include <cstdio>
 #include <cstdlib>
+#include <fstream>
 #include <functional>
 #include <random>
+#include <stdexcept>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 #include "../compat/threading.h"
@@ -59,13 +85,96 @@ struct AppendEntriesReply {
     uint64_t match_index;
 };
 
+struct InstallSnapshotArgs {
+    uint64_t    term;
+    int         leader_id;
+    uint64_t    last_included_index;
+    uint64_t    last_included_term;
+    uint64_t    offset;       // byte offset of `data` in the snapshot file
+    std::string data;
+    bool        done;         // last chunk
+};
+
+struct InstallSnapshotReply {
+    uint64_t term;
+    bool     installed;       // follower's state now covers last_included_index
+    uint64_t next_offset;     // otherwise: the chunk offset it expects next
+};
+
+struct ReadIndexArgs {
+    int requester_id;
+};
+
+struct ReadIndexReply {
+    uint64_t term;
+    bool     success;         // false: not leader, or leadership not confirmed
+    uint64_t read_index;
+};
+
 // ──── Transport Interface ──────────────────────────────────────
 
 class RaftTransport {
 public:
+    /** `delivered` is false if no reply came back (peer down, timeout). */
+    using AppendEntriesCallback   = std::function<void(bool delivered, const AppendEntriesReply&)>;
+    using InstallSnapshotCallback = std::function<void(bool delivered, const InstallSnapshotReply&)>;
+
     virtual ~RaftTransport() = default;
     virtual RequestVoteReply    SendRequestVote(int peer_id, const RequestVoteArgs& args)    = 0;
     virtual AppendEntriesReply SendAppendEntries(int peer_id, const AppendEntriesArgs& args) = 0;
+
+    /**
+     * Fire-and-continue AppendEntries for pipelining.  Callbacks for one
+     * peer must run in send order.  The default is a blocking call, which
+     * is what an in-process transport wants anyway.
+     */
+    virtual void SendAppendEntriesAsync(int peer_id, const AppendEntriesArgs& args,
+                                        AppendEntriesCallback done) {
+        AppendEntriesReply reply{args.term, false, 0};
+        bool delivered = true;
+        try {
+            reply = SendAppendEntries(peer_id, args);
+        } catch (...) {
+            delivered = false;
+        }
+        done(delivered, reply);
+    }
+
+    /** Transports that predate snapshots can't ship one: the peer is unreachable. */
+    virtual InstallSnapshotReply SendInstallSnapshot(int /*peer_id*/, const InstallSnapshotArgs& /*args*/) {
+        throw std::runtime_error("raft transport: InstallSnapshot not supported");
+    }
+
+    virtual void SendInstallSnapshotAsync(int peer_id, const InstallSnapshotArgs& args,
+                                          InstallSnapshotCallback done) {
+        InstallSnapshotReply reply{args.term, false, 0};
+        bool delivered = true;
+        try {
+            reply = SendInstallSnapshot(peer_id, args);
+        } catch (...) {
+            delivered = false;
+        }
+        done(delivered, reply);
+    }
+
+    virtual ReadIndexReply SendReadIndex(int /*peer_id*/, const ReadIndexArgs& /*args*/) {
+        throw std::runtime_error("raft transport: ReadIndex not supported");
+    }
+};
+
+struct RaftOptions {
+    uint64_t snapshot_threshold   = 10000;       // applied entries between snapshots
+    size_t   snapshot_chunk_bytes = 64 * 1024;   // InstallSnapshot payload per RPC
+    size_t   log_segment_bytes    = RaftLog::kDefaultSegmentBytes;
+    bool     sync_log             = true;
+    /**
+     * > 0: the leader serves reads without a heartbeat round for this
+     * long after a quorum acknowledged it, and followers refuse votes for
+     * the minimum election timeout after hearing from a leader, so no new
+     * leader can appear within a lease.  Must stay below that timeout
+     * (150ms) by the clock drift it has to tolerate.
+     */
+    int      lease_ms             = 0;
 };
 
 // ──── Raft Node ────────────────────────────────────────────────
@@ -73,16 +182,25 @@ public:
 class RaftNode {
 public:
     using ApplyCallback = std::function<void(uint64_t index, const std::string& command)>;
+    /** Write the state machine to / replace it from the file at `path`. */
+    using SnapshotCallback = std::function<bool(const std::string& path)>;
 
-    RaftNode(int node_id, int cluster_size, const std::string& data_dir = "data/raft")
+    static constexpr int      kHeartbeatMs     = 50;
+    static constexpr size_t   kMaxBatchEntries = 200;   // entries per AppendEntries
+    static constexpr uint32_t kMaxInflight     = 8;     // unacknowledged AppendEntries per peer
+    static constexpr int      kMinElectionMs   = 150;
+    static constexpr int      kReadTimeoutMs   = 200;   // bounds each wait in ReadBarrier()
+
+    RaftNode(int node_id, int cluster_size, const std::string& data_dir = "data/raft",
+             const RaftOptions& opts = RaftOptions())
         : id_(node_id), cluster_size_(cluster_size),
           role_(RaftRole::Follower), commit_index_(0), last_applied_(0),
-          running_(false), log_(data_dir),
+          running_(false), opts_(opts), data_dir_(data_dir),
+          log_(data_dir, opts.sync_log, opts.log_segment_bytes),
           election_timeout_ms_(150 + (node_id * 50) % 150),
           rng_(static_cast<unsigned>(
               std::chrono::steady_clock::now().time_since_epoch().count())) {
-        next_index_.resize(cluster_size_, 1);
-        match_index_.resize(cluster_size_, 0);
+        peers_.resize(cluster_size_);
     }
 
     ~RaftNode() { Stop(); }
@@ -90,17 +208,42 @@ public:
     void SetTransport(RaftTransport* transport) { transport_ = transport; }
     void SetApplyCallback(ApplyCallback cb) { apply_cb_ = std::move(cb); }
 
+    /**
+     * `save` runs on a background thread while entries keep being
+     * applied, so the file may also reflect some entries after the
+     * snapshot index.  Those are replayed on top after a restore, which
+     * is harmless as long as commands are idempotent overwrites (SET,
+     * DEL).  Without `save` snapshots are empty and only truncate the log.
+     */
+    void SetSnapshotCallbacks(SnapshotCallback save, SnapshotCallback restore) {
+        save_cb_    = std::move(save);
+        restore_cb_ = std::move(restore);
+    }
+
     void Start() {
+        uint64_t base = log_.SnapshotIndex();
+        if (base > 0) {
+            if (restore_cb_) restore_cb_(SnapshotPath());
+            commit_index_ = last_applied_ = base;
+        }
         running_ = true;
         ResetElectionTimer();
-        ticker_thread_ = compat::Thread(&RaftNode::TickerLoop, this);
-        applier_thread_ = compat::Thread(&RaftNode::ApplierLoop, this);
+        ticker_thread_     = compat::Thread(&RaftNode::TickerLoop, this);
+        applier_thread_    = compat::Thread(&RaftNode::ApplierLoop, this);
+        replicator_thread_ = compat::Thread(&RaftNode::ReplicatorLoop, this);
     }
 
     void Stop() {
-        running_ = false;
+        {
+            compat::LockGuard<compat::Mutex> lock(mu_);
+            running_ = false;
+            replicate_cv_.notify_all();
+            read_cv_.notify_all();
+        }
         if (ticker_thread_.joinable()) ticker_thread_.join();
         if (applier_thread_.joinable()) applier_thread_.join();
+        if (replicator_thread_.joinable()) replicator_thread_.join();
+        if (snapshot_thread_.joinable()) snapshot_thread_.join();
     }
 
     // Force a leadership election (for demo purposes)
@@ -110,17 +253,14 @@ public:
 
     // ─── Client Interface ──────────────────────────────────────
 
-    // Propose a new command (only leader can accept)
+    // Propose a new command (only leader can accept).  It joins the batch
+    // the replicator appends and ships next, without waiting for a tick.
+    // The empty command is reserved for the leader's no-op.
     bool Propose(const std::string& command) {
         compat::LockGuard<compat::Mutex> lock(mu_);
-        if (role_ != RaftRole::Leader) return false;
-
-        LogEntry entry;
-        entry.term    = log_.CurrentTerm();
-        entry.index   = log_.LastIndex() + 1;
-        entry.command = command;
-        log_.Append(entry);
-        // Will be replicated on next heartbeat
+        if (role_ != RaftRole::Leader || command.empty()) return false;
+        pending_.push_back(command);
+        replicate_cv_.notify_one();
         return true;
     }
 
@@ -129,6 +269,36 @@ public:
         return role_ == RaftRole::Leader;
     }
 
+    /**
+     * Linearizable read barrier.  Returns true once this node has applied
+     * every entry committed before the call, so a read of the local
+     * state machine sees all writes acknowledged before it started.
+     * False if leadership couldn't be confirmed (no leader, partitioned,
+     * mid-election) within `timeout_ms` per step; the caller may retry or
+     * go to the leader.
+     */
+    bool ReadBarrier(int timeout_ms = kReadTimeoutMs) {
+        uint64_t index = 0;
+        int leader;
+        {
+            compat::UniqueLock<compat::Mutex> lock(mu_);
+            if (role_ == RaftRole::Leader) {
+                return ReadIndexLocked(lock, index, timeout_ms) && WaitAppliedLocked(lock, index, timeout_ms);
+            }
+            leader = leader_id_;
+            if (leader < 0 || leader == id_ || !transport_) return false;
+        }
+        ReadIndexReply reply{};
+        try {
+            reply = transport_->SendReadIndex(leader, ReadIndexArgs{id_});
+        } catch (...) {
+            return false;
+        }
+        if (!reply.success) return false;
+        compat::UniqueLock<compat::Mutex> lock(mu_);
+        return WaitAppliedLocked(lock, reply.read_index, timeout_ms);
+    }
+
     // ─── RPC Handlers ──────────────────────────────────────────
 
     RequestVoteReply HandleRequestVote(const RequestVoteArgs& args) {
@@ -139,6 +309,13 @@ public:
 
         if (args.term < log_.CurrentTerm()) return reply;
 
+        // Leases rely on no vote going out while a leader is heard from
+        if (opts_.lease_ms > 0 && role_ == RaftRole::Follower && leader_id_ >= 0 &&
+            std::chrono::steady_clock::now() - last_leader_contact_ <
+                std::chrono::milliseconds(kMinElectionMs)) {
+            return reply;
+        }
+
         if (args.term > log_.CurrentTerm()) {
             BecomeFollower(args.term);
         }
@@ -172,10 +349,14 @@ public:
         }
         ResetElectionTimer();
         leader_id_ = args.leader_id;
+        last_leader_contact_ = last_heartbeat_;
 
-        // Check log consistency
+        // Check log consistency.  On a mismatch match_index carries our
+        // last index, so the leader can skip straight back to it.
         if (args.prev_log_index > 0 &&
-            !log_.MatchesAt(args.prev_log_index, args.prev_log_term)) {
+            (args.prev_log_index > log_.LastIndex() ||
+             !log_.MatchesAt(args.prev_log_index, args.prev_log_term))) {
+            reply.match_index = log_.LastIndex();
             return reply;
         }
 
@@ -189,22 +370,94 @@ public:
                     break;
                 }
             }
-            // Append entries that are not yet in the log
+            // Append entries that are not yet in the log, as one batch
+            uint64_t last = log_.LastIndex();
+            std::vector<LogEntry> fresh;
             for (const auto& entry : args.entries) {
-                if (entry.index > log_.LastIndex()) {
-                    log_.Append(entry);
-                }
+                if (entry.index > last) fresh.push_back(entry);
             }
+            log_.AppendBatch(fresh);
         }
 
-        // Update commit index
-        if (args.leader_commit > commit_index_) {
-            commit_index_ = std::min(args.leader_commit, log_.LastIndex());
-        }
+        // Only what this request proved to match counts: anything past it
+        // may be a stale suffix from an old term
+        uint64_t last_new = args.entries.empty() ? args.prev_log_index : args.entries.back().index;
+        uint64_t commit = std::min(args.leader_commit, last_new);
+        if (commit > commit_index_) commit_index_ = commit;
 
         reply.success = true;
-        reply.match_index = log_.LastIndex();
+        reply.match_index = last_new;
+        reply.term = log_.CurrentTerm();
+        return reply;
+    }
+
+    // Chunks arrive in order into snapshot.recv; the last one installs it.
+    // A chunk at an unexpected offset is answered with the offset we want.
+    InstallSnapshotReply HandleInstallSnapshot(const InstallSnapshotArgs& args) {
+        compat::LockGuard<compat::Mutex> lock(mu_);
+        InstallSnapshotReply reply{log_.CurrentTerm(), false, 0};
+        if (args.term < log_.CurrentTerm()) return reply;
+
+        BecomeFollower(args.term);
+        ResetElectionTimer();
+        leader_id_ = args.leader_id;
+        last_leader_contact_ = last_heartbeat_;
         reply.term = log_.CurrentTerm();
+
+        uint64_t index = args.last_included_index;
+        if (index <= last_applied_) {
+            reply.installed = true;
+            return reply;
+        }
+        std::string recv_path = data_dir_ + "/snapshot.recv";
+        if (args.offset == 0) {
+            std::remove(recv_path.c_str());
+            recv_index_ = index;
+            recv_bytes_ = 0;
+        }
+        if (recv_index_ != index || args.offset != recv_bytes_) {
+            reply.next_offset = recv_index_ == index ? recv_bytes_ : 0;
+            return reply;
+        }
+        {
+            std::ofstream f(recv_path, std::ios::binary | std::ios::app);
+            f.write(args.data.data(), static_cast<std::streamsize>(args.data.size()));
+            if (!f.flush()) {
+                reply.next_offset = recv_bytes_;   // retry this chunk
+                return reply;
+            }
+        }
+        recv_bytes_ += args.data.size();
+        reply.next_offset = recv_bytes_;
+        if (!args.done) return reply;
+
+        recv_index_ = 0;
+        reply.next_offset = 0;
+#ifdef _WIN32
+        std::remove(SnapshotPath().c_str());
+#endif
+        if (std::rename(recv_path.c_str(), SnapshotPath().c_str()) != 0) return reply;
+        if (restore_cb_ && !restore_cb_(SnapshotPath())) return reply;
+        // Keep a suffix that agrees with the snapshot; otherwise the log
+        // is wrong or too short to be of use and is replaced wholesale
+        if (log_.MatchesAt(index, args.last_included_term)) {
+            log_.CompactTo(index, args.last_included_term);
+        } else {
+            log_.ResetTo(index, args.last_included_term);
+        }
+        if (index > commit_index_) commit_index_ = index;
+        last_applied_ = index;
+        read_cv_.notify_all();
+        reply.installed = true;
+        return reply;
+    }
+
+    // A follower's ReadBarrier(): confirm leadership, hand back the index.
+    ReadIndexReply HandleReadIndex(const ReadIndexArgs& /*args*/) {
+        compat::UniqueLock<compat::Mutex> lock(mu_);
+        ReadIndexReply reply{log_.CurrentTerm(), false, 0};
+        if (role_ != RaftRole::Leader) return reply;
+        reply.success = ReadIndexLocked(lock, reply.read_index, kReadTimeoutMs);
         return reply;
     }
 
@@ -219,58 +472,379 @@ public:
         uint64_t    log_size;
         int         leader_id;
         int         votes_received;
+        uint64_t    snapshot_index;
     };
 
     NodeState GetState() const {
         compat::LockGuard<compat::Mutex> lock(const_cast<compat::Mutex&>(mu_));
         return {id_, role_, log_.CurrentTerm(), commit_index_,
-                last_applied_, log_.Size(), leader_id_, votes_received_};
+                last_applied_, log_.Size(), leader_id_, votes_received_,
+                log_.SnapshotIndex()};
     }
 
 private:
+    struct PeerProgress {
+        uint64_t next_index  = 1;       // next entry to send (advanced optimistically)
+        uint64_t match_index = 0;       // highest entry known replicated
+        uint32_t inflight    = 0;       // AppendEntries awaiting a reply
+        bool     probing     = true;    // one request at a time until next_index is confirmed
+        uint64_t epoch       = 0;       // bumped on each rewind; older rejections are stale
+        uint64_t snapshot_index  = 0;   // snapshot being streamed (0 = none)
+        uint64_t snapshot_offset = 0;   // next chunk of it to send
+        std::chrono::steady_clock::time_point last_sent;
+        std::chrono::steady_clock::time_point retry_after;   // backoff after an undelivered RPC
+        std::chrono::steady_clock::time_point last_ack;      // send time of the newest RPC it answered
+    };
+
+    struct Outgoing {
+        int                 peer;
+        uint64_t            leader_gen;
+        uint64_t            epoch;
+        bool                is_snapshot;
+        AppendEntriesArgs   args;
+        InstallSnapshotArgs snapshot;
+        std::chrono::steady_clock::time_point sent;
+    };
+
+    // Elections only; the leader's heartbeats come from ReplicatorLoop.
     void TickerLoop() {
         while (running_) {
-            compat::this_thread::sleep_for(std::chrono::milliseconds(50));
-            int action = 0; // 0=none, 1=heartbeat, 2=election
+            compat::this_thread::sleep_for(std::chrono::milliseconds(kHeartbeatMs));
+            bool election = false;
             {
                 compat::LockGuard<compat::Mutex> lock(mu_);
-                auto now = std::chrono::steady_clock::now();
-                if (role_ == RaftRole::Leader) {
-                    action = 1;
-                } else {
+                if (role_ != RaftRole::Leader) {
                     auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
-                        now - last_heartbeat_).count();
-                    if (elapsed >= election_timeout_ms_) {
-                        action = 2;
-                    }
+                        std::chrono::steady_clock::now() - last_heartbeat_).count();
+                    election = elapsed >= election_timeout_ms_;
                 }
             }
             // RPC calls made WITHOUT holding mu_ to avoid deadlocks
-            if (action == 1) SendHeartbeats();
-            else if (action == 2) StartElection();
+            if (election) StartElection();
+        }
+    }
+
+    // Leader side of replication.  Wakes on new proposals, on replies that
+    // free a pipeline slot, and at least twice per heartbeat interval.
+    void ReplicatorLoop() {
+        while (running_) {
+            std::vector<Outgoing> sends;
+            {
+                compat::UniqueLock<compat::Mutex> lock(mu_);
+                replicate_cv_.wait_for(lock, std::chrono::milliseconds(kHeartbeatMs / 2),
+                                       [this] { return !running_ || HasReplicationWork(); });
+                if (!running_ || role_ != RaftRole::Leader) continue;
+                AppendPending();
+                if (transport_) CollectSends(sends);
+            }
+            // RPCs made without holding mu_; replies may arrive inline
+            for (auto& out : sends) {
+                int peer = out.peer;
+                uint64_t gen = out.leader_gen, epoch = out.epoch;
+                auto sent = out.sent;
+                if (out.is_snapshot) {
+                    uint64_t index = out.snapshot.last_included_index;
+                    transport_->SendInstallSnapshotAsync(peer, out.snapshot,
+                        [this, peer, gen, index, sent](bool delivered, const InstallSnapshotReply& reply) {
+                            OnSnapshotReply(peer, gen, index, sent, delivered, reply);
+                        });
+                    continue;
+                }
+                uint64_t prev = out.args.prev_log_index;
+                transport_->SendAppendEntriesAsync(peer, out.args,
+                    [this, peer, gen, epoch, prev, sent](bool delivered, const AppendEntriesReply& reply) {
+                        OnAppendReply(peer, gen, epoch, prev, sent, delivered, reply);
+                    });
+            }
         }
     }
 
+    bool HasReplicationWork() const {
+        if (role_ != RaftRole::Leader) return false;
+        if (!pending_.empty()) return true;
+        if (!transport_) return false;
+        uint64_t last = log_.LastIndex();
+        auto now = std::chrono::steady_clock::now();
+        for (int peer = 0; peer < cluster_size_; peer++) {
+            if (peer == id_) continue;
+            const PeerProgress& pr = peers_[peer];
+            if (now < pr.retry_after || pr.inflight >= InflightLimit(pr)) continue;
+            if (pr.next_index <= last || now - pr.last_sent >= std::chrono::milliseconds(kHeartbeatMs)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // One request at a time while probing or streaming a snapshot.
+    uint32_t InflightLimit(const PeerProgress& pr) const {
+        return pr.probing || pr.next_index <= log_.SnapshotIndex() ? 1 : kMaxInflight;
+    }
+
+    // Everything proposed since the last pass becomes one log append.
+    void AppendPending() {
+        if (pending_.empty()) return;
+        std::vector<LogEntry> batch;
+        batch.reserve(pending_.size());
+        uint64_t term = log_.CurrentTerm(), index = log_.LastIndex();
+        for (auto& command : pending_) batch.push_back({term, ++index, std::move(command)});
+        pending_.clear();
+        log_.AppendBatch(batch);
+        TryAdvanceCommit();   // a single-node cluster commits on its own
+    }
+
+    // Fill each peer's pipeline: new entries while slots are free, or an
+    // empty AppendEntries when its heartbeat is due.  A peer that needs
+    // entries already compacted away gets the next snapshot chunk instead.
+    void CollectSends(std::vector<Outgoing>& sends) {
+        auto now = std::chrono::steady_clock::now();
+        uint64_t last = log_.LastIndex();
+        for (int peer = 0; peer < cluster_size_; peer++) {
+            if (peer == id_) continue;
+            PeerProgress& pr = peers_[peer];
+            if (now < pr.retry_after) continue;
+            uint32_t limit = InflightLimit(pr);
+            if (pr.next_index <= log_.SnapshotIndex()) {
+                if (pr.inflight < limit) {
+                    Outgoing out{peer, leader_gen_, pr.epoch, true, AppendEntriesArgs(), InstallSnapshotArgs(), now};
+                    if (ReadSnapshotChunk(pr, out.snapshot)) {
+                        pr.inflight++;
+                        pr.last_sent = now;
+                        sends.push_back(std::move(out));
+                    } else {
+                        pr.retry_after = now + std::chrono::milliseconds(kHeartbeatMs);
+                    }
+                }
+                continue;
+            }
+            bool heartbeat_due = now - pr.last_sent >= std::chrono::milliseconds(kHeartbeatMs);
+            while (pr.inflight < limit && (pr.next_index <= last || heartbeat_due)) {
+                Outgoing out{peer, leader_gen_, pr.epoch, false, AppendEntriesArgs(), InstallSnapshotArgs(), now};
+                AppendEntriesArgs& args = out.args;
+                args.term           = log_.CurrentTerm();
+                args.leader_id      = id_;
+                args.leader_commit  = commit_index_;
+                args.prev_log_index = pr.next_index - 1;
+                args.prev_log_term  = log_.TermAt(args.prev_log_index);
+                if (pr.next_index <= last) args.entries = log_.GetRange(pr.next_index, kMaxBatchEntries);
+                if (!args.entries.empty()) pr.next_index = args.entries.back().index + 1;
+                pr.inflight++;
+                pr.last_sent = now;
+                heartbeat_due = false;
+                sends.push_back(std::move(out));
+            }
+        }
+    }
+
+    // Next chunk of the current snapshot for `pr`, restarting from the
+    // top if the snapshot was replaced since the last chunk.  mu_ held,
+    // which also keeps the file from being swapped mid-read.
+    bool ReadSnapshotChunk(PeerProgress& pr, InstallSnapshotArgs& args) {
+        uint64_t index = log_.SnapshotIndex();
+        if (pr.snapshot_index != index) {
+            pr.snapshot_index  = index;
+            pr.snapshot_offset = 0;
+        }
+        std::ifstream f(SnapshotPath(), std::ios::binary | std::ios::ate);
+        uint64_t size = f.is_open() ? static_cast<uint64_t>(f.tellg()) : 0;
+        if (pr.snapshot_offset > size) pr.snapshot_offset = 0;
+        uint64_t len = std::min<uint64_t>(opts_.snapshot_chunk_bytes, size - pr.snapshot_offset);
+        args.term                = log_.CurrentTerm();
+        args.leader_id           = id_;
+        args.last_included_index = index;
+        args.last_included_term  = log_.SnapshotTerm();
+        args.offset              = pr.snapshot_offset;
+        args.done                = pr.snapshot_offset + len == size;
+        args.data.resize(static_cast<size_t>(len));
+        if (len > 0) {
+            f.seekg(static_cast<std::streamoff>(pr.snapshot_offset));
+            if (!f.read(&args.data[0], static_cast<std::streamsize>(len))) return false;
+        }
+        return true;
+    }
+
+    void OnSnapshotReply(int peer, uint64_t gen, uint64_t index,
+                         std::chrono::steady_clock::time_point sent, bool delivered,
+                         const InstallSnapshotReply& reply) {
+        compat::LockGuard<compat::Mutex> lock(mu_);
+        if (role_ != RaftRole::Leader || gen != leader_gen_) return;
+        PeerProgress& pr = peers_[peer];
+        if (pr.inflight > 0) pr.inflight--;
+        replicate_cv_.notify_one();
+        if (!delivered) {
+            pr.retry_after = std::chrono::steady_clock::now() + std::chrono::milliseconds(kHeartbeatMs);
+            return;
+        }
+        if (reply.term > log_.CurrentTerm()) {
+            BecomeFollower(reply.term);
+            return;
+        }
+        RecordAck(pr, sent);
+        if (index != pr.snapshot_index) return;   // superseded by a newer snapshot
+        if (!reply.installed) {
+            pr.snapshot_offset = reply.next_offset;
+            return;
+        }
+        pr.snapshot_index = 0;
+        if (index > pr.match_index) pr.match_index = index;
+        if (pr.next_index <= index) pr.next_index = index + 1;
+        pr.epoch++;
+        pr.probing = true;
+        TryAdvanceCommit();
+    }
+
+    void OnAppendReply(int peer, uint64_t gen, uint64_t epoch, uint64_t prev_log_index,
+                       std::chrono::steady_clock::time_point sent, bool delivered,
+                       const AppendEntriesReply& reply) {
+        compat::LockGuard<compat::Mutex> lock(mu_);
+        if (role_ != RaftRole::Leader || gen != leader_gen_) return;
+        PeerProgress& pr = peers_[peer];
+        if (pr.inflight > 0) pr.inflight--;
+        replicate_cv_.notify_one();
+        if (delivered && reply.term > log_.CurrentTerm()) {
+            BecomeFollower(reply.term);
+            return;
+        }
+        // Don't hammer a peer that isn't answering: it waits out a
+        // heartbeat interval, like a heartbeat would
+        if (!delivered) pr.retry_after = std::chrono::steady_clock::now() + std::chrono::milliseconds(kHeartbeatMs);
+        else RecordAck(pr, sent);   // even a rejection accepts our term
+        if (delivered && reply.success) {
+            if (reply.match_index > pr.match_index) pr.match_index = reply.match_index;
+            if (pr.next_index <= pr.match_index) pr.next_index = pr.match_index + 1;
+            if (epoch == pr.epoch) pr.probing = false;
+            TryAdvanceCommit();
+            return;
+        }
+        // Rejected or lost.  Everything pipelined behind it in the same
+        // epoch fails the same way, so rewind once and probe from there.
+        if (epoch != pr.epoch) return;
+        pr.epoch++;
+        pr.probing = true;
+        uint64_t next = delivered ? std::min(prev_log_index, reply.match_index + 1)
+                                  : pr.match_index + 1;
+        pr.next_index = std::max(next, pr.match_index + 1);
+    }
+
     void ApplierLoop() {
         while (running_) {
             compat::this_thread::sleep_for(std::chrono::milliseconds(10));
             compat::LockGuard<compat::Mutex> lock(mu_);
+            if (last_applied_ < commit_index_) read_cv_.notify_all();   // wakes once we unlock
             while (last_applied_ < commit_index_) {
                 last_applied_++;
                 LogEntry entry;
-                if (log_.GetEntry(last_applied_, entry) && apply_cb_) {
+                if (log_.GetEntry(last_applied_, entry) && !entry.command.empty() && apply_cb_) {
                     apply_cb_(entry.index, entry.command);
                 }
             }
-            // Compact old log entries to bound memory usage
-            // Keep last 1000 committed entries, discard older ones
-            if (last_applied_ > 1000) {
-                uint64_t compact_before = last_applied_ - 1000;
-                log_.CompactBefore(compact_before);
+            if (!snapshotting_ && last_applied_ - log_.SnapshotIndex() >= opts_.snapshot_threshold) {
+                StartSnapshot();
             }
         }
     }
 
+    // ─── Reads ─────────────────────────────────────────────────
+
+    // mu_ held.  The newest send time that a quorum (counting ourselves)
+    // has acknowledged: we were certainly leader at that instant.
+    std::chrono::steady_clock::time_point QuorumAckTime() const {
+        std::vector<std::chrono::steady_clock::time_point> acks;
+        acks.reserve(cluster_size_);
+        for (int i = 0; i < cluster_size_; i++) {
+            acks.push_back(i == id_ ? std::chrono::steady_clock::time_point::max() : peers_[i].last_ack);
+        }
+        size_t quorum = static_cast<size_t>(cluster_size_ / 2);
+        std::nth_element(acks.begin(), acks.begin() + quorum, acks.end(),
+                         std::greater<std::chrono::steady_clock::time_point>());
+        return acks[quorum];
+    }
+
+    void RecordAck(PeerProgress& pr, std::chrono::steady_clock::time_point sent) {
+        if (sent <= pr.last_ack) return;
+        pr.last_ack = sent;
+        read_cv_.notify_all();
+    }
+
+    // Leader side of ReadIndex.  Until the leader's no-op commits, its
+    // commit index may trail entries an earlier leader committed, so that
+    // is waited for first.  Then the commit index is the read index once
+    // a quorum answers a heartbeat sent after the request (or at once
+    // under a live lease).  Waits release mu_.
+    bool ReadIndexLocked(compat::UniqueLock<compat::Mutex>& lock, uint64_t& index, int timeout_ms) {
+        uint64_t term = log_.CurrentTerm();
+        auto still_leader = [&] { return running_ && role_ == RaftRole::Leader && log_.CurrentTerm() == term; };
+        read_cv_.wait_for(lock, std::chrono::milliseconds(timeout_ms), [&] {
+            return !still_leader() || log_.TermAt(commit_index_) == term;
+        });
+        if (!still_leader() || log_.TermAt(commit_index_) != term) return false;
+        index = commit_index_;
+
+        auto start = std::chrono::steady_clock::now();
+        if (opts_.lease_ms > 0 && start - std::chrono::milliseconds(opts_.lease_ms) < QuorumAckTime()) {
+            return true;
+        }
+        // Make every peer's heartbeat due now rather than up to a tick later
+        for (auto& pr : peers_) pr.last_sent = std::chrono::steady_clock::time_point();
+        replicate_cv_.notify_one();
+        read_cv_.wait_for(lock, std::chrono::milliseconds(timeout_ms), [&] {
+            return !still_leader() || QuorumAckTime() >= start;
+        });
+        return still_leader() && QuorumAckTime() >= start;
+    }
+
+    bool WaitAppliedLocked(compat::UniqueLock<compat::Mutex>& lock, uint64_t index, int timeout_ms) {
+        read_cv_.wait_for(lock, std::chrono::milliseconds(timeout_ms), [&] {
+            return !running_ || last_applied_ >= index;
+        });
+        return last_applied_ >= index;
+    }
+
+    // ─── Snapshots ─────────────────────────────────────────────
+
+    std::string SnapshotPath() const { return data_dir_ + "/snapshot.dat"; }
+
+    // mu_ held.  The previous snapshot thread has cleared snapshotting_,
+    // its last use of mu_, so joining it here can't deadlock.
+    void StartSnapshot() {
+        if (snapshot_thread_.joinable()) snapshot_thread_.join();
+        snapshotting_   = true;
+        snapshot_index_ = last_applied_;
+        snapshot_term_  = log_.TermAt(last_applied_);
+        snapshot_thread_ = compat::Thread(&RaftNode::SnapshotWorker, this);
+    }
+
+    // Writes the snapshot without mu_, so applying and replication carry
+    // on; only the rename and the log compaction happen under the lock.
+    void SnapshotWorker() {
+        uint64_t index, term;
+        {
+            compat::LockGuard<compat::Mutex> lock(mu_);
+            index = snapshot_index_;
+            term  = snapshot_term_;
+        }
+        std::string tmp = data_dir_ + "/snapshot.tmp";
+        std::remove(tmp.c_str());
+        bool ok;
+        if (save_cb_) {
+            ok = save_cb_(tmp);
+        } else {
+            std::ofstream f(tmp, std::ios::binary | std::ios::trunc);
+            ok = static_cast<bool>(f.flush());
+        }
+        compat::LockGuard<compat::Mutex> lock(mu_);
+        // An InstallSnapshot may have moved the base past us meanwhile
+        if (ok && index > log_.SnapshotIndex()) {
+#ifdef _WIN32
+            std::remove(SnapshotPath().c_str());
+#endif
+            if (std::rename(tmp.c_str(), SnapshotPath().c_str()) == 0) log_.CompactTo(index, term);
+        } else {
+            std::remove(tmp.c_str());
+        }
+        snapshotting_ = false;
+    }
+
     void StartElection() {
         // Prepare election state under lock, then release before RPCs
         RequestVoteArgs args;
@@ -320,82 +894,50 @@ private:
         }
     }
 
-    void SendHeartbeats() {
-        // Prepare heartbeat args under lock, then send without lock
-        struct HBInfo { int peer; AppendEntriesArgs args; };
-        std::vector<HBInfo> hbs;
-        {
-            compat::LockGuard<compat::Mutex> lock(mu_);
-            if (!transport_ || role_ != RaftRole::Leader) return;
-            for (int peer = 0; peer < cluster_size_; peer++) {
-                if (peer == id_) continue;
-                AppendEntriesArgs args;
-                args.term           = log_.CurrentTerm();
-                args.leader_id      = id_;
-                args.leader_commit  = commit_index_;
-                uint64_t next = next_index_[peer];
-                args.prev_log_index = (next > 1) ? next - 1 : 0;
-                args.prev_log_term  = log_.TermAt(args.prev_log_index);
-                if (log_.LastIndex() >= next) {
-                    args.entries = log_.GetRange(next, 200);
-                }
-                hbs.push_back({peer, std::move(args)});
-            }
-        }
-        // RPCs made without holding mu_
-        for (auto& hb : hbs) {
-            try {
-                auto reply = transport_->SendAppendEntries(hb.peer, hb.args);
-                compat::LockGuard<compat::Mutex> lock(mu_);
-                if (role_ != RaftRole::Leader) return;
-                if (reply.term > log_.CurrentTerm()) {
-                    BecomeFollower(reply.term);
-                    return;
-                }
-                if (reply.success) {
-                    match_index_[hb.peer] = reply.match_index;
-                    next_index_[hb.peer]  = reply.match_index + 1;
-                    TryAdvanceCommit();
-                } else {
-                    if (next_index_[hb.peer] > 1) next_index_[hb.peer]--;
-                }
-            } catch (...) {
-                // Peer unreachable
-            }
-        }
-    }
-
     void TryAdvanceCommit() {
-        // Find the highest N such that a majority of match_index[i] >= N
-        for (uint64_t n = log_.LastIndex(); n > commit_index_; n--) {
-            if (log_.TermAt(n) != log_.CurrentTerm()) continue;
-            int count = 1;  // self
-            for (int i = 0; i < cluster_size_; i++) {
-                if (i != id_ && match_index_[i] >= n) count++;
-            }
-            if (count > cluster_size_ / 2) {
-                commit_index_ = n;
-                break;
-            }
+        // The highest N replicated on a majority is the median of the match
+        // indices; only an entry from the current term commits by counting
+        std::vector<uint64_t> match;
+        match.reserve(cluster_size_);
+        for (int i = 0; i < cluster_size_; i++) {
+            match.push_back(i == id_ ? log_.LastIndex() : peers_[i].match_index);
         }
+        size_t quorum = static_cast<size_t>(cluster_size_ / 2);
+        std::nth_element(match.begin(), match.begin() + quorum, match.end(), std::greater<uint64_t>());
+        uint64_t n = match[quorum];
+        if (n > commit_index_ && log_.TermAt(n) == log_.CurrentTerm()) commit_index_ = n;
     }
 
     void BecomeFollower(uint64_t term) {
         role_ = RaftRole::Follower;
         log_.SetTerm(term);
         votes_received_ = 0;
+        pending_.clear();   // never appended: a new leader can't know of them
         ResetElectionTimer();
     }
 
     void BecomeLeader() {
         role_ = RaftRole::Leader;
         leader_id_ = id_;
+        leader_gen_++;
         for (int i = 0; i < cluster_size_; i++) {
-            next_index_[i]  = log_.LastIndex() + 1;
-            match_index_[i] = 0;
+            PeerProgress& pr = peers_[i];
+            pr.next_index  = log_.LastIndex() + 1;
+            pr.match_index = 0;
+            pr.inflight    = 0;
+            pr.probing     = true;
+            pr.epoch++;
+            pr.snapshot_index = 0;
+            pr.last_sent   = std::chrono::steady_clock::time_point();
+            pr.retry_after = std::chrono::steady_clock::time_point();
+            pr.last_ack    = std::chrono::steady_clock::time_point();
         }
-        // Immediately send heartbeats
-        SendHeartbeats();
+        // A no-op from this term: once it commits, so has everything
+        // earlier leaders committed (needed before serving reads).
+        pending_.push_back(std::string());
+        // mu_ is held here (called from StartElection); wake the replicator
+        // so the first heartbeat goes out now rather than a tick later.
+        replicate_cv_.notify_one();
     }
 
     void ResetElectionTimer() {
@@ -413,22 +955,38 @@ private:
     int         leader_id_ = -1;
     int         votes_received_ = 0;
 
-    bool        running_;
+    compat::Atomic<bool> running_;
+    RaftOptions opts_;
+    std::string data_dir_;
     RaftLog     log_;
 
     int         election_timeout_ms_;
     std::chrono::steady_clock::time_point last_heartbeat_;
+    std::chrono::steady_clock::time_point last_leader_contact_;
     std::mt19937 rng_;
 
-    std::vector<uint64_t> next_index_;
-    std::vector<uint64_t> match_index_;
+    std::vector<PeerProgress> peers_;
+    std::vector<std::string>  pending_;      // proposals not yet in the log
+    uint64_t                  leader_gen_ = 0;
 
-    RaftTransport* transport_ = nullptr;
-    ApplyCallback  apply_cb_;
+    RaftTransport*   transport_ = nullptr;
+    ApplyCallback    apply_cb_;
+    SnapshotCallback save_cb_;
+    SnapshotCallback restore_cb_;
 
-    compat::Mutex mu_;
+    bool     snapshotting_   = false;   // a SnapshotWorker is running
+    uint64_t snapshot_index_ = 0;       // what it is capturing
+    uint64_t snapshot_term_  = 0;
+    uint64_t recv_index_     = 0;       // snapshot being received (0 = none)
+    uint64_t recv_bytes_     = 0;
+
+    compat::Mutex    mu_;
+    compat::CondVar  replicate_cv_;
+    compat::CondVar  read_cv_;          // quorum acks and applied index advanced
     compat::Thread   ticker_thread_;
     compat::Thread   applier_thread_;
+    compat::Thread   replicator_thread_;
+    compat::Thread   snapshot_thread_;
 };
 
 // ──── Local Transport (for single-process simulation) ──────────
@@ -462,6 +1020,28 @@ public:
         return node->HandleAppendEntries(args);
     }
 
+    InstallSnapshotReply SendInstallSnapshot(int peer_id, const InstallSnapshotArgs& args) override {
+        RaftNode* node = nullptr;
+        {
+            compat::LockGuard<compat::Mutex> lock(mu_);
+            auto it = nodes_.find(peer_id);
+            if (it == nodes_.end()) return {args.term, false, 0};
+            node = it->second;
+        }
+        return node->HandleInstallSnapshot(args);
+    }
+
+    ReadIndexReply SendReadIndex(int peer_id, const ReadIndexArgs& args) override {
+        RaftNode* node = nullptr;
+        {
+            compat::LockGuard<compat::Mutex> lock(mu_);
+            auto it = nodes_.find(peer_id);
+            if (it == nodes_.end()) return {0, false, 0};
+            node = it->second;
+        }
+        return node->HandleReadIndex(args);
+    }
+
 private:
     std::unordered_map<int, RaftNode*> nodes_;
     compat::Mutex mu_;
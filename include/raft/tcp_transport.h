@@ -0,0 +1,724 @@
+#pragma once
+// ────────────────────────────────────────────────────────────────
+// TCP transport for Raft: RaftRpcServer answers a node's RPCs on a
+// port, TcpRaftTransport keeps one persistent connection per peer.
+//
+// Frames are length-prefixed, little-endian:
+//   u32 body length | u8 message type | body
+// A connection carries requests one way and replies the other, and
+// the server answers in arrival order, so the client matches replies
+// to requests FIFO.  That is what lets AppendEntries be pipelined:
+// SendAppendEntriesAsync writes the request and returns; a reader
+// thread per connection runs the callback when its reply arrives.
+// ────────────────────────────────────────────────────────────────
+
+// Winsock MUST be included before windows.h (pulled in by compat/threading.h)
+#ifdef _WIN32
+    #ifndef WIN32_LEAN_AND_MEAN
+        #define WIN32_LEAN_AND_MEAN
+    #endif
+    #include <winsock2.h>
+    #include <ws2tcpip.h>
+    #pragma comment(lib, "Ws2_32.lib")
+    using socket_t = SOCKET;
+    #define SOCKET_INVALID INVALID_SOCKET
+    #define CLOSE_SOCKET(s) closesocket(s)
+#else
+    #include <sys/socket.h>
+    #include <netinet/in.h>
+    #include <netinet/tcp.h>
+    #include <arpa/inet.h>
+    #include <netdb.h>
+    #include <fcntl.h>
+    #include <poll.h>
+    #include <unistd.h>
+    using socket_t = int;
+    #define SOCKET_INVALID (-1)
+    #define CLOSE_SOCKET(s) close(s)
+#endif
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "../compat/threading.h"
+#include "raft_node.h"
+
+namespace dcs {
+namespace raft {
+
+namespace rpc_detail {
+
+enum MessageType : uint8_t {
+    kRequestVote     = 1,
+    kAppendEntries   = 2,
+    kInstallSnapshot = 3,
+    kReadIndex       = 4,
+};
+
+static constexpr uint32_t kMaxFrameBytes = 64 * 1024 * 1024;
+
+inline void Put32(std::string& out, uint32_t v) { out.append(reinterpret_cast<const char*>(&v), 4); }
+inline void Put64(std::string& out, uint64_t v) { out.append(reinterpret_cast<const char*>(&v), 8); }
+
+/** Bounds-checked cursor over a received body. */
+struct Reader {
+    const char* p;
+    size_t      left;
+    bool        ok = true;
+
+    template <class T>
+    T Get() {
+        T v{};
+        if (left < sizeof(T)) { ok = false; return v; }
+        std::memcpy(&v, p, sizeof(T));
+        p += sizeof(T);
+        left -= sizeof(T);
+        return v;
+    }
+    std::string Bytes(size_t n) {
+        if (left < n) { ok = false; return std::string(); }
+        std::string s(p, n);
+        p += n;
+        left -= n;
+        return s;
+    }
+};
+
+inline std::string Encode(const RequestVoteArgs& a) {
+    std::string out;
+    Put64(out, a.term);
+    Put32(out, static_cast<uint32_t>(a.candidate_id));
+    Put64(out, a.last_log_index);
+    Put64(out, a.last_log_term);
+    return out;
+}
+
+inline bool Decode(Reader& r, RequestVoteArgs& a) {
+    a.term           = r.Get<uint64_t>();
+    a.candidate_id   = static_cast<int>(r.Get<uint32_t>());
+    a.last_log_index = r.Get<uint64_t>();
+    a.last_log_term  = r.Get<uint64_t>();
+    return r.ok;
+}
+
+inline std::string Encode(const RequestVoteReply& a) {
+    std::string out;
+    Put64(out, a.term);
+    out += static_cast<char>(a.vote_granted ? 1 : 0);
+    return out;
+}
+
+inline bool Decode(Reader& r, RequestVoteReply& a) {
+    a.term         = r.Get<uint64_t>();
+    a.vote_granted = r.Get<uint8_t>() != 0;
+    return r.ok;
+}
+
+inline std::string Encode(const AppendEntriesArgs& a) {
+    std::string out;
+    Put64(out, a.term);
+    Put32(out, static_cast<uint32_t>(a.leader_id));
+    Put64(out, a.prev_log_index);
+    Put64(out, a.prev_log_term);
+    Put64(out, a.leader_commit);
+    Put32(out, static_cast<uint32_t>(a.entries.size()));
+    for (const auto& e : a.entries) {
+        Put64(out, e.term);
+        Put64(out, e.index);
+        Put32(out, static_cast<uint32_t>(e.command.size()));
+        out += e.command;
+    }
+    return out;
+}
+
+inline bool Decode(Reader& r, AppendEntriesArgs& a) {
+    a.term           = r.Get<uint64_t>();
+    a.leader_id      = static_cast<int>(r.Get<uint32_t>());
+    a.prev_log_index = r.Get<uint64_t>();
+    a.prev_log_term  = r.Get<uint64_t>();
+    a.leader_commit  = r.Get<uint64_t>();
+    uint32_t n = r.Get<uint32_t>();
+    if (!r.ok || n > r.left / 20) return false;   // 20 = smallest encoded entry
+    a.entries.resize(n);
+    for (auto& e : a.entries) {
+        e.term  = r.Get<uint64_t>();
+        e.index = r.Get<uint64_t>();
+        e.command = r.Bytes(r.Get<uint32_t>());
+        if (!r.ok) return false;
+    }
+    return r.ok;
+}
+
+inline std::string Encode(const AppendEntriesReply& a) {
+    std::string out;
+    Put64(out, a.term);
+    out += static_cast<char>(a.success ? 1 : 0);
+    Put64(out, a.match_index);
+    return out;
+}
+
+inline bool Decode(Reader& r, AppendEntriesReply& a) {
+    a.term        = r.Get<uint64_t>();
+    a.success     = r.Get<uint8_t>() != 0;
+    a.match_index = r.Get<uint64_t>();
+    return r.ok;
+}
+
+inline std::string Encode(const InstallSnapshotArgs& a) {
+    std::string out;
+    Put64(out, a.term);
+    Put32(out, static_cast<uint32_t>(a.leader_id));
+    Put64(out, a.last_included_index);
+    Put64(out, a.last_included_term);
+    Put64(out, a.offset);
+    out += static_cast<char>(a.done ? 1 : 0);
+    Put32(out, static_cast<uint32_t>(a.data.size()));
+    out += a.data;
+    return out;
+}
+
+inline bool Decode(Reader& r, InstallSnapshotArgs& a) {
+    a.term                = r.Get<uint64_t>();
+    a.leader_id           = static_cast<int>(r.Get<uint32_t>());
+    a.last_included_index = r.Get<uint64_t>();
+    a.last_included_term  = r.Get<uint64_t>();
+    a.offset              = r.Get<uint64_t>();
+    a.done                = r.Get<uint8_t>() != 0;
+    a.data                = r.Bytes(r.Get<uint32_t>());
+    return r.ok;
+}
+
+inline std::string Encode(const InstallSnapshotReply& a) {
+    std::string out;
+    Put64(out, a.term);
+    out += static_cast<char>(a.installed ? 1 : 0);
+    Put64(out, a.next_offset);
+    return out;
+}
+
+inline bool Decode(Reader& r, InstallSnapshotReply& a) {
+    a.term        = r.Get<uint64_t>();
+    a.installed   = r.Get<uint8_t>() != 0;
+    a.next_offset = r.Get<uint64_t>();
+    return r.ok;
+}
+
+inline std::string Encode(const ReadIndexArgs& a) {
+    std::string out;
+    Put32(out, static_cast<uint32_t>(a.requester_id));
+    return out;
+}
+
+inline bool Decode(Reader& r, ReadIndexArgs& a) {
+    a.requester_id = static_cast<int>(r.Get<uint32_t>());
+    return r.ok;
+}
+
+inline std::string Encode(const ReadIndexReply& a) {
+    std::string out;
+    Put64(out, a.term);
+    out += static_cast<char>(a.success ? 1 : 0);
+    Put64(out, a.read_index);
+    return out;
+}
+
+inline bool Decode(Reader& r, ReadIndexReply& a) {
+    a.term       = r.Get<uint64_t>();
+    a.success    = r.Get<uint8_t>() != 0;
+    a.read_index = r.Get<uint64_t>();
+    return r.ok;
+}
+
+inline std::string Frame(uint8_t type, const std::string& body) {
+    std::string out;
+    out.reserve(5 + body.size());
+    Put32(out, static_cast<uint32_t>(body.size()));
+    out += static_cast<char>(type);
+    out += body;
+    return out;
+}
+
+inline bool SendAll(socket_t fd, const char* p, size_t n) {
+    while (n > 0) {
+#ifdef _WIN32
+        int w = send(fd, p, static_cast<int>(n), 0);
+#elif defined(MSG_NOSIGNAL)
+        ssize_t w = send(fd, p, n, MSG_NOSIGNAL);
+#else
+        ssize_t w = send(fd, p, n, 0);
+#endif
+        if (w <= 0) return false;
+        p += w;
+        n -= static_cast<size_t>(w);
+    }
+    return true;
+}
+
+inline bool RecvAll(socket_t fd, char* p, size_t n) {
+    while (n > 0) {
+#ifdef _WIN32
+        int r = recv(fd, p, static_cast<int>(n), 0);
+#else
+        ssize_t r = recv(fd, p, n, 0);
+#endif
+        if (r <= 0) return false;
+        p += r;
+        n -= static_cast<size_t>(r);
+    }
+    return true;
+}
+
+inline bool RecvFrame(socket_t fd, uint8_t& type, std::string& body) {
+    char header[5];
+    if (!RecvAll(fd, header, 5)) return false;
+    uint32_t len;
+    std::memcpy(&len, header, 4);
+    if (len > kMaxFrameBytes) return false;
+    type = static_cast<uint8_t>(header[4]);
+    body.resize(len);
+    return len == 0 || RecvAll(fd, &body[0], len);
+}
+
+inline void SetNoDelay(socket_t fd) {
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, reinterpret_cast<const char*>(&one), sizeof(one));
+}
+
+// Connects to `host:port` within `timeout_ms`, or returns
+// SOCKET_INVALID: a blackholed peer must not hold the caller for the
+// kernel's SYN timeout.  The socket is left blocking.
+inline socket_t ConnectWithTimeout(const std::string& host, uint16_t port, int timeout_ms) {
+    addrinfo hints{}, *res = nullptr;
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+    std::string service = std::to_string(port);
+    if (getaddrinfo(host.c_str(), service.c_str(), &hints, &res) != 0 || !res) return SOCKET_INVALID;
+    socket_t fd = socket(res->ai_family, res->ai_socktype, res->ai_protocol);
+    if (fd == SOCKET_INVALID) {
+        freeaddrinfo(res);
+        return SOCKET_INVALID;
+    }
+#ifdef _WIN32
+    u_long nonblocking = 1;
+    ioctlsocket(fd, FIONBIO, &nonblocking);
+    bool ok = connect(fd, res->ai_addr, static_cast<int>(res->ai_addrlen)) == 0;
+    if (!ok && WSAGetLastError() == WSAEWOULDBLOCK) {
+        WSAPOLLFD pfd{fd, POLLOUT, 0};
+        ok = WSAPoll(&pfd, 1, timeout_ms) == 1;
+    }
+#else
+    int flags = fcntl(fd, F_GETFL, 0);
+    fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+    bool ok = connect(fd, res->ai_addr, static_cast<socklen_t>(res->ai_addrlen)) == 0;
+    if (!ok && errno == EINPROGRESS) {
+        pollfd pfd{fd, POLLOUT, 0};
+        ok = poll(&pfd, 1, timeout_ms) == 1;
+    }
+#endif
+    freeaddrinfo(res);
+    int err = 0;
+    socklen_t len = sizeof(err);
+    if (ok) ok = getsockopt(fd, SOL_SOCKET, SO_ERROR, reinterpret_cast<char*>(&err), &len) == 0 && err == 0;
+    if (!ok) {
+        CLOSE_SOCKET(fd);
+        return SOCKET_INVALID;
+    }
+#ifdef _WIN32
+    nonblocking = 0;
+    ioctlsocket(fd, FIONBIO, &nonblocking);
+#else
+    fcntl(fd, F_SETFL, flags);
+#endif
+    return fd;
+}
+
+// Wakes a thread blocked in accept()/recv() on `fd`; that thread is
+// the one that closes it, so the descriptor can't be reused under it.
+inline void ShutdownSocket(socket_t fd) {
+#ifdef _WIN32
+    shutdown(fd, SD_BOTH);
+#else
+    shutdown(fd, SHUT_RDWR);
+#endif
+}
+
+inline void StartupSockets() {
+#ifdef _WIN32
+    WSADATA wsa;
+    WSAStartup(MAKEWORD(2, 2), &wsa);
+#endif
+}
+
+}  // namespace rpc_detail
+
+// ──── RPC Server ───────────────────────────────────────────────
+
+/**
+ * RaftRpcServer — accepts peer connections and feeds each request to
+ * the local RaftNode.  One thread per connection; a cluster has few.
+ *
+ *   RaftRpcServer server(&node, 7000);
+ *   server.Start();          // returns once listening
+ *   ...
+ *   server.Stop();
+ */
+class RaftRpcServer {
+public:
+    /** `port` 0 picks a free port; Port() reports it after Start(). */
+    RaftRpcServer(RaftNode* node, uint16_t port)
+        : node_(node), port_(port), running_(false), listen_fd_(SOCKET_INVALID) {}
+
+    ~RaftRpcServer() { Stop(); }
+
+    RaftRpcServer(const RaftRpcServer&) = delete;
+    RaftRpcServer& operator=(const RaftRpcServer&) = delete;
+
+    bool Start() {
+        rpc_detail::StartupSockets();
+        listen_fd_ = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+        if (listen_fd_ == SOCKET_INVALID) return false;
+        int opt = 1;
+        setsockopt(listen_fd_, SOL_SOCKET, SO_REUSEADDR, reinterpret_cast<const char*>(&opt), sizeof(opt));
+
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = INADDR_ANY;
+        addr.sin_port = htons(port_);
+        socklen_t len = sizeof(addr);
+        if (bind(listen_fd_, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 ||
+            listen(listen_fd_, 16) != 0 ||
+            getsockname(listen_fd_, reinterpret_cast<sockaddr*>(&addr), &len) != 0) {
+            CLOSE_SOCKET(listen_fd_);
+            listen_fd_ = SOCKET_INVALID;
+            return false;
+        }
+        port_ = ntohs(addr.sin_port);
+        running_ = true;
+        accept_thread_ = compat::Thread(&RaftRpcServer::AcceptLoop, this);
+        return true;
+    }
+
+    void Stop() {
+        if (!running_.exchange(false)) return;
+        rpc_detail::ShutdownSocket(listen_fd_);
+        if (accept_thread_.joinable()) accept_thread_.join();
+        CLOSE_SOCKET(listen_fd_);
+        listen_fd_ = SOCKET_INVALID;
+        std::vector<compat::Thread> threads;
+        {
+            compat::LockGuard<compat::Mutex> lock(mu_);
+            for (socket_t fd : conn_fds_) rpc_detail::ShutdownSocket(fd);
+            threads.swap(conn_threads_);
+        }
+        for (auto& t : threads) {
+            if (t.joinable()) t.join();
+        }
+    }
+
+    uint16_t Port() const { return port_; }
+
+private:
+    void AcceptLoop() {
+        while (running_) {
+            socket_t fd = accept(listen_fd_, nullptr, nullptr);
+            if (fd == SOCKET_INVALID) {
+                if (!running_) break;
+                continue;
+            }
+            rpc_detail::SetNoDelay(fd);
+            compat::LockGuard<compat::Mutex> lock(mu_);
+            if (!running_) {
+                CLOSE_SOCKET(fd);
+                break;
+            }
+            conn_fds_.push_back(fd);
+            conn_threads_.emplace_back(&RaftRpcServer::Serve, this, fd);
+        }
+    }
+
+    // Requests on one connection are answered strictly in order.
+    void Serve(socket_t fd) {
+        uint8_t type;
+        std::string body;
+        while (running_ && rpc_detail::RecvFrame(fd, type, body)) {
+            rpc_detail::Reader r{body.data(), body.size()};
+            std::string reply;
+            if (type == rpc_detail::kRequestVote) {
+                RequestVoteArgs args;
+                if (!rpc_detail::Decode(r, args)) break;
+                reply = rpc_detail::Encode(node_->HandleRequestVote(args));
+            } else if (type == rpc_detail::kAppendEntries) {
+                AppendEntriesArgs args;
+                if (!rpc_detail::Decode(r, args)) break;
+                reply = rpc_detail::Encode(node_->HandleAppendEntries(args));
+            } else if (type == rpc_detail::kInstallSnapshot) {
+                InstallSnapshotArgs args;
+                if (!rpc_detail::Decode(r, args)) break;
+                reply = rpc_detail::Encode(node_->HandleInstallSnapshot(args));
+            } else if (type == rpc_detail::kReadIndex) {
+                // Blocks this connection for up to one heartbeat round;
+                // peers only send it on their own connection to us
+                ReadIndexArgs args;
+                if (!rpc_detail::Decode(r, args)) break;
+                reply = rpc_detail::Encode(node_->HandleReadIndex(args));
+            } else {
+                break;
+            }
+            std::string frame = rpc_detail::Frame(type, reply);
+            if (!rpc_detail::SendAll(fd, frame.data(), frame.size())) break;
+        }
+        compat::LockGuard<compat::Mutex> lock(mu_);
+        conn_fds_.erase(std::find(conn_fds_.begin(), conn_fds_.end(), fd));
+        CLOSE_SOCKET(fd);
+    }
+
+    RaftNode*            node_;
+    uint16_t             port_;
+    compat::Atomic<bool> running_;
+    socket_t             listen_fd_;
+    compat::Thread       accept_thread_;
+
+    compat::Mutex               mu_;
+    std::vector<socket_t>       conn_fds_;
+    std::vector<compat::Thread> conn_threads_;
+};
+
+// ──── TCP Transport ────────────────────────────────────────────
+
+/**
+ * TcpRaftTransport — RaftTransport over persistent TCP connections.
+ * Connections are opened on first use and re-opened after a failure
+ * (at most once per kReconnectMs, so a dead peer costs nothing per
+ * heartbeat).  A failed connection fails every request still waiting
+ * on it; the synchronous calls throw, which RaftNode treats as an
+ * unreachable peer.
+ */
+class TcpRaftTransport : public RaftTransport {
+public:
+    struct PeerAddress {
+        std::string host;
+        uint16_t    port;
+    };
+
+    static constexpr int kCallTimeoutMs = 500;
+    static constexpr int kReconnectMs   = 100;
+
+    explicit TcpRaftTransport(std::map<int, PeerAddress> peers) {
+        rpc_detail::StartupSockets();
+        for (auto& p : peers) peers_[p.first] = std::make_unique<Connection>(p.second);
+    }
+
+    ~TcpRaftTransport() override {
+        for (auto& p : peers_) p.second->Close();
+    }
+
+    RequestVoteReply SendRequestVote(int peer_id, const RequestVoteArgs& args) override {
+        RequestVoteReply reply{};
+        std::string body = Call(peer_id, rpc_detail::kRequestVote, rpc_detail::Encode(args));
+        rpc_detail::Reader r{body.data(), body.size()};
+        if (!rpc_detail::Decode(r, reply)) throw std::runtime_error("raft rpc: bad RequestVote reply");
+        return reply;
+    }
+
+    AppendEntriesReply SendAppendEntries(int peer_id, const AppendEntriesArgs& args) override {
+        AppendEntriesReply reply{};
+        std::string body = Call(peer_id, rpc_detail::kAppendEntries, rpc_detail::Encode(args));
+        rpc_detail::Reader r{body.data(), body.size()};
+        if (!rpc_detail::Decode(r, reply)) throw std::runtime_error("raft rpc: bad AppendEntries reply");
+        return reply;
+    }
+
+    void SendAppendEntriesAsync(int peer_id, const AppendEntriesArgs& args,
+                                AppendEntriesCallback done) override {
+        auto it = peers_.find(peer_id);
+        AppendEntriesReply failed{args.term, false, 0};
+        if (it == peers_.end()) {
+            done(false, failed);
+            return;
+        }
+        it->second->Send(rpc_detail::kAppendEntries, rpc_detail::Encode(args),
+            [done, failed](bool ok, const std::string& body) {
+                AppendEntriesReply reply{};
+                rpc_detail::Reader r{body.data(), body.size()};
+                if (ok && rpc_detail::Decode(r, reply)) done(true, reply);
+                else done(false, failed);
+            });
+    }
+
+    InstallSnapshotReply SendInstallSnapshot(int peer_id, const InstallSnapshotArgs& args) override {
+        InstallSnapshotReply reply{};
+        std::string body = Call(peer_id, rpc_detail::kInstallSnapshot, rpc_detail::Encode(args));
+        rpc_detail::Reader r{body.data(), body.size()};
+        if (!rpc_detail::Decode(r, reply)) throw std::runtime_error("raft rpc: bad InstallSnapshot reply");
+        return reply;
+    }
+
+    void SendInstallSnapshotAsync(int peer_id, const InstallSnapshotArgs& args,
+                                  InstallSnapshotCallback done) override {
+        auto it = peers_.find(peer_id);
+        InstallSnapshotReply failed{args.term, false, 0};
+        if (it == peers_.end()) {
+            done(false, failed);
+            return;
+        }
+        it->second->Send(rpc_detail::kInstallSnapshot, rpc_detail::Encode(args),
+            [done, failed](bool ok, const std::string& body) {
+                InstallSnapshotReply reply{};
+                rpc_detail::Reader r{body.data(), body.size()};
+                if (ok && rpc_detail::Decode(r, reply)) done(true, reply);
+                else done(false, failed);
+            });
+    }
+
+    ReadIndexReply SendReadIndex(int peer_id, const ReadIndexArgs& args) override {
+        ReadIndexReply reply{};
+        std::string body = Call(peer_id, rpc_detail::kReadIndex, rpc_detail::Encode(args));
+        rpc_detail::Reader r{body.data(), body.size()};
+        if (!rpc_detail::Decode(r, reply)) throw std::runtime_error("raft rpc: bad ReadIndex reply");
+        return reply;
+    }
+
+private:
+    using ReplyCallback = std::function<void(bool ok, const std::string& body)>;
+
+    class Connection {
+    public:
+        explicit Connection(PeerAddress addr) : addr_(std::move(addr)) {}
+
+        // Writes the request and queues `cb` for its reply.  `cb` runs on
+        // this connection's reader thread (or inline on failure) and must
+        // not call back into the transport.
+        void Send(uint8_t type, const std::string& body, ReplyCallback cb) {
+            std::string frame = rpc_detail::Frame(type, body);
+            compat::UniqueLock<compat::Mutex> lock(mu_);
+            if (closed_ || !EnsureConnected(lock)) {
+                lock.unlock();
+                cb(false, std::string());
+                return;
+            }
+            waiting_.push_back(std::move(cb));
+            if (!rpc_detail::SendAll(fd_, frame.data(), frame.size())) {
+                // The reader sees the broken socket and fails the queue
+                rpc_detail::ShutdownSocket(fd_);
+            }
+        }
+
+        void Close() {
+            compat::Thread reader;
+            {
+                compat::LockGuard<compat::Mutex> lock(mu_);
+                closed_ = true;
+                if (fd_ != SOCKET_INVALID) rpc_detail::ShutdownSocket(fd_);
+                reader = std::move(reader_);
+            }
+            if (reader.joinable()) reader.join();
+        }
+
+    private:
+        // `lock` holds mu_; it is released while connecting, so a slow or
+        // blackholed peer holds up only this caller, for at most
+        // kCallTimeoutMs.  Sends arriving meanwhile fail fast.
+        bool EnsureConnected(compat::UniqueLock<compat::Mutex>& lock) {
+            if (fd_ != SOCKET_INVALID) return true;
+            if (connecting_) return false;
+            auto now = std::chrono::steady_clock::now();
+            if (now - last_attempt_ < std::chrono::milliseconds(kReconnectMs)) return false;
+            last_attempt_ = now;
+            // The previous reader has failed its queue and is exiting
+            if (reader_.joinable()) {
+                if (reader_busy_) return false;
+                reader_.join();
+            }
+
+            connecting_ = true;
+            lock.unlock();
+            socket_t fd = rpc_detail::ConnectWithTimeout(addr_.host, addr_.port, kCallTimeoutMs);
+            lock.lock();
+            connecting_ = false;
+            if (fd == SOCKET_INVALID) return false;
+            if (closed_) {
+                CLOSE_SOCKET(fd);
+                return false;
+            }
+            rpc_detail::SetNoDelay(fd);
+            fd_ = fd;
+            reader_busy_ = true;
+            reader_ = compat::Thread(&Connection::ReadLoop, this, fd);
+            return true;
+        }
+
+        void ReadLoop(socket_t fd) {
+            uint8_t type;
+            std::string body;
+            while (rpc_detail::RecvFrame(fd, type, body)) {
+                ReplyCallback cb;
+                {
+                    compat::LockGuard<compat::Mutex> lock(mu_);
+                    if (waiting_.empty()) break;   // reply nobody asked for
+                    cb = std::move(waiting_.front());
+                    waiting_.pop_front();
+                }
+                cb(true, body);
+            }
+            std::deque<ReplyCallback> orphaned;
+            {
+                compat::LockGuard<compat::Mutex> lock(mu_);
+                CLOSE_SOCKET(fd);
+                fd_ = SOCKET_INVALID;
+                orphaned.swap(waiting_);
+                reader_busy_ = false;
+            }
+            for (auto& cb : orphaned) cb(false, std::string());
+        }
+
+        PeerAddress               addr_;
+        compat::Mutex             mu_;
+        socket_t                  fd_ = SOCKET_INVALID;
+        bool                      closed_ = false;
+        bool                      connecting_ = false;   // EnsureConnected() is dialing, mu_ released
+        bool                      reader_busy_ = false;
+        compat::Thread            reader_;
+        std::deque<ReplyCallback> waiting_;
+        std::chrono::steady_clock::time_point last_attempt_;
+    };
+
+    // Blocking request/reply on the pipelined connection.
+    std::string Call(int peer_id, uint8_t type, const std::string& body) {
+        auto it = peers_.find(peer_id);
+        if (it == peers_.end()) throw std::runtime_error("raft rpc: unknown peer");
+        struct Waiter {
+            compat::Mutex   mu;
+            compat::CondVar cv;
+            bool            done = false;
+            bool            ok   = false;
+            std::string     body;
+        };
+        auto w = std::make_shared<Waiter>();
+        it->second->Send(type, body, [w](bool ok, const std::string& reply) {
+            compat::LockGuard<compat::Mutex> lock(w->mu);
+            w->done = true;
+            w->ok   = ok;
+            w->body = reply;
+            w->cv.notify_all();
+        });
+        compat::UniqueLock<compat::Mutex> lock(w->mu);
+        w->cv.wait_for(lock, std::chrono::milliseconds(kCallTimeoutMs), [&] { return w->done; });
+        if (!w->done || !w->ok) throw std::runtime_error("raft rpc: peer unreachable");
+        return std::move(w->body);
+    }
+
+    std::map<int, std::unique_ptr<Connection>> peers_;
+};
+
+}  // namespace raft
+}  // namespace dcs
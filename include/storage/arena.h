@@ -0,0 +1,66 @@
+#pragma once
+// ────────────────────────────────────────────────────────────────
+// Arena: bump allocator owned by a MemTable.  Nodes are never freed
+// individually; dropping the arena releases every block at once.
+// ────────────────────────────────────────────────────────────────
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "../compat/threading.h"
+
+namespace dcs {
+namespace storage {
+
+class Arena {
+public:
+    static constexpr size_t kBlockSize = 64 * 1024;
+    static constexpr size_t kAlign     = alignof(std::max_align_t) > 8 ? alignof(std::max_align_t) : 8;
+
+    Arena() : ptr_(nullptr), remaining_(0), usage_(0) {}
+
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    /**
+     * Aligned storage for `bytes`.  Safe to call from several writers;
+     * the lock covers only the pointer bump, never a reader.
+     */
+    char* Allocate(size_t bytes) {
+        bytes = (bytes + kAlign - 1) & ~(kAlign - 1);
+        compat::LockGuard<compat::Mutex> lock(mu_);
+        if (bytes > remaining_) {
+            // Oversized requests get their own block so the current
+            // block's tail isn't wasted.
+            if (bytes > kBlockSize / 4) return NewBlock(bytes);
+            ptr_ = NewBlock(kBlockSize);
+            remaining_ = kBlockSize;
+        }
+        char* result = ptr_;
+        ptr_ += bytes;
+        remaining_ -= bytes;
+        return result;
+    }
+
+    /** Bytes reserved from the system, including unused block tails. */
+    size_t MemoryUsage() const { return usage_.load(std::memory_order_relaxed); }
+
+private:
+    char* NewBlock(size_t bytes) {
+        blocks_.emplace_back(new char[bytes]);
+        usage_.fetch_add(bytes + sizeof(char*), std::memory_order_relaxed);
+        return blocks_.back().get();
+    }
+
+    compat::Mutex                        mu_;
+    std::vector<std::unique_ptr<char[]>> blocks_;
+    char*                                ptr_;
+    size_t                               remaining_;
+    std::atomic<size_t>                  usage_;
+};
+
+}  // namespace storage
+}  // namespace dcs
@@ -0,0 +1,139 @@
+#pragma once
+// ────────────────────────────────────────────────────────────────
+// BlockCache: shared LRU cache of uncompressed SSTable data blocks,
+// bounded in bytes.  Keyed by (reader file id, block offset); file ids
+// are never reused, so blocks of a deleted SSTable simply age out.
+// ────────────────────────────────────────────────────────────────
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "../compat/threading.h"
+
+namespace dcs {
+namespace storage {
+
+class BlockCache {
+public:
+    using BlockPtr = std::shared_ptr<const std::string>;
+
+    static constexpr size_t kShards = 16;
+    // Per-entry bookkeeping (list node, map slot, control block) charged
+    // on top of the block bytes.
+    static constexpr size_t kEntryOverhead = 96;
+
+    /** `capacity_bytes` of 0 disables caching. */
+    explicit BlockCache(size_t capacity_bytes)
+        : capacity_(capacity_bytes), hits_(0), misses_(0) {
+        for (auto& s : shards_) s.capacity = capacity_bytes / kShards;
+    }
+
+    BlockCache(const BlockCache&) = delete;
+    BlockCache& operator=(const BlockCache&) = delete;
+
+    /** A process-unique id for a newly opened SSTable reader. */
+    static uint64_t NewFileId() {
+        static compat::Atomic<uint64_t> next{1};
+        return next.fetch_add(1);
+    }
+
+    BlockPtr Lookup(uint64_t file_id, uint64_t offset) {
+        if (capacity_ == 0) return nullptr;
+        Key k{file_id, offset};
+        Shard& s = ShardFor(k);
+        compat::LockGuard<compat::Mutex> lock(s.mu);
+        auto it = s.index.find(k);
+        if (it == s.index.end()) {
+            misses_++;
+            return nullptr;
+        }
+        s.lru.splice(s.lru.begin(), s.lru, it->second);
+        hits_++;
+        return it->second->block;
+    }
+
+    void Insert(uint64_t file_id, uint64_t offset, BlockPtr block) {
+        if (capacity_ == 0 || !block) return;
+        Key k{file_id, offset};
+        size_t charge = block->size() + kEntryOverhead;
+        Shard& s = ShardFor(k);
+        if (charge > s.capacity) return;   // would evict the whole shard
+        compat::LockGuard<compat::Mutex> lock(s.mu);
+        auto it = s.index.find(k);
+        if (it != s.index.end()) {
+            s.usage -= it->second->charge;
+            s.lru.erase(it->second);
+            s.index.erase(it);
+        }
+        s.lru.push_front(Entry{k, std::move(block), charge});
+        s.index[k] = s.lru.begin();
+        s.usage += charge;
+        while (s.usage > s.capacity && !s.lru.empty()) {
+            auto& victim = s.lru.back();
+            s.usage -= victim.charge;
+            s.index.erase(victim.key);
+            s.lru.pop_back();
+        }
+    }
+
+    size_t Capacity() const { return capacity_; }
+
+    size_t Usage() const {
+        size_t total = 0;
+        for (auto& s : shards_) {
+            compat::LockGuard<compat::Mutex> lock(s.mu);
+            total += s.usage;
+        }
+        return total;
+    }
+
+    uint64_t Hits()   const { return hits_.load(); }
+    uint64_t Misses() const { return misses_.load(); }
+
+private:
+    struct Key {
+        uint64_t file_id;
+        uint64_t offset;
+        bool operator==(const Key& o) const { return file_id == o.file_id && offset == o.offset; }
+    };
+
+    struct KeyHash {
+        size_t operator()(const Key& k) const {
+            uint64_t x = k.file_id * 0x9e3779b97f4a7c15ULL ^ k.offset;
+            x ^= x >> 31;
+            x *= 0xbf58476d1ce4e5b9ULL;
+            x ^= x >> 29;
+            return static_cast<size_t>(x);
+        }
+    };
+
+    struct Entry {
+        Key      key;
+        BlockPtr block;
+        size_t   charge;
+    };
+
+    struct Shard {
+        mutable compat::Mutex mu;
+        std::list<Entry> lru;   // front = most recently used
+        std::unordered_map<Key, std::list<Entry>::iterator, KeyHash> index;
+        size_t usage = 0;
+        size_t capacity = 0;
+    };
+
+    Shard& ShardFor(const Key& k) { return shards_[KeyHash{}(k) % kShards]; }
+
+    const size_t capacity_;
+    Shard shards_[kShards];
+    compat::Atomic<uint64_t> hits_;
+    compat::Atomic<uint64_t> misses_;
+};
+
+}  // namespace storage
+}  // namespace dcs
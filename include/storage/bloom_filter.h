@@ -0,0 +1,255 @@
+#pragma once
+// ────────────────────────────────────────────────────────────────
+// Bloom filter: split-block layout (as in Parquet / Impala).
+//
+// A key is hashed once to 64 bits.  The high half picks one 32-byte
+// block (eight 32-bit words, so a probe reads a single cache line);
+// the low half, multiplied by eight odd salts, picks one bit in each
+// word.  Insert ORs the eight-bit mask into the block and a probe tests
+// it, which is one AVX2/NEON multiply-shift-test per lookup.  Because
+// the hash no longer depends on the filter, a lookup hashes the key
+// once and reuses it for every SSTable it probes.
+//
+// Serialized: u32 kBlockedMagic | u32 num_blocks | blocks.
+// Filters written before this layout ([u32 k][u32 n][n bytes], k
+// passes over the key) are still read, and probed the old way.
+// ────────────────────────────────────────────────────────────────
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+    #define DCS_BLOOM_X86 1
+    #include <immintrin.h>
+    #if defined(_MSC_VER) && !defined(__clang__)
+        #include <intrin.h>
+        #define DCS_BLOOM_TARGET_AVX2
+    #else
+        #define DCS_BLOOM_TARGET_AVX2 __attribute__((target("avx2")))
+    #endif
+#elif defined(__aarch64__) || defined(_M_ARM64)
+    #define DCS_BLOOM_NEON 1
+    #include <arm_neon.h>
+#endif
+
+namespace dcs {
+namespace storage {
+
+/** 64-bit key hash shared by every filter probe of one lookup. */
+inline uint64_t BloomHash(std::string_view key) {
+    const uint64_t kMul = 0x9e3779b97f4a7c15ULL;
+    uint64_t h = 0x2545f4914f6cdd1dULL ^ (key.size() * kMul);
+    const char* p = key.data();
+    size_t n = key.size();
+    for (; n >= 8; p += 8, n -= 8) {
+        uint64_t w;
+        std::memcpy(&w, p, 8);
+        h = (h ^ (w * kMul)) * 0xff51afd7ed558ccdULL;
+        h ^= h >> 32;
+    }
+    uint64_t tail = 0;
+    for (size_t i = 0; i < n; ++i) tail |= static_cast<uint64_t>(static_cast<unsigned char>(p[i])) << (8 * i);
+    h = (h ^ (tail * kMul)) * 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 29;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 32;
+    return h;
+}
+
+namespace bloom_detail {
+
+struct alignas(32) Block {
+    uint32_t words[8];
+};
+
+constexpr uint32_t kSalt[8] = {
+    0x47b6137bU, 0x44974d91U, 0x8824ad5bU, 0xa2b7289dU,
+    0x705495c7U, 0x2df1424bU, 0x9efc4947U, 0x5c6bfb31U,
+};
+
+inline void MaskScalar(uint32_t key, uint32_t mask[8]) {
+    for (int i = 0; i < 8; ++i) mask[i] = 1u << ((key * kSalt[i]) >> 27);
+}
+
+inline bool TestScalar(const Block& b, uint32_t key) {
+    uint32_t mask[8];
+    MaskScalar(key, mask);
+    for (int i = 0; i < 8; ++i) {
+        if ((b.words[i] & mask[i]) == 0) return false;
+    }
+    return true;
+}
+
+#if DCS_BLOOM_X86
+DCS_BLOOM_TARGET_AVX2 inline bool TestAvx2(const Block& b, uint32_t key) {
+    const __m256i salt = _mm256_setr_epi32(
+        static_cast<int>(kSalt[0]), static_cast<int>(kSalt[1]), static_cast<int>(kSalt[2]),
+        static_cast<int>(kSalt[3]), static_cast<int>(kSalt[4]), static_cast<int>(kSalt[5]),
+        static_cast<int>(kSalt[6]), static_cast<int>(kSalt[7]));
+    __m256i shift = _mm256_srli_epi32(_mm256_mullo_epi32(_mm256_set1_epi32(static_cast<int>(key)), salt), 27);
+    __m256i mask = _mm256_sllv_epi32(_mm256_set1_epi32(1), shift);
+    __m256i bits = _mm256_load_si256(reinterpret_cast<const __m256i*>(b.words));
+    return _mm256_testc_si256(bits, mask) != 0;   // every mask bit set
+}
+
+inline bool Avx2Supported() {
+#if defined(_MSC_VER) && !defined(__clang__)
+    int info[4];
+    __cpuid(info, 1);
+    bool osxsave = (info[2] & (1 << 27)) != 0;
+    if (!osxsave || (_xgetbv(0) & 6) != 6) return false;
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#else
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+#endif
+}
+#endif  // DCS_BLOOM_X86
+
+#if DCS_BLOOM_NEON
+inline bool TestNeon(const Block& b, uint32_t key) {
+    const uint32x4_t k = vdupq_n_u32(key);
+    const uint32x4_t one = vdupq_n_u32(1);
+    // (key * salt) >> 27, applied as a left shift of 1
+    int32x4_t s0 = vreinterpretq_s32_u32(vshrq_n_u32(vmulq_u32(k, vld1q_u32(kSalt)), 27));
+    int32x4_t s1 = vreinterpretq_s32_u32(vshrq_n_u32(vmulq_u32(k, vld1q_u32(kSalt + 4)), 27));
+    uint32x4_t m0 = vshlq_u32(one, s0), m1 = vshlq_u32(one, s1);
+    uint32x4_t miss0 = vbicq_u32(m0, vld1q_u32(b.words));       // mask bits not set
+    uint32x4_t miss1 = vbicq_u32(m1, vld1q_u32(b.words + 4));
+    return vmaxvq_u32(vorrq_u32(miss0, miss1)) == 0;
+}
+#endif  // DCS_BLOOM_NEON
+
+using TestFn = bool (*)(const Block&, uint32_t);
+
+/** Fastest probe this CPU runs; resolved on first use. */
+inline TestFn ActiveTest() {
+    static const TestFn fn = [] {
+#if DCS_BLOOM_X86
+        if (Avx2Supported()) return static_cast<TestFn>(&TestAvx2);
+#elif DCS_BLOOM_NEON
+        return static_cast<TestFn>(&TestNeon);
+#endif
+        return static_cast<TestFn>(&TestScalar);
+    }();
+    return fn;
+}
+
+}  // namespace bloom_detail
+
+// ──── Bloom Filter ─────────────────────────────────────────────
+class BloomFilter {
+public:
+    static constexpr uint32_t kBlockedMagic     = 0x314b4c42;   // "BLK1"
+    static constexpr int      kDefaultBitsPerKey = 10;
+
+    /** Empty filter sized for `num_keys` at `bits_per_key`; Add() them next. */
+    explicit BloomFilter(size_t num_keys, int bits_per_key = kDefaultBitsPerKey)
+        : blocks_(NumBlocks(num_keys, bits_per_key)) {}
+
+    /** Filter over a set of BloomHash() values. */
+    static BloomFilter FromHashes(const std::vector<uint64_t>& hashes, int bits_per_key) {
+        BloomFilter bf(hashes.size(), bits_per_key);
+        for (uint64_t h : hashes) bf.AddHash(h);
+        return bf;
+    }
+
+    BloomFilter() = default;
+
+    void Add(std::string_view key) { AddHash(BloomHash(key)); }
+
+    void AddHash(uint64_t h) {
+        if (blocks_.empty()) return;
+        uint32_t mask[8];
+        bloom_detail::MaskScalar(static_cast<uint32_t>(h), mask);
+        bloom_detail::Block& b = blocks_[BlockIndex(h)];
+        for (int i = 0; i < 8; ++i) b.words[i] |= mask[i];
+    }
+
+    bool MayContain(std::string_view key) const { return MayContain(key, BloomHash(key)); }
+
+    /** `hash` must be BloomHash(key); legacy filters re-hash the key. */
+    bool MayContain(std::string_view key, uint64_t hash) const {
+        if (!blocks_.empty()) return bloom_detail::ActiveTest()(blocks_[BlockIndex(hash)], static_cast<uint32_t>(hash));
+        if (!legacy_bits_.empty()) return LegacyMayContain(key);
+        return true;   // no filter: can't rule anything out
+    }
+
+    /** Pull the block `hash` maps to toward L1 ahead of MayContain(). */
+    void Prefetch(uint64_t hash) const {
+        if (blocks_.empty()) return;
+#if DCS_BLOOM_X86
+        _mm_prefetch(reinterpret_cast<const char*>(&blocks_[BlockIndex(hash)]), _MM_HINT_T0);
+#elif defined(__GNUC__) || defined(__clang__)
+        __builtin_prefetch(&blocks_[BlockIndex(hash)]);
+#endif
+    }
+
+    size_t SizeBytes() const { return blocks_.size() * sizeof(bloom_detail::Block) + legacy_bits_.size(); }
+    bool IsLegacy() const { return blocks_.empty() && !legacy_bits_.empty(); }
+
+    std::string Serialize() const {
+        std::string buf;
+        uint32_t magic = kBlockedMagic, n = static_cast<uint32_t>(blocks_.size());
+        buf.append(reinterpret_cast<const char*>(&magic), 4);
+        buf.append(reinterpret_cast<const char*>(&n), 4);
+        buf.append(reinterpret_cast<const char*>(blocks_.data()), n * sizeof(bloom_detail::Block));
+        return buf;
+    }
+
+    /** Parse either layout; false if `data` is malformed. */
+    static bool Deserialize(std::string_view data, BloomFilter& out) {
+        if (data.size() < 8) return false;
+        uint32_t tag, n;
+        std::memcpy(&tag, data.data(), 4);
+        std::memcpy(&n, data.data() + 4, 4);
+        out = BloomFilter();
+        if (tag == kBlockedMagic) {
+            if (n == 0 || n > (data.size() - 8) / sizeof(bloom_detail::Block)) return false;
+            out.blocks_.resize(n);
+            std::memcpy(out.blocks_.data(), data.data() + 8, n * sizeof(bloom_detail::Block));
+            return true;
+        }
+        if (tag == 0 || tag > 64 || n == 0 || n > data.size() - 8) return false;
+        out.legacy_hashes_ = static_cast<int>(tag);
+        out.legacy_bits_.assign(data.data() + 8, data.data() + 8 + n);
+        return true;
+    }
+
+private:
+    static size_t NumBlocks(size_t num_keys, int bits_per_key) {
+        size_t bits = std::max<size_t>(1, num_keys) * static_cast<size_t>(std::max(1, bits_per_key));
+        return std::max<size_t>(1, (bits + 255) / 256);
+    }
+
+    size_t BlockIndex(uint64_t h) const {
+        return static_cast<size_t>(((h >> 32) * blocks_.size()) >> 32);
+    }
+
+    // Pre-split-block filters: k independent passes over the key.
+    bool LegacyMayContain(std::string_view key) const {
+        size_t num_bits = legacy_bits_.size() * 8;
+        for (int i = 0; i < legacy_hashes_; i++) {
+            size_t h = static_cast<size_t>(i) * 0x9e3779b97f4a7c15ULL;
+            for (unsigned char c : key) {
+                h ^= c;
+                h *= 0x100000001b3ULL;
+            }
+            h %= num_bits;
+            if (!(legacy_bits_[h / 8] & (1u << (h % 8)))) return false;
+        }
+        return true;
+    }
+
+    std::vector<bloom_detail::Block> blocks_;
+    std::vector<uint8_t>             legacy_bits_;
+    int                              legacy_hashes_ = 0;
+};
+
+}  // namespace storage
+}  // namespace dcs
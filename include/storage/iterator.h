@@ -0,0 +1,110 @@
+#pragma once
+// ────────────────────────────────────────────────────────────────
+// Iterators over sorted key/value sources (SSTables, memtables) and
+// the k-way MergingIterator that combines them for compaction.
+// ────────────────────────────────────────────────────────────────
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace dcs {
+namespace storage {
+
+/**
+ * Forward iterator over one version of each key, in ascending key
+ * order.  key()/value() are only valid until the next move.
+ */
+class KVIterator {
+public:
+    virtual ~KVIterator() = default;
+
+    virtual bool Valid() const = 0;
+    virtual void SeekToFirst() = 0;
+    /** Position at the first key >= target. */
+    virtual void Seek(std::string_view target) = 0;
+    virtual void Next() = 0;
+
+    virtual std::string_view key()   const = 0;
+    virtual std::string_view value() const = 0;
+    /** True if the current entry is a tombstone. */
+    virtual bool IsDeletion() const = 0;
+};
+
+/**
+ * MergingIterator — k-way merge of child iterators ordered newest
+ * first.  Each key is yielded once, from the newest child that has
+ * it; older versions are skipped.  Tombstones are yielded too, so the
+ * caller decides whether they still need to shadow anything.
+ */
+class MergingIterator : public KVIterator {
+public:
+    explicit MergingIterator(std::vector<std::unique_ptr<KVIterator>> children)
+        : children_(std::move(children)) {}
+
+    bool Valid() const override { return !heap_.empty(); }
+
+    void SeekToFirst() override {
+        for (auto& c : children_) c->SeekToFirst();
+        BuildHeap();
+    }
+
+    void Seek(std::string_view target) override {
+        for (auto& c : children_) c->Seek(target);
+        BuildHeap();
+    }
+
+    void Next() override {
+        // Advance every child sitting on the current key, which also
+        // drops the older versions of it.
+        std::string_view current = Top()->key();
+        current_key_.assign(current.data(), current.size());
+        while (!heap_.empty() && Top()->key() == current_key_) {
+            std::pop_heap(heap_.begin(), heap_.end(), Greater{this});
+            size_t idx = heap_.back();
+            heap_.pop_back();
+            children_[idx]->Next();
+            if (children_[idx]->Valid()) {
+                heap_.push_back(idx);
+                std::push_heap(heap_.begin(), heap_.end(), Greater{this});
+            }
+        }
+    }
+
+    std::string_view key()   const override { return Top()->key(); }
+    std::string_view value() const override { return Top()->value(); }
+    bool IsDeletion()        const override { return Top()->IsDeletion(); }
+
+private:
+    // Min-heap on (key, child index): for equal keys the lower index,
+    // i.e. the newer source, surfaces first.
+    struct Greater {
+        const MergingIterator* self;
+        bool operator()(size_t a, size_t b) const {
+            int cmp = self->children_[a]->key().compare(self->children_[b]->key());
+            if (cmp != 0) return cmp > 0;
+            return a > b;
+        }
+    };
+
+    KVIterator* Top() const { return children_[heap_.front()].get(); }
+
+    void BuildHeap() {
+        heap_.clear();
+        for (size_t i = 0; i < children_.size(); i++) {
+            if (children_[i]->Valid()) heap_.push_back(i);
+        }
+        std::make_heap(heap_.begin(), heap_.end(), Greater{this});
+    }
+
+    std::vector<std::unique_ptr<KVIterator>> children_;
+    std::vector<size_t> heap_;
+    std::string         current_key_;
+};
+
+}  // namespace storage
+}  // namespace dcs
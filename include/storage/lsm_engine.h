@@ -3,19 +3,32 @@
 // LSM-Tree Engine: Log-Structured Merge-Tree storage backend.
 // Implements StorageBackend interface with WAL → MemTable → SSTable
 // pipeline and leveled compaction.
+//
+// Levels: L0 holds whole memtable flushes (overlapping, newest last);
+// L1..L3 each hold sorted, disjoint files of at most ~target_file_bytes.
+// A level is compacted into the next once it exceeds its byte target
+// (L1 = level1_target_bytes, each deeper level kLevelMultiplier x
+// larger, the bottom level unbounded) with a streaming k-way merge, so
+// memory use is a block per input file regardless of level size.
 // ────────────────────────────────────────────────────────────────
 
 #include <algorithm>
 #include <chrono>
 #include <cstdio>
+#include <cstdlib>
 #include <functional>
 #include <memory>
+#include <set>
 #include <string>
 #include <utility>
 #include <vector>
 
 #include "../compat/threading.h"
+#include "../metrics/latency.h"
 #include "../persistence/storage_backend.h"
+#include "block_cache.h"
+#include "iterator.h"
+#include "manifest.h"
 #include "memtable.h"
 #include "sstable.h"
 #include "wal.h"
@@ -46,17 +59,54 @@ struct LSMStats {
     compat::Atomic<uint64_t> total_gets{0};
     compat::Atomic<uint64_t> total_deletes{0};
     compat::Atomic<uint64_t> bloom_filter_hits{0};
+    WALStats                 wal;   // group-commit batches and sync latency
+
+    // SSTable data blocks written by flushes and compactions, before and
+    // after block compression, and the time spent compressing them
+    compat::Atomic<uint64_t> sst_block_raw_bytes{0};
+    compat::Atomic<uint64_t> sst_block_stored_bytes{0};
+    compat::Atomic<uint64_t> sst_compress_micros{0};
+
+    // load() latency by the tier that answered it (or a miss everywhere)
+    metrics::LatencyHistogram get_memtable;
+    metrics::LatencyHistogram get_immutable;
+    metrics::LatencyHistogram get_sst[4];          // L0..L3
+    metrics::LatencyHistogram get_miss;
+    metrics::LatencyHistogram compaction;          // one level into the next
+};
+
+struct LSMOptions {
+    size_t     block_cache_bytes = 8 * 1024 * 1024;
+    WALOptions wal;
+
+    // Compaction targets.  L0 is also compacted once it holds
+    // level0_max_files tables, since every L0 file costs a probe per read.
+    uint64_t   level0_target_bytes = 4 * 1024 * 1024;
+    size_t     level0_max_files    = 8;
+    uint64_t   level1_target_bytes = 10 * 1024 * 1024;
+    uint64_t   target_file_bytes   = 2 * 1024 * 1024;
+
+    // Bloom bits per key for tables written into each level (L0..L3).
+    // Every lookup probes all of L0 and one table per deeper level, and
+    // the small upper levels cost little extra memory, so they get more
+    // bits; the bottom level holds most keys and stays at the default.
+    int        bloom_bits_per_key[4] = {14, 12, 10, 10};
 };
 
 class LSMEngine : public persistence::StorageBackend {
 public:
     static constexpr int kMaxLevels      = 4;
-    static constexpr int kL0CompactTrig  = 2;
     static constexpr int kLevelMultiplier = 10;
+    static_assert(kMaxLevels == sizeof(LSMStats::get_sst) / sizeof(LSMStats::get_sst[0]),
+                  "one get_sst histogram per level");
+    static_assert(kMaxLevels == sizeof(LSMOptions::bloom_bits_per_key) / sizeof(int),
+                  "one bloom setting per level");
 
-    explicit LSMEngine(const std::string& data_dir)
-        : data_dir_(data_dir), sequence_(0), running_(false),
-          sstable_counter_(0) {
+    explicit LSMEngine(const std::string& data_dir,
+                       const LSMOptions& options = LSMOptions())
+        : data_dir_(data_dir), options_(options), sequence_(0), running_(false),
+          sstable_counter_(0), block_cache_(options.block_cache_bytes),
+          current_(std::make_shared<Version>()) {
         EnsureDir(data_dir_);
         EnsureDir(data_dir_ + "/wal");
         EnsureDir(data_dir_ + "/sst");
@@ -65,9 +115,10 @@ public:
             EnsureDir(level_dir);
         }
 
-        memtable_ = std::make_unique<MemTable>();
-        wal_ = std::make_unique<WALWriter>(data_dir_ + "/wal/current.wal");
+        memtable_ = std::make_shared<MemTable>();
         RecoverFromWAL();
+        wal_ = std::make_unique<WALWriter>(data_dir_ + "/wal/current.wal",
+                                           options_.wal, &stats_.wal);
         LoadSSTables();
         running_ = true;
         compact_thread_ = compat::Thread(&LSMEngine::CompactionLoop, this);
@@ -83,127 +134,474 @@ public:
     // ─── StorageBackend interface ──────────────────────────────
 
     persistence::LoadResult load(const std::string& key) override {
+        const uint64_t t0 = metrics::now_ns();
         stats_.total_gets++;
+        std::shared_ptr<MemTable> mem, imm;
+        SnapshotMemTables(mem, imm);
         // 1. Check active memtable
-        auto result = memtable_->Get(key);
+        auto result = mem->Get(key);
         if (result.found) {
+            stats_.get_memtable.record_since(t0);
             if (result.deleted) return persistence::LoadResult::Miss();
             return persistence::LoadResult::Hit(result.value);
         }
         // 2. Check immutable memtable
-        {
-            compat::LockGuard<compat::Mutex> lock(imm_mu_);
-            if (imm_memtable_) {
-                auto imm_result = imm_memtable_->Get(key);
-                if (imm_result.found) {
-                    if (imm_result.deleted) return persistence::LoadResult::Miss();
-                    return persistence::LoadResult::Hit(imm_result.value);
-                }
+        if (imm) {
+            auto imm_result = imm->Get(key);
+            if (imm_result.found) {
+                stats_.get_immutable.record_since(t0);
+                if (imm_result.deleted) return persistence::LoadResult::Miss();
+                return persistence::LoadResult::Hit(imm_result.value);
             }
         }
         // 3. Check SSTables (newest first, level by level)
-        compat::LockGuard<compat::Mutex> lock(sst_mu_);
-        for (int level = 0; level < kMaxLevels; level++) {
-            for (int i = static_cast<int>(levels_[level].size()) - 1; i >= 0; i--) {
-                std::string value;
-                if (levels_[level][i]->Get(key, value)) {
+        auto version = CurrentVersion();
+        std::string value;
+        int level = -1;
+        LookupStatus s = LookupSSTables(*version, key, value, &level);
+        if (s == LookupStatus::kNotFound) {
+            stats_.get_miss.record_since(t0);
+            return persistence::LoadResult::Miss();
+        }
+        stats_.get_sst[level].record_since(t0);
+        if (s != LookupStatus::kFound) return persistence::LoadResult::Miss();
+        stats_.bloom_filter_hits++;
+        return persistence::LoadResult::Hit(value);
+    }
+
+    // Same lookup order as load(), but each tier is searched for all keys
+    // still unresolved before moving on; one Version snapshot serves all.
+    std::vector<persistence::LoadResult> batch_load(const std::vector<std::string>& keys) override {
+        stats_.total_gets.fetch_add(static_cast<uint64_t>(keys.size()));
+        std::vector<persistence::LoadResult> out(keys.size(), persistence::LoadResult::Miss());
+        std::vector<size_t> pending;
+        pending.reserve(keys.size());
+        std::shared_ptr<MemTable> mem, imm;
+        SnapshotMemTables(mem, imm);
+
+        // 1. Active memtable
+        for (size_t i = 0; i < keys.size(); i++) {
+            auto result = mem->Get(keys[i]);
+            if (!result.found) pending.push_back(i);
+            else if (!result.deleted) out[i] = persistence::LoadResult::Hit(result.value);
+        }
+        // 2. Immutable memtable
+        if (!pending.empty() && imm) {
+            size_t kept = 0;
+            for (size_t i : pending) {
+                auto result = imm->Get(keys[i]);
+                if (!result.found) pending[kept++] = i;
+                else if (!result.deleted) out[i] = persistence::LoadResult::Hit(result.value);
+            }
+            pending.resize(kept);
+        }
+        // 3. SSTables (newest first, level by level)
+        if (!pending.empty()) {
+            auto version = CurrentVersion();
+            std::string value;
+            for (size_t i : pending) {
+                if (LookupSSTables(*version, keys[i], value) == LookupStatus::kFound) {
                     stats_.bloom_filter_hits++;
-                    return persistence::LoadResult::Hit(value);
+                    out[i] = persistence::LoadResult::Hit(value);
                 }
             }
         }
-        return persistence::LoadResult::Miss();
+        return out;
     }
 
+    // Writers hold write_mu_ shared from WAL append to memtable insert so
+    // a WAL rotation never splits a record from its memtable entry.  The
+    // sequence numbers they take stay in flight until the insert is done
+    // (see BeginWrite), which is what iterators snapshot against.
     bool store(const std::string& key, const std::string& value) override {
         stats_.total_puts++;
-        uint64_t seq = sequence_++;
-        WALRecord rec{WALRecordType::kPut, key, value, seq};
-        wal_->Append(rec);
-        memtable_->Put(key, value, seq);
-        stats_.memtable_size.store(memtable_->ApproximateSize());
-        stats_.memtable_entries.store(memtable_->EntryCount());
-        stats_.wal_bytes.store(wal_->BytesWritten());
+        bool ok;
+        {
+            compat::SharedLock<compat::SharedMutex> lock(write_mu_);
+            uint64_t seq = BeginWrite(1);
+            WALRecord rec{WALRecordType::kPut, key, value, seq};
+            ok = wal_->Append(rec);
+            auto mem = ActiveMemTable();
+            mem->Put(key, value, seq);
+            EndWrite(seq);
+            stats_.memtable_size.store(mem->ApproximateSize());
+            stats_.memtable_entries.store(mem->EntryCount());
+            stats_.wal_bytes.store(wal_->BytesWritten());
+        }
         MaybeScheduleFlush();
-        return true;
+        return ok;
     }
 
     bool remove(const std::string& key) override {
         stats_.total_deletes++;
-        uint64_t seq = sequence_++;
-        WALRecord rec{WALRecordType::kDelete, key, "", seq};
-        wal_->Append(rec);
-        memtable_->Delete(key, seq);
+        bool ok;
+        {
+            compat::SharedLock<compat::SharedMutex> lock(write_mu_);
+            uint64_t seq = BeginWrite(1);
+            WALRecord rec{WALRecordType::kDelete, key, "", seq};
+            ok = wal_->Append(rec);
+            ActiveMemTable()->Delete(key, seq);
+            EndWrite(seq);
+        }
         MaybeScheduleFlush();
-        return true;
+        return ok;
     }
 
     bool batch_store(const std::vector<std::pair<std::string, std::string>>& entries) override {
         std::vector<WALRecord> wal_batch;
         wal_batch.reserve(entries.size());
-        for (const auto& e : entries) {
-            uint64_t seq = sequence_++;
-            wal_batch.push_back({WALRecordType::kPut, e.first, e.second, seq});
-        }
-        wal_->AppendBatch(wal_batch);
-        for (size_t i = 0; i < entries.size(); i++) {
-            memtable_->Put(entries[i].first, entries[i].second, wal_batch[i].sequence);
+        bool ok;
+        {
+            compat::SharedLock<compat::SharedMutex> lock(write_mu_);
+            uint64_t first = BeginWrite(entries.size());
+            for (const auto& e : entries) {
+                wal_batch.push_back({WALRecordType::kPut, e.first, e.second, first + wal_batch.size()});
+            }
+            ok = wal_->AppendBatch(wal_batch);
+            auto mem = ActiveMemTable();
+            for (size_t i = 0; i < entries.size(); i++) {
+                mem->Put(entries[i].first, entries[i].second, wal_batch[i].sequence);
+            }
+            EndWrite(first);
+            stats_.memtable_size.store(mem->ApproximateSize());
+            stats_.memtable_entries.store(mem->EntryCount());
+            stats_.wal_bytes.store(wal_->BytesWritten());
         }
         stats_.total_puts.fetch_add(static_cast<uint64_t>(entries.size()));
-        stats_.memtable_size.store(memtable_->ApproximateSize());
-        stats_.memtable_entries.store(memtable_->EntryCount());
-        stats_.wal_bytes.store(wal_->BytesWritten());
         MaybeScheduleFlush();
-        return true;
+        return ok;
     }
 
     bool ping() override { return running_; }
 
+    bool scan(const std::string& after, const std::string& prefix, size_t limit,
+              std::vector<std::string>& keys, bool& done) override {
+        auto it = NewIterator();
+        it->Seek(std::max(after, prefix));
+        if (it->Valid() && !after.empty() && it->key() == after) it->Next();
+        size_t added = 0;
+        for (; it->Valid() && added < limit; it->Next()) {
+            if (it->key().compare(0, prefix.size(), prefix) != 0) break;
+            keys.emplace_back(it->key());
+            added++;
+        }
+        done = !it->Valid() || it->key().compare(0, prefix.size(), prefix) != 0;
+        return true;
+    }
+
+    // ─── Iteration ─────────────────────────────────────────────
+
+    /**
+     * Ordered iterator over live keys as of one sequence number: the
+     * memtables are read at that snapshot and the SSTable Version in
+     * force at the time is pinned, so flushes and compactions running
+     * meanwhile don't change what it sees.  Tombstones are skipped.
+     */
+    std::unique_ptr<KVIterator> NewIterator() const {
+        std::shared_ptr<MemTable> mem, imm;
+        uint64_t snapshot;
+        // Every entry below the visible sequence is in a memtable already;
+        // writers past it (possibly in a WAL sync) are not waited for.  The
+        // memtables are taken after it, so a rotation in between moves
+        // such entries to imm rather than out of sight.
+        snapshot = VisibleSequence();
+        SnapshotMemTables(mem, imm);
+        // Version after memtables: a flush finishing in between shows up
+        // twice (harmless) rather than not at all.
+        return std::unique_ptr<KVIterator>(
+            new SnapshotIterator(std::move(mem), std::move(imm), CurrentVersion(), snapshot));
+    }
+
     // ─── Statistics ────────────────────────────────────────────
 
     const LSMStats& Stats() const { return stats_; }
 
-    // Force a compaction (for demo purposes)
+    void collect_latency(metrics::LatencyReport& out) const override {
+        static const char* const kLevelNames[kMaxLevels] = {
+            "lsm_get_l0", "lsm_get_l1", "lsm_get_l2", "lsm_get_l3"};
+        out.emplace_back("lsm_get_memtable", stats_.get_memtable.snapshot());
+        out.emplace_back("lsm_get_immutable", stats_.get_immutable.snapshot());
+        for (int l = 0; l < kMaxLevels; l++) out.emplace_back(kLevelNames[l], stats_.get_sst[l].snapshot());
+        out.emplace_back("lsm_get_miss", stats_.get_miss.snapshot());
+        out.emplace_back("wal_append", stats_.wal.append_latency.snapshot());
+        out.emplace_back("lsm_compaction", stats_.compaction.snapshot());
+    }
+    const LSMOptions& Options() const { return options_; }
+    const BlockCache& GetBlockCache() const { return block_cache_; }
+
+    // Flush everything, merge all of L0 into L1, then compact any level
+    // still over its target (for demo purposes and tests)
     void ForceCompaction() {
         {
             compat::LockGuard<compat::Mutex> lock(imm_mu_);
-            if (memtable_->EntryCount() > 0) {
-                imm_memtable_ = std::move(memtable_);
-                memtable_ = std::make_unique<MemTable>();
-                flush_pending_ = true;
+            if (imm_memtable_) DoFlush();
+            if (!imm_memtable_ && memtable_->EntryCount() > 0) {
+                RotateMemTableAndLog();
+                DoFlush();
             }
-            if (flush_pending_ && imm_memtable_) DoFlush();
         }
-        bool needs = false;
-        { compat::LockGuard<compat::Mutex> lock(sst_mu_); needs = !levels_[0].empty(); }
-        if (needs) { CompactLevel(0); stats_.compactions_done++; }
+        if (!CurrentVersion()->levels[0].empty()) CompactLevel(0);
+        while (CompactMostOverfull()) {}
     }
 
     size_t SSTCountAtLevel(int level) const {
         if (level < 0 || level >= kMaxLevels) return 0;
-        return levels_[level].size();
+        return CurrentVersion()->levels[level].size();
     }
 
     size_t TotalSSTCount() const {
-        size_t total = 0;
-        for (int i = 0; i < kMaxLevels; i++) total += levels_[i].size();
-        return total;
+        return CurrentVersion()->TotalFiles();
+    }
+
+    uint64_t LevelBytes(int level) const {
+        if (level < 0 || level >= kMaxLevels) return 0;
+        return CurrentVersion()->LevelBytes(level);
+    }
+
+    /** Bloom filter memory of a level's opened tables. */
+    uint64_t FilterBytes(int level) const {
+        if (level < 0 || level >= kMaxLevels) return 0;
+        uint64_t bytes = 0;
+        for (const auto& f : CurrentVersion()->levels[level]) bytes += f->FilterBytes();
+        return bytes;
     }
 
 private:
+    // An immutable snapshot of the SSTable set.  Readers copy the pointer
+    // under sst_mu_ and search without a lock; flushes and compactions
+    // build a new Version and swap it in, so sst_mu_ only ever guards a
+    // pointer copy.  Retired tables stay open until the last reader drops
+    // its snapshot.
+    struct Version {
+        std::vector<std::shared_ptr<SSTableReader>> levels[kMaxLevels];
+
+        size_t TotalFiles() const {
+            size_t total = 0;
+            for (const auto& files : levels) total += files.size();
+            return total;
+        }
+
+        uint64_t LevelBytes(int level) const {
+            uint64_t bytes = 0;
+            for (const auto& f : levels[level]) bytes += f->FileSize();
+            return bytes;
+        }
+    };
+
+    // Concatenates a level's sorted, disjoint files, opening one table
+    // iterator at a time, so a seek costs one block read per level
+    // rather than one per file.
+    class LevelIterator : public KVIterator {
+    public:
+        explicit LevelIterator(const std::vector<std::shared_ptr<SSTableReader>>& files)
+            : files_(files), index_(0) {}
+
+        bool Valid() const override { return current_ && current_->Valid(); }
+        void SeekToFirst() override {
+            Open(0);
+            if (current_) current_->SeekToFirst();
+            SkipExhausted();
+        }
+        void Seek(std::string_view target) override {
+            auto it = std::lower_bound(files_.begin(), files_.end(), target,
+                [](const std::shared_ptr<SSTableReader>& f, std::string_view t) {
+                    return std::string_view(f->LargestKey()) < t;
+                });
+            Open(static_cast<size_t>(it - files_.begin()));
+            if (current_) current_->Seek(target);
+            SkipExhausted();
+        }
+        void Next() override { current_->Next(); SkipExhausted(); }
+        std::string_view key()   const override { return current_->key(); }
+        std::string_view value() const override { return current_->value(); }
+        bool IsDeletion()        const override { return current_->IsDeletion(); }
+
+    private:
+        void Open(size_t index) {
+            index_ = index;
+            current_ = index_ < files_.size() ? files_[index_]->NewIterator() : nullptr;
+        }
+
+        void SkipExhausted() {
+            while (current_ && !current_->Valid()) {
+                Open(index_ + 1);
+                if (current_) current_->SeekToFirst();
+            }
+        }
+
+        const std::vector<std::shared_ptr<SSTableReader>>& files_;
+        size_t                      index_;
+        std::unique_ptr<KVIterator> current_;
+    };
+
+    // Merges memtables and every SSTable newest-first (see NewIterator),
+    // owning what it reads from and hiding tombstones.
+    class SnapshotIterator : public KVIterator {
+    public:
+        SnapshotIterator(std::shared_ptr<MemTable> mem, std::shared_ptr<MemTable> imm,
+                         std::shared_ptr<const Version> version, uint64_t snapshot)
+            : mem_(std::move(mem)), imm_(std::move(imm)), version_(std::move(version)),
+              merged_(Children(*mem_, imm_.get(), *version_, snapshot)) {}
+
+        bool Valid() const override { return merged_.Valid(); }
+        void SeekToFirst() override { merged_.SeekToFirst(); SkipDeleted(); }
+        void Seek(std::string_view target) override { merged_.Seek(target); SkipDeleted(); }
+        void Next() override { merged_.Next(); SkipDeleted(); }
+        std::string_view key()   const override { return merged_.key(); }
+        std::string_view value() const override { return merged_.value(); }
+        bool IsDeletion()        const override { return false; }
+
+    private:
+        static std::vector<std::unique_ptr<KVIterator>> Children(
+                const MemTable& mem, const MemTable* imm, const Version& v, uint64_t snapshot) {
+            std::vector<std::unique_ptr<KVIterator>> children;
+            // Sequence numbers below the snapshot are all < sequence_ at
+            // snapshot time, hence the strict bound.
+            uint64_t visible = snapshot ? snapshot - 1 : 0;
+            children.push_back(mem.NewIterator(visible));
+            if (imm) children.push_back(imm->NewIterator(visible));
+            for (auto it = v.levels[0].rbegin(); it != v.levels[0].rend(); ++it) {
+                children.push_back((*it)->NewIterator());
+            }
+            for (int level = 1; level < kMaxLevels; level++) {
+                if (!v.levels[level].empty()) {
+                    children.push_back(std::unique_ptr<KVIterator>(new LevelIterator(v.levels[level])));
+                }
+            }
+            return children;
+        }
+
+        void SkipDeleted() {
+            while (merged_.Valid() && merged_.IsDeletion()) merged_.Next();
+        }
+
+        std::shared_ptr<MemTable>      mem_;
+        std::shared_ptr<MemTable>      imm_;
+        std::shared_ptr<const Version> version_;
+        MergingIterator                merged_;
+    };
+
+    std::shared_ptr<const Version> CurrentVersion() const {
+        compat::LockGuard<compat::Mutex> lock(sst_mu_);
+        return current_;
+    }
+
+    void InstallVersion(std::shared_ptr<const Version> v) {
+        size_t files = v->TotalFiles();
+        {
+            compat::LockGuard<compat::Mutex> lock(sst_mu_);
+            current_ = std::move(v);
+        }
+        stats_.sstable_count.store(files);
+    }
+
+    // L0 is searched newest-first; deeper levels are disjoint, so at most
+    // one file per level can hold the key.  A tombstone ends the search.
+    // `found_level`, if given, is set to the level that answered.
+    //
+    // The key is hashed once for every filter.  Candidate tables (each
+    // overlapping L0 file, at most one per deeper level) are found first
+    // and their filter blocks prefetched together, so a negative lookup
+    // waits on those cache misses in parallel rather than one by one;
+    // a level whose candidate's filter says no is skipped without
+    // touching its index or data.
+    static LookupStatus LookupSSTables(const Version& v, const std::string& key,
+                                       std::string& value, int* found_level = nullptr) {
+        const uint64_t hash = BloomHash(key);
+        const SSTableReader* deeper[kMaxLevels] = {};
+        for (int level = 1; level < kMaxLevels; level++) {
+            const auto& files = v.levels[level];
+            auto it = std::lower_bound(files.begin(), files.end(), key,
+                [](const std::shared_ptr<SSTableReader>& f, const std::string& k) {
+                    return f->LargestKey() < k;
+                });
+            if (it == files.end() || (*it)->SmallestKey() > key) continue;
+            deeper[level] = it->get();
+            deeper[level]->PrefetchFilter(hash);
+        }
+        const auto& l0 = v.levels[0];
+        for (const auto& f : l0) {
+            if (f->Overlaps(key, key)) f->PrefetchFilter(hash);
+        }
+
+        for (auto it = l0.rbegin(); it != l0.rend(); ++it) {
+            if (!(*it)->Overlaps(key, key)) continue;
+            LookupStatus s = (*it)->Lookup(key, hash, value);
+            if (s != LookupStatus::kNotFound) {
+                if (found_level) *found_level = 0;
+                return s;
+            }
+        }
+        for (int level = 1; level < kMaxLevels; level++) {
+            if (!deeper[level]) continue;
+            LookupStatus s = deeper[level]->Lookup(key, hash, value);
+            if (s != LookupStatus::kNotFound) {
+                if (found_level) *found_level = level;
+                return s;
+            }
+        }
+        return LookupStatus::kNotFound;
+    }
+
+    // memtable_/imm_memtable_ are swapped under imm_mu_ (which also
+    // serialises flushes) and read through a short mem_mu_ snapshot, so
+    // readers never wait behind a flush in progress.
+    void SnapshotMemTables(std::shared_ptr<MemTable>& mem, std::shared_ptr<MemTable>& imm) const {
+        compat::LockGuard<compat::Mutex> lock(mem_mu_);
+        mem = memtable_;
+        imm = imm_memtable_;
+    }
+
+    /**
+     * Reserve `n` consecutive sequence numbers for one write, in flight
+     * until EndWrite(first) once they are all in the memtable.
+     */
+    uint64_t BeginWrite(size_t n) {
+        compat::LockGuard<compat::Mutex> lock(visible_mu_);
+        uint64_t first = sequence_.fetch_add(n);
+        in_flight_.insert(first);
+        return first;
+    }
+
+    void EndWrite(uint64_t first) {
+        compat::LockGuard<compat::Mutex> lock(visible_mu_);
+        in_flight_.erase(in_flight_.find(first));
+    }
+
+    /** Lowest sequence number not yet in a memtable: all below it are. */
+    uint64_t VisibleSequence() const {
+        compat::LockGuard<compat::Mutex> lock(visible_mu_);
+        return in_flight_.empty() ? sequence_.load() : *in_flight_.begin();
+    }
+
+    std::shared_ptr<MemTable> ActiveMemTable() const {
+        compat::LockGuard<compat::Mutex> lock(mem_mu_);
+        return memtable_;
+    }
+
+    // imm_mu_ must be held by caller
+    void RotateMemTable() {
+        auto fresh = std::make_shared<MemTable>();
+        compat::LockGuard<compat::Mutex> lock(mem_mu_);
+        imm_memtable_ = std::move(memtable_);
+        memtable_ = std::move(fresh);
+    }
+
+    // imm_mu_ must be held by caller.  The old log covers exactly the
+    // immutable memtable and is deleted once that reaches an SSTable, so
+    // current.wal only ever holds unflushed writes.
+    void RotateMemTableAndLog() {
+        compat::UniqueLock<compat::SharedMutex> writers(write_mu_);
+        RotateMemTable();
+        wal_->Rotate(data_dir_ + "/wal/rotating_" +
+                     std::to_string(sequence_.load()) + ".wal");
+    }
+
     void MaybeScheduleFlush() {
-        if (memtable_->ShouldFlush()) {
+        if (ActiveMemTable()->ShouldFlush()) {
             compat::LockGuard<compat::Mutex> lock(imm_mu_);
             if (!imm_memtable_) {
-                imm_memtable_ = std::move(memtable_);
-                memtable_ = std::make_unique<MemTable>();
-                // Rotate WAL
-                wal_->Close();
-                std::string old_wal = data_dir_ + "/wal/current.wal";
-                std::string new_wal = data_dir_ + "/wal/rotating_" +
-                    std::to_string(sequence_.load()) + ".wal";
-                std::rename(old_wal.c_str(), new_wal.c_str());
-                wal_ = std::make_unique<WALWriter>(data_dir_ + "/wal/current.wal");
+                RotateMemTableAndLog();
                 flush_pending_ = true;
             }
         }
@@ -212,36 +610,73 @@ private:
     void FlushMemTable() {
         compat::LockGuard<compat::Mutex> lock(imm_mu_);
         if (!imm_memtable_ && memtable_->EntryCount() > 0) {
-            imm_memtable_ = std::move(memtable_);
-            memtable_ = std::make_unique<MemTable>();
+            RotateMemTableAndLog();
         }
         if (imm_memtable_) {
             DoFlush();
         }
     }
 
+    void NoteTableWritten(const SSTableWriter& w) {
+        stats_.sst_block_raw_bytes.fetch_add(w.DataBytesRaw());
+        stats_.sst_block_stored_bytes.fetch_add(w.DataBytesStored());
+        stats_.sst_compress_micros.fetch_add(w.CompressNanos() / 1000);
+    }
+
     void DoFlush() {
         // imm_mu_ must be held by caller
         if (!imm_memtable_) return;
         uint64_t counter = sstable_counter_++;
         std::string sst_path = data_dir_ + "/sst/L0/sst_" +
             std::to_string(counter) + ".sst";
-        SSTableWriter writer(sst_path);
+        SSTableOptions opts;
+        opts.expected_entries = imm_memtable_->EntryCount();
+        opts.bloom_bits_per_key = options_.bloom_bits_per_key[0];
+        SSTableWriter writer(sst_path, opts);
+        // ForEach yields the newest version of each key first; older
+        // versions are dropped.  Deletes are kept as tombstones so they
+        // still shadow values in older tables.
+        std::string prev_key;
+        bool has_prev = false;
         imm_memtable_->ForEach([&](const InternalKey& ik, const std::string& val) {
+            if (has_prev && ik.key == prev_key) return;
+            prev_key = ik.key;
+            has_prev = true;
             if (ik.type == ValueType::kValue) {
                 writer.Add(ik.key, val);
+            } else {
+                writer.AddDeletion(ik.key);
             }
         });
-        writer.Finish();
+        bool written = writer.Finish();
+        NoteTableWritten(writer);
+        if (written && writer.EntryCount() > 0) {
+            auto reader = std::make_shared<SSTableReader>(sst_path, &block_cache_);
+            if (!reader->Valid()) {
+                written = false;
+            } else {
+                compat::LockGuard<compat::Mutex> lock(sst_mu_);
+                auto next = std::make_shared<Version>(*current_);
+                next->levels[0].push_back(std::move(reader));
+                current_ = next;
+                stats_.sstable_count.store(next->TotalFiles());
+            }
+        } else {
+            std::remove(sst_path.c_str());
+        }
+        if (!written) {
+            // Keep the memtable (and its log); the compaction loop retries
+            std::remove(sst_path.c_str());
+            return;
+        }
         {
-            compat::LockGuard<compat::Mutex> lock(sst_mu_);
-            levels_[0].push_back(std::make_shared<SSTableReader>(sst_path));
-            stats_.sstable_count.store(TotalSSTCount());
+            // Readers holding a snapshot keep the memtable alive until done
+            compat::LockGuard<compat::Mutex> lock(mem_mu_);
+            imm_memtable_.reset();
         }
-        imm_memtable_.reset();
         flush_pending_ = false;
-        // Delete rotated WAL files
-        CleanupRotatedWALs();
+        // The rotated log may only go once the MANIFEST lists the table
+        if (PersistManifest()) CleanupRotatedWALs();
     }
 
     void CompactionLoop() {
@@ -253,123 +688,362 @@ private:
                 }
             }
 
-            // Check if L0 compaction needed
-            bool needs_compact = false;
-            {
-                compat::LockGuard<compat::Mutex> lock(sst_mu_);
-                needs_compact = (levels_[0].size() >= static_cast<size_t>(kL0CompactTrig));
-            }
-            if (needs_compact) {
-                CompactLevel(0);
-                stats_.compactions_done++;
-            }
+            while (running_ && CompactMostOverfull()) {}
             compat::this_thread::sleep_for(std::chrono::milliseconds(100));
         }
     }
 
-    void CompactLevel(int level) {
-        if (level >= kMaxLevels - 1) return;
-        compat::LockGuard<compat::Mutex> lock(sst_mu_);
-        if (levels_[level].empty()) return;
-
-        // Merge SSTables: collect keys only (not values) to reduce memory
-        // Use a map of key → (level, sst_index) to track which SSTable has each key
-        std::unordered_map<std::string, std::pair<int, int>> key_source;
-        for (int i = 0; i < (int)levels_[level].size(); i++) {
-            auto keys = levels_[level][i]->AllKeys();
-            for (auto& key : keys) {
-                key_source[std::move(key)] = {level, i};
+    // ──── Compaction ────────────────────────────────────────────
+
+    uint64_t TargetBytes(int level) const {
+        if (level == 0) return options_.level0_target_bytes;
+        uint64_t target = options_.level1_target_bytes;
+        for (int i = 1; i < level; i++) target *= kLevelMultiplier;
+        return target;
+    }
+
+    // Level whose size is furthest over its target, or -1 if all fit.
+    // The bottom level has no target.
+    int PickCompactionLevel() const {
+        auto v = CurrentVersion();
+        int best = -1;
+        double best_score = 1.0;
+        for (int level = 0; level < kMaxLevels - 1; level++) {
+            double score = static_cast<double>(v->LevelBytes(level)) /
+                           static_cast<double>(std::max<uint64_t>(TargetBytes(level), 1));
+            if (level == 0 && options_.level0_max_files > 0) {
+                score = std::max(score, static_cast<double>(v->levels[0].size()) /
+                                        static_cast<double>(options_.level0_max_files));
+            }
+            if (score >= best_score) {
+                best_score = score;
+                best = level;
             }
         }
-        for (int i = 0; i < (int)levels_[level + 1].size(); i++) {
-            auto keys = levels_[level + 1][i]->AllKeys();
-            for (auto& key : keys) {
-                if (key_source.find(key) == key_source.end()) {
-                    key_source[std::move(key)] = {level + 1, i};
-                }
+        return best;
+    }
+
+    /**
+     * Merges `level` into `level + 1`.  L0 contributes all of its files
+     * (they overlap each other); deeper levels contribute one file,
+     * picked round-robin through the key space.  Returns false if there
+     * was nothing to do or the output could not be written.
+     */
+    bool CompactLevel(int level) {
+        compat::LockGuard<compat::Mutex> compact_lock(compact_mu_);
+        return CompactLevelLocked(level);
+    }
+
+    // The pick is made under compact_mu_ too: picked outside it, a level
+    // another compactor empties meanwhile reads as "nothing to do" and
+    // ends the caller's loop with other levels still over target.
+    bool CompactMostOverfull() {
+        compat::LockGuard<compat::Mutex> compact_lock(compact_mu_);
+        return CompactLevelLocked(PickCompactionLevel());
+    }
+
+    bool CompactLevelLocked(int level) {
+        if (level < 0 || level >= kMaxLevels - 1) return false;
+        const uint64_t t0 = metrics::now_ns();
+        // Flushes may add L0 files meanwhile; nothing else changes the
+        // levels while compact_mu_ is held, so the snapshot stays exact
+        // for everything except L0 additions.
+        auto base = CurrentVersion();
+        const int out_level = level + 1;
+
+        std::vector<std::shared_ptr<SSTableReader>> inputs;
+        if (level == 0) {
+            inputs.assign(base->levels[0].rbegin(), base->levels[0].rend());   // newest first
+        } else {
+            const auto& files = base->levels[level];
+            if (files.empty()) return false;
+            size_t pick = 0;
+            while (pick < files.size() && !compact_pointer_[level].empty() &&
+                   files[pick]->SmallestKey() <= compact_pointer_[level]) {
+                pick++;
             }
+            if (pick == files.size()) pick = 0;
+            inputs.push_back(files[pick]);
+            compact_pointer_[level] = files[pick]->LargestKey();
         }
+        if (inputs.empty()) return false;
 
-        // Write merged SSTable by streaming values from source SSTables
-        uint64_t counter = sstable_counter_++;
-        std::string sst_path = data_dir_ + "/sst/L" + std::to_string(level + 1) +
-            "/sst_" + std::to_string(counter) + ".sst";
-        SSTableWriter writer(sst_path);
-        for (const auto& ks : key_source) {
-            std::string val;
-            auto& src = levels_[ks.second.first][ks.second.second];
-            if (src->Get(ks.first, val)) {
-                writer.Add(ks.first, val);
+        std::string lo = inputs[0]->SmallestKey(), hi = inputs[0]->LargestKey();
+        for (const auto& f : inputs) {
+            if (f->SmallestKey() < lo) lo = f->SmallestKey();
+            if (f->LargestKey() > hi) hi = f->LargestKey();
+        }
+        for (const auto& f : base->levels[out_level]) {
+            if (f->Overlaps(lo, hi)) inputs.push_back(f);
+        }
+
+        std::vector<std::unique_ptr<KVIterator>> children;
+        children.reserve(inputs.size());
+        for (const auto& f : inputs) children.push_back(f->NewIterator());
+        MergingIterator merged(std::move(children));
+
+        std::vector<std::string> out_paths;
+        SSTableOptions out_opts;
+        out_opts.bloom_bits_per_key = options_.bloom_bits_per_key[out_level];
+        std::unique_ptr<SSTableWriter> writer;
+        bool ok = true;
+        auto finish_output = [&]() {
+            if (!writer) return;
+            if (!writer->Finish()) ok = false;
+            NoteTableWritten(*writer);
+            writer.reset();
+        };
+        for (merged.SeekToFirst(); merged.Valid() && ok; merged.Next()) {
+            std::string key(merged.key());
+            // The newest version wins inside the merge; a tombstone is
+            // only needed while something below the output may hold the key.
+            if (merged.IsDeletion() && !DeeperLevelsMayContain(*base, out_level, key)) continue;
+            if (!writer) {
+                out_paths.push_back(data_dir_ + "/sst/L" + std::to_string(out_level) +
+                                    "/sst_" + std::to_string(sstable_counter_++) + ".sst");
+                writer.reset(new SSTableWriter(out_paths.back(), out_opts));
             }
+            ok = merged.IsDeletion() ? writer->AddDeletion(key)
+                                     : writer->Add(key, std::string(merged.value()));
+            if (ok && writer->FileSize() >= options_.target_file_bytes) finish_output();
         }
-        writer.Finish();
-        key_source.clear();  // Free memory before loading new reader
+        finish_output();
 
-        // Remove old SSTables (delete files)
-        for (auto& sst : levels_[level]) {
-            std::remove(sst->Filepath().c_str());
+        std::vector<std::shared_ptr<SSTableReader>> outputs;
+        for (const auto& path : out_paths) {
+            if (!ok) break;
+            auto reader = std::make_shared<SSTableReader>(path, &block_cache_);
+            if (!reader->Valid()) ok = false;
+            else outputs.push_back(std::move(reader));
         }
-        for (auto& sst : levels_[level + 1]) {
-            std::remove(sst->Filepath().c_str());
+        if (!ok) {
+            for (const auto& path : out_paths) std::remove(path.c_str());
+            return false;
         }
-        levels_[level].clear();
-        levels_[level + 1].clear();
-        levels_[level + 1].push_back(std::make_shared<SSTableReader>(sst_path));
-        stats_.sstable_count.store(TotalSSTCount());
+
+        // Install: re-read current_ so L0 files flushed meanwhile are kept.
+        {
+            compat::LockGuard<compat::Mutex> lock(sst_mu_);
+            auto next = std::make_shared<Version>(*current_);
+            auto is_input = [&](const std::shared_ptr<SSTableReader>& f) {
+                return std::find(inputs.begin(), inputs.end(), f) != inputs.end();
+            };
+            for (int l : {level, out_level}) {
+                auto& files = next->levels[l];
+                files.erase(std::remove_if(files.begin(), files.end(), is_input), files.end());
+            }
+            auto& dest = next->levels[out_level];
+            dest.insert(dest.end(), outputs.begin(), outputs.end());
+            std::sort(dest.begin(), dest.end(),
+                [](const std::shared_ptr<SSTableReader>& a, const std::shared_ptr<SSTableReader>& b) {
+                    return a->SmallestKey() < b->SmallestKey();
+                });
+            current_ = next;
+            stats_.sstable_count.store(next->TotalFiles());
+        }
+        // Open readers keep their handles; the names can go once the
+        // MANIFEST no longer lists them.
+        if (PersistManifest()) {
+            for (const auto& f : inputs) std::remove(f->Filepath().c_str());
+        }
+        stats_.compactions_done++;
+        stats_.compaction.record_since(t0);
+        return true;
+    }
+
+    static bool DeeperLevelsMayContain(const Version& v, int out_level, const std::string& key) {
+        for (int l = out_level + 1; l < kMaxLevels; l++) {
+            const auto& files = v.levels[l];
+            auto it = std::lower_bound(files.begin(), files.end(), key,
+                [](const std::shared_ptr<SSTableReader>& f, const std::string& k) {
+                    return f->LargestKey() < k;
+                });
+            if (it != files.end() && (*it)->SmallestKey() <= key) return true;
+        }
+        return false;
     }
 
     void RecoverFromWAL() {
-        std::string wal_path = data_dir_ + "/wal/current.wal";
-        WALReader reader(wal_path);
-        reader.Replay([this](const WALRecord& rec) {
-            if (rec.sequence >= sequence_) sequence_ = rec.sequence + 1;
-            if (rec.type == WALRecordType::kPut) {
-                memtable_->Put(rec.key, rec.value, rec.sequence);
-            } else if (rec.type == WALRecordType::kDelete) {
-                memtable_->Delete(rec.key, rec.sequence);
-            }
+        // Rotated logs whose memtable never reached an SSTable, plus the
+        // current one.  Memtable order is by sequence and inserts may run
+        // concurrently, so the logs are replayed in parallel.
+        std::vector<std::string> logs = ListRotatedWALs();
+        logs.push_back(data_dir_ + "/wal/current.wal");
+        std::vector<uint64_t> next_seq(logs.size(), 0);
+        ParallelFor(logs.size(), [&](size_t i) {
+            WALReader reader(logs[i]);
+            reader.Replay([&](const WALRecord& rec) {
+                if (rec.sequence >= next_seq[i]) next_seq[i] = rec.sequence + 1;
+                if (rec.type == WALRecordType::kPut) {
+                    memtable_->Put(rec.key, rec.value, rec.sequence);
+                } else if (rec.type == WALRecordType::kDelete) {
+                    memtable_->Delete(rec.key, rec.sequence);
+                }
+            });
         });
+        for (uint64_t seq : next_seq) {
+            if (seq > sequence_) sequence_ = seq;
+        }
+    }
+
+    std::vector<std::string> ListRotatedWALs() const {
+        std::vector<std::string> paths;
+        std::string dir = data_dir_ + "/wal";
+#ifdef _WIN32
+        struct _finddata_t fileinfo;
+        std::string pattern = dir + "/rotating_*.wal";
+        intptr_t handle = _findfirst(pattern.c_str(), &fileinfo);
+        if (handle == -1) return paths;
+        do {
+            paths.push_back(dir + "/" + fileinfo.name);
+        } while (_findnext(handle, &fileinfo) == 0);
+        _findclose(handle);
+#else
+        DIR* d = opendir(dir.c_str());
+        if (!d) return paths;
+        struct dirent* entry;
+        while ((entry = readdir(d)) != nullptr) {
+            std::string name(entry->d_name);
+            if (name.rfind("rotating_", 0) == 0 && name.size() > 4 &&
+                name.substr(name.size() - 4) == ".wal") {
+                paths.push_back(dir + "/" + name);
+            }
+        }
+        closedir(d);
+#endif
+        return paths;
     }
 
+    // With a MANIFEST the live tables are known up front and are opened
+    // lazily on first use; anything else in the sst directories is output
+    // of a flush or compaction that never got installed and is removed.
+    // Without one (first start, or a tree from before manifests) every
+    // table is opened on a thread pool and a manifest is written.
     void LoadSSTables() {
-        // Scan sst directories for existing files
-        // On Windows we use _findfirst/_findnext pattern
+        auto v = std::make_shared<Version>();
+        uint64_t max_counter = 0;
+        Manifest manifest;
+        if (ReadManifest(ManifestPath(), manifest)) {
+            std::vector<std::string> live[kMaxLevels];
+            for (const auto& f : manifest.files) {
+                if (f.level < 0 || f.level >= kMaxLevels) continue;
+                std::string path = LevelDir(f.level) + "/" + f.name;
+                if (DCS_ACCESS(path.c_str()) != 0) continue;
+                v->levels[f.level].push_back(
+                    std::make_shared<SSTableReader>(path, &block_cache_, f.meta));
+                live[f.level].push_back(f.name);
+            }
+            for (int level = 0; level < kMaxLevels; level++) {
+                for (const auto& name : ListSSTFiles(LevelDir(level))) {
+                    if (std::find(live[level].begin(), live[level].end(), name) == live[level].end()) {
+                        std::remove((LevelDir(level) + "/" + name).c_str());
+                    }
+                }
+            }
+            max_counter = manifest.counter;
+            if (manifest.sequence > sequence_) sequence_ = manifest.sequence;
+        } else {
+            std::vector<std::pair<int, std::string>> paths;
+            for (int level = 0; level < kMaxLevels; level++) {
+                for (const auto& name : ListSSTFiles(LevelDir(level))) {
+                    paths.emplace_back(level, LevelDir(level) + "/" + name);
+                }
+            }
+            std::vector<std::shared_ptr<SSTableReader>> readers(paths.size());
+            ParallelFor(paths.size(), [&](size_t i) {
+                readers[i] = std::make_shared<SSTableReader>(paths[i].second, &block_cache_);
+            });
+            for (size_t i = 0; i < paths.size(); i++) {
+                if (readers[i]->Valid()) v->levels[paths[i].first].push_back(std::move(readers[i]));
+            }
+        }
+
+        for (int level = 0; level < kMaxLevels; level++) {
+            auto& files = v->levels[level];
+            for (const auto& f : files) max_counter = std::max(max_counter, FileCounter(f->Filepath()) + 1);
+            if (level == 0) {
+                // Flush order, so newer tables shadow older ones
+                std::sort(files.begin(), files.end(),
+                    [](const std::shared_ptr<SSTableReader>& a, const std::shared_ptr<SSTableReader>& b) {
+                        return FileCounter(a->Filepath()) < FileCounter(b->Filepath());
+                    });
+            } else {
+                std::sort(files.begin(), files.end(),
+                    [](const std::shared_ptr<SSTableReader>& a, const std::shared_ptr<SSTableReader>& b) {
+                        return a->SmallestKey() < b->SmallestKey();
+                    });
+            }
+        }
+        // New tables must never reuse a surviving file's name
+        if (max_counter > sstable_counter_) sstable_counter_ = max_counter;
+        InstallVersion(std::move(v));
+        PersistManifest();
+    }
+
+    /** Records current_ in the MANIFEST; false if it could not be written. */
+    bool PersistManifest() {
+        compat::LockGuard<compat::Mutex> lock(manifest_mu_);
+        // Re-read under manifest_mu_ so the last writer records the newest Version
+        auto v = CurrentVersion();
+        Manifest m;
+        m.sequence = sequence_.load();
+        m.counter  = sstable_counter_.load();
         for (int level = 0; level < kMaxLevels; level++) {
-            std::string dir = data_dir_ + "/sst/L" + std::to_string(level);
-            LoadSSTFromDir(dir, level);
+            for (const auto& f : v->levels[level]) {
+                const std::string& path = f->Filepath();
+                m.files.push_back({level, path.substr(path.find_last_of('/') + 1), f->Meta()});
+            }
         }
-        stats_.sstable_count.store(TotalSSTCount());
+        return WriteManifest(ManifestPath(), m);
+    }
+
+    std::string ManifestPath() const { return data_dir_ + "/MANIFEST"; }
+    std::string LevelDir(int level) const { return data_dir_ + "/sst/L" + std::to_string(level); }
+
+    // "<dir>/sst_<n>.sst" -> n
+    static uint64_t FileCounter(const std::string& path) {
+        size_t pos = path.rfind("sst_");
+        if (pos == std::string::npos) return 0;
+        return std::strtoull(path.c_str() + pos + 4, nullptr, 10);
     }
 
-    void LoadSSTFromDir(const std::string& dir, int level) {
+    // Runs fn(0) .. fn(n - 1) across up to one thread per core.
+    static void ParallelFor(size_t n, const std::function<void(size_t)>& fn) {
+        size_t workers = std::min<size_t>(n, std::max(1u, compat::Thread::hardware_concurrency()));
+        compat::Atomic<size_t> next{0};
+        auto work = [&]() {
+            for (size_t i = next.fetch_add(1); i < n; i = next.fetch_add(1)) fn(i);
+        };
+        std::vector<compat::Thread> pool;
+        for (size_t w = 1; w < workers; w++) pool.emplace_back(work);
+        work();
+        for (auto& t : pool) t.join();
+    }
+
+    // Names of the *.sst files in `dir`.
+    static std::vector<std::string> ListSSTFiles(const std::string& dir) {
+        std::vector<std::string> names;
 #ifdef _WIN32
         struct _finddata_t fileinfo;
         std::string pattern = dir + "/*.sst";
         intptr_t handle = _findfirst(pattern.c_str(), &fileinfo);
-        if (handle == -1) return;
+        if (handle == -1) return names;
         do {
-            std::string filepath = dir + "/" + fileinfo.name;
-            auto reader = std::make_shared<SSTableReader>(filepath);
-            if (reader->Valid()) {
-                levels_[level].push_back(reader);
-            }
+            names.push_back(fileinfo.name);
         } while (_findnext(handle, &fileinfo) == 0);
         _findclose(handle);
 #else
         // POSIX: use opendir/readdir
         DIR* d = opendir(dir.c_str());
-        if (!d) return;
+        if (!d) return names;
         struct dirent* entry;
         while ((entry = readdir(d)) != nullptr) {
             std::string name(entry->d_name);
-            if (name.size() > 4 && name.substr(name.size() - 4) == ".sst") {
-                std::string filepath = dir + "/" + name;
-                auto reader = std::make_shared<SSTableReader>(filepath);
-                if (reader->Valid()) levels_[level].push_back(reader);
-            }
+            if (name.size() > 4 && name.substr(name.size() - 4) == ".sst") names.push_back(name);
         }
         closedir(d);
 #endif
+        return names;
     }
 
     void CleanupRotatedWALs() {
@@ -397,20 +1071,30 @@ private:
     }
 
     std::string data_dir_;
+    LSMOptions  options_;
     compat::Atomic<uint64_t> sequence_;
     compat::Atomic<bool>     running_;
     compat::Atomic<uint64_t> sstable_counter_;
     bool flush_pending_ = false;
 
-    std::unique_ptr<MemTable>   memtable_;
-    std::unique_ptr<MemTable>   imm_memtable_;
+    std::shared_ptr<MemTable>   memtable_;
+    std::shared_ptr<MemTable>   imm_memtable_;
     std::unique_ptr<WALWriter>  wal_;
 
-    std::vector<std::shared_ptr<SSTableReader>> levels_[kMaxLevels];
+    // Declared before current_ so it outlives the readers pointing at it.
+    BlockCache block_cache_;
+    std::shared_ptr<const Version> current_;          // guarded by sst_mu_
+    std::string compact_pointer_[kMaxLevels];         // guarded by compact_mu_
 
     compat::Mutex mu_;
+    mutable compat::SharedMutex write_mu_;
+    mutable compat::Mutex visible_mu_;          // sequence_ reservations and in_flight_
+    std::multiset<uint64_t> in_flight_;         // first sequence of each write in progress
+    mutable compat::Mutex mem_mu_;
     compat::Mutex imm_mu_;
-    compat::Mutex sst_mu_;
+    mutable compat::Mutex sst_mu_;
+    compat::Mutex compact_mu_;
+    compat::Mutex manifest_mu_;
 
     compat::Thread compact_thread_;
     LSMStats    stats_;
@@ -0,0 +1,138 @@
+#pragma once
+// ────────────────────────────────────────────────────────────────
+// MANIFEST: checkpoint of the live SSTable set.  Rewritten (to a temp
+// file, synced, then renamed over the old one) whenever a flush or
+// compaction installs a new Version, so at startup the engine knows
+// which tables are live and their key ranges without opening any.
+//
+// Text format, one record per line:
+//   DCSMANIFEST 1
+//   sequence <next sequence number>
+//   counter  <next sstable file number>
+//   file <level> <file name> <bytes> <entries> <hex smallest> <hex largest>
+//   end
+// A file without the trailing "end" (torn write) is ignored.
+// ────────────────────────────────────────────────────────────────
+
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "sstable.h"
+#include "wal.h"
+
+namespace dcs {
+namespace storage {
+
+struct Manifest {
+    struct File {
+        int         level = 0;
+        std::string name;        // relative to sst/L<level>/
+        SSTableMeta meta;
+    };
+
+    uint64_t          sequence = 0;
+    uint64_t          counter  = 0;
+    std::vector<File> files;
+};
+
+namespace manifest_detail {
+
+inline std::string HexEncode(const std::string& s) {
+    static const char* kDigits = "0123456789abcdef";
+    std::string out;
+    out.reserve(s.size() * 2 + 1);
+    out += '=';   // keeps empty strings a non-empty token
+    for (unsigned char c : s) {
+        out += kDigits[c >> 4];
+        out += kDigits[c & 15];
+    }
+    return out;
+}
+
+inline bool HexDecode(const std::string& in, std::string& out) {
+    if (in.empty() || in[0] != '=' || in.size() % 2 != 1) return false;
+    auto nibble = [](char c) -> int {
+        if (c >= '0' && c <= '9') return c - '0';
+        if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+        return -1;
+    };
+    out.clear();
+    for (size_t i = 1; i < in.size(); i += 2) {
+        int hi = nibble(in[i]), lo = nibble(in[i + 1]);
+        if (hi < 0 || lo < 0) return false;
+        out += static_cast<char>((hi << 4) | lo);
+    }
+    return true;
+}
+
+}  // namespace manifest_detail
+
+inline bool WriteManifest(const std::string& path, const Manifest& m) {
+    std::ostringstream out;
+    out << "DCSMANIFEST 1\n";
+    out << "sequence " << m.sequence << "\n";
+    out << "counter " << m.counter << "\n";
+    for (const auto& f : m.files) {
+        out << "file " << f.level << ' ' << f.name << ' ' << f.meta.file_size << ' '
+            << f.meta.num_entries << ' ' << manifest_detail::HexEncode(f.meta.smallest) << ' '
+            << manifest_detail::HexEncode(f.meta.largest) << "\n";
+    }
+    out << "end\n";
+    std::string data = out.str();
+
+    std::string tmp = path + ".tmp";
+    std::remove(tmp.c_str());
+    int fd = wal_detail::OpenAppend(tmp);
+    if (fd < 0) return false;
+    bool ok = wal_detail::WriteAll(fd, data.data(), data.size()) && wal_detail::SyncFd(fd);
+    wal_detail::CloseFd(fd);
+    if (!ok) {
+        std::remove(tmp.c_str());
+        return false;
+    }
+#ifdef _WIN32
+    std::remove(path.c_str());   // rename() won't replace an existing file
+#endif
+    return std::rename(tmp.c_str(), path.c_str()) == 0;
+}
+
+inline bool ReadManifest(const std::string& path, Manifest& m) {
+    std::ifstream in(path);
+    if (!in.is_open()) return false;
+    std::string line, tag;
+    if (!std::getline(in, line) || line != "DCSMANIFEST 1") return false;
+    Manifest parsed;
+    while (std::getline(in, line)) {
+        std::istringstream fields(line);
+        fields >> tag;
+        if (tag == "end") {
+            m = std::move(parsed);
+            return true;
+        }
+        if (tag == "sequence") {
+            fields >> parsed.sequence;
+        } else if (tag == "counter") {
+            fields >> parsed.counter;
+        } else if (tag == "file") {
+            Manifest::File f;
+            std::string lo, hi;
+            fields >> f.level >> f.name >> f.meta.file_size >> f.meta.num_entries >> lo >> hi;
+            if (!manifest_detail::HexDecode(lo, f.meta.smallest) ||
+                !manifest_detail::HexDecode(hi, f.meta.largest)) {
+                return false;
+            }
+            parsed.files.push_back(std::move(f));
+        } else {
+            return false;
+        }
+        if (fields.fail()) return false;
+    }
+    return false;   // no "end": torn write
+}
+
+}  // namespace storage
+}  // namespace dcs
@@ -2,20 +2,30 @@
 // ────────────────────────────────────────────────────────────────
 // MemTable: in-memory ordered key-value store backed by skip-list.
 // Supports versioned keys (sequence numbers) and soft-deletes.
+//
+// Concurrency: readers never lock.  Writers link nodes in with a CAS
+// per level, so any number of Put/Delete calls may race with each
+// other and with Get/ForEach.  Nodes (with their key and value bytes
+// inline) live in an Arena and are released together when the
+// memtable is destroyed; entries are never unlinked before that.
 // ────────────────────────────────────────────────────────────────
 
 #include <algorithm>
 #include <atomic>
+#include <cstddef>
 #include <cstdint>
 #include <cstdlib>
 #include <cstring>
 #include <functional>
 #include <memory>
+#include <new>
 #include <string>
+#include <string_view>
 #include <utility>
 #include <vector>
 
-#include "../compat/threading.h"
+#include "arena.h"
+#include "iterator.h"
 
 namespace dcs {
 namespace storage {
@@ -45,26 +55,23 @@ public:
     static constexpr int kMaxHeight       = 12;
     static constexpr size_t kWriteBufferSize = 4 * 1024 * 1024; // 4 MB
 
-    MemTable() : head_(new Node(kMaxHeight)), max_height_(1),
-                 approx_size_(0), entry_count_(0), rng_state_(42) {}
+    MemTable() : head_(NewNode(std::string_view(), 0, ValueType::kValue, std::string_view(), kMaxHeight)),
+                 max_height_(1), approx_size_(0), entry_count_(0), rng_state_(42) {}
 
-    ~MemTable() { Clear(); }
+    MemTable(const MemTable&) = delete;
+    MemTable& operator=(const MemTable&) = delete;
 
     bool Put(const std::string& key, const std::string& value, uint64_t seq) {
-        compat::LockGuard<compat::Mutex> lock(mu_);
-        InternalKey ik{key, seq, ValueType::kValue};
-        Insert(ik, value);
-        approx_size_ += key.size() + value.size() + 32;
-        entry_count_++;
+        if (!Insert(key, seq, ValueType::kValue, value)) return true;
+        approx_size_.fetch_add(key.size() + value.size() + 32, std::memory_order_relaxed);
+        entry_count_.fetch_add(1, std::memory_order_relaxed);
         return true;
     }
 
     bool Delete(const std::string& key, uint64_t seq) {
-        compat::LockGuard<compat::Mutex> lock(mu_);
-        InternalKey ik{key, seq, ValueType::kDeletion};
-        Insert(ik, "");
-        approx_size_ += key.size() + 32;
-        entry_count_++;
+        if (!Insert(key, seq, ValueType::kDeletion, std::string_view())) return true;
+        approx_size_.fetch_add(key.size() + 32, std::memory_order_relaxed);
+        entry_count_.fetch_add(1, std::memory_order_relaxed);
         return true;
     }
 
@@ -76,110 +83,215 @@ public:
     };
 
     LookupResult Get(const std::string& key) const {
-        // Lock-free read via lock (safe for single-writer multiple reader)
-        compat::LockGuard<compat::Mutex> lock(const_cast<compat::Mutex&>(mu_));
-        Node* node = head_.get();
-        for (int i = max_height_ - 1; i >= 0; i--) {
-            while (node->next[i] && node->next[i]->ikey < InternalKey{key, UINT64_MAX, ValueType::kValue}) {
-                node = node->next[i];
-            }
-        }
-        Node* target = node->next[0];
-        if (target && target->ikey.key == key) {
-            return {true, target->value,
-                    target->ikey.type == ValueType::kDeletion};
+        // Newest version sorts first, so seek to (key, UINT64_MAX)
+        Node* target = FindGreaterOrEqual(key, UINT64_MAX);
+        if (target && target->Key() == key) {
+            std::string_view v = target->Value();
+            return {true, std::string(v.data(), v.size()),
+                    target->type == ValueType::kDeletion};
         }
         return {false, "", false};
     }
 
     using EntryCallback = std::function<void(const InternalKey&, const std::string&)>;
 
+    // Visits entries in InternalKey order.  Entries inserted while the
+    // walk is in progress may or may not be seen.
     void ForEach(EntryCallback cb) const {
-        compat::LockGuard<compat::Mutex> lock(const_cast<compat::Mutex&>(mu_));
-        Node* node = head_->next[0];
-        while (node) {
-            cb(node->ikey, node->value);
-            node = node->next[0];
+        InternalKey ik;
+        std::string value;
+        for (Node* node = head_->Next(0); node; node = node->Next(0)) {
+            ik.key.assign(node->Key().data(), node->Key().size());
+            ik.sequence = node->sequence;
+            ik.type = node->type;
+            value.assign(node->Value().data(), node->Value().size());
+            cb(ik, value);
         }
     }
 
-    size_t ApproximateSize() const { return approx_size_; }
-    size_t EntryCount()      const { return entry_count_; }
-    bool   ShouldFlush()     const { return approx_size_ >= kWriteBufferSize; }
-
-    void Clear() {
-        compat::LockGuard<compat::Mutex> lock(mu_);
-        Node* node = head_->next[0];
-        while (node) {
-            Node* next = node->next[0];
-            delete node;
-            node = next;
-        }
-        for (int i = 0; i < kMaxHeight; i++) head_->next[i] = nullptr;
-        max_height_ = 1;
-        approx_size_ = 0;
-        entry_count_ = 0;
+    /**
+     * Ordered view of the newest version of each key with a sequence
+     * number <= `snapshot`; later writes are invisible to it.  Deletions
+     * are yielded as tombstones.  The memtable must outlive the iterator.
+     */
+    std::unique_ptr<KVIterator> NewIterator(uint64_t snapshot = UINT64_MAX) const {
+        return std::unique_ptr<KVIterator>(new Iterator(this, snapshot));
     }
 
+    size_t ApproximateSize() const { return approx_size_.load(std::memory_order_relaxed); }
+    size_t EntryCount()      const { return entry_count_.load(std::memory_order_relaxed); }
+    bool   ShouldFlush()     const { return ApproximateSize() >= kWriteBufferSize; }
+    size_t ArenaBytes()      const { return arena_.MemoryUsage(); }
+
 private:
+    struct Node;
+
+    class Iterator : public KVIterator {
+    public:
+        Iterator(const MemTable* table, uint64_t snapshot)
+            : table_(table), snapshot_(snapshot), node_(nullptr) {}
+
+        bool Valid() const override { return node_ != nullptr; }
+        void SeekToFirst() override { node_ = table_->head_->Next(0); SkipInvisible(); }
+        void Seek(std::string_view target) override {
+            node_ = table_->FindGreaterOrEqual(target, UINT64_MAX);
+            SkipInvisible();
+        }
+        void Next() override {
+            std::string_view key = node_->Key();
+            do { node_ = node_->Next(0); } while (node_ && node_->Key() == key);
+            SkipInvisible();
+        }
+        std::string_view key()   const override { return node_->Key(); }
+        std::string_view value() const override { return node_->Value(); }
+        bool IsDeletion()        const override { return node_->type == ValueType::kDeletion; }
+
+    private:
+        // Versions of a key run newest first, so the first one at or
+        // below the snapshot is the visible one.
+        void SkipInvisible() {
+            while (node_ && node_->sequence > snapshot_) node_ = node_->Next(0);
+        }
+
+        const MemTable* table_;
+        uint64_t        snapshot_;
+        const Node*     node_;
+    };
+
+    // Variable-size node: `height` next pointers, then key and value
+    // bytes, all carved from one arena allocation.
     struct Node {
-        InternalKey       ikey;
-        std::string       value;
-        std::vector<Node*> next;
+        uint64_t  sequence;
+        uint32_t  key_size;
+        uint32_t  value_size;
+        ValueType type;
+        uint8_t   height;
+        std::atomic<Node*> next[1];   // really `height` entries
+
+        std::atomic<Node*>*       Links()       { return next; }
+        const std::atomic<Node*>* Links() const { return next; }
+        const char* Data() const { return reinterpret_cast<const char*>(Links() + height); }
 
-        explicit Node(int height) : next(height, nullptr) {}
-        Node(const InternalKey& k, const std::string& v, int height)
-            : ikey(k), value(v), next(height, nullptr) {}
+        std::string_view Key()   const { return std::string_view(Data(), key_size); }
+        std::string_view Value() const { return std::string_view(Data() + key_size, value_size); }
+
+        Node* Next(int level) const { return Links()[level].load(std::memory_order_acquire); }
+        void  SetNextRelaxed(int level, Node* n) { Links()[level].store(n, std::memory_order_relaxed); }
+        bool  CasNext(int level, Node* expected, Node* n) {
+            return Links()[level].compare_exchange_strong(expected, n, std::memory_order_release,
+                                                          std::memory_order_relaxed);
+        }
     };
 
-    int RandomHeight() {
-        int h = 1;
-        while (h < kMaxHeight && ((FastRand() & 3) == 0)) ++h;
-        return h;
+    Node* NewNode(std::string_view key, uint64_t seq, ValueType type,
+                  std::string_view value, int height) {
+        size_t links = sizeof(std::atomic<Node*>) * static_cast<size_t>(height);
+        char* mem = arena_.Allocate(offsetof(Node, next) + links + key.size() + value.size());
+        Node* n = reinterpret_cast<Node*>(mem);
+        n->sequence   = seq;
+        n->key_size   = static_cast<uint32_t>(key.size());
+        n->value_size = static_cast<uint32_t>(value.size());
+        n->type       = type;
+        n->height     = static_cast<uint8_t>(height);
+        for (int i = 0; i < height; i++) new (n->Links() + i) std::atomic<Node*>(nullptr);
+        char* data = const_cast<char*>(n->Data());
+        if (!key.empty()) std::memcpy(data, key.data(), key.size());
+        if (!value.empty()) std::memcpy(data + key.size(), value.data(), value.size());
+        return n;
     }
 
-    uint32_t FastRand() {
-        rng_state_ ^= (rng_state_ << 13);
-        rng_state_ ^= (rng_state_ >> 17);
-        rng_state_ ^= (rng_state_ << 5);
-        return rng_state_;
+    // InternalKey order without materialising an InternalKey.
+    static bool Before(const Node* n, std::string_view key, uint64_t seq) {
+        int cmp = n->Key().compare(key);
+        if (cmp != 0) return cmp < 0;
+        return n->sequence > seq;   // newer first
     }
 
-    void Insert(const InternalKey& ikey, const std::string& value) {
-        Node* prev[kMaxHeight];
-        Node* node = head_.get();
-        for (int i = max_height_ - 1; i >= 0; i--) {
-            while (node->next[i] && node->next[i]->ikey < ikey) {
-                node = node->next[i];
+    Node* FindGreaterOrEqual(std::string_view key, uint64_t seq) const {
+        Node* x = head_;
+        for (int level = max_height_.load(std::memory_order_relaxed) - 1; level >= 0; level--) {
+            Node* next = x->Next(level);
+            while (next && Before(next, key, seq)) {
+                x = next;
+                next = x->Next(level);
             }
-            prev[i] = node;
+            if (level == 0) return next;
         }
+        return nullptr;
+    }
 
-        // Check for exact match (same key + sequence)
-        if (node->next[0] && node->next[0]->ikey == ikey) {
-            node->next[0]->value = value;
-            return;
+    // Walks right from `before` on one level to where (key, seq) belongs.
+    static void FindSplice(std::string_view key, uint64_t seq, Node* before, int level,
+                           Node** prev, Node** succ) {
+        Node* x = before;
+        Node* next = x->Next(level);
+        while (next && Before(next, key, seq)) {
+            x = next;
+            next = x->Next(level);
         }
+        *prev = x;
+        *succ = next;
+    }
 
+    int RandomHeight() {
+        int h = 1;
+        uint32_t r = FastRand();
+        while (h < kMaxHeight && (r & 3) == 0) {
+            ++h;
+            r >>= 2;
+        }
+        return h;
+    }
+
+    // Weyl sequence + finalizer: one atomic add, safe across writers
+    uint32_t FastRand() {
+        uint32_t x = rng_state_.fetch_add(0x9E3779B9u, std::memory_order_relaxed);
+        x ^= x >> 16;
+        x *= 0x85EBCA6Bu;
+        x ^= x >> 13;
+        x *= 0xC2B2AE35u;
+        x ^= x >> 16;
+        return x;
+    }
+
+    // Returns false if (key, seq) is already present.
+    bool Insert(std::string_view key, uint64_t seq, ValueType type, std::string_view value) {
         int height = RandomHeight();
-        if (height > max_height_) {
-            for (int i = max_height_; i < height; i++) prev[i] = head_.get();
-            max_height_ = height;
+        int max_h = max_height_.load(std::memory_order_relaxed);
+        while (height > max_h &&
+               !max_height_.compare_exchange_weak(max_h, height, std::memory_order_relaxed)) {}
+
+        Node* prev[kMaxHeight];
+        Node* succ[kMaxHeight];
+        Node* x = head_;
+        for (int level = std::max(height, max_h) - 1; level >= 0; level--) {
+            FindSplice(key, seq, x, level, &prev[level], &succ[level]);
+            x = prev[level];
         }
+        if (succ[0] && succ[0]->sequence == seq && succ[0]->Key() == key) return false;
 
-        Node* new_node = new Node(ikey, value, height);
-        for (int i = 0; i < height; i++) {
-            new_node->next[i] = prev[i]->next[i];
-            prev[i]->next[i] = new_node;
+        Node* node = NewNode(key, seq, type, value, height);
+        for (int level = 0; level < height; level++) {
+            for (;;) {
+                node->SetNextRelaxed(level, succ[level]);
+                if (prev[level]->CasNext(level, succ[level], node)) break;
+                // Another writer linked in at this spot; nodes are never
+                // removed, so the new splice is still to the right.
+                FindSplice(key, seq, prev[level], level, &prev[level], &succ[level]);
+                if (level == 0 && succ[0] && succ[0]->sequence == seq && succ[0]->Key() == key) {
+                    return false;   // lost a race for the same version
+                }
+            }
         }
+        return true;
     }
 
-    std::unique_ptr<Node> head_;
-    int                   max_height_;
-    size_t                approx_size_;
-    size_t                entry_count_;
-    uint32_t              rng_state_;
-    compat::Mutex         mu_;
+    Arena                 arena_;   // declared first: head_ lives in it
+    Node*                 head_;
+    std::atomic<int>      max_height_;
+    std::atomic<size_t>   approx_size_;
+    std::atomic<size_t>   entry_count_;
+    std::atomic<uint32_t> rng_state_;
 };
 
 }  // namespace storage
@@ -0,0 +1,169 @@
+#pragma once
+// ────────────────────────────────────────────────────────────────
+// RandomAccessFile: read-only file handle kept open for an SSTable's
+// lifetime.  On 64-bit POSIX hosts the whole file is mapped read-only
+// and reads are served straight from the mapping; elsewhere (32-bit
+// builds, where address space is scarce, and Windows) positional
+// reads are used.  Both paths are safe for concurrent readers.
+// ────────────────────────────────────────────────────────────────
+
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace dcs {
+namespace storage {
+
+class RandomAccessFile {
+public:
+    enum class Access {
+        kNormal,
+        kRandom,       // point lookups: no readahead
+        kSequential,   // full scans: aggressive readahead, drop behind
+        kWillNeed,     // prefetch the range
+    };
+
+    // Mapping is only worth its address space on 64-bit hosts.
+    static constexpr bool kMmapSupported = sizeof(void*) >= 8;
+
+    RandomAccessFile() = default;
+    ~RandomAccessFile() { Close(); }
+
+    RandomAccessFile(const RandomAccessFile&) = delete;
+    RandomAccessFile& operator=(const RandomAccessFile&) = delete;
+
+    bool Open(const std::string& path, bool allow_mmap = kMmapSupported) {
+        Close();
+#ifdef _WIN32
+        (void)allow_mmap;
+        handle_ = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE,
+                              nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (handle_ == INVALID_HANDLE_VALUE) return false;
+        LARGE_INTEGER size;
+        if (!GetFileSizeEx(handle_, &size)) { Close(); return false; }
+        size_ = static_cast<uint64_t>(size.QuadPart);
+#else
+        fd_ = ::open(path.c_str(), O_RDONLY);
+        if (fd_ < 0) return false;
+        struct stat st;
+        if (::fstat(fd_, &st) != 0) { Close(); return false; }
+        size_ = static_cast<uint64_t>(st.st_size);
+        if (allow_mmap && kMmapSupported && size_ > 0) {
+            void* p = ::mmap(nullptr, static_cast<size_t>(size_), PROT_READ, MAP_SHARED, fd_, 0);
+            if (p != MAP_FAILED) map_ = static_cast<const char*>(p);
+        }
+#endif
+        Advise(Access::kRandom);
+        return true;
+    }
+
+    void Close() {
+#ifdef _WIN32
+        if (handle_ != INVALID_HANDLE_VALUE) CloseHandle(handle_);
+        handle_ = INVALID_HANDLE_VALUE;
+#else
+        if (map_) ::munmap(const_cast<char*>(map_), static_cast<size_t>(size_));
+        map_ = nullptr;
+        if (fd_ >= 0) ::close(fd_);
+        fd_ = -1;
+#endif
+        size_ = 0;
+    }
+
+#ifdef _WIN32
+    bool IsOpen() const { return handle_ != INVALID_HANDLE_VALUE; }
+#else
+    bool IsOpen() const { return fd_ >= 0; }
+#endif
+    bool     Mapped() const { return map_ != nullptr; }
+    uint64_t Size()   const { return size_; }
+
+    /**
+     * Read [offset, offset + n).  `out` points into the mapping when the
+     * file is mapped, otherwise into `scratch`; it stays valid while the
+     * file is open and `scratch` is untouched.
+     */
+    bool Read(uint64_t offset, size_t n, std::string& scratch, std::string_view& out) const {
+        if (offset > size_ || n > size_ - offset) return false;
+        if (map_) {
+            out = std::string_view(map_ + offset, n);
+            return true;
+        }
+        scratch.resize(n);
+        size_t done = 0;
+        while (done < n) {
+#ifdef _WIN32
+            OVERLAPPED ov = {};
+            uint64_t pos = offset + done;
+            ov.Offset     = static_cast<DWORD>(pos);
+            ov.OffsetHigh = static_cast<DWORD>(pos >> 32);
+            DWORD want = static_cast<DWORD>(std::min<size_t>(n - done, 1u << 30));
+            DWORD got = 0;
+            if (!ReadFile(handle_, &scratch[done], want, &got, &ov) || got == 0) return false;
+#else
+            ssize_t got = ::pread(fd_, &scratch[done], n - done, static_cast<off_t>(offset + done));
+            if (got < 0 && errno == EINTR) continue;
+            if (got <= 0) return false;
+#endif
+            done += static_cast<size_t>(got);
+        }
+        out = std::string_view(scratch.data(), n);
+        return true;
+    }
+
+    /** Access-pattern hint for [offset, offset + len); len 0 = to the end. */
+    void Advise(Access access, uint64_t offset = 0, uint64_t len = 0) const {
+#if defined(_WIN32)
+        (void)access; (void)offset; (void)len;
+#else
+        if (!IsOpen()) return;
+        if (map_) {
+            int advice = access == Access::kRandom     ? MADV_RANDOM
+                       : access == Access::kSequential ? MADV_SEQUENTIAL
+                       : access == Access::kWillNeed   ? MADV_WILLNEED
+                                                       : MADV_NORMAL;
+            if (offset >= size_) return;
+            // madvise needs a page-aligned start
+            static const uint64_t page = static_cast<uint64_t>(::sysconf(_SC_PAGESIZE));
+            uint64_t start = offset & ~(page - 1);
+            uint64_t end = (len == 0 || len > size_ - offset) ? size_ : offset + len;
+            ::madvise(const_cast<char*>(map_) + start, static_cast<size_t>(end - start), advice);
+            return;
+        }
+#if defined(POSIX_FADV_RANDOM)
+        int advice = access == Access::kRandom     ? POSIX_FADV_RANDOM
+                   : access == Access::kSequential ? POSIX_FADV_SEQUENTIAL
+                   : access == Access::kWillNeed   ? POSIX_FADV_WILLNEED
+                                                   : POSIX_FADV_NORMAL;
+        ::posix_fadvise(fd_, static_cast<off_t>(offset), static_cast<off_t>(len), advice);
+#endif
+#endif
+    }
+
+private:
+#ifdef _WIN32
+    HANDLE      handle_ = INVALID_HANDLE_VALUE;
+#else
+    int         fd_ = -1;
+#endif
+    const char* map_ = nullptr;
+    uint64_t    size_ = 0;
+};
+
+}  // namespace storage
+}  // namespace dcs
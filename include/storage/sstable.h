@@ -1,161 +1,340 @@
 #pragma once
 // ────────────────────────────────────────────────────────────────
 // SSTable: Sorted String Table — immutable on-disk key-value storage.
-// Format:
+// Format (v3):
 //   [DataBlock 0][DataBlock 1]...[IndexBlock][MetaBlock(Bloom)][Footer]
+// The meta block is a split-block bloom filter (bloom_filter.h) built
+// at Finish() from the hashes of every key, at bits_per_key.
+//
+// Data block  : prefix-compressed entries
+//                 varint shared | varint unshared | varint value_len
+//                 | key[shared..] | value
+//               with the full key stored every `restart_interval`
+//               entries, then u32 restart offsets[] | u32 num_restarts.
+// Block trailer: u8 type (0 raw, 1 LZ) | u32 uncompressed size.
+// Index block : same block layout, one entry per data block
+//               (last key -> varint offset | varint size), so the
+//               index is binary-searched and costs RAM per block, not
+//               per key.
+// v3 values   : u8 tag (1 value, 2 tombstone) | value bytes.
+//
+// v1 files (one record per entry, full key index) and v2 files
+// (untagged values) are still readable.
 // ────────────────────────────────────────────────────────────────
 
 #include <algorithm>
+#include <atomic>
 #include <cmath>
 #include <cstdint>
 #include <cstring>
 #include <fstream>
 #include <functional>
+#include <limits>
+#include <memory>
 #include <string>
+#include <string_view>
 #include <unordered_map>
 #include <utility>
 #include <vector>
 
+#include "../compat/threading.h"
+#include "../compression/lz.h"
+#include "../metrics/latency.h"
+#include "block_cache.h"
+#include "bloom_filter.h"
+#include "iterator.h"
+#include "random_access_file.h"
+
 namespace dcs {
 namespace storage {
 
-// ──── Bloom Filter ─────────────────────────────────────────────
-class BloomFilter {
+// ──── Block Handle ─────────────────────────────────────────────
+struct BlockHandle {
+    uint64_t offset;
+    uint64_t size;
+};
+
+// ──── Footer ───────────────────────────────────────────────────
+constexpr uint64_t kTableMagicV1 = 0xDC5F00DAULL;   // one record per entry
+constexpr uint64_t kTableMagicV2 = 0xDC5F00DBULL;   // blocks, untagged values
+constexpr uint64_t kTableMagicV3 = 0xDC5F00DCULL;   // blocks, tagged values (tombstones)
+
+struct Footer {
+    BlockHandle index_handle;
+    BlockHandle meta_handle;
+    uint64_t    num_entries;
+    uint64_t    magic = kTableMagicV3;
+
+    std::string Serialize() const {
+        std::string buf(sizeof(Footer), '\0');
+        std::memcpy(&buf[0], this, sizeof(Footer));
+        return buf;
+    }
+    static Footer Deserialize(const std::string& data) {
+        Footer f;
+        std::memcpy(&f, data.data(), sizeof(Footer));
+        return f;
+    }
+};
+
+// ──── Encoding helpers ─────────────────────────────────────────
+inline void PutVarint(std::string& dst, uint64_t v) {
+    while (v >= 0x80) {
+        dst.push_back(static_cast<char>(v | 0x80));
+        v >>= 7;
+    }
+    dst.push_back(static_cast<char>(v));
+}
+
+inline bool GetVarint(std::string_view src, size_t& pos, uint64_t& v) {
+    v = 0;
+    for (int shift = 0; shift <= 63 && pos < src.size(); shift += 7) {
+        uint8_t b = static_cast<uint8_t>(src[pos++]);
+        v |= static_cast<uint64_t>(b & 0x7F) << shift;
+        if (!(b & 0x80)) return true;
+    }
+    return false;
+}
+
+inline void PutFixed32(std::string& dst, uint32_t v) {
+    dst.append(reinterpret_cast<const char*>(&v), 4);
+}
+
+inline uint32_t DecodeFixed32(const char* p) {
+    uint32_t v;
+    std::memcpy(&v, p, 4);
+    return v;
+}
+
+inline std::string EncodeHandle(const BlockHandle& h) {
+    std::string buf;
+    PutVarint(buf, h.offset);
+    PutVarint(buf, h.size);
+    return buf;
+}
+
+inline bool DecodeHandle(std::string_view src, BlockHandle& h) {
+    size_t pos = 0;
+    return GetVarint(src, pos, h.offset) && GetVarint(src, pos, h.size);
+}
+
+// ──── Block Builder ────────────────────────────────────────────
+// Keys must be added in strictly ascending order.
+class BlockBuilder {
 public:
-    explicit BloomFilter(size_t num_keys, double fp_rate = 0.01)
-        : num_hashes_(OptimalHashes(fp_rate)) {
-        size_t num_bits = std::max<size_t>(64, num_keys * 10);
-        bits_.resize((num_bits + 7) / 8, 0);
-        num_bits_ = bits_.size() * 8;
+    explicit BlockBuilder(int restart_interval)
+        : restart_interval_(std::max(1, restart_interval)) { Reset(); }
+
+    void Add(std::string_view key, std::string_view value) {
+        size_t shared = 0;
+        if (counter_ < restart_interval_) {
+            size_t n = std::min(last_key_.size(), key.size());
+            while (shared < n && last_key_[shared] == key[shared]) shared++;
+        } else {
+            restarts_.push_back(static_cast<uint32_t>(buf_.size()));
+            counter_ = 0;
+        }
+        PutVarint(buf_, shared);
+        PutVarint(buf_, key.size() - shared);
+        PutVarint(buf_, value.size());
+        buf_.append(key.data() + shared, key.size() - shared);
+        buf_.append(value.data(), value.size());
+        last_key_.assign(key.data(), key.size());
+        counter_++;
+        entries_++;
     }
 
-    BloomFilter() : num_bits_(0), num_hashes_(7) {}
+    /** Append the restart array and return the block; the builder is reset. */
+    std::string Finish() {
+        for (uint32_t r : restarts_) PutFixed32(buf_, r);
+        PutFixed32(buf_, static_cast<uint32_t>(restarts_.size()));
+        std::string out;
+        out.swap(buf_);
+        Reset();
+        return out;
+    }
 
-    void Add(const std::string& key) {
-        for (int i = 0; i < num_hashes_; i++) {
-            size_t h = Hash(key, i) % num_bits_;
-            bits_[h / 8] |= (1u << (h % 8));
-        }
+    size_t CurrentSize() const { return buf_.size() + restarts_.size() * 4 + 4; }
+    bool   Empty()       const { return entries_ == 0; }
+    const std::string& LastKey() const { return last_key_; }
+
+private:
+    void Reset() {
+        buf_.clear();
+        restarts_.assign(1, 0);
+        last_key_.clear();
+        counter_ = 0;
+        entries_ = 0;
     }
 
-    bool MayContain(const std::string& key) const {
-        for (int i = 0; i < num_hashes_; i++) {
-            size_t h = Hash(key, i) % num_bits_;
-            if (!(bits_[h / 8] & (1u << (h % 8)))) return false;
-        }
-        return true;
+    int                   restart_interval_;
+    std::string           buf_;
+    std::vector<uint32_t> restarts_;
+    std::string           last_key_;
+    int                   counter_;
+    size_t                entries_;
+};
+
+// ──── Block Iterator ───────────────────────────────────────────
+// Walks one uncompressed block.  Malformed input stops iteration
+// (Valid() turns false) rather than reading out of bounds.
+class BlockIterator {
+public:
+    explicit BlockIterator(std::shared_ptr<const std::string> block)
+        : block_(std::move(block)) {
+        const std::string& d = *block_;
+        if (d.size() < 4) { corrupt_ = true; return; }
+        num_restarts_ = DecodeFixed32(d.data() + d.size() - 4);
+        if (num_restarts_ == 0 || num_restarts_ > (d.size() - 4) / 4) { corrupt_ = true; return; }
+        restarts_ = d.size() - 4 - 4 * static_cast<size_t>(num_restarts_);
+        current_ = next_ = restarts_;
     }
 
-    std::string Serialize() const {
-        std::string buf;
-        uint32_t n = static_cast<uint32_t>(bits_.size());
-        buf.append(reinterpret_cast<const char*>(&num_hashes_), 4);
-        buf.append(reinterpret_cast<const char*>(&n), 4);
-        buf.append(reinterpret_cast<const char*>(bits_.data()), n);
-        return buf;
+    bool Valid()   const { return !corrupt_ && current_ < restarts_; }
+    bool Corrupt() const { return corrupt_; }
+    const std::string& key()   const { return key_; }
+    std::string_view   value() const { return value_; }
+
+    void SeekToFirst() {
+        if (corrupt_) return;
+        SeekToRestart(0);
+        ParseNext();
     }
 
-    static BloomFilter Deserialize(const std::string& data) {
-        BloomFilter bf;
-        int nh = 0; uint32_t n = 0;
-        std::memcpy(&nh, data.data(), 4);
-        std::memcpy(&n, data.data() + 4, 4);
-        bf.num_hashes_ = nh;
-        bf.bits_.assign(data.data() + 8, data.data() + 8 + n);
-        bf.num_bits_ = n * 8;
-        return bf;
+    void Next() { ParseNext(); }
+
+    /** Position at the first entry with key >= target. */
+    void Seek(std::string_view target) {
+        if (corrupt_) return;
+        uint32_t lo = 0, hi = num_restarts_ - 1;
+        while (lo < hi) {
+            uint32_t mid = lo + (hi - lo + 1) / 2;
+            std::string_view k;
+            if (!RestartKey(mid, k)) { corrupt_ = true; return; }
+            if (k < target) lo = mid;
+            else hi = mid - 1;
+        }
+        SeekToRestart(lo);
+        while (ParseNext() && std::string_view(key_) < target) {}
     }
 
 private:
-    static int OptimalHashes(double fp) {
-        return std::max(1, static_cast<int>(-std::log(fp) / std::log(2)));
+    std::string_view Entries() const { return std::string_view(block_->data(), restarts_); }
+
+    size_t RestartOffset(uint32_t i) const {
+        return DecodeFixed32(block_->data() + restarts_ + 4 * static_cast<size_t>(i));
+    }
+
+    void SeekToRestart(uint32_t i) {
+        key_.clear();
+        next_ = RestartOffset(i);
+        current_ = restarts_;
     }
 
-    static size_t Hash(const std::string& key, int seed) {
-        size_t h = static_cast<size_t>(seed) * 0x9e3779b97f4a7c15ULL;
-        for (unsigned char c : key) {
-            h ^= c;
-            h *= 0x100000001b3ULL;
+    bool RestartKey(uint32_t i, std::string_view& key) const {
+        std::string_view d = Entries();
+        size_t pos = RestartOffset(i);
+        uint64_t shared, unshared, vlen;
+        if (pos >= d.size() || !GetVarint(d, pos, shared) || !GetVarint(d, pos, unshared) ||
+            !GetVarint(d, pos, vlen) || shared != 0 || unshared > d.size() - pos) {
+            return false;
         }
-        return h;
+        key = d.substr(pos, unshared);
+        return true;
+    }
+
+    bool ParseNext() {
+        std::string_view d = Entries();
+        current_ = next_;
+        if (current_ >= d.size()) { current_ = restarts_; return false; }
+        size_t pos = current_;
+        uint64_t shared, unshared, vlen;
+        if (!GetVarint(d, pos, shared) || !GetVarint(d, pos, unshared) ||
+            !GetVarint(d, pos, vlen) || shared > key_.size() ||
+            unshared > d.size() - pos || vlen > d.size() - pos - unshared) {
+            corrupt_ = true;
+            current_ = restarts_;
+            return false;
+        }
+        key_.resize(shared);
+        key_.append(d.data() + pos, unshared);
+        pos += unshared;
+        value_ = d.substr(pos, vlen);
+        next_ = pos + vlen;
+        return true;
     }
 
-    std::vector<uint8_t> bits_;
-    size_t               num_bits_;
-    int                  num_hashes_;
+    std::shared_ptr<const std::string> block_;
+    uint32_t         num_restarts_ = 0;
+    size_t           restarts_ = 0;   // offset of the restart array
+    size_t           current_ = 0;
+    size_t           next_ = 0;
+    std::string      key_;
+    std::string_view value_;
+    bool             corrupt_ = false;
 };
 
-// ──── Block Handle ─────────────────────────────────────────────
-struct BlockHandle {
-    uint64_t offset;
-    uint64_t size;
+// ──── Options ──────────────────────────────────────────────────
+enum class BlockType : uint8_t {
+    kRaw = 0,
+    kLZ  = 1,
 };
 
-// ──── Footer ───────────────────────────────────────────────────
-struct Footer {
-    BlockHandle index_handle;
-    BlockHandle meta_handle;
-    uint64_t    num_entries;
-    uint64_t    magic = 0xDC5F00DAULL;
+constexpr size_t kBlockTrailerSize = 5;
 
-    std::string Serialize() const {
-        std::string buf(sizeof(Footer), '\0');
-        std::memcpy(&buf[0], this, sizeof(Footer));
-        return buf;
-    }
-    static Footer Deserialize(const std::string& data) {
-        Footer f;
-        std::memcpy(&f, data.data(), sizeof(Footer));
-        return f;
-    }
+// v3 entries carry a one-byte tag before the value (same values as
+// MemTable's ValueType) so deletions can be stored as tombstones.
+constexpr char kTagValue    = 0x01;
+constexpr char kTagDeletion = 0x02;
+
+struct SSTableOptions {
+    size_t block_size       = 4096;   // target uncompressed data block size
+    int    restart_interval = 16;
+    bool   compress         = true;   // LZ per block, kept only if it saves >= 12.5%
+    size_t expected_entries = 0;      // reserve hint for the key hashes kept until Finish()
+    int    bloom_bits_per_key = BloomFilter::kDefaultBitsPerKey;
+};
+
+enum class LookupStatus {
+    kNotFound,
+    kFound,
+    kDeleted,   // a tombstone: older tables must not be consulted
 };
 
 // ──── SSTable Writer ───────────────────────────────────────────
+// Streams entries to disk block by block; keys must be added in
+// strictly ascending order, so memory use is one block plus the
+// index, independent of table size.
 class SSTableWriter {
 public:
-    explicit SSTableWriter(const std::string& filepath)
-        : filepath_(filepath), current_offset_(0), entry_count_(0) {
+    explicit SSTableWriter(const std::string& filepath,
+                           const SSTableOptions& options = SSTableOptions())
+        : filepath_(filepath), options_(options), current_offset_(0), entry_count_(0),
+          data_(options.restart_interval), index_(1) {
+        key_hashes_.reserve(options.expected_entries);
         file_.open(filepath, std::ios::binary | std::ios::trunc);
     }
 
+    /** Returns false if the key is not greater than the previous one. */
     bool Add(const std::string& key, const std::string& value) {
-        if (!file_.is_open()) return false;
-        entries_.push_back({key, value});
-        bloom_.Add(key);
-        entry_count_++;
-        return true;
+        return Append(key, kTagValue, value);
+    }
+
+    bool AddDeletion(const std::string& key) {
+        return Append(key, kTagDeletion, std::string());
     }
 
     bool Finish() {
         if (!file_.is_open()) return false;
-        // Sort entries
-        std::sort(entries_.begin(), entries_.end(),
-            [](const KV& a, const KV& b) { return a.key < b.key; });
+        if (!data_.Empty()) FlushDataBlock();
 
-        // Write data blocks (one entry per record for simplicity)
-        std::vector<std::pair<std::string, BlockHandle>> index_entries;
-        for (const auto& kv : entries_) {
-            BlockHandle bh;
-            bh.offset = current_offset_;
-            std::string record = EncodeKV(kv.key, kv.value);
-            bh.size = record.size();
-            file_.write(record.data(), record.size());
-            current_offset_ += record.size();
-            index_entries.push_back({kv.key, bh});
-        }
-
-        // Write index block
-        BlockHandle index_handle;
-        index_handle.offset = current_offset_;
-        std::string index_data = EncodeIndex(index_entries);
-        file_.write(index_data.data(), index_data.size());
-        index_handle.size = index_data.size();
-        current_offset_ += index_data.size();
+        // Write index block (kept uncompressed: it is read once at open)
+        BlockHandle index_handle = WriteBlock(index_.Finish(), false);
 
         // Write bloom filter (meta block)
         BlockHandle meta_handle;
         meta_handle.offset = current_offset_;
-        std::string bloom_data = bloom_.Serialize();
+        std::string bloom_data = BloomFilter::FromHashes(key_hashes_, options_.bloom_bits_per_key).Serialize();
         file_.write(bloom_data.data(), bloom_data.size());
         meta_handle.size = bloom_data.size();
         current_offset_ += bloom_data.size();
@@ -165,143 +344,495 @@ public:
         footer.index_handle = index_handle;
         footer.meta_handle  = meta_handle;
         footer.num_entries  = entry_count_;
+        footer.magic        = kTableMagicV3;
         std::string footer_data = footer.Serialize();
         file_.write(footer_data.data(), footer_data.size());
         file_.flush();
+        bool ok = file_.good();
         file_.close();
-        return true;
+        return ok;
     }
 
     size_t EntryCount() const { return entry_count_; }
+    /** Bytes written so far plus the block being built. */
+    uint64_t FileSize() const { return current_offset_ + data_.CurrentSize(); }
+    const std::string& Filepath() const { return filepath_; }
+
+    // Data blocks only: bytes before and after compression, and the time
+    // spent compressing them.
+    uint64_t DataBytesRaw() const { return data_raw_bytes_; }
+    uint64_t DataBytesStored() const { return data_stored_bytes_; }
+    uint64_t CompressNanos() const { return compress_ns_; }
 
 private:
-    struct KV { std::string key, value; };
-
-    static std::string EncodeKV(const std::string& key, const std::string& value) {
-        std::string buf;
-        uint32_t klen = static_cast<uint32_t>(key.size());
-        uint32_t vlen = static_cast<uint32_t>(value.size());
-        buf.append(reinterpret_cast<const char*>(&klen), 4);
-        buf.append(key);
-        buf.append(reinterpret_cast<const char*>(&vlen), 4);
-        buf.append(value);
-        return buf;
+    bool Append(const std::string& key, char tag, const std::string& value) {
+        if (!file_.is_open()) return false;
+        if (entry_count_ > 0 && key <= last_key_) return false;
+        tagged_.assign(1, tag);
+        tagged_.append(value);
+        data_.Add(key, tagged_);
+        key_hashes_.push_back(BloomHash(key));
+        last_key_ = key;
+        entry_count_++;
+        if (data_.CurrentSize() >= options_.block_size) FlushDataBlock();
+        return file_.good();
+    }
+
+    void FlushDataBlock() {
+        std::string last_key = data_.LastKey();
+        const std::string& raw = data_.Finish();
+        BlockHandle h = WriteBlock(raw, options_.compress);
+        data_raw_bytes_ += raw.size();
+        data_stored_bytes_ += h.size;
+        index_.Add(last_key, EncodeHandle(h));
     }
 
-    static std::string EncodeIndex(const std::vector<std::pair<std::string, BlockHandle>>& entries) {
-        std::string buf;
-        uint32_t n = static_cast<uint32_t>(entries.size());
-        buf.append(reinterpret_cast<const char*>(&n), 4);
-        for (const auto& e : entries) {
-            uint32_t klen = static_cast<uint32_t>(e.first.size());
-            buf.append(reinterpret_cast<const char*>(&klen), 4);
-            buf.append(e.first);
-            buf.append(reinterpret_cast<const char*>(&e.second.offset), 8);
-            buf.append(reinterpret_cast<const char*>(&e.second.size), 8);
+    BlockHandle WriteBlock(const std::string& raw, bool compress) {
+        BlockType type = BlockType::kRaw;
+        std::string packed;
+        if (compress) {
+            const uint64_t t0 = metrics::now_ns();
+            packed = compression::Compress(raw);
+            compress_ns_ += metrics::now_ns() - t0;
+            if (packed.size() < raw.size() - raw.size() / 8) type = BlockType::kLZ;
         }
-        return buf;
+        const std::string& payload = (type == BlockType::kLZ) ? packed : raw;
+
+        BlockHandle h;
+        h.offset = current_offset_;
+        h.size   = payload.size();
+        file_.write(payload.data(), payload.size());
+        char trailer[kBlockTrailerSize];
+        trailer[0] = static_cast<char>(type);
+        uint32_t raw_size = static_cast<uint32_t>(raw.size());
+        std::memcpy(trailer + 1, &raw_size, 4);
+        file_.write(trailer, kBlockTrailerSize);
+        current_offset_ += payload.size() + kBlockTrailerSize;
+        return h;
     }
 
     std::string        filepath_;
+    SSTableOptions     options_;
     std::ofstream      file_;
     uint64_t           current_offset_;
     size_t             entry_count_;
-    std::vector<KV>    entries_;
-    BloomFilter        bloom_{1024};
+    BlockBuilder       data_;
+    BlockBuilder       index_;
+    std::vector<uint64_t> key_hashes_;   // filter input, sized exactly at Finish()
+    std::string        last_key_;
+    std::string        tagged_;
+    uint64_t           data_raw_bytes_ = 0;
+    uint64_t           data_stored_bytes_ = 0;
+    uint64_t           compress_ns_ = 0;
+};
+
+// What a MANIFEST records per table: enough to place it in a level and
+// route lookups without opening the file.
+struct SSTableMeta {
+    uint64_t    file_size   = 0;
+    uint64_t    num_entries = 0;
+    std::string smallest;
+    std::string largest;
 };
 
 // ──── SSTable Reader ───────────────────────────────────────────
+// Only the index block and bloom filter stay resident; data blocks are
+// read on demand through the (optional, shared) BlockCache.  The file
+// stays open (mapped on 64-bit hosts) for the reader's lifetime, so a
+// cold lookup is one pread or page fault rather than an open/close.
 class SSTableReader {
 public:
-    explicit SSTableReader(const std::string& filepath) : filepath_(filepath) {
+    explicit SSTableReader(const std::string& filepath, BlockCache* cache = nullptr,
+                           bool allow_mmap = RandomAccessFile::kMmapSupported)
+        : filepath_(filepath), cache_(cache), file_id_(BlockCache::NewFileId()),
+          allow_mmap_(allow_mmap) {
         Load();
+        loaded_.store(true, std::memory_order_release);
+    }
+
+    /**
+     * Lazy reader for a table described by a MANIFEST: the file is opened
+     * and its index and bloom filter read on first use, so startup cost
+     * doesn't grow with the number (or size) of tables.
+     */
+    SSTableReader(const std::string& filepath, BlockCache* cache, const SSTableMeta& meta,
+                  bool allow_mmap = RandomAccessFile::kMmapSupported)
+        : filepath_(filepath), cache_(cache), file_id_(BlockCache::NewFileId()),
+          allow_mmap_(allow_mmap), num_entries_(static_cast<size_t>(meta.num_entries)),
+          file_size_(meta.file_size), smallest_(meta.smallest), largest_(meta.largest) {}
+
+    LookupStatus Lookup(const std::string& key, std::string& value) const {
+        return Lookup(key, BloomHash(key), value);
+    }
+
+    /** Lookup with the key's BloomHash() already computed (one per LSM read). */
+    LookupStatus Lookup(const std::string& key, uint64_t hash, std::string& value) const {
+        EnsureLoaded();
+        if (!valid_ || !bloom_.MayContain(key, hash)) return LookupStatus::kNotFound;
+        if (legacy_) {
+            auto it = legacy_index_.find(key);
+            if (it == legacy_index_.end()) return LookupStatus::kNotFound;
+            return ReadKVAt(it->second, key, value) ? LookupStatus::kFound : LookupStatus::kNotFound;
+        }
+        BlockIterator idx(index_block_);
+        idx.Seek(key);
+        BlockHandle h;
+        if (!idx.Valid() || !DecodeHandle(idx.value(), h)) return LookupStatus::kNotFound;
+        auto block = ReadBlock(h, true);
+        if (!block) return LookupStatus::kNotFound;
+        BlockIterator it(block);
+        it.Seek(key);
+        if (!it.Valid() || it.key() != key) return LookupStatus::kNotFound;
+        std::string_view v = it.value();
+        if (typed_) {
+            if (v.empty()) return LookupStatus::kNotFound;
+            if (v[0] == kTagDeletion) return LookupStatus::kDeleted;
+            v.remove_prefix(1);
+        }
+        value.assign(v.data(), v.size());
+        return LookupStatus::kFound;
     }
 
     bool Get(const std::string& key, std::string& value) const {
-        if (!valid_ || !bloom_.MayContain(key)) return false;
-        auto it = index_.find(key);
-        if (it == index_.end()) return false;
-        return ReadKVAt(it->second, key, value);
+        return Lookup(key, value) == LookupStatus::kFound;
     }
 
-    bool Valid()  const { return valid_; }
-    size_t Size() const { return index_.size(); }
+    /** False once the file has failed to open or parse; lazy tables count as valid until then. */
+    bool Valid()  const { return !loaded_.load(std::memory_order_acquire) || valid_; }
+    bool Loaded() const { return loaded_.load(std::memory_order_acquire); }
+    bool Mapped() const { EnsureLoaded(); return file_.Mapped(); }
+    size_t Size() const { return num_entries_; }
+    uint64_t FileSize() const { return file_size_; }
+    SSTableMeta Meta() const { return {file_size_, num_entries_, smallest_, largest_}; }
+
+    /** Opens a lazy table now (e.g. from a background prefetch). */
+    void EnsureLoaded() const {
+        if (loaded_.load(std::memory_order_acquire)) return;
+        compat::LockGuard<compat::Mutex> lock(load_mu_);
+        if (loaded_.load(std::memory_order_relaxed)) return;
+        // Only this call, under load_mu_, writes the fields Load() fills;
+        // readers see them after the release store below.
+        const_cast<SSTableReader*>(this)->Load();
+        loaded_.store(true, std::memory_order_release);
+    }
     const std::string& Filepath() const { return filepath_; }
+    const std::string& SmallestKey() const { return smallest_; }
+    const std::string& LargestKey()  const { return largest_; }
+
+    /** Prefetch the bloom block a Lookup(key, hash) will test; no-op until loaded. */
+    void PrefetchFilter(uint64_t hash) const {
+        if (loaded_.load(std::memory_order_acquire) && valid_) bloom_.Prefetch(hash);
+    }
+
+    size_t FilterBytes() const { return Loaded() && valid_ ? bloom_.SizeBytes() : 0; }
 
+    /** True if [lo, hi] intersects this table's key range. */
+    bool Overlaps(std::string_view lo, std::string_view hi) const {
+        return num_entries_ > 0 && std::string_view(largest_) >= lo &&
+               std::string_view(smallest_) <= hi;
+    }
+
+    /** Live keys in order; tombstones are skipped. */
     std::vector<std::string> AllKeys() const {
         std::vector<std::string> keys;
-        keys.reserve(index_.size());
-        for (const auto& kv : index_) keys.push_back(kv.first);
-        std::sort(keys.begin(), keys.end());
+        keys.reserve(num_entries_);
+        auto it = NewIterator();
+        for (it->SeekToFirst(); it->Valid(); it->Next()) {
+            if (!it->IsDeletion()) keys.emplace_back(it->key());
+        }
         return keys;
     }
 
+    /**
+     * Sequential scan for compaction.  Blocks bypass the cache so a
+     * scan doesn't evict hot blocks, and the file is advised for
+     * read-ahead while the iterator lives.  The reader must outlive it.
+     */
+    std::unique_ptr<KVIterator> NewIterator() const {
+        EnsureLoaded();
+        return std::unique_ptr<KVIterator>(new Iterator(this));
+    }
+
 private:
-    void Load() {
-        std::ifstream file(filepath_, std::ios::binary | std::ios::ate);
-        if (!file.is_open()) { valid_ = false; return; }
+    class Iterator : public KVIterator {
+    public:
+        explicit Iterator(const SSTableReader* table) : table_(table) {
+            if (!table_->valid_) return;
+            if (table_->legacy_) {
+                for (const auto& kv : table_->legacy_index_) legacy_.push_back(kv);
+                std::sort(legacy_.begin(), legacy_.end(),
+                    [](const auto& a, const auto& b) { return a.first < b.first; });
+                legacy_pos_ = legacy_.size();
+            } else {
+                index_.reset(new BlockIterator(table_->index_block_));
+            }
+            table_->file_.Advise(RandomAccessFile::Access::kSequential);
+        }
 
-        auto file_size = file.tellg();
-        if (static_cast<size_t>(file_size) < sizeof(Footer)) { valid_ = false; return; }
+        ~Iterator() override {
+            if (table_->valid_) table_->file_.Advise(RandomAccessFile::Access::kRandom);
+        }
+
+        bool Valid() const override {
+            if (table_->legacy_) return legacy_pos_ < legacy_.size();
+            return !corrupt_ && data_ && data_->Valid();
+        }
+
+        void SeekToFirst() override {
+            if (table_->legacy_) { LegacyPosition(0); return; }
+            if (!index_) return;
+            index_->SeekToFirst();
+            LoadBlock();
+            if (data_) data_->SeekToFirst();
+            SkipExhaustedBlocks();
+        }
+
+        void Seek(std::string_view target) override {
+            if (table_->legacy_) {
+                auto it = std::lower_bound(legacy_.begin(), legacy_.end(), target,
+                    [](const auto& e, std::string_view t) { return std::string_view(e.first) < t; });
+                LegacyPosition(static_cast<size_t>(it - legacy_.begin()));
+                return;
+            }
+            if (!index_) return;
+            index_->Seek(target);
+            LoadBlock();
+            if (data_) data_->Seek(target);
+            SkipExhaustedBlocks();
+        }
+
+        void Next() override {
+            if (table_->legacy_) { LegacyPosition(legacy_pos_ + 1); return; }
+            data_->Next();
+            SkipExhaustedBlocks();
+        }
+
+        std::string_view key() const override {
+            if (table_->legacy_) return legacy_[legacy_pos_].first;
+            return data_->key();
+        }
+
+        std::string_view value() const override {
+            if (table_->legacy_) return legacy_value_;
+            std::string_view v = data_->value();
+            if (table_->typed_ && !v.empty()) v.remove_prefix(1);
+            return v;
+        }
+
+        bool IsDeletion() const override {
+            if (!table_->typed_ || table_->legacy_) return false;
+            std::string_view v = data_->value();
+            return !v.empty() && v[0] == kTagDeletion;
+        }
+
+    private:
+        void LoadBlock() {
+            data_.reset();
+            if (!index_->Valid()) return;
+            BlockHandle h;
+            std::shared_ptr<const std::string> block;
+            if (!DecodeHandle(index_->value(), h) || !(block = table_->ReadBlock(h, false))) {
+                corrupt_ = true;
+                return;
+            }
+            data_.reset(new BlockIterator(std::move(block)));
+        }
+
+        void SkipExhaustedBlocks() {
+            while (!corrupt_ && index_->Valid() && (!data_ || !data_->Valid())) {
+                index_->Next();
+                LoadBlock();
+                if (data_) data_->SeekToFirst();
+            }
+        }
+
+        void LegacyPosition(size_t pos) {
+            legacy_pos_ = pos;
+            while (legacy_pos_ < legacy_.size() &&
+                   !table_->ReadKVAt(legacy_[legacy_pos_].second, legacy_[legacy_pos_].first,
+                                     legacy_value_)) {
+                legacy_pos_++;
+            }
+        }
+
+        const SSTableReader*            table_;
+        std::unique_ptr<BlockIterator>  index_;
+        std::unique_ptr<BlockIterator>  data_;
+        bool                            corrupt_ = false;
+        std::vector<std::pair<std::string, BlockHandle>> legacy_;
+        size_t                          legacy_pos_ = 0;
+        std::string                     legacy_value_;
+    };
+
+    // A lazy table already has its metadata, which concurrent callers may
+    // be reading; Load() then only checks the file against it.
+    void Load() {
+        bool lazy = file_size_ != 0;
+        if (!file_.Open(filepath_, allow_mmap_)) { valid_ = false; return; }
+        if (lazy && file_.Size() != file_size_) { valid_ = false; return; }
+        if (!lazy) file_size_ = file_.Size();
+        if (file_.Size() < sizeof(Footer)) { valid_ = false; return; }
 
         // Read footer
-        file.seekg(-static_cast<int>(sizeof(Footer)), std::ios::end);
-        std::string footer_buf(sizeof(Footer), '\0');
-        file.read(&footer_buf[0], sizeof(Footer));
-        Footer footer = Footer::Deserialize(footer_buf);
-        if (footer.magic != 0xDC5F00DAULL) { valid_ = false; return; }
+        std::string scratch;
+        std::string_view footer_buf;
+        if (!file_.Read(file_.Size() - sizeof(Footer), sizeof(Footer), scratch, footer_buf)) {
+            valid_ = false;
+            return;
+        }
+        Footer footer = Footer::Deserialize(std::string(footer_buf));
+        if (footer.magic != kTableMagicV1 && footer.magic != kTableMagicV2 &&
+            footer.magic != kTableMagicV3) {
+            valid_ = false;
+            return;
+        }
+        legacy_ = (footer.magic == kTableMagicV1);
+        typed_  = (footer.magic == kTableMagicV3);
 
         // Read bloom filter
-        file.seekg(footer.meta_handle.offset);
-        std::string bloom_buf(footer.meta_handle.size, '\0');
-        file.read(&bloom_buf[0], footer.meta_handle.size);
-        bloom_ = BloomFilter::Deserialize(bloom_buf);
+        std::string_view bloom_buf;
+        if (!ReadRange(footer.meta_handle, scratch, bloom_buf) ||
+            !BloomFilter::Deserialize(bloom_buf, bloom_)) {
+            valid_ = false;
+            return;
+        }
 
         // Read index
-        file.seekg(footer.index_handle.offset);
-        std::string index_buf(footer.index_handle.size, '\0');
-        file.read(&index_buf[0], footer.index_handle.size);
-        DecodeIndex(index_buf);
+        if (legacy_) {
+            std::string_view index_buf;
+            if (!ReadRange(footer.index_handle, scratch, index_buf)) { valid_ = false; return; }
+            DecodeLegacyIndex(index_buf);
+            if (!lazy) num_entries_ = legacy_index_.size();
+        } else {
+            auto index = std::make_shared<std::string>();
+            if (!ReadBlockInto(footer.index_handle, *index)) { valid_ = false; return; }
+            index_block_ = std::move(index);
+            if (!lazy) num_entries_ = footer.num_entries;
+        }
 
         valid_ = true;
+        if (!lazy) LoadKeyRange();
+    }
+
+    // Smallest key = first key of the first block; largest = the last
+    // index entry (each index key is its block's last key).
+    void LoadKeyRange() {
+        if (legacy_) {
+            for (const auto& kv : legacy_index_) {
+                if (smallest_.empty() || kv.first < smallest_) smallest_ = kv.first;
+                if (kv.first > largest_) largest_ = kv.first;
+            }
+            return;
+        }
+        BlockIterator idx(index_block_);
+        idx.SeekToFirst();
+        if (!idx.Valid()) return;
+        BlockHandle first;
+        auto block = std::make_shared<std::string>();
+        if (DecodeHandle(idx.value(), first) && ReadBlockInto(first, *block)) {
+            BlockIterator it(std::move(block));
+            it.SeekToFirst();
+            if (it.Valid()) smallest_ = it.key();
+        }
+        for (; idx.Valid(); idx.Next()) largest_ = idx.key();
     }
 
-    void DecodeIndex(const std::string& data) {
+    bool ReadRange(const BlockHandle& h, std::string& scratch, std::string_view& out) const {
+        if (h.size > std::numeric_limits<size_t>::max()) return false;
+        return file_.Read(h.offset, static_cast<size_t>(h.size), scratch, out);
+    }
+
+    // Reads a block plus its trailer and decompresses it into `out`.
+    // A mapped file decompresses straight from the mapping.
+    bool ReadBlockInto(const BlockHandle& h, std::string& out) const {
+        std::string scratch;
+        std::string_view buf;
+        if (h.size > std::numeric_limits<uint64_t>::max() - kBlockTrailerSize ||
+            !ReadRange(BlockHandle{h.offset, h.size + kBlockTrailerSize}, scratch, buf)) {
+            return false;
+        }
+        size_t n = buf.size() - kBlockTrailerSize;
+        auto type = static_cast<BlockType>(buf[n]);
+        uint32_t raw_size = DecodeFixed32(buf.data() + n + 1);
+        if (type == BlockType::kRaw) {
+            if (raw_size != n) return false;
+            if (file_.Mapped()) {
+                out.assign(buf.data(), n);
+            } else {
+                scratch.resize(n);
+                out.swap(scratch);
+            }
+            return true;
+        }
+        if (type == BlockType::kLZ) {
+            return compression::Decompress(buf.substr(0, n), raw_size, out);
+        }
+        return false;
+    }
+
+    std::shared_ptr<const std::string> ReadBlock(const BlockHandle& h, bool fill_cache) const {
+        if (cache_) {
+            if (auto hit = cache_->Lookup(file_id_, h.offset)) return hit;
+        }
+        auto block = std::make_shared<std::string>();
+        if (!ReadBlockInto(h, *block)) return nullptr;
+        std::shared_ptr<const std::string> result = std::move(block);
+        if (cache_ && fill_cache) cache_->Insert(file_id_, h.offset, result);
+        return result;
+    }
+
+    // ── v1 compatibility ──
+
+    void DecodeLegacyIndex(std::string_view data) {
         size_t pos = 0;
         uint32_t n = 0;
+        if (data.size() < 4) return;
         std::memcpy(&n, data.data(), 4); pos += 4;
         for (uint32_t i = 0; i < n; i++) {
             uint32_t klen = 0;
+            if (data.size() - pos < 4) return;
             std::memcpy(&klen, data.data() + pos, 4); pos += 4;
+            if (data.size() - pos < static_cast<size_t>(klen) + 16) return;
             std::string key(data.data() + pos, klen); pos += klen;
             BlockHandle bh;
             std::memcpy(&bh.offset, data.data() + pos, 8); pos += 8;
             std::memcpy(&bh.size, data.data() + pos, 8); pos += 8;
-            index_[key] = bh;
+            legacy_index_[key] = bh;
         }
     }
 
+    // v1 record: u32 klen | key | u32 vlen | value
     bool ReadKVAt(const BlockHandle& bh, const std::string& expected_key,
                   std::string& value) const {
-        std::ifstream file(filepath_, std::ios::binary);
-        if (!file.is_open()) return false;
-        file.seekg(bh.offset);
-        uint32_t klen = 0;
-        file.read(reinterpret_cast<char*>(&klen), 4);
-        std::string key(klen, '\0');
-        file.read(&key[0], klen);
-        if (key != expected_key) return false;
-        uint32_t vlen = 0;
-        file.read(reinterpret_cast<char*>(&vlen), 4);
-        value.resize(vlen);
-        file.read(&value[0], vlen);
-        return file.good();
-    }
-
-    std::string filepath_;
-    bool        valid_ = false;
-    BloomFilter bloom_;
-    std::unordered_map<std::string, BlockHandle> index_;
+        std::string scratch;
+        std::string_view rec;
+        if (!ReadRange(bh, scratch, rec) || rec.size() < 4) return false;
+        uint32_t klen = DecodeFixed32(rec.data());
+        if (rec.size() - 4 < static_cast<size_t>(klen) + 4) return false;
+        if (rec.substr(4, klen) != expected_key) return false;
+        uint32_t vlen = DecodeFixed32(rec.data() + 4 + klen);
+        if (rec.size() - 8 - klen < vlen) return false;
+        value.assign(rec.data() + 8 + klen, vlen);
+        return true;
+    }
+
+    std::string      filepath_;
+    BlockCache*      cache_;
+    uint64_t         file_id_;
+    bool             allow_mmap_;
+    mutable compat::Mutex load_mu_;
+    mutable std::atomic<bool> loaded_{false};
+    RandomAccessFile file_;
+    bool             valid_ = false;
+    bool             legacy_ = false;
+    bool             typed_ = false;
+    size_t           num_entries_ = 0;
+    uint64_t         file_size_ = 0;
+    BloomFilter      bloom_;
+    std::string      smallest_;
+    std::string      largest_;
+    std::shared_ptr<const std::string> index_block_;
+    std::unordered_map<std::string, BlockHandle> legacy_index_;   // v1 files only
 };
 
 }  // namespace storage
@@ -4,14 +4,28 @@
 // Format per record:  [CRC32:4][Length:4][Type:1][Data:Length]
 // ────────────────────────────────────────────────────────────────
 
+#include <cerrno>
+#include <chrono>
 #include <cstdint>
+#include <cstdio>
 #include <cstring>
+#include <deque>
 #include <fstream>
 #include <functional>
 #include <string>
 #include <vector>
 
 #include "../compat/threading.h"
+#include "../metrics/latency.h"
+
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#include <sys/stat.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
 
 namespace dcs {
 namespace storage {
@@ -29,59 +43,260 @@ struct WALRecord {
     uint64_t      sequence;
 };
 
+// ──── Durability ───────────────────────────────────────────────
+enum class WALSyncMode {
+    kNone,       // leave it to the OS page cache
+    kInterval,   // background fdatasync every sync_interval_ms if dirty
+    kPerBatch,   // fdatasync each group commit before acknowledging it
+};
+
+inline const char* WALSyncModeName(WALSyncMode m) {
+    switch (m) {
+        case WALSyncMode::kNone:     return "none";
+        case WALSyncMode::kInterval: return "interval";
+        case WALSyncMode::kPerBatch: return "batch";
+    }
+    return "unknown";
+}
+
+struct WALOptions {
+    WALSyncMode sync_mode        = WALSyncMode::kInterval;
+    uint32_t    sync_interval_ms = 100;
+    size_t      max_group_bytes  = 1024 * 1024;   // cap on one leader's write
+};
+
+struct WALStats {
+    compat::Atomic<uint64_t> batches{0};        // group commits written
+    compat::Atomic<uint64_t> records{0};        // records across all batches
+    compat::Atomic<uint64_t> max_batch{0};      // largest group, in records
+    compat::Atomic<uint64_t> syncs{0};
+    compat::Atomic<uint64_t> sync_micros{0};    // total time in fdatasync
+    compat::Atomic<uint64_t> max_sync_micros{0};
+    metrics::LatencyHistogram append_latency;   // Append/AppendBatch, incl. waiting on the group
+};
+
+namespace wal_detail {
+
+#ifdef _WIN32
+inline int OpenAppend(const std::string& path) {
+    return _open(path.c_str(), _O_WRONLY | _O_CREAT | _O_APPEND | _O_BINARY, _S_IREAD | _S_IWRITE);
+}
+inline bool WriteAll(int fd, const char* p, size_t n) {
+    while (n > 0) {
+        int chunk = static_cast<int>(n > (1u << 30) ? (1u << 30) : n);
+        int w = _write(fd, p, static_cast<unsigned>(chunk));
+        if (w <= 0) return false;
+        p += w;
+        n -= static_cast<size_t>(w);
+    }
+    return true;
+}
+inline bool SyncFd(int fd)  { return _commit(fd) == 0; }
+inline void CloseFd(int fd) { _close(fd); }
+#else
+inline int OpenAppend(const std::string& path) {
+    return ::open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644);
+}
+inline bool WriteAll(int fd, const char* p, size_t n) {
+    while (n > 0) {
+        ssize_t w = ::write(fd, p, n);
+        if (w < 0 && errno == EINTR) continue;
+        if (w <= 0) return false;
+        p += w;
+        n -= static_cast<size_t>(w);
+    }
+    return true;
+}
+inline bool SyncFd(int fd) {
+#if defined(__APPLE__)
+    return ::fsync(fd) == 0;
+#else
+    return ::fdatasync(fd) == 0;
+#endif
+}
+inline void CloseFd(int fd) { ::close(fd); }
+#endif
+
+}  // namespace wal_detail
+
+// ──── WAL Writer ───────────────────────────────────────────────
+// Group commit: each Append queues its serialized frames.  The writer
+// at the head of the queue becomes leader, writes every queued frame
+// in one write() (and one fdatasync in kPerBatch mode) and wakes the
+// followers it covered.  Concurrent writers therefore share a syscall
+// and a sync instead of paying one each.
 class WALWriter {
 public:
-    explicit WALWriter(const std::string& filepath)
-        : filepath_(filepath), bytes_written_(0) {
-        file_.open(filepath, std::ios::binary | std::ios::app);
+    explicit WALWriter(const std::string& filepath,
+                       const WALOptions& options = WALOptions(),
+                       WALStats* stats = nullptr)
+        : filepath_(filepath), options_(options), stats_(stats ? stats : &own_stats_),
+          fd_(wal_detail::OpenAppend(filepath)), bytes_written_(0), dirty_(false),
+          stopping_(false) {
+        if (options_.sync_mode == WALSyncMode::kInterval) {
+            syncer_ = compat::Thread([this] { SyncLoop(); });
+        }
     }
 
-    ~WALWriter() {
-        if (file_.is_open()) file_.close();
-    }
+    ~WALWriter() { Close(); }
+
+    WALWriter(const WALWriter&) = delete;
+    WALWriter& operator=(const WALWriter&) = delete;
 
     bool Append(const WALRecord& record) {
-        compat::LockGuard<compat::Mutex> lock(mu_);
-        std::string serialized = Serialize(record);
-        return WriteFrame(serialized);
+        metrics::ScopedLatency timed(stats_->append_latency);
+        std::string frames;
+        EncodeFrame(frames, Serialize(record));
+        return Commit(std::move(frames), 1);
     }
 
     bool AppendBatch(const std::vector<WALRecord>& records) {
-        compat::LockGuard<compat::Mutex> lock(mu_);
-        for (const auto& rec : records) {
-            std::string serialized = Serialize(rec);
-            if (!WriteFrame(serialized)) return false;
-        }
-        return Sync();
+        if (records.empty()) return true;
+        metrics::ScopedLatency timed(stats_->append_latency);
+        std::string frames;
+        for (const auto& rec : records) EncodeFrame(frames, Serialize(rec));
+        return Commit(std::move(frames), records.size());
     }
 
+    /** Force everything written so far to stable storage. */
     bool Sync() {
-        if (!file_.is_open()) return false;
-        file_.flush();
-        return file_.good();
+        compat::LockGuard<compat::Mutex> io(io_mu_);
+        if (fd_ < 0) return false;
+        return SyncLocked();
+    }
+
+    /**
+     * Sync and close the current log, rename it to `archive_path`, and
+     * start a fresh one at the original path.  The caller must keep new
+     * appends out until this returns.
+     */
+    bool Rotate(const std::string& archive_path) {
+        compat::LockGuard<compat::Mutex> io(io_mu_);
+        if (fd_ >= 0) {
+            if (dirty_) SyncLocked();
+            wal_detail::CloseFd(fd_);
+        }
+        std::rename(filepath_.c_str(), archive_path.c_str());
+        fd_ = wal_detail::OpenAppend(filepath_);
+        bytes_written_.store(0);
+        return fd_ >= 0;
     }
 
-    size_t BytesWritten() const { return bytes_written_; }
+    size_t BytesWritten() const { return static_cast<size_t>(bytes_written_.load()); }
     const std::string& Filepath() const { return filepath_; }
+    const WALOptions& Options() const { return options_; }
 
     void Close() {
-        compat::LockGuard<compat::Mutex> lock(mu_);
-        if (file_.is_open()) {
-            file_.flush();
-            file_.close();
+        if (syncer_.joinable()) {
+            {
+                compat::LockGuard<compat::Mutex> lock(sync_mu_);
+                stopping_ = true;
+            }
+            sync_cv_.notify_all();
+            syncer_.join();
+        }
+        compat::LockGuard<compat::Mutex> io(io_mu_);
+        if (fd_ >= 0) {
+            if (dirty_ && options_.sync_mode != WALSyncMode::kNone) SyncLocked();
+            wal_detail::CloseFd(fd_);
+            fd_ = -1;
         }
     }
 
 private:
-    bool WriteFrame(const std::string& payload) {
-        if (!file_.is_open()) return false;
+    struct PendingWrite {
+        std::string     frames;
+        size_t          records;
+        bool            done = false;
+        bool            ok = false;
+        compat::CondVar cv;
+    };
+
+    bool Commit(std::string frames, size_t records) {
+        PendingWrite w;
+        w.frames  = std::move(frames);
+        w.records = records;
+
+        compat::UniqueLock<compat::Mutex> lock(mu_);
+        queue_.push_back(&w);
+        while (!w.done && queue_.front() != &w) w.cv.wait(lock);
+        if (w.done) return w.ok;
+
+        // Leader: fold in everything queued behind us, up to the cap.
+        std::string group = std::move(w.frames);
+        size_t group_records = w.records;
+        size_t covered = 1;
+        for (size_t i = 1; i < queue_.size(); i++) {
+            PendingWrite* p = queue_[i];
+            if (group.size() + p->frames.size() > options_.max_group_bytes) break;
+            group.append(p->frames);
+            group_records += p->records;
+            covered++;
+        }
+        lock.unlock();
+
+        bool ok = WriteGroup(group, group_records);
+
+        lock.lock();
+        for (size_t i = 0; i < covered; i++) {
+            PendingWrite* p = queue_.front();
+            queue_.pop_front();
+            if (p == &w) continue;
+            p->ok = ok;
+            p->done = true;
+            p->cv.notify_one();
+        }
+        if (!queue_.empty()) queue_.front()->cv.notify_one();
+        return ok;
+    }
+
+    bool WriteGroup(const std::string& group, size_t records) {
+        compat::LockGuard<compat::Mutex> io(io_mu_);
+        if (fd_ < 0) return false;
+        bool ok = wal_detail::WriteAll(fd_, group.data(), group.size());
+        bytes_written_.fetch_add(group.size());
+        dirty_ = true;
+        stats_->batches++;
+        stats_->records.fetch_add(records);
+        if (records > stats_->max_batch.load()) stats_->max_batch.store(records);
+        if (options_.sync_mode == WALSyncMode::kPerBatch) ok = SyncLocked() && ok;
+        return ok;
+    }
+
+    // io_mu_ must be held
+    bool SyncLocked() {
+        auto start = std::chrono::steady_clock::now();
+        bool ok = wal_detail::SyncFd(fd_);
+        auto us = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - start).count());
+        dirty_ = false;
+        stats_->syncs++;
+        stats_->sync_micros.fetch_add(us);
+        if (us > stats_->max_sync_micros.load()) stats_->max_sync_micros.store(us);
+        return ok;
+    }
+
+    void SyncLoop() {
+        auto interval = std::chrono::milliseconds(options_.sync_interval_ms);
+        compat::UniqueLock<compat::Mutex> lock(sync_mu_);
+        while (!stopping_) {
+            sync_cv_.wait_for(lock, interval, [this] { return stopping_; });
+            if (stopping_) break;
+            lock.unlock();
+            {
+                compat::LockGuard<compat::Mutex> io(io_mu_);
+                if (fd_ >= 0 && dirty_) SyncLocked();
+            }
+            lock.lock();
+        }
+    }
+
+    static void EncodeFrame(std::string& out, const std::string& payload) {
         uint32_t length = static_cast<uint32_t>(payload.size());
         uint32_t crc    = ComputeCRC(payload);
-        file_.write(reinterpret_cast<const char*>(&crc), 4);
-        file_.write(reinterpret_cast<const char*>(&length), 4);
-        file_.write(payload.data(), length);
-        bytes_written_ += 8 + length;
-        return file_.good();
+        out.append(reinterpret_cast<const char*>(&crc), 4);
+        out.append(reinterpret_cast<const char*>(&length), 4);
+        out.append(payload);
     }
 
     static std::string Serialize(const WALRecord& rec) {
@@ -107,9 +322,23 @@ private:
     }
 
     std::string       filepath_;
-    std::ofstream     file_;
-    size_t            bytes_written_;
-    compat::Mutex     mu_;
+    WALOptions        options_;
+    WALStats          own_stats_;
+    WALStats*         stats_;
+
+    // Writer queue (mu_) and file I/O (io_mu_: leader write, sync, rotate)
+    compat::Mutex                mu_;
+    std::deque<PendingWrite*>    queue_;
+    compat::Mutex                io_mu_;
+    int                          fd_;
+    compat::Atomic<uint64_t>     bytes_written_;
+    bool                         dirty_;
+
+    // Interval syncer
+    compat::Mutex     sync_mu_;
+    compat::CondVar   sync_cv_;
+    bool              stopping_;
+    compat::Thread    syncer_;
 };
 
 class WALReader {
@@ -1,14 +1,28 @@
 #pragma once
 
 #include "../cache/segmented_cache.h"
+#include "../cache/expiry_worker.h"
+#include "../cache/hot_keys.h"
 #include "../persistence/storage_backend.h"
 #include "../persistence/write_back_worker.h"
 #include "../compat/threading.h"
+#include "../compression/value_codec.h"
+#include "../metrics/latency.h"
+#include "tracking.h"
 
+#include <algorithm>
+#include <charconv>
+#include <iterator>
 #include <string>
+#include <string_view>
+#include <functional>
 #include <memory>
+#include <unordered_map>
+#include <unordered_set>
 #include <iostream>
 #include <chrono>
+#include <cstdio>
+#include <fstream>
 
 namespace dcs {
 namespace sync {
@@ -27,6 +41,29 @@ enum class WriteMode {
  * Read Path  (Cache-Aside):  cache hit? return : fetch from DB, populate cache, return.
  * Write Path (Write-Through): update cache, then synchronously write to DB.
  * Write Path (Write-Back):    update cache, return OK, background worker flushes.
+ *
+ * Keys may carry a TTL.  A volatile key's value reaches the backend
+ * wrapped with its deadline (ValueCodec::WrapDeadline, as wall-clock
+ * time so it survives restarts), and every read from the backend
+ * restores it, so a key evicted, flushed or reloaded keeps its TTL.  When
+ * a key expires it is removed from the backend too (as DEL would); a
+ * backend record found past its deadline is dropped the same way.
+ * Expired dirty values are never written back; see note_expired() for
+ * the race with a flush that is already in flight.
+ *
+ * Hot keys: GETs are sampled into a per-segment top-K (HOTKEYS).  Every
+ * `hot_key_interval` the hottest keys are copied into a read-mostly
+ * replica that GETs consult before taking their segment's lock, so a few
+ * dominant keys no longer serialize on one segment mutex.  Every write
+ * path calls note_write(), which drops the key's replica copy and sends
+ * CLIENT TRACKING invalidations to near caches holding it.
+ *
+ * Value compression: with `value_compression_min` set, put() packs large
+ * values once (compression::ValueCodec) and everything below — cache
+ * entries, write-back and write-through stores, the backend's WAL and
+ * tables — holds the packed form; the memory budget is charged for it
+ * too.  Values are unpacked on their way out to a reader, and the hot-key
+ * replica keeps them unpacked, so the hottest keys never pay for it.
  */
 class CacheManager {
 public:
@@ -34,19 +71,45 @@ public:
         size_t cache_capacity       = 65536;
         WriteMode write_mode        = WriteMode::WriteBack;
         std::chrono::seconds flush_interval{5};
+        cache::EvictionPolicy eviction_policy = cache::EvictionPolicy::Clock;
+        size_t segments             = 0;  // 0 = scale with core count
+        size_t max_memory           = 0;  // bytes; non-zero replaces cache_capacity
+        std::chrono::milliseconds expiry_interval{100};  // active-expiry pass period
+        size_t hot_key_replicas     = 32;    // hottest keys served without a segment lock; 0 = off
+        double hot_key_min_share    = 0.01;  // of sampled GETs, to qualify for the replica
+        unsigned hot_key_sample_shift = 4;   // sample one GET in 2^n for hot-key detection
+        std::chrono::milliseconds hot_key_interval{1000};  // replica refresh period
+        size_t value_compression_min = 0;    // bytes; larger values are stored compressed; 0 = off
     };
 
+    /** Sampled hits a key needs (besides its share) before it is replicated. */
+    static constexpr uint64_t kMinHotSamples = 8;
+
     CacheManager(Config cfg, persistence::StorageBackend* backend)
         : config_(cfg)
-        , cache_(cfg.cache_capacity)
+        , cache_(cfg.cache_capacity, cfg.eviction_policy, cfg.segments, cfg.max_memory)
         , backend_(backend)
+        , segment_latency_(new metrics::LatencyHistogram[cache_.segment_count()])
+        , hot_keys_(cache_.segment_count(), cfg.hot_key_sample_shift)
+        , codec_(cfg.value_compression_min)
     {
-        // Set eviction callback: on eviction of dirty data, persist it.
+        // Set eviction callback: on eviction of dirty data (or data whose
+        // write-back batch is still in flight), persist it.
         cache_.set_eviction_callback(
-            [this](const std::string& key, const std::string& value, bool dirty) {
-                if (dirty && backend_) {
-                    backend_->store(key, value);
-                }
+            [this](const std::string& key, const std::string& value, bool dirty, uint64_t expire_at) {
+                if (!dirty || !backend_) return;
+                std::string framed;
+                if (expire_at) framed = with_deadline(value, expire_at);
+                const std::string& stored = expire_at ? framed : value;
+                if (wb_worker_) wb_worker_->store_now(key, stored);
+                else backend_->store(key, stored);
+            });
+        cache_.set_expiry_callback(
+            [this](const std::string& key, bool) {
+                tracking_.invalidate(key);   // replica entries carry their own deadline
+                if (!backend_) return;
+                backend_->remove(key);
+                note_expired(key);
             });
 
         // Start write-back worker if in WriteBack mode
@@ -54,11 +117,39 @@ public:
             wb_worker_ = std::make_unique<persistence::WriteBackWorker>(
                 backend_,
                 config_.flush_interval,
-                [this]() { return cache_.dirty_entries(); },
-                [this](const std::string& key) { cache_.clear_dirty(key); }
+                [this](size_t max, persistence::WriteBackWorker::Entries& out) {
+                    begin_flush_pass();
+                    std::vector<cache::DirtyEntry> drained;
+                    size_t taken = cache_.drain_dirty(max, drained);
+                    out.reserve(out.size() + drained.size());
+                    for (auto& e : drained) {
+                        if (e.expire_at) e.value = with_deadline(e.value, e.expire_at);
+                        out.emplace_back(std::move(e.key), std::move(e.value));
+                    }
+                    return taken;
+                },
+                [this]() { return cache_.dirty_count(); },
+                [this](const std::string& key, bool ok) {
+                    cache_.settle_flush(key, ok);
+                    if (ok) undo_if_expired(key);
+                }
             );
             wb_worker_->start();
         }
+
+        expiry_worker_ = std::make_unique<cache::ExpiryWorker>(&cache_, config_.expiry_interval);
+        expiry_worker_->start();
+
+        if (config_.hot_key_replicas && config_.hot_key_interval.count() > 0) {
+            hot_running_ = true;
+            hot_thread_ = compat::Thread([this] { hot_key_loop(); });
+        }
+
+        if (backend_) {
+            std::vector<std::string> probe;
+            bool done;
+            ordered_scan_ = backend_->scan("", "", 0, probe, done);
+        }
     }
 
     ~CacheManager() {
@@ -71,41 +162,176 @@ public:
      * GET — Cache-Aside pattern.
      *   1. Check cache (fast).
      *   2. On miss, load from DB (slow), insert into cache, return.
+     * Takes a view so RESP GETs hit the cache without copying the key.
+     * Replicated hot keys are answered before the segment is locked.
+     * Compressed values are unpacked before they are returned.
+     * Timed into the replica, hit or miss histogram (a miss includes the
+     * backend load) and into the key's segment histogram.
      */
-    cache::CacheResult get(const std::string& key) {
+    cache::CacheResult get(std::string_view key) {
+        const uint64_t t0 = metrics::now_ns();
+        const size_t seg = cache_.segment_index(key);
+        hot_keys_.record(seg, key);
+
+        // Step 0: Hot-key replica (no segment lock)
+        cache::CacheResult result = cache::CacheResult::Miss();
+        if (replica_.lookup(key, result.value)) {
+            result.hit = true;
+            stats_.cache_hits++;
+            record_get(seg, get_replica_latency_, t0);
+            return result;
+        }
+
         // Step 1: Check cache
-        auto result = cache_.get(key);
+        result = cache_.get(key);
         if (result.hit) {
+            codec_.DecodeInPlace(result.value);
             stats_.cache_hits++;
+            record_get(seg, get_hit_latency_, t0);
             return result;
         }
 
         // Step 2: Cache miss — fetch from backend
         stats_.cache_misses++;
-        if (!backend_) return cache::CacheResult::Miss();
+        result = load_from_backend(key);
+        if (result.hit) codec_.DecodeInPlace(result.value);
+        record_get(seg, get_miss_latency_, t0);
+        return result;
+    }
+
+    /**
+     * MGET — batch Cache-Aside.  One cache pass grouped by segment, then
+     * every miss goes to the backend in a single batch_load() and the
+     * found values are filled back in one more grouped pass.
+     */
+    std::vector<cache::CacheResult> get_many(const std::vector<std::string_view>& keys) {
+        for (const auto& k : keys) hot_keys_.record(cache_.segment_index(k), k);
+        auto results = cache_.get_many(keys);
 
-        auto db_val = backend_->load(key);
-        if (!db_val.found) {
-            return cache::CacheResult::Miss();  // not in DB either
+        std::vector<size_t> misses;
+        for (size_t i = 0; i < results.size(); ++i) {
+            if (!results[i].hit) misses.push_back(i);
         }
+        stats_.cache_hits.fetch_add(static_cast<uint64_t>(results.size() - misses.size()));
+        stats_.cache_misses.fetch_add(static_cast<uint64_t>(misses.size()));
+        if (misses.empty() || !backend_) return unpacked(std::move(results));
 
-        // Step 3: Populate cache (don't mark dirty — it's already in DB)
-        cache_.put(key, db_val.value);
-        cache_.clear_dirty(key);  // came from DB, so it's clean
-        return cache::CacheResult::Hit(db_val.value);
+        std::vector<std::string> miss_keys;
+        miss_keys.reserve(misses.size());
+        for (size_t i : misses) miss_keys.emplace_back(keys[i]);
+        auto loaded = backend_->batch_load(miss_keys);
+
+        std::vector<std::pair<std::string_view, std::string_view>> fills;
+        for (size_t j = 0; j < misses.size() && j < loaded.size(); ++j) {
+            uint64_t expire_at;
+            if (!loaded[j].found || !restore(keys[misses[j]], loaded[j].value, expire_at)) continue;
+            results[misses[j]] = cache::CacheResult::Hit(loaded[j].value);
+            if (expire_at) fill(keys[misses[j]], loaded[j].value, expire_at);
+            else fills.emplace_back(keys[misses[j]], loaded[j].value);
+        }
+        if (!fills.empty()) cache_.put_many(fills, /*dirty=*/false);  // already in DB
+        return unpacked(std::move(results));
     }
 
     // ── Write Path ─────────────────────────────────────────────────
 
     /**
      * PUT — Dispatches to WriteThrough or WriteBack based on config.
+     * The value is compressed here, once, if it qualifies.
      */
-    bool put(const std::string& key, const std::string& value) {
+    bool put(const std::string& key, const std::string& value, uint64_t expire_at = 0) {
+        std::string packed;
+        const std::string& stored = codec_.Encode(value, packed) ? packed : value;
         if (config_.write_mode == WriteMode::WriteThrough) {
-            return put_write_through(key, value);
+            return put_write_through(key, stored, expire_at);
         } else {
-            return put_write_back(key, value);
+            return put_write_back(key, stored, expire_at);
+        }
+    }
+
+    // ── Expiry ─────────────────────────────────────────────────────
+
+    /**
+     * EXPIRE — set a TTL deadline (cache::steady_now_ms() base).  A key
+     * that only lives in the backend is loaded first, since the TTL is
+     * tracked by the cache entry; the new deadline then reaches the
+     * backend like a write.  Returns false if the key doesn't exist.
+     */
+    bool expire(const std::string& key, uint64_t expire_at) {
+        bool ok = cache_.expire(key, expire_at) ||
+                  (load_from_backend(key).hit && cache_.expire(key, expire_at));
+        if (!ok) return false;
+        note_write(key);
+        store_ttl(key);
+        return true;
+    }
+
+    /** PERSIST — drop a key's TTL.  True if it had one. */
+    bool persist(const std::string& key) {
+        bool ok = cache_.persist(key) || (load_from_backend(key).hit && cache_.persist(key));
+        if (!ok) return false;
+        note_write(key);
+        store_ttl(key);
+        return true;
+    }
+
+    /** Remaining TTL in ms: -2 if the key doesn't exist, -1 if it has no TTL. */
+    int64_t ttl_ms(const std::string& key) {
+        int64_t ttl = cache_.ttl_ms(key);
+        if (ttl != -2 || !backend_) return ttl;
+        std::string value;
+        uint64_t expire_at;
+        if (!load_stored(key, value, expire_at)) return -2;
+        if (!expire_at) return -1;
+        uint64_t now = cache::steady_now_ms();
+        return expire_at > now ? static_cast<int64_t>(expire_at - now) : -2;
+    }
+
+    /**
+     * MSET — batch PUT.  Write-through persists the whole batch with one
+     * batch_store() and only then clears the entries' dirty flags.
+     */
+    bool put_many(const std::vector<std::pair<std::string_view, std::string_view>>& raw) {
+        std::vector<std::string> packed(raw.size());
+        auto entries = raw;
+        for (size_t i = 0; i < raw.size(); ++i) {
+            if (codec_.Encode(raw[i].second, packed[i])) entries[i].second = packed[i];
+        }
+        cache_.put_many(entries);
+        for (const auto& e : entries) note_write(e.first);
+        if (config_.write_mode == WriteMode::WriteBack) {
+            for (const auto& e : entries) clear_expired_mark(std::string(e.first));
+            stats_.write_back_count.fetch_add(static_cast<uint64_t>(entries.size()));
+            return true;
+        }
+        if (backend_) {
+            std::vector<std::pair<std::string, std::string>> batch;
+            batch.reserve(entries.size());
+            for (const auto& e : entries) batch.emplace_back(std::string(e.first), std::string(e.second));
+            if (!backend_->batch_store(batch)) {
+                std::cerr << "[WriteThrough] DB batch write failed (" << batch.size() << " keys)\n";
+                return false;
+            }
+            std::vector<std::string_view> keys;
+            keys.reserve(entries.size());
+            for (const auto& e : entries) keys.push_back(e.first);
+            cache_.clear_dirty_many(keys);
+        }
+        stats_.write_through_count.fetch_add(static_cast<uint64_t>(entries.size()));
+        return true;
+    }
+
+    /**
+     * Multi-key DELETE from cache and backend.  Like del(), every key
+     * given counts as deleted (the backend can't cheaply say otherwise).
+     */
+    size_t del_many(const std::vector<std::string_view>& keys) {
+        cache_.del_many(keys);
+        for (const auto& k : keys) note_write(k);
+        if (backend_) {
+            for (const auto& k : keys) backend_->remove(std::string(k));
         }
+        return keys.size();
     }
 
     /**
@@ -113,6 +339,7 @@ public:
      */
     bool del(const std::string& key) {
         cache_.del(key);
+        note_write(key);
         if (backend_) {
             backend_->remove(key);
         }
@@ -122,9 +349,210 @@ public:
     // ── Admin ──────────────────────────────────────────────────────
 
     bool exists(const std::string& key) { return cache_.exists(key); }
+    size_t exists_many(const std::vector<std::string_view>& keys) const { return cache_.exists_many(keys); }
     size_t size() const { return cache_.size(); }
     std::vector<std::string> keys() const { return cache_.keys(); }
 
+    struct ScanPage {
+        std::string cursor = "0";         // "0" once the scan is complete
+        std::vector<std::string> keys;
+        bool valid = true;                // false: malformed cursor
+    };
+
+    /**
+     * SCAN — one bounded batch of the key space, examining at most
+     * `count` keys that start with `prefix`.
+     *
+     * With an ordered backend the backend's keys are walked in order and
+     * the cursor spells out the key to resume after, so a batch costs one
+     * seek no matter how far in it is, and a cursor can be retried or
+     * held for as long as the client likes.  Keys the backend doesn't
+     * hold yet (dirty, or in a write-back batch in flight) are merged
+     * into the page whose range covers them.  Otherwise the cache is
+     * walked one segment at a time and the cursor is the next segment
+     * index.
+     */
+    ScanPage scan(std::string_view cursor, const std::string& prefix, size_t count) {
+        ScanPage page;
+        if (count == 0) count = 1;
+        if (ordered_scan_) {
+            std::string after;
+            if (cursor != "0" && !decode_scan_cursor(cursor, after)) {
+                page.valid = false;
+                return page;
+            }
+            // The cache first: a key that stops being unpersisted after
+            // this has been stored, so the backend scan below sees it.
+            auto pending = cache_.unpersisted_keys(prefix, after);
+            std::vector<std::string> stored;
+            bool done = true;
+            backend_->scan(after, prefix, count, stored, done);
+            if (stored.empty()) done = true;
+            // This page covers (after, last stored key]; beyond it is the next page's
+            auto end = done ? pending.end() : std::upper_bound(pending.begin(), pending.end(), stored.back());
+            page.keys.reserve(stored.size() + static_cast<size_t>(end - pending.begin()));
+            std::set_union(stored.begin(), stored.end(), pending.begin(), end, std::back_inserter(page.keys));
+            if (!done) page.cursor = encode_scan_cursor(stored.back());
+            return page;
+        }
+
+        uint64_t seg;
+        size_t n = cache_.segment_count();
+        auto r = std::from_chars(cursor.data(), cursor.data() + cursor.size(), seg);
+        if (r.ec != std::errc() || r.ptr != cursor.data() + cursor.size() || seg >= n) {
+            page.valid = false;
+            return page;
+        }
+        while (seg < n && page.keys.size() < count) {
+            for (auto& k : cache_.segment_keys(static_cast<size_t>(seg++))) {
+                if (k.compare(0, prefix.size(), prefix) == 0) page.keys.push_back(std::move(k));
+            }
+        }
+        if (seg < n) page.cursor = std::to_string(seg);
+        return page;
+    }
+
+    // ── Slot migration ─────────────────────────────────────────────
+
+    /** EXISTS that also consults the backend (for keys evicted from the cache). */
+    bool contains(const std::string& key) {
+        if (cache_.exists(key)) return true;
+        std::string value;
+        uint64_t expire_at;
+        return backend_ && load_stored(key, value, expire_at);
+    }
+
+    /**
+     * Every key (cache, and the backend when it can iterate) for which
+     * `match` holds.  A full walk: meant for rare whole-keyspace jobs
+     * such as collecting the keys of slots about to move.
+     */
+    std::vector<std::string> keys_where(const std::function<bool(const std::string&)>& match) {
+        std::unordered_set<std::string> seen;
+        std::vector<std::string> out;
+        for (auto& k : cache_.keys()) {
+            if (match(k) && seen.insert(k).second) out.push_back(std::move(k));
+        }
+        if (ordered_scan_) {
+            std::string after;
+            bool done = false;
+            while (!done) {
+                std::vector<std::string> batch;
+                if (!backend_->scan(after, "", 1024, batch, done) || batch.empty()) break;
+                after = batch.back();
+                for (auto& k : batch) {
+                    if (match(k) && seen.insert(k).second) out.push_back(std::move(k));
+                }
+            }
+        }
+        return out;
+    }
+
+    /**
+     * Remove a key from cache and backend, handing back its value and
+     * remaining TTL in ms (-1 = none).  False if it doesn't exist.
+     */
+    bool take(const std::string& key, std::string& value, int64_t& ttl_ms) {
+        uint64_t expire_at = 0;
+        bool found = cache_.take(key, value, expire_at);
+        note_write(key);
+        if (!found && backend_) found = load_stored(key, value, expire_at);
+        // A write-back batch may still hold the key: strike it or wait for it
+        if (wb_worker_) wb_worker_->remove_now(key);
+        else if (backend_) backend_->remove(key);
+        if (!found) return false;
+        codec_.DecodeInPlace(value);
+        uint64_t now = cache::steady_now_ms();
+        if (expire_at && expire_at <= now) return false;
+        ttl_ms = expire_at ? static_cast<int64_t>(expire_at - now) : -1;
+        return true;
+    }
+
+    /**
+     * Store a key moved here from another node unless it already exists:
+     * a local copy was written after the move began and is newer.
+     * `ttl_ms` as from take().  Returns true if stored.
+     */
+    bool import_entry(const std::string& key, const std::string& raw, int64_t ttl_ms) {
+        std::string existing;
+        uint64_t expire_at;
+        if (backend_ && load_stored(key, existing, expire_at)) return false;
+        std::string packed;
+        const std::string& value = codec_.Encode(raw, packed) ? packed : raw;
+        expire_at = ttl_ms >= 0 ? cache::steady_now_ms() + static_cast<uint64_t>(ttl_ms) : 0;
+        if (!cache_.put_if_absent(key, value, expire_at)) return false;
+        note_write(key);
+        if (config_.write_mode == WriteMode::WriteThrough && backend_) {
+            if (!backend_->store(key, expire_at ? with_deadline(value, expire_at) : value)) return false;
+            cache_.clear_dirty(key);
+        } else {
+            clear_expired_mark(key);
+        }
+        return true;
+    }
+
+    // ── Warm restart ───────────────────────────────────────────────
+
+    /**
+     * Persist up to `limit` of the hottest keys to `path` (keys only,
+     * each as u32 length + bytes), replacing the file atomically.
+     */
+    bool save_hot_keys(const std::string& path, size_t limit) const {
+        auto keys = cache_.hot_keys(limit);
+        std::string tmp = path + ".tmp";
+        {
+            std::ofstream f(tmp, std::ios::binary | std::ios::trunc);
+            if (!f.is_open()) return false;
+            for (const auto& k : keys) {
+                uint32_t len = static_cast<uint32_t>(k.size());
+                f.write(reinterpret_cast<const char*>(&len), 4);
+                f.write(k.data(), len);
+            }
+            f.flush();
+            if (!f.good()) return false;
+        }
+#ifdef _WIN32
+        std::remove(path.c_str());
+#endif
+        return std::rename(tmp.c_str(), path.c_str()) == 0;
+    }
+
+    /**
+     * Load the keys listed by save_hot_keys() from the backend into the
+     * cache (clean, with their TTLs), `batch` keys per batch_load().
+     * Meant to run before clients connect, so it never races a newer
+     * write.  Returns the number of keys warmed.
+     */
+    size_t prewarm(const std::string& path, size_t batch = 1024) {
+        std::ifstream f(path, std::ios::binary);
+        if (!f.is_open() || !backend_) return 0;
+        size_t warmed = 0;
+        std::vector<std::string> keys;
+        auto load_batch = [&]() {
+            auto loaded = backend_->batch_load(keys);
+            std::vector<std::pair<std::string_view, std::string_view>> fills;
+            for (size_t i = 0; i < keys.size() && i < loaded.size(); ++i) {
+                uint64_t expire_at;
+                if (!loaded[i].found || !restore(keys[i], loaded[i].value, expire_at)) continue;
+                if (expire_at) fill(keys[i], loaded[i].value, expire_at);
+                else fills.emplace_back(keys[i], loaded[i].value);
+                ++warmed;
+            }
+            if (!fills.empty()) cache_.put_many(fills, /*dirty=*/false);
+            keys.clear();
+        };
+        uint32_t len = 0;
+        while (f.read(reinterpret_cast<char*>(&len), 4)) {
+            if (len > 64 * 1024 * 1024) break;
+            std::string key(len, '\0');
+            if (!f.read(&key[0], len)) break;
+            keys.push_back(std::move(key));
+            if (keys.size() >= batch) load_batch();
+        }
+        if (!keys.empty()) load_batch();
+        return warmed;
+    }
+
     /** Force immediate flush of dirty data (write-back mode). */
     void flush() {
         if (wb_worker_) wb_worker_->flush();
@@ -135,16 +563,59 @@ public:
         cache_.clear();   // eviction callback persists dirty data first
         // Not clearing backend on purpose for persistence semantics,
         // but to match Redis FLUSHALL we need an empty cache.
+        replica_.clear();
+        tracking_.invalidate_all();
     }
 
+    // ── Hot keys ───────────────────────────────────────────────────
+
+    /** The `n` most-read keys by sampled GETs, hottest first (HOTKEYS). */
+    std::vector<cache::HotKeyTracker::HotKey> hottest_keys(size_t n) const { return hot_keys_.top(n); }
+
+    /**
+     * Re-pick the replica from the tracker: up to `hot_key_replicas` of
+     * the hottest keys with at least `hot_key_min_share` of sampled GETs.
+     * Runs every `hot_key_interval`; returns the number now replicated.
+     */
+    size_t refresh_hot_keys() {
+        if (!config_.hot_key_replicas) return 0;
+        const uint64_t min_hits = kMinHotSamples << hot_keys_.sample_shift();
+        std::vector<std::string> keys;
+        for (auto& h : hot_keys_.top(config_.hot_key_replicas)) {
+            if (h.share >= config_.hot_key_min_share && h.hits >= min_hits) keys.push_back(std::move(h.key));
+        }
+        replica_.rebuild(std::move(keys), [this](const std::string& k, std::string& v, uint64_t& expire_at) {
+            if (!cache_.peek(k, v, expire_at)) return false;
+            codec_.DecodeInPlace(v);   // replicated values are served unpacked
+            return true;
+        });
+        return replica_.size();
+    }
+
+    /** Keys the replica currently serves, sorted. */
+    std::vector<std::string> replicated_keys() const { return replica_.keys(); }
+
+    /** Near-cache invalidation registry for CLIENT TRACKING. */
+    TrackingTable& tracking() { return tracking_; }
+    const TrackingTable& tracking() const { return tracking_; }
+
     /** Graceful shutdown: flush dirty data, stop worker. */
     void shutdown() {
+        if (hot_running_.exchange(false)) {
+            hot_cv_.notify_all();
+            if (hot_thread_.joinable()) hot_thread_.join();
+        }
+        if (expiry_worker_) {
+            expiry_worker_->stop();
+            expiry_worker_.reset();
+        }
         if (wb_worker_) {
             wb_worker_->stop();
             wb_worker_.reset();
         }
         // Final eviction flush
         cache_.clear();
+        replica_.clear();
     }
 
     struct Stats {
@@ -157,19 +628,239 @@ public:
     const Stats& stats() const { return stats_; }
     WriteMode write_mode() const { return config_.write_mode; }
     std::vector<size_t> segment_sizes() const { return cache_.segment_sizes(); }
+    size_t segment_count() const { return cache_.segment_count(); }
+    size_t memory_bytes() const { return cache_.memory_bytes(); }
+    size_t payload_bytes() const { return cache_.payload_bytes(); }
+    size_t max_memory() const { return cache_.max_memory(); }
+    size_t used_memory() const { return cache_.used_memory(); }
+    uint64_t budget_evictions() const { return cache_.budget_evictions(); }
+    uint64_t admission_rejections() const { return cache_.admission_rejections(); }
+    size_t volatile_count() const { return cache_.volatile_count(); }
+    size_t dirty_count() const { return cache_.dirty_count(); }
+    uint64_t flush_lag_ms() const { return cache_.flush_lag_ms(); }
+    uint64_t flushed_entries() const { return wb_worker_ ? wb_worker_->flushed_entries() : 0; }
+    uint64_t expired_count() const { return cache_.expired_count(); }
+    cache::EvictionPolicy eviction_policy() const { return cache_.policy(); }
+    size_t segment_index(const std::string& key) const { return cache_.segment_index(key); }
+
+    /** GET latency of keys in segment `i` (hits and misses). */
+    metrics::LatencySnapshot segment_latency(size_t i) const {
+        return i < cache_.segment_count() ? segment_latency_[i].snapshot() : metrics::LatencySnapshot();
+    }
+
+    /** Value compression: what put() packed and what reads unpacked. */
+    const compression::ValueCodec& value_codec() const { return codec_; }
+
+    /**
+     * GET hit/miss/replica-hit latency, value compress/decompress time,
+     * then the backend's histograms.
+     */
+    void collect_latency(metrics::LatencyReport& out) const {
+        out.emplace_back("cache_get_hit", get_hit_latency_.snapshot());
+        out.emplace_back("cache_get_miss", get_miss_latency_.snapshot());
+        out.emplace_back("cache_get_replica", get_replica_latency_.snapshot());
+        out.emplace_back("value_compress", codec_.GetStats().compress_latency.snapshot());
+        out.emplace_back("value_decompress", codec_.GetStats().decompress_latency.snapshot());
+        if (backend_) backend_->collect_latency(out);
+    }
 
 private:
+    void record_get(size_t seg, metrics::LatencyHistogram& h, uint64_t t0) {
+        uint64_t ns = metrics::now_ns() - t0;
+        h.record_ns(ns);
+        segment_latency_[seg].record_ns(ns);
+    }
+
+    /** Stored values of `results` back in client form. */
+    std::vector<cache::CacheResult> unpacked(std::vector<cache::CacheResult> results) {
+        for (auto& r : results) {
+            if (r.hit) codec_.DecodeInPlace(r.value);
+        }
+        return results;
+    }
+
+    /** Every write path, once the cache holds the new state of `key`. */
+    void note_write(std::string_view key) {
+        replica_.invalidate(key);
+        tracking_.invalidate(key);
+    }
+
+    void hot_key_loop() {
+        while (hot_running_.load()) {
+            compat::UniqueLock<compat::Mutex> lock(hot_mu_);
+            hot_cv_.wait_for(lock, config_.hot_key_interval, [this] { return !hot_running_.load(); });
+            if (!hot_running_.load()) break;
+            lock.unlock();
+            refresh_hot_keys();
+        }
+    }
+
+    /** Read-through fill: load `key` from the backend into the cache (clean). */
+    cache::CacheResult load_from_backend(std::string_view key) {
+        if (!backend_) return cache::CacheResult::Miss();
+
+        std::string value;
+        uint64_t expire_at;
+        if (!load_stored(std::string(key), value, expire_at)) {
+            return cache::CacheResult::Miss();  // not in DB either, or expired there
+        }
+
+        fill(key, value, expire_at);
+        return {true, std::move(value)};
+    }
+
+    /** Populate the cache from the backend (don't mark dirty — it's already in DB). */
+    void fill(std::string_view key, std::string_view stored, uint64_t expire_at) {
+        cache_.put(key, stored, expire_at);
+        cache_.clear_dirty(key);  // came from DB, so it's clean
+    }
+
+    // ── Backend value form ─────────────────────────────────────────
+
+    static uint64_t unix_now_ms() {
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count());
+    }
+
+    /** What the backend stores for a stored value expiring at `expire_at` (steady base). */
+    static std::string with_deadline(std::string_view stored, uint64_t expire_at) {
+        uint64_t now = cache::steady_now_ms();
+        uint64_t left = expire_at > now ? expire_at - now : 0;
+        return compression::ValueCodec::WrapDeadline(stored, unix_now_ms() + left);
+    }
+
+    /**
+     * Turn a value read from the backend back into its stored form and
+     * `expire_at` (steady base, 0 = none).  False if its deadline has
+     * already passed; the record is then dropped via drop_expired().
+     */
+    bool restore(std::string_view key, std::string& value, uint64_t& expire_at) {
+        std::string_view stored;
+        uint64_t unix_ms;
+        expire_at = 0;
+        if (!compression::ValueCodec::UnwrapDeadline(value, stored, unix_ms)) return true;
+        uint64_t now = unix_now_ms();
+        if (unix_ms <= now) {
+            drop_expired(key);
+            return false;
+        }
+        expire_at = cache::steady_now_ms() + (unix_ms - now);
+        value.erase(0, compression::ValueCodec::kDeadlineHeaderSize);
+        return true;
+    }
+
+    /** Backend value of `key` in stored form, with its deadline; false if absent or expired. */
+    bool load_stored(const std::string& key, std::string& value, uint64_t& expire_at) {
+        auto loaded = backend_->load(key);
+        if (!loaded.found) return false;
+        value = std::move(loaded.value);
+        return restore(key, value, expire_at);
+    }
+
+    /**
+     * A backend record found past its deadline.  The cache's expiry path
+     * removes it from the backend under the key's segment lock, ordered
+     * against a write racing this read (a live entry is left alone).
+     */
+    void drop_expired(std::string_view key) {
+        cache_.expire_absent(key);
+    }
+
+    /**
+     * Make a TTL change on a cached key reach the backend: write-back
+     * queues the entry for the next flush, write-through rewrites it now.
+     */
+    void store_ttl(const std::string& key) {
+        if (!backend_) return;
+        if (config_.write_mode == WriteMode::WriteBack) {
+            if (cache_.mark_dirty(key)) clear_expired_mark(key);
+            return;
+        }
+        std::string value;
+        uint64_t expire_at;
+        if (!cache_.peek(key, value, expire_at)) return;
+        backend_->store(key, expire_at ? with_deadline(value, expire_at) : value);
+    }
+
+    /**
+     * A write-back batch is drained from the cache, then stored.  A key
+     * that expires in between has already been removed from the backend,
+     * and the batch would store it again.  Keys expiring while a batch may
+     * be in flight are remembered here; the worker removes them once more
+     * after storing.  A rewrite of the key clears the mark (it is live again).
+     */
+    void note_expired(const std::string& key) {
+        if (config_.write_mode != WriteMode::WriteBack) return;
+        compat::LockGuard<compat::Mutex> lock(expired_mu_);
+        expired_since_pass_.insert(key);
+        has_expired_.store(true);
+    }
+
+    void begin_flush_pass() {
+        compat::LockGuard<compat::Mutex> lock(expired_mu_);
+        expired_since_pass_.clear();
+        has_expired_.store(false);
+    }
+
+    void undo_if_expired(const std::string& key) {
+        if (!has_expired_.load()) return;
+        compat::LockGuard<compat::Mutex> lock(expired_mu_);
+        if (expired_since_pass_.erase(key)) backend_->remove(key);
+    }
+
+    void clear_expired_mark(const std::string& key) {
+        if (!has_expired_.load()) return;
+        compat::LockGuard<compat::Mutex> lock(expired_mu_);
+        expired_since_pass_.erase(key);
+    }
+
+    // Ordered-SCAN cursors carry the key to resume after, as "1" then
+    // three decimal digits per byte: still a number, for clients that
+    // parse cursors as integers, and never "0".
+    static std::string encode_scan_cursor(std::string_view resume_after) {
+        std::string out;
+        out.reserve(1 + 3 * resume_after.size());
+        out.push_back('1');
+        for (unsigned char c : resume_after) {
+            out.push_back(static_cast<char>('0' + c / 100));
+            out.push_back(static_cast<char>('0' + c / 10 % 10));
+            out.push_back(static_cast<char>('0' + c % 10));
+        }
+        return out;
+    }
+
+    static bool decode_scan_cursor(std::string_view cursor, std::string& resume_after) {
+        if (cursor.empty() || cursor[0] != '1' || (cursor.size() - 1) % 3 != 0) return false;
+        resume_after.clear();
+        resume_after.reserve((cursor.size() - 1) / 3);
+        for (size_t i = 1; i < cursor.size(); i += 3) {
+            unsigned v = 0;
+            for (size_t j = i; j < i + 3; ++j) {
+                if (cursor[j] < '0' || cursor[j] > '9') return false;
+                v = v * 10 + static_cast<unsigned>(cursor[j] - '0');
+            }
+            if (v > 255) return false;
+            resume_after.push_back(static_cast<char>(v));
+        }
+        return true;
+    }
+
     /**
      * Write-Through: Cache + DB written synchronously.
      * Returns OK only after DB confirms success.
      */
-    bool put_write_through(const std::string& key, const std::string& value) {
+    bool put_write_through(const std::string& key, const std::string& value, uint64_t expire_at) {
         // Step 1: Update cache
-        cache_.put(key, value);
+        cache_.put(key, value, expire_at);
+        note_write(key);
 
-        // Step 2: Synchronously write to DB
+        // Step 2: Synchronously write to DB, with the TTL the entry ended up with
         if (backend_) {
-            bool ok = backend_->store(key, value);
+            if (expire_at == cache::kKeepTTL) {
+                std::string current;
+                if (!cache_.peek(key, current, expire_at)) expire_at = 0;
+            }
+            bool ok = backend_->store(key, expire_at ? with_deadline(value, expire_at) : value);
             if (!ok) {
                 std::cerr << "[WriteThrough] DB write failed for key: " << key << "\n";
                 return false;
@@ -185,8 +876,10 @@ private:
      * Write-Back: Cache updated immediately, DB synced in background.
      * Returns OK right away — dirty flag is set on the cache entry.
      */
-    bool put_write_back(const std::string& key, const std::string& value) {
-        cache_.put(key, value);  // dirty flag set inside LRUCache::put
+    bool put_write_back(const std::string& key, const std::string& value, uint64_t expire_at) {
+        cache_.put(key, value, expire_at);  // dirty flag set inside LRUCache::put
+        note_write(key);
+        clear_expired_mark(key);
         stats_.write_back_count++;
         return true;
     }
@@ -195,7 +888,27 @@ private:
     cache::SegmentedCache cache_;
     persistence::StorageBackend* backend_;   // non-owning
     std::unique_ptr<persistence::WriteBackWorker> wb_worker_;
+    std::unique_ptr<cache::ExpiryWorker> expiry_worker_;
     Stats stats_;
+    metrics::LatencyHistogram get_hit_latency_;
+    metrics::LatencyHistogram get_miss_latency_;
+    metrics::LatencyHistogram get_replica_latency_;
+    std::unique_ptr<metrics::LatencyHistogram[]> segment_latency_;   // one per cache segment
+
+    cache::HotKeyTracker hot_keys_;
+    cache::HotReplica replica_;
+    TrackingTable tracking_;
+    compression::ValueCodec codec_;
+    compat::Atomic<bool> hot_running_{false};
+    compat::Thread hot_thread_;
+    compat::Mutex hot_mu_;
+    compat::CondVar hot_cv_;
+
+    compat::Mutex expired_mu_;                          // leaf lock
+    std::unordered_set<std::string> expired_since_pass_;
+    compat::Atomic<bool> has_expired_{false};
+
+    bool ordered_scan_ = false;                         // backend supports scan()
 };
 
 }  // namespace sync
@@ -0,0 +1,194 @@
+#pragma once
+
+#include "../compat/threading.h"
+
+#include <algorithm>
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace dcs {
+namespace sync {
+
+/**
+ * TrackingTable — which clients hold which keys in a near cache, for
+ * CLIENT TRACKING invalidation (after Redis's tracking table).
+ *
+ * Default mode: a client's read of a key is remembered with track(), and
+ * the next write to that key notifies the client once and forgets it; the
+ * client must read the key again to hear about the next change.
+ * Broadcast mode: a client hears about every write to a key starting with
+ * one of its prefixes (all keys when it has none), and nothing is stored
+ * per key.
+ *
+ * Tracked keys live in kStripes lock stripes.  Past `max_keys` some key
+ * of a full stripe is invalidated early, so memory stays bounded and a
+ * client only ever drops a value too soon, never keeps one too long.
+ * Callers must track a read *before* reading the value: a write that
+ * finished first is then seen by the read, and one that finishes later
+ * sends the invalidation.
+ */
+class TrackingTable {
+public:
+    /** Delivers invalidated keys to one client; empty = every key (FLUSHALL). */
+    using Sink = std::function<void(const std::vector<std::string>& keys)>;
+
+    static constexpr size_t kStripes = 16;
+
+    explicit TrackingTable(size_t max_keys = 1 << 20)
+        : max_per_stripe_(std::max<size_t>(1, max_keys / kStripes)) {}
+
+    TrackingTable(const TrackingTable&) = delete;
+    TrackingTable& operator=(const TrackingTable&) = delete;
+
+    /**
+     * Start (or reconfigure) tracking for `client`.  The sink runs on the
+     * writing thread, possibly under a cache segment lock: it must only
+     * queue the message and must not call back into the table.
+     */
+    void subscribe(uint64_t client, Sink sink, bool bcast, std::vector<std::string> prefixes = {}) {
+        compat::LockGuard<compat::SharedMutex> lock(clients_mu_);
+        Client& c = clients_[client];
+        if (c.bcast) bcast_clients_--;
+        c.sink = std::move(sink);
+        c.bcast = bcast;
+        c.prefixes = std::move(prefixes);
+        if (c.bcast) bcast_clients_++;
+        active_.store(clients_.size());
+    }
+
+    /**
+     * Stop tracking `client`.  Once this returns its sink is not running
+     * and will not run again.  Its per-key entries are dropped lazily.
+     */
+    void unsubscribe(uint64_t client) {
+        compat::LockGuard<compat::SharedMutex> lock(clients_mu_);
+        auto it = clients_.find(client);
+        if (it == clients_.end()) return;
+        if (it->second.bcast) bcast_clients_--;
+        clients_.erase(it);
+        active_.store(clients_.size());
+    }
+
+    /** Remember that `client` (default mode) read `key`. */
+    void track(uint64_t client, std::string_view key) {
+        std::string evicted;
+        std::vector<uint64_t> evicted_readers;
+        {
+            Stripe& s = stripe_for(key);
+            compat::LockGuard<compat::Mutex> lock(s.mu);
+            auto it = s.readers.find(std::string(key));
+            if (it == s.readers.end()) {
+                if (s.readers.size() >= max_per_stripe_) {
+                    auto victim = s.readers.begin();
+                    evicted = victim->first;
+                    evicted_readers = std::move(victim->second);
+                    s.readers.erase(victim);
+                }
+                it = s.readers.emplace(std::string(key), std::vector<uint64_t>()).first;
+            }
+            auto& ids = it->second;
+            if (std::find(ids.begin(), ids.end(), client) == ids.end()) ids.push_back(client);
+        }
+        if (!evicted_readers.empty()) notify(evicted, evicted_readers);
+    }
+
+    /** A write to `key` finished: tell every client that may hold it. */
+    void invalidate(std::string_view key) {
+        if (!active_.load()) return;
+        std::vector<uint64_t> readers;
+        {
+            Stripe& s = stripe_for(key);
+            compat::LockGuard<compat::Mutex> lock(s.mu);
+            auto it = s.readers.find(std::string(key));
+            if (it != s.readers.end()) {
+                readers = std::move(it->second);
+                s.readers.erase(it);
+            }
+        }
+        notify(key, readers);
+    }
+
+    /** Every key changed (FLUSHALL): all tracking clients drop everything. */
+    void invalidate_all() {
+        for (auto& s : stripes_) {
+            compat::LockGuard<compat::Mutex> lock(s.mu);
+            s.readers.clear();
+        }
+        compat::SharedLock<compat::SharedMutex> lock(clients_mu_);
+        const std::vector<std::string> all;
+        for (const auto& kv : clients_) {
+            kv.second.sink(all);
+            sent_++;
+        }
+    }
+
+    size_t clients() const { return active_.load(); }
+    uint64_t invalidations_sent() const { return sent_.load(); }
+
+    size_t tracked_keys() const {
+        size_t n = 0;
+        for (const auto& s : stripes_) {
+            compat::LockGuard<compat::Mutex> lock(s.mu);
+            n += s.readers.size();
+        }
+        return n;
+    }
+
+private:
+    struct Client {
+        Sink sink;
+        bool bcast = false;
+        std::vector<std::string> prefixes;   // bcast only; empty = all keys
+    };
+
+    struct Stripe {
+        mutable compat::Mutex mu;
+        std::unordered_map<std::string, std::vector<uint64_t>> readers;
+    };
+
+    Stripe& stripe_for(std::string_view key) {
+        return stripes_[std::hash<std::string_view>()(key) % kStripes];
+    }
+
+    static bool has_prefix(std::string_view key, const std::vector<std::string>& prefixes) {
+        if (prefixes.empty()) return true;
+        for (const auto& p : prefixes) {
+            if (key.compare(0, p.size(), p) == 0) return true;
+        }
+        return false;
+    }
+
+    void notify(std::string_view key, const std::vector<uint64_t>& readers) {
+        if (readers.empty() && !bcast_clients_.load()) return;
+        const std::vector<std::string> keys{std::string(key)};
+        compat::SharedLock<compat::SharedMutex> lock(clients_mu_);
+        for (uint64_t id : readers) {
+            auto it = clients_.find(id);
+            if (it == clients_.end() || it->second.bcast) continue;   // gone, or re-subscribed as bcast
+            it->second.sink(keys);
+            sent_++;
+        }
+        if (!bcast_clients_.load()) return;
+        for (const auto& kv : clients_) {
+            if (!kv.second.bcast || !has_prefix(key, kv.second.prefixes)) continue;
+            kv.second.sink(keys);
+            sent_++;
+        }
+    }
+
+    const size_t max_per_stripe_;
+    Stripe stripes_[kStripes];
+    mutable compat::SharedMutex clients_mu_;
+    std::unordered_map<uint64_t, Client> clients_;
+    compat::Atomic<size_t> active_{0};
+    compat::Atomic<size_t> bcast_clients_{0};
+    compat::Atomic<uint64_t> sent_{0};
+};
+
+}  // namespace sync
+}  // namespace dcs
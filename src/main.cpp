@@ -6,7 +6,7 @@
  * ║    • LSM-Tree Storage Engine (WAL → MemTable → SSTable)             ║
  * ║    • Raft Consensus (leader election + log replication)             ║
  * ║    • PINN Load Predictor (Burgers' equation physics prior)          ║
- * ║    • 32-Shard Segmented LRU with per-shard read-write locks        ║
+ * ║    • Core-scaled Segmented LRU with per-shard read-write locks     ║
  * ║    • RESP protocol (redis-cli compatible)                           ║
  * ║    • Embedded HTTP dashboard (real-time monitoring)                  ║
  * ╚══════════════════════════════════════════════════════════════════════╝
@@ -17,7 +17,9 @@
 #include "include/raft/raft_node.h"
 #include "include/ml/predictive_sharder.h"
 #include "include/network/tcp_server.h"
+#include "include/cluster/cluster.h"
 #include "include/network/http_server.h"
+#include "include/metrics/exposition.h"
 
 #include <iostream>
 #include <sstream>
@@ -28,6 +30,8 @@
 #include <thread>
 #include <deque>
 #include <fstream>
+#include <cctype>
+#include <memory>
 #ifdef _WIN32
 #include <io.h>
 #endif
@@ -80,22 +84,40 @@ static dcs::compat::Atomic<uint64_t> g_node_reqs[5] = {{0},{0},{0},{0},{0}};
 static dcs::compat::Atomic<uint64_t> g_flush_count{0};
 static dcs::compat::Atomic<uint64_t> g_heatstroke_count{0};
 
+// Per-segment telemetry, sized to the cache's segment count at startup
+static size_t g_num_segments = 0;
+using SegCounters = std::unique_ptr<dcs::compat::Atomic<uint64_t>[]>;
+
 // Per-segment lock counters (simulated)
-static dcs::compat::Atomic<uint64_t> g_seg_locks[32];
+static SegCounters g_seg_locks;
 
 // Burst detection: per-segment ops sliding window
-static dcs::compat::Atomic<uint64_t> g_seg_ops_window[32];
-static dcs::compat::Atomic<uint64_t> g_seg_ops_pinn[32];  // persistent PINN accumulator (never reset)
+static SegCounters g_seg_ops_window;
+static SegCounters g_seg_ops_pinn;  // persistent PINN accumulator (never reset)
 static dcs::compat::Atomic<uint64_t> g_burst_check_counter{0};
 static dcs::compat::Atomic<int> g_burst_cooldown{0};
 
 // Persistent burst state
 static dcs::compat::Atomic<bool> g_burst_active{false};
 static dcs::compat::Atomic<int>  g_burst_intensity{500};
-static int g_burst_shards_list[32];
+static std::unique_ptr<int[]> g_burst_shards_list;
 static dcs::compat::Atomic<int>  g_burst_shard_count{0};
 static dcs::compat::Atomic<uint64_t> g_burst_ops_done{0};
 
+static SegCounters make_seg_counters(size_t n) {
+    SegCounters c(new dcs::compat::Atomic<uint64_t>[n]);
+    for (size_t i = 0; i < n; ++i) c[i].store(0);
+    return c;
+}
+
+static void init_segment_telemetry(size_t n) {
+    g_num_segments     = n;
+    g_seg_locks        = make_seg_counters(n);
+    g_seg_ops_window   = make_seg_counters(n);
+    g_seg_ops_pinn     = make_seg_counters(n);
+    g_burst_shards_list.reset(new int[n]());
+}
+
 // ── Command-line argument helpers ─────────────────────────────────────
 struct ServerConfig {
     uint16_t    port             = 6379;
@@ -106,8 +128,48 @@ struct ServerConfig {
     std::string data_dir         = "data";
     int         node_id          = 0;
     int         cluster_size     = 5;
+    dcs::network::IOModel io_model = dcs::network::IOModel::EventLoop;
+    size_t      io_threads       = 0;    // 0 = one reactor per core
+    dcs::cache::EvictionPolicy eviction = dcs::cache::EvictionPolicy::Clock;
+    size_t      segments         = 0;    // 0 = scale with core count
+    size_t      max_memory       = 0;    // bytes; 0 = bound by --capacity entries
+    size_t      prewarm_keys     = 0;    // hot keys saved at shutdown / reloaded at start
+    size_t      hot_key_replicas = 32;   // hottest keys served without a segment lock; 0 = off
+    size_t      compress_min     = 0;    // values this size and up are stored compressed; 0 = off
+    int         metrics_interval_ms = 1000;  // /metrics and /api/metrics sampling period
+    std::string cluster_nodes;           // "id@host:port,..."; empty = standalone (no redirects)
+    dcs::storage::LSMOptions lsm;
 };
 
+/** Parse "0@127.0.0.1:6379,1@127.0.0.1:6380" into node addresses; malformed entries are skipped. */
+static std::vector<dcs::cluster::NodeAddress> parse_cluster_nodes(const std::string& list) {
+    std::vector<dcs::cluster::NodeAddress> nodes;
+    std::stringstream ss(list);
+    std::string item;
+    while (std::getline(ss, item, ',')) {
+        size_t at = item.find('@'), colon = item.rfind(':');
+        if (at == std::string::npos || colon == std::string::npos || colon < at) continue;
+        dcs::cluster::NodeAddress n;
+        n.id   = std::atoi(item.substr(0, at).c_str());
+        n.host = item.substr(at + 1, colon - at - 1);
+        n.port = static_cast<uint16_t>(std::atoi(item.substr(colon + 1).c_str()));
+        nodes.push_back(n);
+    }
+    return nodes;
+}
+
+/** Parse "512mb", "2gb", "65536" etc. into bytes. */
+static size_t parse_bytes(const std::string& s) {
+    char* end = nullptr;
+    double v = std::strtod(s.c_str(), &end);
+    std::string unit(end ? end : "");
+    for (auto& ch : unit) ch = static_cast<char>(std::tolower(static_cast<unsigned char>(ch)));
+    if (unit == "k" || unit == "kb") v *= 1024.0;
+    else if (unit == "m" || unit == "mb") v *= 1024.0 * 1024.0;
+    else if (unit == "g" || unit == "gb") v *= 1024.0 * 1024.0 * 1024.0;
+    return v > 0 ? static_cast<size_t>(v) : 0;
+}
+
 ServerConfig parse_args(int argc, char* argv[]) {
     ServerConfig cfg;
     for (int i = 1; i < argc; ++i) {
@@ -132,16 +194,77 @@ ServerConfig parse_args(int argc, char* argv[]) {
             cfg.node_id = std::atoi(argv[++i]);
         else if (arg == "--cluster-size" && i + 1 < argc)
             cfg.cluster_size = std::atoi(argv[++i]);
+        else if (arg == "--io-model" && i + 1 < argc) {
+            std::string m = argv[++i];
+            cfg.io_model = (m == "threads" || m == "thread-per-client")
+                           ? dcs::network::IOModel::ThreadPerClient
+                           : dcs::network::IOModel::EventLoop;
+        }
+        else if (arg == "--io-threads" && i + 1 < argc)
+            cfg.io_threads = static_cast<size_t>(std::atoll(argv[++i]));
+        else if (arg == "--maxmemory" && i + 1 < argc)
+            cfg.max_memory = parse_bytes(argv[++i]);
+        else if (arg == "--block-cache" && i + 1 < argc)
+            cfg.lsm.block_cache_bytes = parse_bytes(argv[++i]);
+        else if (arg == "--wal-sync" && i + 1 < argc) {
+            std::string m = argv[++i];
+            cfg.lsm.wal.sync_mode = (m == "none")  ? dcs::storage::WALSyncMode::kNone
+                                  : (m == "batch") ? dcs::storage::WALSyncMode::kPerBatch
+                                                   : dcs::storage::WALSyncMode::kInterval;
+        }
+        else if (arg == "--bloom-bits" && i + 1 < argc) {
+            // "14,12,10,10": bits per key for L0..L3; a shorter list repeats its last value
+            std::stringstream ss(argv[++i]);
+            std::string item;
+            int level = 0, bits = dcs::storage::BloomFilter::kDefaultBitsPerKey;
+            while (level < 4 && std::getline(ss, item, ','))
+                cfg.lsm.bloom_bits_per_key[level++] = bits = std::max(1, std::atoi(item.c_str()));
+            while (level < 4) cfg.lsm.bloom_bits_per_key[level++] = bits;
+        }
+        else if (arg == "--wal-sync-ms" && i + 1 < argc)
+            cfg.lsm.wal.sync_interval_ms = static_cast<uint32_t>(std::atoi(argv[++i]));
+        else if (arg == "--prewarm-keys" && i + 1 < argc)
+            cfg.prewarm_keys = static_cast<size_t>(std::atoll(argv[++i]));
+        else if (arg == "--hot-key-replicas" && i + 1 < argc)
+            cfg.hot_key_replicas = static_cast<size_t>(std::atoll(argv[++i]));
+        else if (arg == "--compress-min" && i + 1 < argc)
+            cfg.compress_min = parse_bytes(argv[++i]);
+        else if (arg == "--metrics-interval-ms" && i + 1 < argc)
+            cfg.metrics_interval_ms = std::max(50, std::atoi(argv[++i]));
+        else if (arg == "--cluster-nodes" && i + 1 < argc)
+            cfg.cluster_nodes = argv[++i];
+        else if (arg == "--segments" && i + 1 < argc)
+            cfg.segments = static_cast<size_t>(std::atoll(argv[++i]));
+        else if (arg == "--eviction" && i + 1 < argc) {
+            std::string e = argv[++i];
+            cfg.eviction = (e == "lru")     ? dcs::cache::EvictionPolicy::LRU
+                         : (e == "tinylfu") ? dcs::cache::EvictionPolicy::TinyLFU
+                                            : dcs::cache::EvictionPolicy::Clock;
+        }
         else if (arg == "--help" || arg == "-h") {
             std::cout << "Usage: distributed_cache [OPTIONS]\n"
                       << "  -p, --port PORT              RESP TCP port (default: 6379)\n"
                       << "      --http-port PORT         Dashboard HTTP port (default: 8080)\n"
                       << "  -c, --capacity N             Max cache entries (default: 65536)\n"
+                      << "      --maxmemory BYTES        Byte budget, e.g. 512mb (replaces --capacity)\n"
+                      << "      --block-cache BYTES      SSTable block cache size (default: 8mb, 0 = off)\n"
+                      << "      --wal-sync MODE          none | interval (default) | batch (fsync per group commit)\n"
+                      << "      --wal-sync-ms N          Interval-mode fsync period (default: 100)\n"
+                      << "      --bloom-bits L0,L1,..    Bloom bits per key by level (default: 14,12,10,10)\n"
+                      << "      --prewarm-keys N         Save N hot keys at shutdown, reload at start (default: 0)\n"
+                      << "      --hot-key-replicas N     Hottest keys GET serves lock-free (default: 32, 0 = off)\n"
+                      << "      --compress-min BYTES     Store values this large LZ-compressed (default: 0 = off)\n"
+                      << "      --metrics-interval-ms N  Metrics sampling period for /metrics (default: 1000)\n"
                       << "  -m, --mode MODE              write-through | write-back (default)\n"
                       << "  -f, --flush-interval SECS    Write-back flush interval (default: 5)\n"
                       << "  -d, --data-dir PATH          Data directory (default: data)\n"
                       << "      --node-id ID             Raft node ID (default: 0)\n"
                       << "      --cluster-size N         Raft cluster size (default: 3)\n"
+                      << "      --cluster-nodes LIST     Shard slots over id@host:port,... (self = --node-id)\n"
+                      << "      --io-model MODEL         epoll (default) | threads\n"
+                      << "      --io-threads N           Event-loop reactors (default: 1 per core)\n"
+                      << "      --segments N             Cache segments, power of two (default: 4 per core)\n"
+                      << "      --eviction POLICY        clock (default, shared-lock GETs) | lru | tinylfu\n"
                       << "  -h, --help                   Show this help\n";
             std::exit(0);
         }
@@ -162,9 +285,14 @@ int main(int argc, char* argv[]) {
     std::cout << "  ╠══════════════════════════════════════════════════╣\n";
     std::cout << "  ║  RESP Port:     " << cfg.port << std::string(34 - std::to_string(cfg.port).size(), ' ') << "║\n";
     std::cout << "  ║  HTTP Port:     " << cfg.http_port << std::string(34 - std::to_string(cfg.http_port).size(), ' ') << "║\n";
-    std::cout << "  ║  Capacity:      " << cfg.capacity << std::string(34 - std::to_string(cfg.capacity).size(), ' ') << "║\n";
+    std::string cap_str = cfg.max_memory
+        ? std::to_string(cfg.max_memory / (1024 * 1024)) + " MB (maxmemory)"
+        : std::to_string(cfg.capacity) + " entries";
+    std::cout << "  ║  Capacity:      " << cap_str << std::string(34 - cap_str.size(), ' ') << "║\n";
     std::cout << "  ║  Write Mode:    " << mode_str << std::string(34 - mode_str.size(), ' ') << "║\n";
-    std::cout << "  ║  Segments:      32 (read-write locks)" << std::string(12, ' ') << "║\n";
+    std::string seg_str = std::to_string(dcs::cache::SegmentedCache::resolve_segment_count(
+                              cfg.segments, cfg.capacity)) + " (read-write locks)";
+    std::cout << "  ║  Segments:      " << seg_str << std::string(34 - seg_str.size(), ' ') << "║\n";
     std::cout << "  ║  Storage:       LSM-Tree (WAL+SSTable)" << std::string(11, ' ') << "║\n";
     std::cout << "  ║  Consensus:     Raft (node " << cfg.node_id << "/" << cfg.cluster_size << ")" << std::string(std::max(0, 24 - (int)std::to_string(cfg.node_id).size() - (int)std::to_string(cfg.cluster_size).size()), ' ') << "║\n";
     std::cout << "  ║  ML Engine:     PINN (Burgers' eq.)" << std::string(15, ' ') << "║\n";
@@ -197,7 +325,7 @@ int main(int argc, char* argv[]) {
         }
 #endif
     }
-    dcs::storage::LSMEngine lsm_storage(cfg.data_dir + "/lsm");
+    dcs::storage::LSMEngine lsm_storage(cfg.data_dir + "/lsm", cfg.lsm);
     std::cout << "[Init] LSM-Tree ready (WAL + " << lsm_storage.TotalSSTCount()
               << " SSTables loaded)\n";
 
@@ -206,31 +334,38 @@ int main(int argc, char* argv[]) {
     cache_cfg.cache_capacity = cfg.capacity;
     cache_cfg.write_mode     = cfg.mode;
     cache_cfg.flush_interval = std::chrono::seconds(cfg.flush_interval);
+    cache_cfg.eviction_policy = cfg.eviction;
+    cache_cfg.segments        = cfg.segments;
+    cache_cfg.max_memory      = cfg.max_memory;
+    cache_cfg.hot_key_replicas = cfg.hot_key_replicas;
+    cache_cfg.value_compression_min = cfg.compress_min;
 
     dcs::sync::CacheManager manager(cache_cfg, &lsm_storage);
-    std::cout << "[Init] Cache manager ready (32-shard segmented LRU, "
-              << cfg.capacity << " capacity)\n";
-    push_event("info", "Cache manager initialized (" + std::to_string(cfg.capacity) + " capacity)");
+    init_segment_telemetry(manager.segment_count());
+    const int NSEG = static_cast<int>(g_num_segments);
+    std::string policy_label = dcs::cache::policy_name(cfg.eviction);
+    for (auto& ch : policy_label) ch = static_cast<char>(std::toupper(static_cast<unsigned char>(ch)));
+    std::cout << "[Init] Cache manager ready (" << NSEG << "-shard segmented "
+              << policy_label << ", "
+              << cap_str << " capacity)\n";
+    push_event("info", "Cache manager initialized (" + cap_str + " capacity)");
+
+    // Warm the cache from the previous run's hot-key list before any
+    // traffic (client or generated) can write.
+    const std::string hot_keys_path = cfg.data_dir + "/hot_keys.dat";
+    if (cfg.prewarm_keys > 0) {
+        size_t warmed = manager.prewarm(hot_keys_path);
+        if (warmed > 0) {
+            std::cout << "[Init] Prewarmed " << warmed << " hot keys from " << hot_keys_path << "\n";
+            push_event("info", "Prewarmed " + std::to_string(warmed) + " hot keys");
+        }
+    }
 
     // ── 3. Raft Consensus (5-node in-process cluster) ────────────────
     const int RAFT_CLUSTER_SIZE = 5;
     std::cout << "[Init] Starting Raft consensus (" << RAFT_CLUSTER_SIZE
               << "-node cluster)...\n";
 
-    // Clean up accumulated raft log files to prevent memory bloat on 32-bit
-    for (int i = 0; i < RAFT_CLUSTER_SIZE; i++) {
-        std::string raft_log_path = cfg.data_dir + "/raft/node" + std::to_string(i) + "/raft_log.dat";
-        std::ifstream rlf(raft_log_path, std::ios::binary | std::ios::ate);
-        if (rlf.is_open()) {
-            auto sz = rlf.tellg();
-            rlf.close();
-            if (sz > 500 * 1024) {  // If log > 500KB, truncate it
-                std::ofstream(raft_log_path, std::ios::binary | std::ios::trunc).close();
-                std::cout << "[Init] Raft node " << i << " log compacted (" << sz << " bytes)\n";
-            }
-        }
-    }
-
     dcs::raft::LocalRaftTransport raft_transport;
     std::vector<std::unique_ptr<dcs::raft::RaftNode>> raft_nodes;
     for (int i = 0; i < RAFT_CLUSTER_SIZE; i++) {
@@ -251,6 +386,16 @@ int main(int argc, char* argv[]) {
             manager.del(key);
         }
     });
+    // Node 0's applied state already lives in the cache manager's backend,
+    // so its snapshot is just a flush of pending write-backs; the log is
+    // then compacted instead of growing without bound across restarts.
+    raft_nodes[0]->SetSnapshotCallbacks(
+        [&manager](const std::string& path) {
+            manager.flush();
+            std::ofstream f(path, std::ios::binary | std::ios::trunc);
+            return static_cast<bool>(f.flush());
+        },
+        [](const std::string& /*path*/) { return true; });
     for (int i = 0; i < RAFT_CLUSTER_SIZE; i++) raft_nodes[i]->Start();
     // Allow initial leader election
     dcs::compat::this_thread::sleep_for(std::chrono::milliseconds(500));
@@ -271,7 +416,7 @@ int main(int argc, char* argv[]) {
     pinn_cfg.lambda_pde    = 0.1f;
     pinn_cfg.nu            = 0.01f;
 
-    dcs::ml::PredictiveSharder sharder(32, pinn_cfg);
+    dcs::ml::PredictiveSharder sharder(NSEG, pinn_cfg);
     sharder.Start();
     auto pinn_stats = sharder.GetStats();
     std::cout << "[Init] PINN ready (" << pinn_stats.num_parameters
@@ -288,20 +433,25 @@ int main(int argc, char* argv[]) {
     dcs::network::HTTPServer http_server(cfg.http_port, "web");
     g_http_server = &http_server;
 
-    // ── Metrics endpoint ──────────────────────────────────────────────
-    http_server.setMetricsCallback([&]() -> std::string {
+    // ── Metrics sampler ───────────────────────────────────────────────
+    // One pass per interval reads the cache, LSM, Raft and PINN state and
+    // renders both the dashboard JSON and the Prometheus exposition from
+    // it; HTTP handlers only hand out the last published page.
+    dcs::metrics::MetricsPublisher metrics_publisher(
+        std::chrono::milliseconds(cfg.metrics_interval_ms), [&]() -> dcs::metrics::MetricsPage {
         auto& cache_stats = manager.stats();
         auto& lsm_stats   = lsm_storage.Stats();
         auto pinn_info    = sharder.GetStats();
         auto predictions  = sharder.PredictLoads();
         // Blend PINN predictions with actual per-shard ops load for differentiated output
         {
-            uint64_t pinn_ops[32], max_po = 1;
-            for (int i = 0; i < 32; i++) {
+            std::vector<uint64_t> pinn_ops(NSEG);
+            uint64_t max_po = 1;
+            for (int i = 0; i < NSEG; i++) {
                 pinn_ops[i] = g_seg_ops_pinn[i].load();
                 if (pinn_ops[i] > max_po) max_po = pinn_ops[i];
             }
-            for (size_t i = 0; i < predictions.size() && i < 32; i++) {
+            for (size_t i = 0; i < predictions.size() && i < pinn_ops.size(); i++) {
                 float actual = static_cast<float>(pinn_ops[i]) / static_cast<float>(max_po);
                 predictions[i] = 0.3f * predictions[i] + 0.7f * actual;
             }
@@ -319,15 +469,39 @@ int main(int argc, char* argv[]) {
         }
         auto raft_state = (raft_leader_id >= 0) ? all_raft_states[raft_leader_id] : all_raft_states[0];
 
+        // Cache counters are read once so both renderings agree
+        const uint64_t hits          = cache_stats.cache_hits.load();
+        const uint64_t misses        = cache_stats.cache_misses.load();
+        const uint64_t rejections    = manager.admission_rejections();
+        const size_t   cache_size    = manager.size();
+        const uint64_t wt_ops        = cache_stats.write_through_count.load();
+        const uint64_t wb_ops        = cache_stats.write_back_count.load();
+        const size_t   dirty         = manager.dirty_count();
+        const uint64_t flush_lag     = manager.flush_lag_ms();
+        const uint64_t flushed       = manager.flushed_entries();
+        const size_t   used_memory   = manager.used_memory();
+        const uint64_t evicted       = manager.budget_evictions();
+        const uint64_t expired       = manager.expired_count();
+
         std::ostringstream json;
         json << "{\n";
 
         // Cache stats
-        json << "  \"cache_hits\": " << cache_stats.cache_hits.load() << ",\n";
-        json << "  \"cache_misses\": " << cache_stats.cache_misses.load() << ",\n";
-        json << "  \"cache_size\": " << manager.size() << ",\n";
-        json << "  \"write_through_ops\": " << cache_stats.write_through_count.load() << ",\n";
-        json << "  \"write_back_ops\": " << cache_stats.write_back_count.load() << ",\n";
+        json << "  \"cache_hits\": " << hits << ",\n";
+        json << "  \"cache_misses\": " << misses << ",\n";
+        {
+            uint64_t lookups = hits + misses;
+            json << "  \"hit_rate\": "
+                 << (lookups ? static_cast<double>(hits) / lookups : 0.0) << ",\n";
+        }
+        json << "  \"eviction_policy\": \"" << dcs::cache::policy_name(manager.eviction_policy()) << "\",\n";
+        json << "  \"admission_rejections\": " << rejections << ",\n";
+        json << "  \"cache_size\": " << cache_size << ",\n";
+        json << "  \"write_through_ops\": " << wt_ops << ",\n";
+        json << "  \"write_back_ops\": " << wb_ops << ",\n";
+        json << "  \"dirty_keys\": " << dirty << ",\n";
+        json << "  \"flush_lag_ms\": " << flush_lag << ",\n";
+        json << "  \"flushed_keys\": " << flushed << ",\n";
         json << "  \"write_mode\": \"" << (manager.write_mode() == dcs::sync::WriteMode::WriteThrough ? "write-through" : "write-back") << "\",\n";
 
         // Per-segment sizes (for heat grid)
@@ -340,7 +514,7 @@ int main(int argc, char* argv[]) {
 
         // Per-segment lock counts
         json << "  \"segment_locks\": [";
-        for (int i = 0; i < 32; i++) {
+        for (int i = 0; i < NSEG; i++) {
             if (i > 0) json << ",";
             json << g_seg_locks[i].load();
         }
@@ -359,6 +533,21 @@ int main(int argc, char* argv[]) {
         json << "  \"heatstroke_count\": " << g_heatstroke_count.load() << ",\n";
         json << "  \"traffic_rate\": " << g_traffic_rate.load() << ",\n";
 
+        // Value compression (applied at put; the cache, WAL and SSTables hold the packed form)
+        {
+            const auto& codec = manager.value_codec();
+            const auto& cs = codec.GetStats();
+            json << "  \"compression\": {\n";
+            json << "    \"min_bytes\": " << codec.MinSize() << ",\n";
+            json << "    \"compressed\": " << cs.compressed.load() << ",\n";
+            json << "    \"skipped\": " << cs.skipped.load() << ",\n";
+            json << "    \"decompressed\": " << cs.decompressed.load() << ",\n";
+            json << "    \"bytes_raw\": " << cs.raw_bytes.load() << ",\n";
+            json << "    \"bytes_stored\": " << cs.stored_bytes.load() << ",\n";
+            json << "    \"ratio\": " << codec.Ratio() << "\n";
+            json << "  },\n";
+        }
+
         // LSM-Tree stats
         json << "  \"lsm\": {\n";
         json << "    \"wal_bytes\": " << lsm_stats.wal_bytes.load() << ",\n";
@@ -370,14 +559,56 @@ int main(int argc, char* argv[]) {
         json << "    \"total_gets\": " << lsm_stats.total_gets.load() << ",\n";
         json << "    \"total_deletes\": " << lsm_stats.total_deletes.load() << ",\n";
         json << "    \"bloom_hits\": " << lsm_stats.bloom_filter_hits.load() << ",\n";
+        json << "    \"sst_block_bytes_raw\": " << lsm_stats.sst_block_raw_bytes.load() << ",\n";
+        json << "    \"sst_block_bytes_stored\": " << lsm_stats.sst_block_stored_bytes.load() << ",\n";
+        json << "    \"sst_compress_us_total\": " << lsm_stats.sst_compress_micros.load() << ",\n";
+        json << "    \"wal_sync_mode\": \"" << dcs::storage::WALSyncModeName(lsm_storage.Options().wal.sync_mode) << "\",\n";
+        json << "    \"wal_batches\": " << lsm_stats.wal.batches.load() << ",\n";
+        json << "    \"wal_records\": " << lsm_stats.wal.records.load() << ",\n";
+        json << "    \"wal_max_batch\": " << lsm_stats.wal.max_batch.load() << ",\n";
+        json << "    \"wal_syncs\": " << lsm_stats.wal.syncs.load() << ",\n";
+        json << "    \"wal_sync_us_total\": " << lsm_stats.wal.sync_micros.load() << ",\n";
+        json << "    \"wal_sync_us_max\": " << lsm_stats.wal.max_sync_micros.load() << ",\n";
+        json << "    \"block_cache_hits\": " << lsm_storage.GetBlockCache().Hits() << ",\n";
+        json << "    \"block_cache_misses\": " << lsm_storage.GetBlockCache().Misses() << ",\n";
+        json << "    \"block_cache_bytes\": " << lsm_storage.GetBlockCache().Usage() << ",\n";
         json << "    \"levels\": [";
         for (int i = 0; i < 4; i++) {
             if (i > 0) json << ", ";
             json << lsm_storage.SSTCountAtLevel(i);
         }
+        json << "],\n";
+        json << "    \"level_bytes\": [";
+        for (int i = 0; i < 4; i++) {
+            if (i > 0) json << ", ";
+            json << lsm_storage.LevelBytes(i);
+        }
+        json << "],\n";
+        json << "    \"filter_bytes\": [";
+        for (int i = 0; i < 4; i++) {
+            if (i > 0) json << ", ";
+            json << lsm_storage.FilterBytes(i);
+        }
         json << "]\n";
         json << "  },\n";
 
+        // Latency histograms: RESP commands, cache GETs, LSM tiers, WAL, compaction
+        dcs::metrics::LatencyReport latency;
+        dcs::network::ClientHandler::collect_command_latency(latency);
+        manager.collect_latency(latency);
+        json << "  \"latency\": {";
+        for (size_t i = 0; i < latency.size(); i++) {
+            const auto& snap = latency[i].second;
+            json << (i > 0 ? "," : "") << "\n    \"" << latency[i].first << "\": {"
+                 << "\"count\": " << snap.count
+                 << ", \"mean_us\": " << snap.mean_ns() / 1e3
+                 << ", \"p50_us\": " << snap.percentile_ns(0.50) / 1e3
+                 << ", \"p99_us\": " << snap.percentile_ns(0.99) / 1e3
+                 << ", \"p999_us\": " << snap.percentile_ns(0.999) / 1e3
+                 << ", \"max_us\": " << snap.max_ns / 1e3 << "}";
+        }
+        json << "\n  },\n";
+
         // Raft state (all 5 nodes)
         json << "  \"raft\": {\n";
         json << "    \"node_id\": " << raft_state.id << ",\n";
@@ -388,6 +619,7 @@ int main(int argc, char* argv[]) {
         json << "    \"log_size\": " << raft_state.log_size << ",\n";
         json << "    \"leader_id\": " << raft_leader_id << ",\n";
         json << "    \"votes\": " << raft_state.votes_received << ",\n";
+        json << "    \"snapshot_index\": " << raft_state.snapshot_index << ",\n";
         json << "    \"nodes\": [";
         for (int i = 0; i < RAFT_CLUSTER_SIZE; i++) {
             if (i > 0) json << ",";
@@ -440,13 +672,85 @@ int main(int argc, char* argv[]) {
         }
         json << "\n  ],\n";
 
-        json << "  \"segments\": 32,\n";
+        json << "  \"segments\": " << NSEG << ",\n";
         json << "  \"burst_active\": " << (g_burst_active.load() ? "true" : "false") << ",\n";
         json << "  \"burst_ops_done\": " << g_burst_ops_done.load() << ",\n";
         json << "  \"server_running\": true\n";
         json << "}";
-        return json.str();
+
+        // Prometheus exposition
+        dcs::metrics::PrometheusWriter prom;
+        prom.counter("dcs_cache_hits_total", "GET lookups answered by the cache", hits);
+        prom.counter("dcs_cache_misses_total", "GET lookups that missed the cache", misses);
+        prom.counter("dcs_cache_admission_rejections_total", "Inserts refused by the admission filter", rejections);
+        prom.gauge("dcs_cache_keys", "Entries in the cache", cache_size);
+        prom.gauge("dcs_cache_used_memory_bytes", "Bytes charged against the memory budget", used_memory);
+        prom.counter("dcs_cache_evicted_keys_total", "Entries evicted to stay within the memory budget", evicted);
+        prom.counter("dcs_cache_expired_keys_total", "Entries removed by TTL expiry", expired);
+        prom.counter("dcs_cache_write_through_total", "Writes persisted synchronously", wt_ops);
+        prom.counter("dcs_cache_write_back_total", "Writes deferred to the write-back worker", wb_ops);
+        prom.gauge("dcs_cache_dirty_keys", "Entries waiting for write-back", dirty);
+        prom.gauge("dcs_cache_flush_lag_seconds", "Age of the oldest unflushed write", static_cast<double>(flush_lag) / 1e3);
+        prom.counter("dcs_cache_flushed_keys_total", "Entries written back by the worker", flushed);
+        prom.gauge("dcs_hot_keys_replicated", "Hot keys served from the lock-free replica", manager.replicated_keys().size());
+        prom.gauge("dcs_tracking_clients", "Connections with CLIENT TRACKING on", manager.tracking().clients());
+        prom.counter("dcs_tracking_invalidations_total", "Invalidation pushes sent to near caches", manager.tracking().invalidations_sent());
+        prom.counter("dcs_values_compressed_total", "Values stored compressed by PUT", manager.value_codec().GetStats().compressed.load());
+        prom.counter("dcs_value_bytes_raw_total", "Bytes of values PUT tried to compress", manager.value_codec().GetStats().raw_bytes.load());
+        prom.counter("dcs_value_bytes_stored_total", "Bytes those values were stored as", manager.value_codec().GetStats().stored_bytes.load());
+        prom.family("dcs_segment_keys", "gauge", "Entries per cache segment");
+        for (size_t i = 0; i < seg_sizes.size(); i++) prom.sample("dcs_segment_keys", seg_sizes[i], {{"segment", std::to_string(i)}});
+
+        prom.counter("dcs_lsm_puts_total", "LSM puts", lsm_stats.total_puts.load());
+        prom.counter("dcs_lsm_gets_total", "LSM point reads", lsm_stats.total_gets.load());
+        prom.counter("dcs_lsm_deletes_total", "LSM deletes", lsm_stats.total_deletes.load());
+        prom.counter("dcs_lsm_sstable_hits_total", "Point reads answered by an SSTable", lsm_stats.bloom_filter_hits.load());
+        prom.counter("dcs_lsm_compactions_total", "Level compactions completed", lsm_stats.compactions_done.load());
+        prom.gauge("dcs_lsm_memtable_bytes", "Active memtable size", lsm_stats.memtable_size.load());
+        prom.gauge("dcs_lsm_memtable_entries", "Active memtable entries", lsm_stats.memtable_entries.load());
+        prom.gauge("dcs_lsm_sstables", "Live SSTable files", lsm_stats.sstable_count.load());
+        prom.gauge("dcs_lsm_wal_bytes", "Bytes in the current WAL", lsm_stats.wal_bytes.load());
+        prom.counter("dcs_lsm_wal_batches_total", "WAL group commits", lsm_stats.wal.batches.load());
+        prom.counter("dcs_lsm_wal_records_total", "Records across WAL group commits", lsm_stats.wal.records.load());
+        prom.counter("dcs_lsm_wal_syncs_total", "WAL fsyncs", lsm_stats.wal.syncs.load());
+        prom.counter("dcs_lsm_wal_sync_seconds_total", "Time spent in WAL fsync",
+                     static_cast<double>(lsm_stats.wal.sync_micros.load()) / 1e6);
+        prom.counter("dcs_lsm_block_bytes_raw_total", "SSTable data block bytes before compression", lsm_stats.sst_block_raw_bytes.load());
+        prom.counter("dcs_lsm_block_bytes_stored_total", "SSTable data block bytes written", lsm_stats.sst_block_stored_bytes.load());
+        prom.counter("dcs_lsm_block_compress_seconds_total", "Time spent compressing SSTable blocks",
+                     static_cast<double>(lsm_stats.sst_compress_micros.load()) / 1e6);
+        prom.counter("dcs_lsm_block_cache_hits_total", "SSTable block cache hits", lsm_storage.GetBlockCache().Hits());
+        prom.counter("dcs_lsm_block_cache_misses_total", "SSTable block cache misses", lsm_storage.GetBlockCache().Misses());
+        prom.gauge("dcs_lsm_block_cache_bytes", "SSTable block cache usage", lsm_storage.GetBlockCache().Usage());
+        prom.family("dcs_lsm_level_files", "gauge", "SSTable files per level");
+        for (int i = 0; i < 4; i++) prom.sample("dcs_lsm_level_files", lsm_storage.SSTCountAtLevel(i), {{"level", std::to_string(i)}});
+        prom.family("dcs_lsm_level_bytes", "gauge", "SSTable bytes per level");
+        for (int i = 0; i < 4; i++) prom.sample("dcs_lsm_level_bytes", lsm_storage.LevelBytes(i), {{"level", std::to_string(i)}});
+        prom.family("dcs_lsm_filter_bytes", "gauge", "Bloom filter memory per level");
+        for (int i = 0; i < 4; i++) prom.sample("dcs_lsm_filter_bytes", lsm_storage.FilterBytes(i), {{"level", std::to_string(i)}});
+
+        prom.latency_summary("dcs_latency_seconds", "Latency by command and storage stage", latency);
+
+        prom.gauge("dcs_raft_leader_id", "Current Raft leader (-1 = none)", raft_leader_id);
+        prom.family("dcs_raft_term", "gauge", "Current term per node");
+        for (const auto& st : all_raft_states) prom.sample("dcs_raft_term", st.term, {{"node", std::to_string(st.id)}});
+        prom.family("dcs_raft_commit_index", "gauge", "Commit index per node");
+        for (const auto& st : all_raft_states) prom.sample("dcs_raft_commit_index", st.commit_index, {{"node", std::to_string(st.id)}});
+        prom.family("dcs_raft_last_applied", "gauge", "Last applied index per node");
+        for (const auto& st : all_raft_states) prom.sample("dcs_raft_last_applied", st.last_applied, {{"node", std::to_string(st.id)}});
+
+        prom.counter("dcs_pinn_training_steps_total", "PINN training steps", pinn_info.training_steps);
+        prom.gauge("dcs_pinn_loss", "PINN total loss at the last step", pinn_info.total_loss);
+        prom.family("dcs_pinn_predicted_load", "gauge", "Predicted load per segment (blended with observed ops)");
+        for (size_t i = 0; i < predictions.size(); i++) prom.sample("dcs_pinn_predicted_load", predictions[i], {{"segment", std::to_string(i)}});
+
+        dcs::metrics::MetricsPage page;
+        page.json = json.str();
+        page.prometheus = prom.take();
+        return page;
     });
+    http_server.setMetricsCallback([&]() { return metrics_publisher.current()->json; });
+    http_server.setPrometheusCallback([&]() { return metrics_publisher.current()->prometheus; });
 
     // ── Traffic rate control endpoint ─────────────────────────────────
     http_server.addEndpoint("/api/traffic", [&](const std::string& body) -> std::string {
@@ -484,11 +788,11 @@ int main(int argc, char* argv[]) {
             std::string token;
             while (std::getline(ss, token, ',')) {
                 int s = std::atoi(token.c_str());
-                if (s >= 0 && s < 32) target_shards.push_back(s);
+                if (s >= 0 && s < NSEG) target_shards.push_back(s);
             }
         }
         if (target_shards.empty()) {
-            target_shards = {0, 1, 2, 3};
+            for (int s = 0; s < std::min(4, NSEG); s++) target_shards.push_back(s);
         }
 
         int intensity = 500;
@@ -503,7 +807,7 @@ int main(int argc, char* argv[]) {
         // Store burst config
         g_burst_intensity = intensity;
         int cnt = 0;
-        for (size_t i = 0; i < target_shards.size() && cnt < 32; i++) {
+        for (size_t i = 0; i < target_shards.size() && cnt < NSEG; i++) {
             g_burst_shards_list[cnt++] = target_shards[i];
         }
         g_burst_shard_count = cnt;
@@ -532,14 +836,14 @@ int main(int argc, char* argv[]) {
         push_event("pinn", "Persistent burst STOPPED after " + std::to_string(ops) + " ops");
 
         // Run burst detection
-        uint64_t seg_ops[32]; uint64_t total_seg = 0;
-        for (int i = 0; i < 32; i++) {
+        std::vector<uint64_t> seg_ops(NSEG); uint64_t total_seg = 0;
+        for (int i = 0; i < NSEG; i++) {
             seg_ops[i] = g_seg_ops_window[i].load();
             total_seg += seg_ops[i];
         }
-        float avg = total_seg > 0 ? static_cast<float>(total_seg) / 32.0f : 1.0f;
+        float avg = total_seg > 0 ? static_cast<float>(total_seg) / static_cast<float>(NSEG) : 1.0f;
         int hot = 0;
-        for (int i = 0; i < 32; i++) {
+        for (int i = 0; i < NSEG; i++) {
             if (static_cast<float>(seg_ops[i]) > avg * 3.0f) hot++;
         }
         if (hot >= 2) {
@@ -631,6 +935,7 @@ int main(int argc, char* argv[]) {
                ",\"sstable_count\":" + std::to_string(s.sstable_count.load()) + "}";
     });
 
+    metrics_publisher.start();
     http_server.start();
     std::cout << "[Init] Dashboard: http://localhost:" << cfg.http_port << "\n\n";
 
@@ -639,36 +944,66 @@ int main(int argc, char* argv[]) {
     std::cout << "[Ready] All systems operational. Accepting connections.\n\n";
     push_event("info", "Server ready on port " + std::to_string(cfg.port));
 
-    dcs::network::TCPServer tcp_server(cfg.port, &manager);
+    // Slot sharding across server processes: requests for slots owned
+    // elsewhere are redirected, and the balancer moves hot slots off this
+    // node when the PINN predicts it will run hotter than a peer.
+    std::unique_ptr<dcs::cluster::Cluster> cluster;
+    std::unique_ptr<dcs::cluster::ClusterBalancer> balancer;
+    if (!cfg.cluster_nodes.empty()) {
+        cluster.reset(new dcs::cluster::Cluster(&manager, cfg.node_id));
+        for (const auto& n : parse_cluster_nodes(cfg.cluster_nodes)) cluster->slots().add_node(n);
+        cluster->slots().assign_evenly();
+        balancer.reset(new dcs::cluster::ClusterBalancer(cluster.get(), std::chrono::seconds(5), pinn_cfg));
+        balancer->start();
+        size_t mine = cluster->slots().slots_of(cfg.node_id).size();
+        std::cout << "[Init] Cluster mode: node " << cfg.node_id << " of "
+                  << cluster->slots().nodes().size() << ", " << mine << " slots\n";
+        push_event("info", "Cluster node " + std::to_string(cfg.node_id) +
+                   " serving " + std::to_string(mine) + " slots");
+    }
+
+    dcs::network::TCPServer::Config tcp_cfg;
+    tcp_cfg.io_model        = cfg.io_model;
+    tcp_cfg.reactor_threads = cfg.io_threads;
+    tcp_cfg.cluster         = cluster.get();
+    dcs::network::TCPServer tcp_server(cfg.port, &manager, tcp_cfg);
     g_tcp_server = &tcp_server;
 
     // ── Telemetry collection thread ───────────────────────────────────
     dcs::compat::Thread telemetry_thread([&]() {
-        uint64_t prev_pinn[32] = {};
+        std::vector<uint64_t> prev_pinn(NSEG, 0);
+        std::vector<uint64_t> seg_ops(NSEG);
+        std::vector<dcs::metrics::LatencySnapshot> prev_latency(NSEG);
         while (!g_shutdown.load()) {
             auto& s = manager.stats();
             uint64_t total_ops = s.cache_hits.load() + s.cache_misses.load();
             // Use PINN accumulator deltas for differentiated load measurement
-            uint64_t seg_ops[32];
             uint64_t max_seg_ops = 1;
-            for (int shard = 0; shard < 32; shard++) {
+            for (int shard = 0; shard < NSEG; shard++) {
                 uint64_t cur = g_seg_ops_pinn[shard].load();
                 seg_ops[shard] = cur - prev_pinn[shard];
                 prev_pinn[shard] = cur;
                 if (seg_ops[shard] > max_seg_ops) max_seg_ops = seg_ops[shard];
             }
-            for (int shard = 0; shard < 32; shard++) {
+            auto seg_sizes = manager.segment_sizes();
+            // Byte-budget mode has no entry capacity: measure against 2× the mean fill
+            size_t per_segment = cfg.max_memory
+                ? std::max<size_t>(1, 2 * manager.size() / seg_sizes.size())
+                : std::max<size_t>(1, cfg.capacity / seg_sizes.size());
+            for (int shard = 0; shard < NSEG; shard++) {
                 // Blend segment size ratio with recent ops ratio for diverse predictions
                 float ops_load = static_cast<float>(seg_ops[shard]) /
                                  static_cast<float>(max_seg_ops);
-                auto seg_sizes = manager.segment_sizes();
                 float size_load = static_cast<float>(seg_sizes[shard]) /
-                    static_cast<float>(std::max<size_t>(1, cfg.capacity / 32));
+                    static_cast<float>(per_segment);
                 float load = std::min(1.0f, 0.7f * ops_load + 0.3f * size_load);
                 float hit_rate = (total_ops > 0)
                     ? static_cast<float>(s.cache_hits.load()) / static_cast<float>(total_ops)
                     : 0.0f;
-                float latency = (seg_ops[shard] > 0) ? 0.2f + 0.8f * ops_load : 0.1f;
+                // Measured mean GET latency in the segment since the last sample
+                auto snap = manager.segment_latency(static_cast<size_t>(shard));
+                float latency = static_cast<float>(snap.since(prev_latency[shard]).mean_ns() / 1e6);
+                prev_latency[shard] = std::move(snap);
                 sharder.RecordTelemetry(shard, load, hit_rate, latency);
             }
             dcs::compat::this_thread::sleep_for(std::chrono::seconds(2));
@@ -680,7 +1015,7 @@ int main(int argc, char* argv[]) {
     static std::string prev_raft_role = "Follower";
 
     // Initialize burst detection window
-    for (int i = 0; i < 32; i++) g_seg_ops_window[i] = 0;
+    for (int i = 0; i < NSEG; i++) g_seg_ops_window[i] = 0;
 
     // ── Persistent burst thread ───────────────────────────────────────
     dcs::compat::Thread burst_thread([&]() {
@@ -700,7 +1035,7 @@ int main(int argc, char* argv[]) {
                 g_seg_locks[s].fetch_add(1);
                 g_seg_ops_window[s].fetch_add(1);
                 g_seg_ops_pinn[s].fetch_add(1);
-                g_node_reqs[s * 5 / 32].fetch_add(1);
+                g_node_reqs[s * 5 / NSEG].fetch_add(1);
                 g_traffic_total.fetch_add(1);
                 g_burst_ops_done.fetch_add(1);
             }
@@ -743,18 +1078,18 @@ int main(int argc, char* argv[]) {
                 int roll = static_cast<int>(kn % 100);
                 std::string key;
                 if (roll < 10) {
-                    shard_idx = 4;
+                    shard_idx = 4 % NSEG;
                     key = "hot4_" + std::to_string(kn % 5000);
                 } else if (roll < 20) {
-                    shard_idx = 5;
+                    shard_idx = 5 % NSEG;
                     key = "hot5_" + std::to_string(kn % 5000);
                 } else {
-                    shard_idx = static_cast<int>(kn % 32);
+                    shard_idx = static_cast<int>(kn % static_cast<uint64_t>(NSEG));
                     key = "k" + std::to_string(kn % 50000);
                 }
 
                 // Route to one of 5 raft nodes
-                int node_idx = shard_idx * 5 / 32;
+                int node_idx = shard_idx * 5 / NSEG;
                 g_node_reqs[node_idx].fetch_add(1);
 
                 // Track lock usage and PINN telemetry
@@ -786,17 +1121,17 @@ int main(int argc, char* argv[]) {
 
             // ── Burst / heat stroke detection (only worker 0 handles this) ──
             if (worker_id == 0 && local_counter % 2000 < static_cast<uint64_t>(ops_per_batch)) {
-                uint64_t seg_ops[32];
+                std::vector<uint64_t> seg_ops(NSEG);
                 uint64_t total_seg_ops = 0;
-                for (int i = 0; i < 32; i++) {
+                for (int i = 0; i < NSEG; i++) {
                     seg_ops[i] = g_seg_ops_window[i].load();
                     total_seg_ops += seg_ops[i];
                     g_seg_ops_window[i] = 0;
                 }
                 if (total_seg_ops > 50) {
-                    float avg_ops = static_cast<float>(total_seg_ops) / 32.0f;
+                    float avg_ops = static_cast<float>(total_seg_ops) / static_cast<float>(NSEG);
                     int hot_count = 0;
-                    for (int i = 0; i < 32; i++) {
+                    for (int i = 0; i < NSEG; i++) {
                         if (static_cast<float>(seg_ops[i]) > avg_ops * 2.5f)
                             hot_count++;
                     }
@@ -887,9 +1222,11 @@ int main(int argc, char* argv[]) {
     std::cout << "\n[Shutdown] Stopping subsystems...\n";
 
     http_server.stop();
+    metrics_publisher.stop();
     std::cout << "[Shutdown] HTTP server stopped.\n";
 
     sharder.Stop();
+    if (balancer) balancer->stop();
     std::cout << "[Shutdown] PINN sharder stopped.\n";
 
     for (int i = 0; i < RAFT_CLUSTER_SIZE; i++) {
@@ -904,6 +1241,10 @@ int main(int argc, char* argv[]) {
     }
     if (burst_thread.joinable()) burst_thread.join();
 
+    if (cfg.prewarm_keys > 0 && manager.save_hot_keys(hot_keys_path, cfg.prewarm_keys)) {
+        std::cout << "[Shutdown] Hot-key list saved to " << hot_keys_path << "\n";
+    }
+
     std::cout << "[Shutdown] Flushing cache to LSM-Tree...\n";
     manager.shutdown();
 
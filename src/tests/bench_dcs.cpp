@@ -0,0 +1,644 @@
+/**
+ * dcs_bench — regression benchmarks with machine-readable output.
+ *
+ *   dcs_bench micro [options]   in-process: LRUCache, SegmentedCache,
+ *                               RESPStream, MemTable, SSTableReader, WALWriter
+ *   dcs_bench load  [options]   pipelined RESP load against a running server
+ *
+ * Every result is one JSON object per line on stdout:
+ *   {"suite":"micro","bench":"lru_get","threads":1,"ops":200000,"seconds":0.021,
+ *    "ops_per_sec":9.5e6,"p50_us":0.09,"p99_us":0.21,"p999_us":0.4,"max_us":3.1}
+ * Micro latencies are per-op averages over samples of a few dozen ops
+ * (timing a single 50 ns operation would measure the clock); load
+ * latencies are per request, from the send of its pipeline batch to its
+ * reply.  Progress and errors go to stderr.
+ *
+ * Not part of ctest — run manually, e.g.
+ *   ./dcs_bench micro --ops 1000000 --dist zipf --only lru,sstable
+ *   ./dcs_bench load --port 6379 --connections 16 --pipeline 32 --read-ratio 0.9
+ */
+
+#include "include/cluster/remote.h"   // first: Winsock before windows.h
+#include "include/cache/lru_cache.h"
+#include "include/cache/segmented_cache.h"
+#include "include/compat/threading.h"
+#include "include/metrics/latency.h"
+#include "include/network/resp_parser.h"
+#include "include/storage/block_cache.h"
+#include "include/storage/lsm_engine.h"
+#include "include/storage/memtable.h"
+#include "include/storage/sstable.h"
+#include "include/storage/wal.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+using namespace dcs;
+
+namespace {
+
+struct Options {
+    std::string mode;
+    uint64_t    ops         = 200000;   // micro: per benchmark; load: total requests
+    size_t      keys        = 100000;
+    size_t      value_min   = 64;
+    size_t      value_max   = 64;
+    bool        zipf        = false;
+    double      theta       = 0.99;
+    double      read_ratio  = 0.9;      // GET share of mixed workloads
+    size_t      threads     = compat::Thread::hardware_concurrency();
+    std::string only;                   // micro: comma-separated bench name prefixes
+    std::string host        = "127.0.0.1";
+    uint16_t    port        = 6379;
+    size_t      connections = 8;
+    size_t      pipeline    = 16;
+    bool        preload     = true;
+    uint64_t    seed        = 42;
+};
+
+// ── Workload ───────────────────────────────────────────────────────
+
+/** splitmix64: small, fast, good enough to pick keys. */
+class Rng {
+public:
+    explicit Rng(uint64_t seed) : s_(seed) {}
+
+    uint64_t next() {
+        uint64_t z = (s_ += 0x9e3779b97f4a7c15ULL);
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+        return z ^ (z >> 31);
+    }
+
+    double unit() { return static_cast<double>(next() >> 11) * (1.0 / 9007199254740992.0); }
+
+private:
+    uint64_t s_;
+};
+
+/**
+ * Key indices, uniform or zipfian (Gray et al., as in YCSB).  Zipfian
+ * ranks are scrambled over the key space so the hottest keys don't all
+ * sit next to each other (and in the same cache segment).
+ */
+class KeyDist {
+public:
+    KeyDist(size_t n, bool zipf, double theta) : n_(std::max<size_t>(1, n)), zipf_(zipf) {
+        if (!zipf_) return;
+        theta_ = std::min(std::max(theta, 0.01), 0.999);
+        for (size_t i = 1; i <= n_; ++i) zetan_ += 1.0 / std::pow(static_cast<double>(i), theta_);
+        double zeta2 = 1.0 + 1.0 / std::pow(2.0, theta_);
+        alpha_ = 1.0 / (1.0 - theta_);
+        eta_ = (1.0 - std::pow(2.0 / static_cast<double>(n_), 1.0 - theta_)) / (1.0 - zeta2 / zetan_);
+    }
+
+    size_t next(Rng& rng) const {
+        if (!zipf_) return static_cast<size_t>(rng.next() % n_);
+        double u = rng.unit();
+        double uz = u * zetan_;
+        size_t rank;
+        if (uz < 1.0) rank = 0;
+        else if (uz < 1.0 + std::pow(0.5, theta_)) rank = 1;
+        else rank = static_cast<size_t>(static_cast<double>(n_) * std::pow(eta_ * u - eta_ + 1.0, alpha_));
+        rank = std::min(rank, n_ - 1);
+        return static_cast<size_t>((rank * 0x9e3779b97f4a7c15ULL) % n_);
+    }
+
+private:
+    size_t n_;
+    bool   zipf_;
+    double theta_ = 0, zetan_ = 0, alpha_ = 0, eta_ = 0;
+};
+
+struct Workload {
+    std::vector<std::string> keys;   // zero-padded, so index order is key order
+    std::string values;              // value_max bytes; a value is a prefix
+    KeyDist dist;
+    size_t value_min, value_max;
+
+    explicit Workload(const Options& o)
+        : dist(o.keys, o.zipf, o.theta), value_min(o.value_min), value_max(std::max(o.value_min, o.value_max)) {
+        keys.reserve(o.keys);
+        char buf[32];
+        for (size_t i = 0; i < o.keys; ++i) {
+            std::snprintf(buf, sizeof(buf), "key:%012zu", i);
+            keys.emplace_back(buf);
+        }
+        Rng rng(o.seed);
+        static const char kAlphabet[] = "abcdefghijklmnopqrstuvwxyz0123456789";
+        values.resize(value_max);
+        for (auto& c : values) c = kAlphabet[rng.next() % (sizeof(kAlphabet) - 1)];
+    }
+
+    const std::string& key(Rng& rng) const { return keys[dist.next(rng)]; }
+
+    std::string_view value(Rng& rng) const {
+        size_t n = value_min == value_max ? value_max
+                                          : value_min + static_cast<size_t>(rng.next() % (value_max - value_min + 1));
+        return std::string_view(values.data(), n);
+    }
+};
+
+// ── Results ────────────────────────────────────────────────────────
+
+struct Result {
+    std::string suite;
+    std::string bench;
+    size_t      threads = 1;
+    uint64_t    ops = 0;
+    double      seconds = 0;
+    metrics::LatencySnapshot latency;
+    std::string extra;   // further ,"name":value pairs
+};
+
+void print_result(const Result& r) {
+    const double us = 1e3;
+    char buf[512];
+    std::snprintf(buf, sizeof(buf),
+                  "{\"suite\":\"%s\",\"bench\":\"%s\",\"threads\":%zu,\"ops\":%llu,\"seconds\":%.6f,"
+                  "\"ops_per_sec\":%.1f,\"p50_us\":%.3f,\"p99_us\":%.3f,\"p999_us\":%.3f,\"max_us\":%.3f",
+                  r.suite.c_str(), r.bench.c_str(), r.threads, static_cast<unsigned long long>(r.ops), r.seconds,
+                  r.seconds > 0 ? static_cast<double>(r.ops) / r.seconds : 0.0,
+                  r.latency.percentile_ns(0.50) / us, r.latency.percentile_ns(0.99) / us,
+                  r.latency.percentile_ns(0.999) / us, static_cast<double>(r.latency.max_ns) / us);
+    std::cout << buf << r.extra << "}\n" << std::flush;
+}
+
+std::atomic<uint64_t> g_sink{0};   // keeps benchmarked results observable
+
+/**
+ * Run `op(thread, i)` `ops` times on each of `threads` threads, timing
+ * samples of `sample` consecutive ops.  `op` returns something to sum
+ * into g_sink, so the work can't be optimized away.
+ */
+template <class Op>
+Result run_micro(const std::string& bench, size_t threads, uint64_t ops, uint64_t sample, Op op) {
+    metrics::LatencyHistogram hist;
+    threads = std::max<size_t>(1, threads);
+    sample = std::max<uint64_t>(1, sample);
+    auto body = [&](size_t t) {
+        uint64_t sum = 0;
+        for (uint64_t i = 0; i < ops;) {
+            uint64_t n = std::min(sample, ops - i);
+            uint64_t t0 = metrics::now_ns();
+            for (uint64_t j = 0; j < n; ++j) sum += op(t, i + j);
+            hist.record_ns((metrics::now_ns() - t0) / n);
+            i += n;
+        }
+        g_sink.fetch_add(sum, std::memory_order_relaxed);
+    };
+    uint64_t t0 = metrics::now_ns();
+    if (threads == 1) {
+        body(0);
+    } else {
+        std::vector<compat::Thread> pool;
+        for (size_t t = 0; t < threads; ++t) pool.emplace_back([&body, t] { body(t); });
+        for (auto& th : pool) th.join();
+    }
+    Result r;
+    r.suite = "micro";
+    r.bench = bench;
+    r.threads = threads;
+    r.ops = ops * threads;
+    r.seconds = static_cast<double>(metrics::now_ns() - t0) / 1e9;
+    r.latency = hist.snapshot();
+    return r;
+}
+
+// ── Micro benchmarks ───────────────────────────────────────────────
+
+const std::string kDataDir = "dcs_bench_data";
+
+bool selected(const Options& o, const std::string& bench) {
+    if (o.only.empty()) return true;
+    std::stringstream ss(o.only);
+    std::string item;
+    while (std::getline(ss, item, ',')) {
+        if (!item.empty() && bench.compare(0, item.size(), item) == 0) return true;
+    }
+    return false;
+}
+
+void remove_data_dir() {
+#ifdef _WIN32
+    std::system(("rmdir /s /q " + kDataDir + " 2>nul").c_str());
+#else
+    std::system(("rm -rf " + kDataDir).c_str());
+#endif
+}
+
+void bench_lru(const Options& o, const Workload& w) {
+    cache::LRUCache lru(w.keys.size());
+    Rng fill(o.seed);
+    for (const auto& k : w.keys) lru.put(k, w.value(fill));
+    std::vector<Rng> rngs(1, Rng(o.seed + 1));
+
+    if (selected(o, "lru_get")) {
+        print_result(run_micro("lru_get", 1, o.ops, 64, [&](size_t t, uint64_t) {
+            return static_cast<uint64_t>(lru.get(w.key(rngs[t])).value.size());
+        }));
+    }
+    if (selected(o, "lru_put")) {
+        print_result(run_micro("lru_put", 1, o.ops, 64, [&](size_t t, uint64_t) {
+            lru.put(w.key(rngs[t]), w.value(rngs[t]));
+            return uint64_t(1);
+        }));
+    }
+}
+
+void bench_segmented(const Options& o, const Workload& w) {
+    cache::SegmentedCache cache(w.keys.size());
+    Rng fill(o.seed);
+    for (const auto& k : w.keys) cache.put(k, w.value(fill));
+    std::vector<Rng> rngs;
+    for (size_t t = 0; t < o.threads; ++t) rngs.emplace_back(o.seed + 100 + t);
+    const uint64_t per_thread = std::max<uint64_t>(1, o.ops / std::max<size_t>(1, o.threads));
+
+    if (selected(o, "segmented_get")) {
+        print_result(run_micro("segmented_get", o.threads, per_thread, 64, [&](size_t t, uint64_t) {
+            return static_cast<uint64_t>(cache.get(w.key(rngs[t])).value.size());
+        }));
+    }
+    if (selected(o, "segmented_put")) {
+        print_result(run_micro("segmented_put", o.threads, per_thread, 64, [&](size_t t, uint64_t) {
+            cache.put(w.key(rngs[t]), w.value(rngs[t]));
+            return uint64_t(1);
+        }));
+    }
+    if (selected(o, "segmented_mixed")) {
+        const uint64_t read_cut = static_cast<uint64_t>(o.read_ratio * 1e6);
+        Result r = run_micro("segmented_mixed", o.threads, per_thread, 64, [&](size_t t, uint64_t) {
+            Rng& rng = rngs[t];
+            if (rng.next() % 1000000 < read_cut) return static_cast<uint64_t>(cache.get(w.key(rng)).value.size());
+            cache.put(w.key(rng), w.value(rng));
+            return uint64_t(1);
+        });
+        char extra[32];
+        std::snprintf(extra, sizeof(extra), ",\"read_ratio\":%.3f", o.read_ratio);
+        r.extra = extra;
+        print_result(r);
+    }
+}
+
+/** RESPStream over a pipelined GET/SET stream, fed in 16 KB recv()-sized chunks. */
+void bench_resp(const Options& o, const Workload& w) {
+    if (!selected(o, "resp_parse")) return;
+    Rng rng(o.seed + 2);
+    std::string wire;
+    const size_t kCommands = 4096;
+    for (size_t i = 0; i < kCommands; ++i) {
+        bool get = rng.unit() < o.read_ratio;
+        network::RESPParser::append_array_header(wire, get ? 2 : 3);
+        network::RESPParser::append_bulk_string(wire, get ? "GET" : "SET");
+        network::RESPParser::append_bulk_string(wire, w.key(rng));
+        if (!get) network::RESPParser::append_bulk_string(wire, w.value(rng));
+    }
+    const size_t kChunk = 16384;
+    std::vector<std::pair<size_t, size_t>> chunks;   // (offset, commands completed by it)
+    {
+        network::RESPStream probe;
+        std::vector<std::string_view> argv;
+        for (size_t off = 0; off < wire.size(); off += kChunk) {
+            probe.append(wire.data() + off, std::min(kChunk, wire.size() - off));
+            size_t n = 0;
+            while (probe.next(argv) == network::RESPStream::Status::Ok) ++n;
+            chunks.emplace_back(off, n);
+        }
+    }
+
+    network::RESPStream stream;
+    std::vector<std::string_view> argv;
+    metrics::LatencyHistogram hist;
+    uint64_t parsed = 0, sum = 0;
+    uint64_t t0 = metrics::now_ns();
+    while (parsed < o.ops) {
+        for (const auto& c : chunks) {
+            uint64_t s0 = metrics::now_ns();
+            stream.append(wire.data() + c.first, std::min(kChunk, wire.size() - c.first));
+            size_t n = 0;
+            while (stream.next(argv) == network::RESPStream::Status::Ok) {
+                sum += argv.back().size();
+                ++n;
+            }
+            if (n) hist.record_ns((metrics::now_ns() - s0) / n);
+            parsed += n;
+        }
+    }
+    g_sink.fetch_add(sum, std::memory_order_relaxed);
+    Result r;
+    r.suite = "micro";
+    r.bench = "resp_parse";
+    r.ops = parsed;
+    r.seconds = static_cast<double>(metrics::now_ns() - t0) / 1e9;
+    r.latency = hist.snapshot();
+    r.extra = ",\"bytes_per_command\":" + std::to_string(wire.size() / kCommands);
+    print_result(r);
+}
+
+void bench_memtable(const Options& o, const Workload& w) {
+    Rng rng(o.seed + 3);
+    if (selected(o, "memtable_put")) {
+        // Rotated once full, as the engine does; the rotation is in the timing.
+        auto table = std::make_unique<storage::MemTable>();
+        uint64_t seq = 0;
+        print_result(run_micro("memtable_put", 1, o.ops, 64, [&](size_t, uint64_t) {
+            if (table->ShouldFlush()) table = std::make_unique<storage::MemTable>();
+            return static_cast<uint64_t>(table->Put(w.key(rng), std::string(w.value(rng)), ++seq));
+        }));
+    }
+    if (selected(o, "memtable_get")) {
+        storage::MemTable table;
+        uint64_t seq = 0;
+        // Keep the table below its flush size, as a live memtable would be.
+        size_t n = std::min(w.keys.size(), size_t(20000));
+        for (size_t i = 0; i < n; ++i) table.Put(w.keys[i], std::string(w.value(rng)), ++seq);
+        print_result(run_micro("memtable_get", 1, o.ops, 64, [&](size_t, uint64_t) {
+            return static_cast<uint64_t>(table.Get(w.keys[rng.next() % n]).found);
+        }));
+    }
+}
+
+void bench_sstable(const Options& o, const Workload& w) {
+    if (!selected(o, "sstable")) return;
+    const std::string path = kDataDir + "/bench.sst";
+    {
+        storage::SSTableOptions opts;
+        opts.expected_entries = w.keys.size();
+        storage::SSTableWriter writer(path, opts);
+        Rng fill(o.seed);
+        for (const auto& k : w.keys) writer.Add(k, std::string(w.value(fill)));
+        if (!writer.Finish()) {
+            std::cerr << "[sstable] could not write " << path << "\n";
+            return;
+        }
+    }
+    Rng rng(o.seed + 4);
+    storage::BlockCache block_cache(256 * 1024 * 1024);
+    storage::SSTableReader cached(path, &block_cache);
+    storage::SSTableReader uncached(path, nullptr);
+    std::string value;
+    if (selected(o, "sstable_get_cached")) {
+        print_result(run_micro("sstable_get_cached", 1, o.ops, 64, [&](size_t, uint64_t) {
+            return static_cast<uint64_t>(cached.Get(w.key(rng), value));
+        }));
+    }
+    if (selected(o, "sstable_get_uncached")) {
+        print_result(run_micro("sstable_get_uncached", 1, o.ops, 16, [&](size_t, uint64_t) {
+            return static_cast<uint64_t>(uncached.Get(w.key(rng), value));
+        }));
+    }
+    if (selected(o, "sstable_get_miss")) {
+        std::vector<std::string> absent;
+        for (size_t i = 0; i < 4096; ++i) absent.push_back(w.keys[i % w.keys.size()] + "~");
+        print_result(run_micro("sstable_get_miss", 1, o.ops, 64, [&](size_t, uint64_t i) {
+            return static_cast<uint64_t>(cached.Get(absent[i % absent.size()], value));
+        }));
+    }
+}
+
+void bench_wal(const Options& o, const Workload& w) {
+    Rng rng(o.seed + 5);
+    auto record = [&](uint64_t seq) {
+        return storage::WALRecord{storage::WALRecordType::kPut, w.key(rng), std::string(w.value(rng)), seq};
+    };
+    if (selected(o, "wal_append")) {
+        storage::WALOptions opts;
+        opts.sync_mode = storage::WALSyncMode::kNone;
+        storage::WALWriter wal(kDataDir + "/bench_nosync.wal", opts);
+        print_result(run_micro("wal_append", 1, o.ops, 64, [&](size_t, uint64_t i) {
+            return static_cast<uint64_t>(wal.Append(record(i + 1)));
+        }));
+    }
+    if (selected(o, "wal_append_fsync")) {
+        // One fdatasync per append: bounded by the device, so far fewer ops.
+        storage::WALOptions opts;
+        opts.sync_mode = storage::WALSyncMode::kPerBatch;
+        storage::WALWriter wal(kDataDir + "/bench_sync.wal", opts);
+        uint64_t ops = std::max<uint64_t>(1, std::min<uint64_t>(o.ops / 100, 2000));
+        print_result(run_micro("wal_append_fsync", 1, ops, 1, [&](size_t, uint64_t i) {
+            return static_cast<uint64_t>(wal.Append(record(i + 1)));
+        }));
+    }
+}
+
+int run_micro_suite(const Options& o) {
+    remove_data_dir();
+    DCS_MKDIR(kDataDir.c_str());
+    std::cerr << "[micro] " << o.keys << " keys, " << o.ops << " ops per benchmark, "
+              << (o.zipf ? "zipfian" : "uniform") << " keys\n";
+    Workload w(o);
+    bench_lru(o, w);
+    bench_segmented(o, w);
+    bench_resp(o, w);
+    bench_memtable(o, w);
+    bench_sstable(o, w);
+    bench_wal(o, w);
+    remove_data_dir();
+    return 0;
+}
+
+// ── Load client ────────────────────────────────────────────────────
+
+struct LoadTotals {
+    metrics::LatencyHistogram get_latency;
+    metrics::LatencyHistogram set_latency;
+    std::atomic<uint64_t> gets{0}, sets{0}, misses{0}, errors{0};
+};
+
+void append_command(std::string& out, std::string_view cmd, std::string_view key, std::string_view value = {}) {
+    network::RESPParser::append_array_header(out, value.data() ? 3 : 2);
+    network::RESPParser::append_bulk_string(out, cmd);
+    network::RESPParser::append_bulk_string(out, key);
+    if (value.data()) network::RESPParser::append_bulk_string(out, value);
+}
+
+/** SET every key once, 256 per pipeline, so GETs measure hits. */
+bool preload(const Options& o, const Workload& w) {
+    cluster::RespClient client(o.host, o.port, 10000);
+    Rng rng(o.seed);
+    const size_t kBatch = 256;
+    for (size_t i = 0; i < w.keys.size(); i += kBatch) {
+        size_t n = std::min(kBatch, w.keys.size() - i);
+        std::string wire;
+        for (size_t j = 0; j < n; ++j) append_command(wire, "SET", w.keys[i + j], w.value(rng));
+        if (!client.send(wire)) return false;
+        cluster::RespClient::Reply reply;
+        for (size_t j = 0; j < n; ++j) {
+            if (!client.receive(reply) || !reply.ok()) return false;
+        }
+    }
+    return true;
+}
+
+/** One connection: `requests` commands, `pipeline` in flight per round trip. */
+void load_connection(const Options& o, const Workload& w, size_t index, uint64_t requests, LoadTotals& totals) {
+    cluster::RespClient client(o.host, o.port, 10000);
+    Rng rng(o.seed + 1000 + index);
+    const uint64_t read_cut = static_cast<uint64_t>(o.read_ratio * 1e6);
+    const size_t depth = std::max<size_t>(1, o.pipeline);
+    std::vector<bool> is_get(depth);
+    std::string wire;
+    uint64_t done = 0;
+    while (done < requests) {
+        size_t n = static_cast<size_t>(std::min<uint64_t>(depth, requests - done));
+        wire.clear();
+        for (size_t j = 0; j < n; ++j) {
+            is_get[j] = rng.next() % 1000000 < read_cut;
+            if (is_get[j]) append_command(wire, "GET", w.key(rng));
+            else append_command(wire, "SET", w.key(rng), w.value(rng));
+        }
+        uint64_t t0 = metrics::now_ns();
+        if (!client.send(wire)) {
+            totals.errors.fetch_add(requests - done);
+            return;
+        }
+        cluster::RespClient::Reply reply;
+        for (size_t j = 0; j < n; ++j) {
+            if (!client.receive(reply)) {
+                totals.errors.fetch_add(requests - done - j);
+                return;
+            }
+            uint64_t ns = metrics::now_ns() - t0;
+            if (reply.type == '-') totals.errors++;
+            if (is_get[j]) {
+                totals.get_latency.record_ns(ns);
+                totals.gets++;
+                if (reply.type == '$' && reply.integer < 0) totals.misses++;
+            } else {
+                totals.set_latency.record_ns(ns);
+                totals.sets++;
+            }
+        }
+        done += n;
+    }
+}
+
+int run_load(const Options& o) {
+    Workload w(o);
+    std::cerr << "[load] " << o.host << ":" << o.port << ", " << o.connections << " connections x "
+              << o.pipeline << " pipelined, " << o.ops << " requests, " << o.keys << " "
+              << (o.zipf ? "zipfian" : "uniform") << " keys, read ratio " << o.read_ratio << "\n";
+    if (o.preload) {
+        std::cerr << "[load] preloading " << w.keys.size() << " keys\n";
+        if (!preload(o, w)) {
+            std::cerr << "[load] preload failed: cannot reach " << o.host << ":" << o.port << "\n";
+            return 1;
+        }
+    }
+
+    LoadTotals totals;
+    const size_t conns = std::max<size_t>(1, o.connections);
+    uint64_t t0 = metrics::now_ns();
+    std::vector<compat::Thread> pool;
+    for (size_t c = 0; c < conns; ++c) {
+        uint64_t share = o.ops / conns + (c < o.ops % conns ? 1 : 0);
+        pool.emplace_back([&, c, share] { load_connection(o, w, c, share, totals); });
+    }
+    for (auto& th : pool) th.join();
+    double seconds = static_cast<double>(metrics::now_ns() - t0) / 1e9;
+
+    char extra[256];
+    std::snprintf(extra, sizeof(extra),
+                  ",\"connections\":%zu,\"pipeline\":%zu,\"keys\":%zu,\"dist\":\"%s\",\"read_ratio\":%.3f,"
+                  "\"value_min\":%zu,\"value_max\":%zu",
+                  conns, o.pipeline, o.keys, o.zipf ? "zipf" : "uniform", o.read_ratio, w.value_min, w.value_max);
+    auto emit = [&](const char* bench, uint64_t ops, metrics::LatencySnapshot lat, const std::string& more) {
+        Result r;
+        r.suite = "load";
+        r.bench = bench;
+        r.threads = conns;
+        r.ops = ops;
+        r.seconds = seconds;
+        r.latency = std::move(lat);
+        r.extra = extra + more;
+        print_result(r);
+    };
+    metrics::LatencySnapshot all = totals.get_latency.snapshot();
+    all.merge(totals.set_latency.snapshot());
+    emit("get", totals.gets.load(), totals.get_latency.snapshot(), ",\"misses\":" + std::to_string(totals.misses.load()));
+    emit("set", totals.sets.load(), totals.set_latency.snapshot(), "");
+    emit("all", totals.gets.load() + totals.sets.load(), std::move(all),
+         ",\"errors\":" + std::to_string(totals.errors.load()));
+    if (totals.errors.load()) {
+        std::cerr << "[load] " << totals.errors.load() << " requests failed\n";
+        return 1;
+    }
+    return 0;
+}
+
+// ── Command line ───────────────────────────────────────────────────
+
+void usage() {
+    std::cerr << "Usage: dcs_bench micro|load [OPTIONS]\n"
+              << "Common:\n"
+              << "  --ops N              micro: ops per benchmark; load: total requests (default: 200000)\n"
+              << "  --keys N             Key space size (default: 100000)\n"
+              << "  --dist D             uniform (default) | zipf\n"
+              << "  --zipf-theta T       Zipfian skew, 0 < T < 1 (default: 0.99)\n"
+              << "  --value-size N|A:B   Value bytes, fixed or uniform in [A, B] (default: 64)\n"
+              << "  --read-ratio R       GET share of mixed workloads (default: 0.9)\n"
+              << "  --seed N             Workload seed (default: 42)\n"
+              << "micro:\n"
+              << "  --threads N          SegmentedCache threads (default: one per core)\n"
+              << "  --only A,B           Only benchmarks whose name starts with A or B\n"
+              << "                       (lru, segmented, resp_parse, memtable, sstable, wal)\n"
+              << "load:\n"
+              << "  --host H             Server host (default: 127.0.0.1)\n"
+              << "  -p, --port P         Server port (default: 6379)\n"
+              << "  -c, --connections N  Concurrent connections (default: 8)\n"
+              << "  -P, --pipeline N     Requests in flight per connection (default: 16)\n"
+              << "  --no-preload         Don't SET every key before measuring\n";
+}
+
+bool parse_args(int argc, char** argv, Options& o) {
+    if (argc < 2) return false;
+    o.mode = argv[1];
+    if (o.mode != "micro" && o.mode != "load") return false;
+    for (int i = 2; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool has = i + 1 < argc;
+        if (arg == "--ops" && has) o.ops = std::strtoull(argv[++i], nullptr, 10);
+        else if (arg == "--keys" && has) o.keys = std::max<size_t>(1, std::strtoull(argv[++i], nullptr, 10));
+        else if (arg == "--dist" && has) o.zipf = std::string(argv[++i]) == "zipf";
+        else if (arg == "--zipf-theta" && has) o.theta = std::atof(argv[++i]);
+        else if (arg == "--value-size" && has) {
+            std::string v = argv[++i];
+            size_t colon = v.find(':');
+            o.value_min = std::strtoull(v.c_str(), nullptr, 10);
+            o.value_max = colon == std::string::npos ? o.value_min : std::strtoull(v.c_str() + colon + 1, nullptr, 10);
+        }
+        else if (arg == "--read-ratio" && has) o.read_ratio = std::min(1.0, std::max(0.0, std::atof(argv[++i])));
+        else if (arg == "--seed" && has) o.seed = std::strtoull(argv[++i], nullptr, 10);
+        else if (arg == "--threads" && has) o.threads = std::max<size_t>(1, std::strtoull(argv[++i], nullptr, 10));
+        else if (arg == "--only" && has) o.only = argv[++i];
+        else if (arg == "--host" && has) o.host = argv[++i];
+        else if ((arg == "--port" || arg == "-p") && has) o.port = static_cast<uint16_t>(std::atoi(argv[++i]));
+        else if ((arg == "--connections" || arg == "-c") && has) o.connections = std::strtoull(argv[++i], nullptr, 10);
+        else if ((arg == "--pipeline" || arg == "-P") && has) o.pipeline = std::strtoull(argv[++i], nullptr, 10);
+        else if (arg == "--no-preload") o.preload = false;
+        else return false;
+    }
+    return true;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    Options o;
+    if (!parse_args(argc, argv, o)) {
+        usage();
+        return 2;
+    }
+    return o.mode == "micro" ? run_micro_suite(o) : run_load(o);
+}
@@ -0,0 +1,127 @@
+/**
+ * Micro-benchmark: the ml kernels and the PINN built on them.
+ *   - GEMM GFLOP/s: naive triple loop vs. blocked scalar vs. the
+ *     dispatched SIMD kernel, at the PINN's shapes and larger ones;
+ *   - fused bias+tanh throughput and its error against std::tanh;
+ *   - batched PredictAllShards latency and TrainStep time, with the
+ *     share of one core the background trainer takes at its 5 s period.
+ *
+ * Not part of ctest — run manually:  ./ml_bench [repeat_scale]
+ */
+
+#include "include/ml/predictive_sharder.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+using namespace dcs::ml;
+using Clock = std::chrono::steady_clock;
+
+static void naive_gemm(size_t M, size_t N, size_t K, const float* A, const float* B, float* C) {
+    for (size_t i = 0; i < M * N; ++i) C[i] = 0.0f;
+    for (size_t i = 0; i < M; ++i)
+        for (size_t k = 0; k < K; ++k)
+            for (size_t j = 0; j < N; ++j) C[i * N + j] += A[i * K + k] * B[k * N + j];
+}
+
+template <class F>
+static double seconds_per_call(F&& f, size_t reps) {
+    f();   // warm up
+    auto t0 = Clock::now();
+    for (size_t r = 0; r < reps; ++r) f();
+    return std::chrono::duration<double>(Clock::now() - t0).count() / static_cast<double>(reps);
+}
+
+int main(int argc, char** argv) {
+    double scale = argc > 1 ? std::atof(argv[1]) : 1.0;
+    bool ok = true;
+    std::cout << "=== ML Kernel Benchmark ===\n"
+              << "  dispatched ISA: " << kernels::ActiveIsa() << "\n\n";
+
+    // ── GEMM ─────────────────────────────────────────────────
+    struct Shape { size_t M, N, K; const char* what; };
+    const Shape shapes[] = {
+        {64, 64, 2, "PINN input layer"},   {64, 64, 64, "PINN hidden layer"},
+        {320, 64, 64, "PDE stencil batch"}, {256, 256, 256, ""}, {512, 512, 512, ""},
+    };
+    for (const auto& s : shapes) {
+        Tensor a = Tensor::Random(s.M, s.K, -1, 1, 1), b = Tensor::Random(s.K, s.N, -1, 1, 2);
+        std::vector<float> ref(s.M * s.N), blk(s.M * s.N), simd(s.M * s.N);
+        double flops = 2.0 * s.M * s.N * s.K;
+        size_t reps = std::max<size_t>(1, static_cast<size_t>(scale * 2e8 / flops));
+
+        double t_naive = seconds_per_call([&] { naive_gemm(s.M, s.N, s.K, a.Data(), b.Data(), ref.data()); }, reps);
+        double t_blk = seconds_per_call([&] {
+            kernels::GemmScalar(s.M, s.N, s.K, a.Data(), s.K, b.Data(), s.N, blk.data(), s.N, false);
+        }, reps);
+        double t_simd = seconds_per_call([&] {
+            kernels::Gemm(s.M, s.N, s.K, a.Data(), s.K, b.Data(), s.N, simd.data(), s.N);
+        }, reps);
+
+        float err = 0;
+        for (size_t i = 0; i < ref.size(); ++i) {
+            err = std::max(err, std::fabs(ref[i] - simd[i]));
+            err = std::max(err, std::fabs(ref[i] - blk[i]));
+        }
+        if (err > 1e-3f * static_cast<float>(s.K)) ok = false;
+
+        std::cout << "  gemm " << s.M << "x" << s.N << "x" << s.K
+                  << (s.what[0] ? std::string(" (") + s.what + ")" : std::string()) << "\n"
+                  << "    naive   : " << flops / t_naive / 1e9 << " GFLOP/s\n"
+                  << "    blocked : " << flops / t_blk / 1e9 << " GFLOP/s\n"
+                  << "    " << kernels::ActiveIsa() << "    : " << flops / t_simd / 1e9
+                  << " GFLOP/s  (" << t_naive / t_simd << "x naive, max err " << err << ")\n";
+    }
+
+    // ── Fused bias + tanh ────────────────────────────────────
+    {
+        const size_t rows = 320, cols = 64;
+        Tensor x = Tensor::Random(rows, cols, -6, 6, 3), bias = Tensor::Random(1, cols, -1, 1, 4);
+        Tensor work = x;
+        float err = 0;
+        work.AddBiasTanhInPlace(bias);
+        for (size_t r = 0; r < rows; ++r)
+            for (size_t c = 0; c < cols; ++c)
+                err = std::max(err, std::fabs(work(r, c) - std::tanh(x(r, c) + bias(0, c))));
+        if (err > 1e-5f) ok = false;
+        size_t reps = static_cast<size_t>(scale * 20000) + 1;
+        double t_fused = seconds_per_call([&] { work = x; work.AddBiasTanhInPlace(bias); }, reps);
+        double t_split = seconds_per_call([&] { work = x.AddBias(bias).Tanh(); }, reps);
+        std::cout << "\n  bias+tanh " << rows << "x" << cols << ": fused " << rows * cols / t_fused / 1e6
+                  << " M elem/s, AddBias().Tanh() " << rows * cols / t_split / 1e6
+                  << " M elem/s (max err " << err << ")\n";
+    }
+
+    // ── PINN ─────────────────────────────────────────────────
+    {
+        PINNConfig cfg;
+        PINNModel model(cfg);
+        const int shards = 16;
+        size_t reps = static_cast<size_t>(scale * 2000) + 1;
+        double t_pred = seconds_per_call([&] { model.PredictAllShards(shards, 0.5f); }, reps);
+        double t_one = seconds_per_call([&] {
+            for (int i = 0; i < shards; ++i) model.Predict(static_cast<float>(i) / shards, 0.5f);
+        }, reps);
+
+        Tensor x = Tensor::Random(PredictiveSharder::kTrainBatchSize, 2, 0, 1, 5);
+        Tensor y = Tensor::Random(PredictiveSharder::kTrainBatchSize, 1, 0, 1, 6);
+        size_t train_reps = static_cast<size_t>(scale * 50) + 1;
+        double t_train = seconds_per_call([&] { model.TrainStep(x, y); }, train_reps);
+
+        std::cout << "\n  PredictAllShards(" << shards << "): " << t_pred * 1e6 << " us batched, "
+                  << t_one * 1e6 << " us one shard at a time\n"
+                  << "  TrainStep(batch " << PredictiveSharder::kTrainBatchSize << "): "
+                  << t_train * 1e3 << " ms\n"
+                  << "  trainer CPU share: " << 100.0 * t_train / PredictiveSharder::kTrainInterval
+                  << "% of one core (one step per " << PredictiveSharder::kTrainInterval << " s)\n";
+    }
+
+    if (!ok) {
+        std::cout << "\n  MISMATCH: kernel results differ from the reference\n";
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,96 @@
+/**
+ * Micro-benchmark: legacy RESPParser::parse (copying, erase-per-command)
+ * vs. RESPStream (incremental, string_view tokens) on a pipelined
+ * GET/SET workload delivered in recv()-sized chunks.
+ *
+ * Not part of ctest — run manually:  ./resp_bench [commands] [chunk_bytes]
+ */
+
+#include "include/network/resp_parser.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+using namespace dcs::network;
+using Clock = std::chrono::steady_clock;
+
+static std::string build_workload(size_t commands) {
+    std::string value(64, 'x');
+    std::string out;
+    for (size_t i = 0; i < commands; ++i) {
+        std::string key = "user:" + std::to_string(i % 10000);
+        if (i % 4 == 0) {
+            out += "*3\r\n$3\r\nSET\r\n$" + std::to_string(key.size()) + "\r\n" + key + "\r\n$"
+                 + std::to_string(value.size()) + "\r\n" + value + "\r\n";
+        } else {
+            out += "*2\r\n$3\r\nGET\r\n$" + std::to_string(key.size()) + "\r\n" + key + "\r\n";
+        }
+    }
+    return out;
+}
+
+static double run_legacy(const std::string& wire, size_t chunk, size_t& parsed, size_t& checksum) {
+    auto t0 = Clock::now();
+    std::string buffer;
+    for (size_t off = 0; off < wire.size(); off += chunk) {
+        buffer.append(wire, off, chunk);
+        while (!buffer.empty()) {
+            size_t consumed = 0;
+            auto tokens = RESPParser::parse(buffer, consumed);
+            if (tokens.empty() || consumed == 0) break;
+            checksum += tokens.back().size();
+            buffer.erase(0, consumed);
+            ++parsed;
+        }
+    }
+    return std::chrono::duration<double>(Clock::now() - t0).count();
+}
+
+static double run_stream(const std::string& wire, size_t chunk, size_t& parsed, size_t& checksum) {
+    auto t0 = Clock::now();
+    RESPStream stream;
+    std::vector<std::string_view> argv;
+    for (size_t off = 0; off < wire.size(); off += chunk) {
+        size_t n = std::min(chunk, wire.size() - off);
+        stream.append(wire.data() + off, n);
+        while (stream.next(argv) == RESPStream::Status::Ok) {
+            checksum += argv.back().size();
+            ++parsed;
+        }
+    }
+    return std::chrono::duration<double>(Clock::now() - t0).count();
+}
+
+int main(int argc, char** argv) {
+    size_t commands = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 500000;
+    size_t chunk    = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 16384;
+
+    std::string wire = build_workload(commands);
+    double mb = wire.size() / (1024.0 * 1024.0);
+    std::cout << "=== RESP Parser Benchmark ===\n"
+              << "  commands: " << commands << "  bytes: " << wire.size()
+              << "  chunk: " << chunk << "\n\n";
+
+    size_t n_legacy = 0, n_stream = 0, sum_legacy = 0, sum_stream = 0;
+    double t_legacy = run_legacy(wire, chunk, n_legacy, sum_legacy);
+    double t_stream = run_stream(wire, chunk, n_stream, sum_stream);
+
+    auto report = [&](const char* name, size_t n, double t) {
+        std::cout << "  " << name << n / t / 1e6 << " M cmd/s, "
+                  << mb / t << " MB/s (" << t * 1e3 << " ms)\n";
+    };
+    report("legacy parse : ", n_legacy, t_legacy);
+    report("RESPStream   : ", n_stream, t_stream);
+    std::cout << "\n  speedup: " << t_legacy / t_stream << "x\n";
+
+    if (n_legacy != commands || n_stream != commands || sum_legacy != sum_stream) {
+        std::cout << "  MISMATCH: parsed " << n_legacy << " / " << n_stream << "\n";
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,371 @@
+/**
+ * Test suite for cluster sharding: key slots, MOVED / ASK routing,
+ * online slot migration between two in-process nodes, and moving hot
+ * slots on a sharder recommendation.
+ */
+
+#include "include/network/client_handler.h"
+#include "include/cluster/cluster.h"
+
+#include <cassert>
+#include <chrono>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#define TEST(name) \
+    static void name(); \
+    struct name##_reg { name##_reg() { tests.push_back({#name, name}); } } name##_inst; \
+    static void name()
+
+static std::vector<std::pair<std::string, void(*)()>> tests;
+
+using namespace dcs::cluster;
+using dcs::network::ClientHandler;
+
+namespace {
+class MapBackend : public dcs::persistence::StorageBackend {
+public:
+    dcs::persistence::LoadResult load(const std::string& key) override {
+        dcs::compat::LockGuard<dcs::compat::Mutex> lock(mu_);
+        auto it = data_.find(key);
+        if (it == data_.end()) return dcs::persistence::LoadResult::Miss();
+        return dcs::persistence::LoadResult::Hit(it->second);
+    }
+    bool store(const std::string& key, const std::string& value) override {
+        dcs::compat::LockGuard<dcs::compat::Mutex> lock(mu_);
+        data_[key] = value;
+        return true;
+    }
+    bool remove(const std::string& key) override {
+        dcs::compat::LockGuard<dcs::compat::Mutex> lock(mu_);
+        return data_.erase(key) > 0;
+    }
+    bool ping() override { return true; }
+    bool has(const std::string& key) { return load(key).found; }
+private:
+    dcs::compat::Mutex mu_;
+    std::map<std::string, std::string> data_;
+};
+
+/** Two nodes in one process: node 0 owns slots 0-8191, node 1 the rest. */
+struct TwoNodes {
+    MapBackend backend[2];
+    std::unique_ptr<dcs::sync::CacheManager> manager[2];
+    std::unique_ptr<Cluster> cluster[2];
+
+    explicit TwoNodes(ClusterOptions options = ClusterOptions()) {
+        dcs::sync::CacheManager::Config cfg;
+        cfg.write_mode = dcs::sync::WriteMode::WriteBack;
+        cfg.flush_interval = std::chrono::seconds(3600);
+        for (int i = 0; i < 2; ++i) {
+            manager[i].reset(new dcs::sync::CacheManager(cfg, &backend[i]));
+            cluster[i].reset(new Cluster(manager[i].get(), i, options));
+        }
+        for (int i = 0; i < 2; ++i) {
+            for (int n = 0; n < 2; ++n) {
+                NodeAddress a;
+                a.id = n;
+                a.host = "127.0.0.1";
+                a.port = static_cast<uint16_t>(7000 + n);
+                cluster[i]->slots().add_node(a);
+            }
+            cluster[i]->slots().assign_evenly();
+            // Calls to node n go straight to cluster[n]
+            cluster[i]->set_target_factory([this](const NodeAddress& a) {
+                return std::unique_ptr<SlotTarget>(new LocalSlotTarget(cluster[a.id].get()));
+            });
+        }
+    }
+};
+
+/** LocalSlotTarget with hooks to fail imports and to race writes against the move. */
+class FlakyTarget : public LocalSlotTarget {
+public:
+    FlakyTarget(Cluster* target, bool* fail_import, std::function<void()>* before_import,
+                std::function<void()>* before_owner)
+        : LocalSlotTarget(target), fail_import_(fail_import)
+        , before_import_(before_import), before_owner_(before_owner) {}
+
+    bool import(uint16_t slot, const std::vector<MovedEntry>& batch) override {
+        run_once(*before_import_);
+        return !*fail_import_ && LocalSlotTarget::import(slot, batch);
+    }
+    bool set_owner(uint16_t slot, int owner) override {
+        run_once(*before_owner_);
+        return LocalSlotTarget::set_owner(slot, owner);
+    }
+
+private:
+    static void run_once(std::function<void()>& hook) {
+        std::function<void()> h;
+        h.swap(hook);
+        if (h) h();
+    }
+    bool* fail_import_;
+    std::function<void()>* before_import_;
+    std::function<void()>* before_owner_;
+};
+
+std::string reply(ClientHandler& h, std::initializer_list<std::string_view> argv) {
+    return h.execute(argv).data;
+}
+}  // namespace
+
+// ──── Key slots ────────────────────────────────────────────────
+
+TEST(test_key_slot_matches_redis_and_honours_hash_tags) {
+    assert(crc16("123456789", 9) == 0x31C3);
+    assert(key_slot("foo") == 12182);
+    assert(key_slot("bar") == 5061);
+    assert(key_slot("{user1000}.following") == key_slot("{user1000}.followers"));
+    assert(key_slot("{user1000}.following") == key_slot("user1000"));
+    // An empty tag does not count: the whole key is hashed
+    assert(key_slot("foo{}{bar}") == crc16("foo{}{bar}", 10) % kSlotCount);
+    assert(key_slot("foo{{bar}}zap") == key_slot("{bar"));
+}
+
+TEST(test_slot_map_ranges_and_state_rules) {
+    SlotMap map(0);
+    map.add_node({0, "127.0.0.1", 7000});
+    map.add_node({1, "127.0.0.1", 7001});
+    map.add_node({2, "127.0.0.1", 7002});
+    map.assign_evenly();
+    auto ranges = map.ranges();
+    assert(ranges.size() == 3);
+    assert(ranges[0].first == 0 && ranges[0].last == 5461 && ranges[0].owner == 0);
+    assert(ranges[2].last == kSlotCount - 1 && ranges[2].owner == 2);
+
+    assert(!map.set_migrating(9000, 2));   // not ours
+    assert(!map.set_migrating(10, 7));     // unknown node
+    assert(!map.set_importing(10, 1));     // ours already
+    assert(map.set_migrating(10, 1));
+    assert(map.route(10).state == SlotState::Migrating && map.route(10).peer == 1);
+    assert(map.set_owner(10, 1));
+    assert(map.owner(10) == 1 && map.route(10).state == SlotState::Stable);
+    assert(map.ranges().size() == 5);
+}
+
+// ──── Routing ──────────────────────────────────────────────────
+
+TEST(test_requests_for_foreign_slots_are_moved) {
+    TwoNodes nodes;
+    ClientHandler h0(nodes.manager[0].get(), nodes.cluster[0].get());
+
+    assert(reply(h0, {"SET", "bar", "1"}) == "+OK\r\n");
+    assert(reply(h0, {"GET", "foo"}) == "-MOVED 12182 127.0.0.1:7001\r\n");
+    assert(reply(h0, {"SET", "foo", "1"}) == "-MOVED 12182 127.0.0.1:7001\r\n");
+    assert(reply(h0, {"MSET", "{b}a", "1", "{b}b", "2"}) == "+OK\r\n");
+    assert(reply(h0, {"MGET", "foo", "bar"}).rfind("-CROSSSLOT", 0) == 0);
+    assert(reply(h0, {"CLUSTER", "KEYSLOT", "foo"}) == ":12182\r\n");
+    assert(reply(h0, {"DBSIZE"}) == ":3\r\n");
+    assert(nodes.cluster[0]->ops() == 2);
+
+    // Without a cluster the commands are plain errors
+    ClientHandler standalone(nodes.manager[0].get());
+    assert(reply(standalone, {"GET", "foo"}) == "$-1\r\n");
+    assert(reply(standalone, {"CLUSTER", "INFO"}).rfind("-ERR", 0) == 0);
+}
+
+TEST(test_migrating_slot_asks_for_missing_keys) {
+    TwoNodes nodes;
+    ClientHandler h0(nodes.manager[0].get(), nodes.cluster[0].get());
+    ClientHandler h1(nodes.manager[1].get(), nodes.cluster[1].get());
+    uint16_t slot = key_slot("bar");
+
+    assert(reply(h0, {"SET", "{bar}here", "v"}) == "+OK\r\n");
+    assert(reply(h1, {"CLUSTER", "SETSLOT", "5061", "IMPORTING", "0"}) == "+OK\r\n");
+    assert(reply(h0, {"CLUSTER", "SETSLOT", "5061", "MIGRATING", "1"}) == "+OK\r\n");
+
+    assert(reply(h0, {"GET", "{bar}here"}) == "$1\r\nv\r\n");
+    assert(reply(h0, {"GET", "{bar}gone"}) == "-ASK 5061 127.0.0.1:7001\r\n");
+    assert(reply(h0, {"MGET", "{bar}here", "{bar}gone"}).rfind("-TRYAGAIN", 0) == 0);
+
+    // The target serves the slot only right after ASKING
+    assert(reply(h1, {"GET", "{bar}gone"}) == "-MOVED 5061 127.0.0.1:7000\r\n");
+    assert(reply(h1, {"ASKING"}) == "+OK\r\n");
+    assert(reply(h1, {"SET", "{bar}gone", "new"}) == "+OK\r\n");
+    assert(reply(h1, {"GET", "{bar}gone"}) == "-MOVED 5061 127.0.0.1:7000\r\n");
+
+    // Imports only land on a node that is importing the slot
+    assert(reply(h1, {"CLUSTER", "IMPORT", "5061", "{bar}here", "v", "-1"}) == ":1\r\n");
+    assert(reply(h1, {"CLUSTER", "IMPORT", "100", "k", "v", "-1"}).rfind("-ERR", 0) == 0);
+    assert(nodes.cluster[1]->slots().route(slot).state == SlotState::Importing);
+}
+
+// ──── Migration ────────────────────────────────────────────────
+
+TEST(test_migrate_slots_moves_values_ttls_and_ownership) {
+    ClusterOptions opt;
+    opt.migrate_batch = 16;
+    TwoNodes nodes(opt);
+    auto& m0 = *nodes.manager[0];
+    uint64_t ttl_at = dcs::cache::steady_now_ms() + 60000;
+    for (int i = 0; i < 200; ++i) {
+        m0.put("{c}k" + std::to_string(i), "v" + std::to_string(i), i % 2 ? ttl_at : 0);
+    }
+    m0.put("{stay}k", "s");
+    m0.flush();                  // the backend holds copies too
+    m0.put("{c}k0", "newest");   // and the cache a newer, dirty one
+    uint16_t slot = key_slot("c");
+    assert(nodes.cluster[0]->slots().owner(slot) == 0);
+    assert(nodes.cluster[0]->slots().owner(key_slot("stay")) == 0);
+
+    auto moved = nodes.cluster[0]->migrate_slots({slot}, 1);
+    assert(moved.size() == 1 && moved[0] == slot);
+    assert(nodes.cluster[0]->slots().owner(slot) == 1);
+    assert(nodes.cluster[1]->slots().owner(slot) == 1);
+    assert(nodes.cluster[0]->keys_moved() == 200);
+
+    auto& m1 = *nodes.manager[1];
+    assert(m1.get("{c}k0").value == "newest");
+    for (int i = 1; i < 200; ++i) {
+        std::string key = "{c}k" + std::to_string(i);
+        assert(m1.get(key).value == "v" + std::to_string(i));
+        int64_t ttl = m1.ttl_ms(key);
+        assert(i % 2 ? (ttl > 50000 && ttl <= 60000) : ttl == -1);
+        assert(!m0.contains(key) && !nodes.backend[0].has(key));
+    }
+    assert(m0.get("{stay}k").value == "s");
+
+    ClientHandler h0(nodes.manager[0].get(), nodes.cluster[0].get());
+    assert(reply(h0, {"GET", "{c}k1"}) == "-MOVED " + std::to_string(slot) + " 127.0.0.1:7001\r\n");
+}
+
+TEST(test_writes_during_migration_follow_redirects_without_loss) {
+    ClusterOptions opt;
+    opt.migrate_batch = 8;
+    TwoNodes nodes(opt);
+    for (int i = 0; i < 2000; ++i) nodes.manager[0]->put("{w}old" + std::to_string(i), "o");
+    uint16_t slot = key_slot("w");
+
+    dcs::compat::Atomic<bool> done{false};
+    dcs::compat::Atomic<int> written{0};
+    std::thread writer([&] {
+        ClientHandler h0(nodes.manager[0].get(), nodes.cluster[0].get());
+        ClientHandler h1(nodes.manager[1].get(), nodes.cluster[1].get());
+        for (int i = 0; !done.load() || i < 200; ++i) {
+            std::string key = "{w}new" + std::to_string(i);
+            std::string r = h0.execute({"SET", key, "n"}).data;
+            if (r.rfind("-ASK", 0) == 0) {
+                h1.execute({"ASKING"});
+                r = h1.execute({"SET", key, "n"}).data;
+            } else if (r.rfind("-MOVED", 0) == 0) {
+                r = h1.execute({"SET", key, "n"}).data;
+            }
+            assert(r == "+OK\r\n");
+            written.store(i + 1);
+        }
+    });
+    while (written.load() < 50) std::this_thread::yield();
+    auto moved = nodes.cluster[0]->migrate_slots({slot}, 1);
+    done.store(true);
+    writer.join();
+
+    assert(moved.size() == 1);
+    auto& m1 = *nodes.manager[1];
+    for (int i = 0; i < 2000; ++i) assert(m1.get("{w}old" + std::to_string(i)).hit);
+    for (int i = 0; i < written.load(); ++i) assert(m1.get("{w}new" + std::to_string(i)).hit);
+    assert(nodes.manager[0]->size() == 0);
+}
+
+TEST(test_migration_sweeps_late_writes_before_flipping_ownership) {
+    TwoNodes nodes;
+    bool fail_import = false;
+    std::function<void()> before_import, before_owner;
+    nodes.cluster[0]->set_target_factory([&](const NodeAddress& a) {
+        return std::unique_ptr<SlotTarget>(new FlakyTarget(nodes.cluster[a.id].get(), &fail_import,
+                                                           &before_import, &before_owner));
+    });
+    auto& m0 = *nodes.manager[0];
+    ClientHandler h0(nodes.manager[0].get(), nodes.cluster[0].get());
+    for (int i = 0; i < 20; ++i) m0.put("{s}k" + std::to_string(i), "v");
+    uint16_t slot = key_slot("s");
+
+    // A write already past routing lands here during the first pass, and
+    // the sweep that would move it fails: nothing flips, the key stays
+    // reachable on this node
+    before_import = [&] {
+        m0.put("{s}late", "l");
+        before_import = [&] { fail_import = true; };
+    };
+    assert(nodes.cluster[0]->migrate_slots({slot}, 1).empty());
+    assert(nodes.cluster[0]->slots().route(slot).state == SlotState::Migrating);
+    assert(reply(h0, {"GET", "{s}late"}) == "$1\r\nl\r\n");
+
+    // A write racing the flip whose sweep fails: ownership is taken back
+    fail_import = false;
+    before_owner = [&] {
+        m0.put("{s}racer", "r");
+        fail_import = true;
+    };
+    assert(nodes.cluster[0]->migrate_slots({slot}, 1).empty());
+    assert(nodes.cluster[0]->slots().route(slot).owner == 0);
+    assert(nodes.cluster[0]->slots().route(slot).state == SlotState::Migrating);
+    assert(nodes.cluster[1]->slots().route(slot).state == SlotState::Importing);
+    assert(reply(h0, {"GET", "{s}racer"}) == "$1\r\nr\r\n");
+
+    // Once the target answers again the move resumes and loses nothing
+    fail_import = false;
+    assert(nodes.cluster[0]->migrate_slots({slot}, 1).size() == 1);
+    auto& m1 = *nodes.manager[1];
+    assert(nodes.cluster[1]->slots().owner(slot) == 1);
+    assert(m1.get("{s}late").value == "l" && m1.get("{s}racer").value == "r");
+    for (int i = 0; i < 20; ++i) assert(m1.get("{s}k" + std::to_string(i)).hit);
+    assert(m0.size() == 0 && !nodes.backend[0].has("{s}late"));
+}
+
+// ──── Rebalancing ──────────────────────────────────────────────
+
+TEST(test_rebalance_moves_the_hottest_slots) {
+    TwoNodes nodes;
+    auto& c0 = *nodes.cluster[0];
+    nodes.manager[0]->put("{hot}k", "h");
+    nodes.manager[0]->put("{w}k", "w");
+    for (int i = 0; i < 900; ++i) c0.route({"{hot}k"}, false);
+    for (int i = 0; i < 100; ++i) c0.route({"{w}k"}, false);
+    assert(c0.slot_heat(key_slot("hot")) == 900);
+
+    // Not addressed to this node: nothing happens
+    assert(c0.rebalance({1, 0, 0.9f, 0.1f, 1.0f}).empty());
+
+    // Gap 0.8 of 0.9 → move up to ~44% of the traffic: the hot slot alone
+    auto moved = c0.rebalance({0, 1, 0.9f, 0.1f, 1.0f});
+    assert(moved.size() == 1 && moved[0] == key_slot("hot"));
+    assert(c0.slots().owner(key_slot("hot")) == 1);
+    assert(c0.slots().owner(key_slot("w")) == 0);
+    assert(nodes.manager[1]->get("{hot}k").value == "h");
+    assert(c0.slot_heat(key_slot("w")) == 50);
+
+    // Low confidence scales the share down; at least one slot still moves
+    auto again = c0.rebalance({0, 1, 0.9f, 0.1f, 0.01f});
+    assert(again.size() == 1 && again[0] == key_slot("w"));
+}
+
+// ──── Main ─────────────────────────────────────────────────────
+
+int main() {
+    int passed = 0, failed = 0;
+    std::cout << "=== Cluster Tests ===\n\n";
+
+    for (size_t i = 0; i < tests.size(); ++i) {
+        try {
+            tests[i].second();
+            std::cout << "  [PASS] " << tests[i].first << "\n";
+            ++passed;
+        } catch (const std::exception& e) {
+            std::cout << "  [FAIL] " << tests[i].first << ": " << e.what() << "\n";
+            ++failed;
+        } catch (...) {
+            std::cout << "  [FAIL] " << tests[i].first << ": assertion failed\n";
+            ++failed;
+        }
+    }
+
+    std::cout << "\nResults: " << passed << " passed, " << failed << " failed.\n";
+    return failed > 0 ? 1 : 0;
+}
@@ -4,13 +4,20 @@
  */
 
 #include "include/cache/segmented_cache.h"
+#include "include/sync/cache_manager.h"
 #include "include/compat/threading.h"
+#include "include/metrics/latency.h"
+#include "include/metrics/exposition.h"
 
 #include <iostream>
 #include <cassert>
+#include <cstdio>
 #include <vector>
 #include <string>
 #include <chrono>
+#include <algorithm>
+#include <map>
+#include <thread>
 
 using Thread  = dcs::compat::Thread;
 using AtomicI = dcs::compat::Atomic<int>;
@@ -85,6 +92,457 @@ TEST(test_concurrent_reads_writes) {
     assert(read_hits.load() > 0);
 }
 
+TEST(test_shared_lock_reads_with_eviction) {
+    // Readers run under shared locks while writers churn past capacity,
+    // forcing CLOCK sweeps; every hit must still return a well-formed value.
+    dcs::cache::SegmentedCache cache(1024, dcs::cache::EvictionPolicy::Clock);
+    for (int i = 0; i < 1024; ++i) {
+        cache.put("key" + std::to_string(i), "val" + std::to_string(i));
+    }
+
+    AtomicI bad(0);
+    AtomicI hits(0);
+    std::vector<Thread> threads;
+    for (int t = 0; t < 4; ++t) {
+        threads.push_back(Thread([&cache, &bad, &hits]() {
+            for (int i = 0; i < 20000; ++i) {
+                std::string k = std::to_string(i % 2048);
+                auto r = cache.get("key" + k);
+                if (!r.hit) continue;
+                hits++;
+                if (r.value != "val" + k) bad++;
+            }
+        }));
+    }
+    for (int t = 0; t < 2; ++t) {
+        threads.push_back(Thread([&cache, t]() {
+            for (int i = 0; i < 20000; ++i) {
+                std::string k = std::to_string((i * 7 + t) % 4096);
+                cache.put("key" + k, "val" + k);
+            }
+        }));
+    }
+    for (size_t i = 0; i < threads.size(); ++i) threads[i].join();
+
+    std::cout << "    Shared-lock hits: " << hits.load() << "\n";
+    assert(bad.load() == 0);
+    assert(hits.load() > 0);
+    assert(cache.size() <= 1024);
+}
+
+TEST(test_configurable_segment_count) {
+    dcs::cache::SegmentedCache explicit_count(4096, dcs::cache::EvictionPolicy::Clock, 10);
+    assert(explicit_count.segment_count() == 16);  // rounded up to a power of two
+    assert(explicit_count.segment_sizes().size() == 16);
+
+    dcs::cache::SegmentedCache scaled(1 << 20);
+    size_t n = scaled.segment_count();
+    assert(n >= 8 && (n & (n - 1)) == 0);
+    std::cout << "    Default segments: " << n << "\n";
+
+    // Every key lands in a valid segment and the mapping matches segment_sizes()
+    for (int i = 0; i < 2000; ++i) {
+        std::string key = "seg" + std::to_string(i);
+        assert(explicit_count.segment_index(key) < 16);
+        explicit_count.put(key, "v");
+    }
+    auto sizes = explicit_count.segment_sizes();
+    size_t total = 0, used = 0;
+    for (size_t i = 0; i < sizes.size(); ++i) {
+        total += sizes[i];
+        if (sizes[i] > 0) ++used;
+    }
+    assert(total == explicit_count.size());
+    assert(used == 16);
+
+    // Small caches keep usable per-segment depth
+    assert(dcs::cache::SegmentedCache::default_segment_count(256) <= 4);
+}
+
+TEST(test_memory_budget_shared_across_segments) {
+    const size_t kBudget = 1 << 20;
+    dcs::cache::SegmentedCache cache(65536, dcs::cache::EvictionPolicy::Clock, 8, kBudget);
+    AtomicI dirty_evictions(0);
+    cache.set_eviction_callback([&dirty_evictions](const std::string&, const std::string&, bool dirty, uint64_t) {
+        if (dirty) dirty_evictions++;
+    });
+
+    // One hot segment may use far more than an even 1/8 share
+    std::string value(1000, 'h');
+    int hot = 0;
+    for (int i = 0; hot < 600; ++i) {
+        std::string key = "hot" + std::to_string(i);
+        if (cache.segment_index(key) != 0) continue;
+        cache.put(key, value);
+        ++hot;
+    }
+    assert(cache.segment_sizes()[0] == 600);
+    assert(cache.used_memory() > kBudget / 8 * 4);
+
+    // Overflowing the budget evicts (dirty entries reach the callback)
+    std::vector<Thread> threads;
+    for (int t = 0; t < 4; ++t) {
+        threads.push_back(Thread([&cache, t]() {
+            std::string v(700 + t * 300, 'x');
+            for (int i = 0; i < 2000; ++i) {
+                cache.put("t" + std::to_string(t) + "_" + std::to_string(i), v);
+            }
+        }));
+    }
+    for (size_t i = 0; i < threads.size(); ++i) threads[i].join();
+
+    std::cout << "    used " << cache.used_memory() << " / " << kBudget
+              << " bytes, " << cache.size() << " entries, "
+              << cache.budget_evictions() << " evictions\n";
+    assert(cache.used_memory() <= kBudget + 4 * 4096);  // one in-flight entry per writer
+    assert(cache.budget_evictions() > 0);
+    assert(dirty_evictions.load() == static_cast<int>(cache.budget_evictions()));
+}
+
+TEST(test_active_expiry_across_segments) {
+    using dcs::cache::steady_now_ms;
+    dcs::cache::SegmentedCache cache(8192, dcs::cache::EvictionPolicy::Clock, 8);
+    uint64_t soon = steady_now_ms() + 20;
+    for (int i = 0; i < 2000; ++i) {
+        cache.put("ttl" + std::to_string(i), "v", soon);
+        cache.put("keep" + std::to_string(i), "v");
+    }
+    assert(cache.volatile_count() == 2000);
+    std::this_thread::sleep_for(std::chrono::milliseconds(40));
+
+    // Readers racing the expiry pass only ever see a miss
+    Thread reader([&cache]() {
+        for (int i = 0; i < 2000; ++i) assert(!cache.get("ttl" + std::to_string(i)).hit);
+    });
+    size_t passes = 0;
+    while (cache.expired_count() < 2000) {
+        cache.expire_cycle(64);
+        ++passes;
+    }
+    reader.join();
+    std::cout << "    2000 keys expired in " << passes << " bounded passes\n";
+    assert(passes > 1);
+    assert(cache.size() == 2000 && cache.volatile_count() == 0);
+}
+
+namespace {
+class MapBackend : public dcs::persistence::StorageBackend {
+public:
+    dcs::persistence::LoadResult load(const std::string& key) override {
+        dcs::compat::LockGuard<dcs::compat::Mutex> lock(mu_);
+        auto it = data_.find(key);
+        if (it == data_.end()) return dcs::persistence::LoadResult::Miss();
+        return dcs::persistence::LoadResult::Hit(it->second);
+    }
+    bool store(const std::string& key, const std::string& value) override {
+        dcs::compat::LockGuard<dcs::compat::Mutex> lock(mu_);
+        if (fail) return false;
+        data_[key] = value;
+        ++stores;
+        return true;
+    }
+    bool remove(const std::string& key) override {
+        dcs::compat::LockGuard<dcs::compat::Mutex> lock(mu_);
+        return data_.erase(key) > 0;
+    }
+    bool ping() override { return true; }
+    bool has(const std::string& key) { return load(key).found; }
+    bool fail = false;
+    size_t stores = 0;
+private:
+    dcs::compat::Mutex mu_;
+    std::map<std::string, std::string> data_;
+};
+}  // namespace
+
+TEST(test_expiry_removes_backend_copy) {
+    using dcs::cache::steady_now_ms;
+    MapBackend backend;
+    dcs::sync::CacheManager::Config cfg;
+    cfg.write_mode = dcs::sync::WriteMode::WriteBack;
+    cfg.flush_interval = std::chrono::seconds(3600);
+    cfg.expiry_interval = std::chrono::milliseconds(10);
+    dcs::sync::CacheManager manager(cfg, &backend);
+
+    manager.put("flushed", "v1", steady_now_ms() + 30);
+    manager.flush();
+    assert(backend.has("flushed"));
+    manager.put("unflushed", "v2", steady_now_ms() + 30);
+    manager.put("stays", "v3");
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));   // worker expires both
+    assert(manager.expired_count() == 2);
+    assert(!backend.has("flushed"));             // a read-through can't resurrect it
+    assert(!manager.get("flushed").hit);
+    manager.flush();                             // expired dirty value is not written back
+    assert(!backend.has("unflushed"));
+    assert(backend.has("stays"));
+    assert(manager.ttl_ms("stays") == -1 && manager.ttl_ms("flushed") == -2);
+
+    // EXPIRE on a key that only the backend holds loads it first
+    backend.store("cold", "v4");
+    assert(manager.expire("cold", steady_now_ms() + 60000));
+    assert(manager.ttl_ms("cold") > 59000);
+}
+
+TEST(test_ttl_survives_eviction_and_reload) {
+    using dcs::cache::steady_now_ms;
+    MapBackend backend;
+    dcs::sync::CacheManager::Config cfg;
+    cfg.write_mode = dcs::sync::WriteMode::WriteBack;
+    cfg.flush_interval = std::chrono::seconds(3600);
+    cfg.cache_capacity = 8;
+    cfg.segments = 1;
+    cfg.expiry_interval = std::chrono::milliseconds(10);
+    {
+        dcs::sync::CacheManager manager(cfg, &backend);
+        manager.put("vol", "v", steady_now_ms() + 60000);
+        manager.put("brief", "b", steady_now_ms() + 50);
+        for (int i = 0; i < 16; ++i) manager.put("k" + std::to_string(i), "x");   // evicts both, dirty
+        assert(!manager.exists("vol") && backend.has("vol") && backend.has("brief"));
+        assert(backend.load("vol").value != "v");          // stored with its deadline
+
+        assert(manager.ttl_ms("vol") > 59000);
+        auto r = manager.get("vol");                       // read-through restores the TTL
+        assert(r.hit && r.value == "v");
+        assert(manager.ttl_ms("vol") > 59000);
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(80));
+        assert(!manager.get("brief").hit);                 // expired while only the backend had it
+        assert(!backend.has("brief"));
+
+        // EXPIRE / PERSIST on a flushed, evicted key reach the backend too
+        manager.put("later", "l");
+        manager.flush();
+        for (int i = 0; i < 16; ++i) manager.put("e" + std::to_string(i), "x");
+        assert(manager.expire("later", steady_now_ms() + 30000));
+        for (int i = 0; i < 16; ++i) manager.put("f" + std::to_string(i), "x");
+        assert(!manager.exists("later") && manager.ttl_ms("later") > 29000);
+        assert(manager.persist("later"));
+        for (int i = 0; i < 16; ++i) manager.put("g" + std::to_string(i), "x");
+        assert(!manager.exists("later") && manager.ttl_ms("later") == -1);
+    }
+
+    // A restart (shutdown flushes) keeps the deadline; write-through stores it directly
+    cfg.write_mode = dcs::sync::WriteMode::WriteThrough;
+    dcs::sync::CacheManager restarted(cfg, &backend);
+    assert(restarted.ttl_ms("vol") > 59000 && restarted.get("vol").value == "v");
+    restarted.put("wt", "w", steady_now_ms() + 40000);
+    for (int i = 0; i < 16; ++i) restarted.put("h" + std::to_string(i), "x");
+    assert(!restarted.exists("wt") && restarted.ttl_ms("wt") > 39000);
+    std::string value;
+    int64_t ttl;
+    assert(restarted.take("wt", value, ttl) && value == "w" && ttl > 39000);
+}
+
+TEST(test_write_back_drains_dirty_queue_incrementally) {
+    MapBackend backend;
+    dcs::sync::CacheManager::Config cfg;
+    cfg.write_mode = dcs::sync::WriteMode::WriteBack;
+    cfg.flush_interval = std::chrono::seconds(3600);
+    cfg.segments = 8;
+    dcs::sync::CacheManager manager(cfg, &backend);
+
+    for (int round = 0; round < 5; ++round) {          // repeat writes coalesce
+        for (int i = 0; i < 12000; ++i) {
+            manager.put("k" + std::to_string(i), "v" + std::to_string(round));
+        }
+    }
+    assert(manager.dirty_count() == 12000);
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    assert(manager.flush_lag_ms() >= 20);
+
+    // Writers keep going while the pass drains in batches
+    Thread writer([&manager]() {
+        for (int i = 0; i < 3000; ++i) manager.put("w" + std::to_string(i), "x");
+    });
+    manager.flush();
+    writer.join();
+    assert(backend.stores >= 12000 && backend.stores <= 15000);
+    assert(manager.flushed_entries() == backend.stores);
+    assert(backend.load("k11999").value == "v4");
+    manager.flush();
+    assert(manager.dirty_count() == 0 && manager.flush_lag_ms() == 0);
+    assert(backend.has("w2999"));
+
+    // A failed batch goes back on the queue
+    backend.fail = true;
+    manager.put("k1", "new");
+    manager.flush();
+    assert(manager.dirty_count() == 1);
+    backend.fail = false;
+    manager.flush();
+    assert(manager.dirty_count() == 0 && backend.load("k1").value == "new");
+}
+
+namespace {
+/** MapBackend whose batch_store runs a hook first and can be made to fail. */
+class GatedBackend : public MapBackend {
+public:
+    bool batch_store(const std::vector<std::pair<std::string, std::string>>& entries) override {
+        if (on_batch) on_batch();
+        if (fail_batch) return false;
+        return MapBackend::batch_store(entries);
+    }
+    std::function<void()> on_batch;
+    bool fail_batch = false;
+};
+}  // namespace
+
+TEST(test_write_back_store_now_supersedes_open_batch) {
+    MapBackend backend;
+    std::vector<std::string> settled;
+    dcs::persistence::WriteBackWorker* self = nullptr;
+    dcs::persistence::WriteBackWorker worker(
+        &backend, std::chrono::seconds(3600),
+        [&](size_t, dcs::persistence::WriteBackWorker::Entries& out) {
+            out.emplace_back("a", "old");
+            out.emplace_back("b", "old");
+            self->store_now("a", "new");   // evicted after its drain, before the batch is written
+            return size_t(2);
+        },
+        [] { return size_t(2); },
+        [&](const std::string& key, bool ok) { if (ok) settled.push_back(key); });
+    self = &worker;
+    worker.flush();
+    assert(backend.load("a").value == "new" && backend.load("b").value == "old");
+    assert(settled.size() == 1 && settled[0] == "b");
+}
+
+TEST(test_eviction_during_in_flight_batch_keeps_newest_value) {
+    GatedBackend backend;
+    dcs::sync::CacheManager::Config cfg;
+    cfg.write_mode = dcs::sync::WriteMode::WriteBack;
+    cfg.flush_interval = std::chrono::seconds(3600);
+    cfg.cache_capacity = 8;
+    cfg.segments = 1;
+    cfg.hot_key_replicas = 0;
+    dcs::sync::CacheManager manager(cfg, &backend);
+
+    // Rewritten and evicted while the batch holding its old value is being stored
+    manager.put("k", "v1");
+    Thread evictor;
+    backend.on_batch = [&] {
+        if (evictor.joinable()) return;
+        evictor = Thread([&manager] {
+            manager.put("k", "v2");
+            for (int i = 0; i < 16; ++i) manager.put("fill" + std::to_string(i), "x");
+        });
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));   // evictor waits for the batch
+    };
+    manager.flush();
+    evictor.join();
+    backend.on_batch = nullptr;
+    assert(!manager.exists("k"));
+    assert(backend.load("k").value == "v2" && manager.get("k").value == "v2");
+
+    // Evicted while its batch fails: the eviction persisted it
+    manager.flush();
+    manager.put("f", "keep");
+    backend.fail_batch = true;
+    backend.on_batch = [&] {
+        if (evictor.joinable()) return;
+        evictor = Thread([&manager] {
+            for (int i = 0; i < 16; ++i) manager.put("g" + std::to_string(i), "x");
+        });
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    };
+    manager.flush();
+    evictor.join();
+    backend.on_batch = nullptr;
+    backend.fail_batch = false;
+    assert(!manager.exists("f") && backend.load("f").value == "keep");
+    assert(manager.get("f").value == "keep");
+}
+
+TEST(test_take_during_in_flight_batch_leaves_backend_empty) {
+    GatedBackend backend;
+    dcs::sync::CacheManager::Config cfg;
+    cfg.write_mode = dcs::sync::WriteMode::WriteBack;
+    cfg.flush_interval = std::chrono::seconds(3600);
+    cfg.hot_key_replicas = 0;
+    dcs::sync::CacheManager manager(cfg, &backend);
+
+    // Taken (as by a slot migration) while its drained batch is being stored
+    manager.put("k", "v1");
+    Thread taker;
+    bool found = false;
+    std::string value;
+    backend.on_batch = [&] {
+        if (taker.joinable()) return;
+        taker = Thread([&] {
+            int64_t ttl;
+            found = manager.take("k", value, ttl);
+        });
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));   // taker waits for the batch
+    };
+    manager.flush();
+    taker.join();
+    backend.on_batch = nullptr;
+    assert(found && value == "v1");
+    assert(!backend.load("k").found && !manager.get("k").hit);
+}
+
+TEST(test_hot_keys_saved_and_prewarmed) {
+    MapBackend backend;
+    dcs::sync::CacheManager::Config cfg;
+    cfg.write_mode = dcs::sync::WriteMode::WriteThrough;
+    cfg.segments = 4;
+    const std::string path = "test_hot_keys.dat";
+    {
+        dcs::sync::CacheManager manager(cfg, &backend);
+        for (int i = 0; i < 100; ++i) manager.put("k" + std::to_string(i), "v" + std::to_string(i));
+        for (int round = 0; round < 3; ++round) {
+            for (int i = 0; i < 10; ++i) manager.get("k" + std::to_string(i));
+        }
+        assert(manager.save_hot_keys(path, 40));   // 10 per segment: all hot keys fit
+    }
+    backend.remove("k5");                       // gone since the list was written
+    dcs::sync::CacheManager manager(cfg, &backend);
+    assert(manager.size() == 0);
+    size_t warmed = manager.prewarm(path, 7);   // several batches
+    assert(warmed >= 9 && warmed <= 39);
+    assert(manager.size() == warmed);
+    for (int i = 0; i < 10; ++i) {
+        assert(manager.exists("k" + std::to_string(i)) == (i != 5));
+    }
+    assert(manager.prewarm("missing_hot_keys.dat") == 0);
+    std::remove(path.c_str());
+}
+
+TEST(test_batch_ops_group_by_segment) {
+    dcs::cache::SegmentedCache cache(8192, dcs::cache::EvictionPolicy::Clock, 8);
+    std::vector<std::string> keys;
+    for (int i = 0; i < 200; ++i) keys.push_back("k" + std::to_string(i));
+
+    std::vector<std::pair<std::string_view, std::string_view>> entries;
+    for (const auto& k : keys) entries.emplace_back(k, k);
+    cache.put_many(entries);
+    assert(cache.size() == 200);
+
+    // Batches race single-key writers on the same segments
+    Thread writer([&cache]() {
+        for (int i = 0; i < 5000; ++i) cache.put("w" + std::to_string(i % 300), "v");
+    });
+    for (int round = 0; round < 50; ++round) {
+        std::vector<std::string_view> batch;
+        for (int i = 199; i >= 0; i -= 3) batch.push_back(keys[i]);
+        batch.push_back("absent");
+        batch.push_back(keys[199]);
+        auto r = cache.get_many(batch);
+        assert(r.size() == batch.size());
+        for (size_t i = 0; i + 2 < batch.size(); ++i) assert(r[i].hit && r[i].value == batch[i]);
+        assert(!r[batch.size() - 2].hit && r.back().value == keys[199]);
+        assert(cache.exists_many(batch) == batch.size() - 1);
+    }
+    writer.join();
+
+    std::vector<std::string_view> doomed(keys.begin(), keys.begin() + 100);
+    doomed.push_back("absent");
+    assert(cache.del_many(doomed) == 100);
+    assert(cache.exists_many(std::vector<std::string_view>(keys.begin(), keys.end())) == 100);
+}
+
 TEST(test_concurrent_deletes) {
     dcs::cache::SegmentedCache cache(4096);
 
@@ -138,6 +596,281 @@ TEST(test_segment_isolation) {
     reader.join();
 }
 
+TEST(test_latency_histogram_percentiles) {
+    dcs::metrics::LatencyHistogram h;
+    for (uint64_t v = 1; v <= 100000; ++v) h.record_ns(v * 10);   // uniform 10 ns .. 1 ms
+    auto snap = h.snapshot();
+    assert(snap.count == 100000);
+    assert(snap.max_ns == 1000000);
+    const double qs[] = {0.50, 0.99, 0.999};
+    for (double q : qs) {
+        double want = q * 1e6;
+        double got = snap.percentile_ns(q);
+        assert(got > want * 0.97 && got < want * 1.03);
+    }
+    assert(snap.mean_ns() > 500000 && snap.mean_ns() < 500010);
+
+    // Small values are exact; since() subtracts an earlier view
+    dcs::metrics::LatencyHistogram small;
+    for (int i = 0; i < 10; ++i) small.record_ns(7);
+    auto before = small.snapshot();
+    for (int i = 0; i < 5; ++i) small.record_ns(31);
+    auto delta = small.snapshot().since(before);
+    assert(delta.count == 5 && delta.sum_ns == 155);
+    assert(delta.percentile_ns(0.5) == 31.0);
+}
+
+TEST(test_latency_histogram_concurrent_record) {
+    dcs::metrics::LatencyHistogram h;
+    const int N_THREADS = 8;
+    const int N_OPS = 20000;
+    // Threads come and go: slots are reused, none of the samples are lost
+    for (int round = 0; round < 3; ++round) {
+        std::vector<Thread> threads;
+        for (int t = 0; t < N_THREADS; ++t) {
+            threads.push_back(Thread([&h, t, N_OPS]() {
+                for (int i = 0; i < N_OPS; ++i) h.record_ns(static_cast<uint64_t>(100 * (t + 1)));
+            }));
+        }
+        for (size_t i = 0; i < threads.size(); ++i) threads[i].join();
+    }
+    auto snap = h.snapshot();
+    assert(snap.count == 3ull * N_THREADS * N_OPS);
+    assert(snap.sum_ns == 3ull * N_OPS * 100 * (N_THREADS * (N_THREADS + 1) / 2));
+    assert(snap.max_ns == 100ull * N_THREADS);
+}
+
+TEST(test_cache_manager_get_latency) {
+    dcs::sync::CacheManager::Config cfg;
+    cfg.cache_capacity = 1024;
+    dcs::sync::CacheManager mgr(cfg, nullptr);
+    mgr.put("present", "v");
+    for (int i = 0; i < 10; ++i) mgr.get("present");
+    for (int i = 0; i < 4; ++i) mgr.get("absent");
+
+    dcs::metrics::LatencyReport report;
+    mgr.collect_latency(report);
+    assert(report.size() == 5);
+    assert(report[0].first == "cache_get_hit" && report[0].second.count == 10);
+    assert(report[1].first == "cache_get_miss" && report[1].second.count == 4);
+    assert(report[2].first == "cache_get_replica" && report[2].second.count == 0);
+    assert(report[3].first == "value_compress" && report[3].second.count == 0);   // compression off
+    assert(report[4].first == "value_decompress" && report[4].second.count == 0);
+    assert(mgr.segment_latency(mgr.segment_index("present")).count >= 10);
+    uint64_t total = 0;
+    for (size_t i = 0; i < mgr.segment_count(); ++i) total += mgr.segment_latency(i).count;
+    assert(total == 14);
+}
+
+TEST(test_cache_manager_compresses_values_once) {
+    MapBackend backend;
+    dcs::sync::CacheManager::Config cfg;
+    cfg.write_mode = dcs::sync::WriteMode::WriteThrough;
+    cfg.value_compression_min = 64;
+    cfg.hot_key_sample_shift = 0;
+    cfg.hot_key_interval = std::chrono::milliseconds(0);
+    std::string big;
+    for (int i = 0; i < 100; i++) big += "compress me ";
+    {
+        dcs::sync::CacheManager mgr(cfg, &backend);
+        assert(mgr.put("big", big) && mgr.put("small", "tiny"));
+        size_t payload = mgr.payload_bytes();
+        assert(payload < big.size());                    // the cache holds the packed form
+
+        // The backend receives exactly what the cache holds
+        auto stored = backend.load("big");
+        assert(stored.found && dcs::compression::ValueCodec::HasMagic(stored.value));
+        assert(stored.value.size() < big.size() / 4);
+        assert(backend.load("small").value == "tiny");
+
+        assert(mgr.get("big").value == big);
+        auto many = mgr.get_many({"big", "small", "none"});
+        assert(many[0].value == big && many[1].value == "tiny" && !many[2].hit);
+
+        // The replica serves the unpacked copy
+        for (int i = 0; i < 20; ++i) mgr.get("big");
+        assert(mgr.refresh_hot_keys() == 1);
+        uint64_t before = mgr.value_codec().GetStats().decompressed.load();
+        assert(mgr.get("big").value == big);
+        assert(mgr.value_codec().GetStats().decompressed.load() == before);
+
+        assert(mgr.value_codec().GetStats().compressed.load() == 1);
+        assert(mgr.value_codec().Ratio() < 0.25);
+    }
+    {
+        // A cold cache reads the packed value through from the backend
+        dcs::sync::CacheManager mgr(cfg, &backend);
+        assert(mgr.get("big").value == big);
+        std::string v;
+        int64_t ttl = 0;
+        assert(mgr.take("big", v, ttl) && v == big && ttl == -1);
+        assert(mgr.import_entry("big", v, -1) && mgr.get("big").value == big);
+        assert(dcs::compression::ValueCodec::HasMagic(backend.load("big").value));
+    }
+}
+
+TEST(test_hot_keys_detected_and_replicated) {
+    dcs::sync::CacheManager::Config cfg;
+    cfg.cache_capacity = 1024;
+    cfg.hot_key_sample_shift = 0;                        // sample every GET
+    cfg.hot_key_interval = std::chrono::milliseconds(0); // refresh by hand
+    dcs::sync::CacheManager mgr(cfg, nullptr);
+    for (int i = 0; i < 50; ++i) mgr.put("k" + std::to_string(i), "v");
+    mgr.put("hot", "v1");
+    for (int round = 0; round < 40; ++round) {
+        for (int i = 0; i < 50; ++i) mgr.get("k" + std::to_string(i));   // 2% share each
+        for (int j = 0; j < 50; ++j) mgr.get("hot");                     // 50% share
+    }
+
+    auto top = mgr.hottest_keys(3);
+    assert(!top.empty() && top[0].key == "hot");
+    assert(top[0].segment == mgr.segment_index("hot"));
+    assert(top[0].share > 0.3 && top[0].hits >= 1000);
+
+    mgr.refresh_hot_keys();
+    auto replicated = mgr.replicated_keys();
+    assert(std::find(replicated.begin(), replicated.end(), "hot") != replicated.end());
+    auto r = mgr.get("hot");
+    assert(r.hit && r.value == "v1");
+
+    // Writes invalidate the copy before they return
+    mgr.put("hot", "v2");
+    assert(mgr.get("hot").value == "v2");
+    replicated = mgr.replicated_keys();
+    assert(std::find(replicated.begin(), replicated.end(), "hot") == replicated.end());
+    mgr.refresh_hot_keys();
+    assert(mgr.get("hot").value == "v2");
+    mgr.del("hot");
+    assert(!mgr.get("hot").hit);
+
+    // The copy honours the TTL it was read with
+    mgr.put("hot", "v3", dcs::cache::steady_now_ms() + 60);
+    for (int j = 0; j < 500; ++j) mgr.get("hot");
+    mgr.refresh_hot_keys();
+    replicated = mgr.replicated_keys();
+    assert(std::find(replicated.begin(), replicated.end(), "hot") != replicated.end());
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    assert(!mgr.get("hot").hit);
+
+    dcs::metrics::LatencyReport report;
+    mgr.collect_latency(report);
+    assert(report[2].first == "cache_get_replica" && report[2].second.count > 0);
+}
+
+TEST(test_hot_replica_never_serves_stale_values) {
+    dcs::sync::CacheManager::Config cfg;
+    cfg.cache_capacity = 1024;
+    cfg.hot_key_sample_shift = 0;
+    cfg.hot_key_interval = std::chrono::milliseconds(0);
+    dcs::sync::CacheManager mgr(cfg, nullptr);
+    mgr.put("hot", "0");
+    for (int j = 0; j < 100; ++j) mgr.get("hot");
+
+    dcs::compat::Atomic<int> written{0};
+    dcs::compat::Atomic<bool> stop{false};
+    AtomicI stale{0};
+    Thread writer([&] {
+        for (int i = 1; i <= 3000; ++i) {
+            mgr.put("hot", std::to_string(i));
+            written.store(i);
+        }
+        stop.store(true);
+    });
+    Thread refresher([&] {
+        while (!stop.load()) mgr.refresh_hot_keys();
+    });
+    std::vector<Thread> readers;
+    for (int t = 0; t < 3; ++t) {
+        readers.emplace_back([&] {
+            while (!stop.load()) {
+                int floor = written.load();
+                auto r = mgr.get("hot");
+                if (!r.hit || std::stoi(r.value) < floor) stale++;
+            }
+        });
+    }
+    writer.join();
+    refresher.join();
+    for (auto& t : readers) t.join();
+    assert(stale.load() == 0);
+    assert(mgr.get("hot").value == "3000");
+}
+
+TEST(test_tracking_table_invalidates_readers_once) {
+    dcs::sync::TrackingTable table;
+    std::vector<std::string> got_a, got_b;
+    int flushes = 0;
+    table.subscribe(1, [&](const std::vector<std::string>& keys) {
+        if (keys.empty()) flushes++;
+        for (const auto& k : keys) got_a.push_back(k);
+    }, false);
+    table.subscribe(2, [&](const std::vector<std::string>& keys) {
+        for (const auto& k : keys) got_b.push_back(k);
+    }, true, {"user:"});
+
+    table.track(1, "a");
+    table.invalidate("a");
+    table.invalidate("a");                 // interest was dropped by the first one
+    table.invalidate("never-read");
+    assert(got_a == std::vector<std::string>{"a"});
+
+    table.invalidate("user:7");
+    table.invalidate("order:7");
+    assert(got_b == std::vector<std::string>{"user:7"});
+
+    table.invalidate_all();
+    assert(flushes == 1);
+
+    table.unsubscribe(1);
+    table.track(1, "b");
+    table.invalidate("b");
+    assert(got_a.size() == 1);
+    assert(table.clients() == 1);
+}
+
+TEST(test_metrics_publisher_serves_sampled_page) {
+    dcs::metrics::LatencyHistogram h;
+    h.record_ns(2000);
+    AtomicI samples(0);
+    dcs::metrics::MetricsPublisher pub(std::chrono::milliseconds(20), [&]() {
+        int n = ++samples;
+        dcs::metrics::PrometheusWriter w;
+        w.counter("dcs_test_total", "Samples taken", n);
+        w.family("dcs_test_keys", "gauge", "Keys \"per\" segment");
+        w.sample("dcs_test_keys", 1.5, {{"segment", "a\"b"}});
+        dcs::metrics::LatencyReport report;
+        report.emplace_back("cmd_get", h.snapshot());
+        report.emplace_back("cmd_set", dcs::metrics::LatencySnapshot());
+        w.latency_summary("dcs_latency_seconds", "Latency", report);
+        dcs::metrics::MetricsPage page;
+        page.json = "{\"n\": " + std::to_string(n) + "}";
+        page.prometheus = w.take();
+        return page;
+    });
+    assert(pub.current()->prometheus.empty());
+
+    pub.start();
+    auto page = pub.current();
+    assert(samples.load() == 1 && page->json == "{\"n\": 1}");
+    const std::string& text = page->prometheus;
+    assert(text.find("# TYPE dcs_test_total counter\ndcs_test_total 1\n") != std::string::npos);
+    assert(text.find("dcs_test_keys{segment=\"a\\\"b\"} 1.5\n") != std::string::npos);
+    assert(text.find("dcs_latency_seconds{op=\"cmd_get\",quantile=\"0.99\"} 2") != std::string::npos);
+    assert(text.find("dcs_latency_seconds_count{op=\"cmd_get\"} 1\n") != std::string::npos);
+    assert(text.find("dcs_latency_seconds{op=\"cmd_set\",quantile=\"0.5\"} NaN\n") != std::string::npos);
+
+    // Reads never sample; the thread republishes on its own
+    for (int i = 0; i < 1000; ++i) pub.current();
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (pub.pages_published() < 3 && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    pub.stop();
+    assert(pub.pages_published() >= 3);
+    assert(static_cast<uint64_t>(samples.load()) == pub.pages_published());
+    assert(page->json == "{\"n\": 1}");   // an old page stays valid while held
+}
+
 TEST(test_stress_mixed_operations) {
     dcs::cache::SegmentedCache cache(2048);
     const int N_THREADS = 16;
@@ -7,8 +7,12 @@
 
 #include <iostream>
 #include <cassert>
+#include <cstdint>
 #include <string>
 #include <vector>
+#include <set>
+#include <thread>
+#include <chrono>
 
 #define TEST(name) \
     static void name(); \
@@ -91,6 +95,214 @@ TEST(test_get_promotes_to_mru) {
     assert(r.hit);  // "a" is still here
 }
 
+TEST(test_clock_second_chance) {
+    using dcs::cache::EvictionPolicy;
+    dcs::cache::LRUCache cache(3, EvictionPolicy::Clock);
+    cache.put("a", "1");
+    cache.put("b", "2");
+    cache.put("c", "3");
+
+    // Hit "a" — only sets its reference bit, no relink
+    assert(cache.get_shared("a").hit);
+
+    // "a" gets a second chance; "b" is the first unreferenced victim
+    cache.put("d", "4");
+    assert(cache.exists("a"));
+    assert(!cache.exists("b"));
+
+    // Without further hits the hand now takes "c", then "a"
+    cache.put("e", "5");
+    assert(!cache.exists("c"));
+    cache.put("f", "6");
+    assert(!cache.exists("a"));
+    assert(cache.size() == 3);
+}
+
+TEST(test_clock_hit_rate_close_to_lru) {
+    using dcs::cache::EvictionPolicy;
+    dcs::cache::LRUCache lru(200, EvictionPolicy::LRU);
+    dcs::cache::LRUCache clock(200, EvictionPolicy::Clock);
+
+    // Skewed workload: 80% of requests go to 100 hot keys out of 2000
+    int lru_hits = 0, clock_hits = 0;
+    uint32_t x = 12345;
+    for (int i = 0; i < 50000; ++i) {
+        x = x * 1103515245u + 12345u;
+        uint32_t r = (x >> 8) % 100;
+        x = x * 1103515245u + 12345u;
+        std::string key = "k" + std::to_string(r < 80 ? (x >> 8) % 100 : 100 + (x >> 8) % 1900);
+        if (lru.get(key).hit) ++lru_hits; else lru.put(key, "v");
+        if (clock.get_shared(key).hit) ++clock_hits; else clock.put(key, "v");
+    }
+    std::cout << "    LRU hits: " << lru_hits << ", CLOCK hits: " << clock_hits << "\n";
+    assert(clock_hits * 100 >= lru_hits * 95);
+}
+
+TEST(test_tinylfu_scan_resistance) {
+    using dcs::cache::EvictionPolicy;
+    dcs::cache::LRUCache lru(1000, EvictionPolicy::LRU);
+    dcs::cache::LRUCache tlfu(1000, EvictionPolicy::TinyLFU);
+
+    // 500 hot keys read-through, interleaved with a one-pass scan of cold keys
+    int lru_hits = 0, tlfu_hits = 0, hot_reads = 0;
+    uint32_t x = 777;
+    int cold = 0;
+    for (int i = 0; i < 100000; ++i) {
+        std::string key;
+        bool hot = (i % 3 == 0);
+        if (hot) {
+            x = x * 1103515245u + 12345u;
+            key = "hot" + std::to_string((x >> 8) % 500);
+        } else {
+            key = "cold" + std::to_string(cold++);
+        }
+        bool lh = lru.get(key).hit;
+        bool th = tlfu.get(key).hit;
+        if (!lh) lru.put(key, "v");
+        if (!th) tlfu.put(key, "v");
+        if (hot && i > 50000) {
+            ++hot_reads;
+            lru_hits += lh;
+            tlfu_hits += th;
+        }
+    }
+    std::cout << "    hot-key hit rate  LRU: " << (100.0 * lru_hits / hot_reads)
+              << "%  TinyLFU: " << (100.0 * tlfu_hits / hot_reads) << "%  ("
+              << tlfu.admission_rejections() << " rejected)\n";
+    assert(tlfu.size() <= 1000);
+    assert(tlfu_hits > hot_reads * 9 / 10);
+    assert(tlfu_hits > lru_hits * 3 / 2);
+    assert(tlfu.admission_rejections() > 0);
+}
+
+TEST(test_tinylfu_regions_and_callback) {
+    using dcs::cache::EvictionPolicy;
+    dcs::cache::LRUCache cache(100, EvictionPolicy::TinyLFU);
+    int evicted = 0;
+    cache.set_eviction_callback([&evicted](const std::string&, const std::string&, bool dirty, uint64_t) {
+        if (dirty) ++evicted;
+    });
+
+    for (int i = 0; i < 100; ++i) cache.put("k" + std::to_string(i), "v");
+    for (int i = 0; i < 50; ++i) cache.get("k" + std::to_string(i));   // into protected
+    assert(cache.size() == 100);
+
+    // Updates and deletes work wherever the entry lives
+    cache.put("k1", std::string(500, 'g'));
+    assert(cache.get("k1").value.size() == 500);
+    assert(cache.del("k99") && cache.del("k2"));
+    assert(cache.size() == 98);
+
+    // Every departure (rejected or evicted) is reported, dirty flag intact
+    for (int i = 0; i < 300; ++i) cache.put("n" + std::to_string(i), "v");
+    assert(cache.size() == 100);
+    assert(evicted == 98 + 300 - 100 + 2);  // two deletes also report
+    assert(cache.exists("k1") && cache.exists("k10"));
+    assert(cache.dirty_entries().size() == 100);
+}
+
+TEST(test_timing_wheel_cascades) {
+    using dcs::cache::TimingWheel;
+    const uint64_t base = 1000003;   // not aligned to any wheel boundary
+    TimingWheel wheel(base);
+
+    // One timer per level, plus one past the ~46 h horizon
+    const uint64_t offsets[] = {0, 40, 630, 700, 45000, 3000000, 172800000};
+    for (uint64_t off : offsets) wheel.schedule("t" + std::to_string(off), base + off, base);
+    assert(wheel.pending() == 7);
+
+    std::set<std::string> fired;
+    auto collect = [&fired](const std::string& key) { fired.insert(key); };
+    const uint64_t checks[] = {0, 39, 40, 640, 699, 700, 44990, 45000, 2999990, 3000000,
+                               172799990, 172800000, 172800010};
+    for (uint64_t at : checks) {
+        wheel.advance(base + at, SIZE_MAX, collect);
+        for (uint64_t off : offsets) {
+            // Deadlines round up to the 10 ms tick
+            bool due = (base + off + 9) / 10 * 10 <= base + at;
+            assert(fired.count("t" + std::to_string(off)) == (due ? 1u : 0u));
+        }
+    }
+    assert(wheel.pending() == 0);
+
+    // Work per advance() is bounded; the backlog drains over several calls
+    for (int i = 0; i < 100; ++i) wheel.schedule("b" + std::to_string(i), base + 172800100, base + 172800000);
+    fired.clear();
+    size_t calls = 0;
+    while (fired.size() < 100) {
+        assert(wheel.advance(base + 172800200, 16, collect) <= 16);
+        ++calls;
+    }
+    assert(calls >= 100 / 16);
+}
+
+TEST(test_ttl_lazy_and_active_expiry) {
+    using dcs::cache::steady_now_ms;
+    dcs::cache::LRUCache cache(100);
+    int expired_dirty = 0, evicted = 0;
+    cache.set_expiry_callback([&expired_dirty](const std::string&, bool dirty) {
+        if (dirty) ++expired_dirty;
+    });
+    cache.set_eviction_callback([&evicted](const std::string&, const std::string&, bool, uint64_t) {
+        ++evicted;
+    });
+
+    uint64_t soon = steady_now_ms() + 30;
+    cache.put("session", "s1", soon);
+    cache.put("active", "a1", soon);
+    cache.put("forever", "f1");
+    cache.put("kept", "k1", soon);
+    cache.put("kept", "k2", dcs::cache::kKeepTTL);   // KEEPTTL: still volatile
+    cache.put("reset", "r1", soon);
+    cache.put("reset", "r2");                         // plain SET clears the TTL
+    cache.put("persisted", "p1", soon);
+    assert(cache.persist("persisted"));
+    assert(!cache.persist("forever"));
+    assert(cache.ttl_ms("forever") == -1);
+    assert(cache.ttl_ms("missing") == -2);
+    assert(cache.ttl_ms("session") > 0 && cache.ttl_ms("session") <= 30);
+    assert(cache.volatile_count() == 3);
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+    // Lazy: expired keys read as absent and are not written back
+    assert(!cache.exists("session"));
+    assert(cache.ttl_ms("kept") == -2);
+    assert(cache.dirty_entries().size() == 3);
+    assert(!cache.get("session").hit);
+    assert(expired_dirty == 1);
+
+    // Active: the wheel finds the rest without anyone touching them
+    assert(cache.expire_due(steady_now_ms(), 1000) == 2);   // "active", "kept"
+    assert(expired_dirty == 3);
+    assert(evicted == 0);
+    assert(cache.size() == 3 && cache.volatile_count() == 0);
+    assert(cache.get("reset").value == "r2" && cache.get("persisted").hit);
+    assert(cache.expired_count() == 3);
+}
+
+TEST(test_expire_absent_reports_without_inserting) {
+    dcs::cache::LRUCache cache(2);
+    std::vector<std::string> expired;
+    int evicted = 0;
+    cache.set_expiry_callback([&expired](const std::string& key, bool) { expired.push_back(key); });
+    cache.set_eviction_callback([&evicted](const std::string&, const std::string&, bool, uint64_t) {
+        ++evicted;
+    });
+    cache.put("a", "1");
+    cache.put("b", "2");
+
+    // A full cache is left as it was: nothing inserted, evicted or dirtied
+    assert(cache.expire_absent("gone"));
+    assert(expired.size() == 1 && expired[0] == "gone");
+    assert(evicted == 0 && cache.size() == 2 && !cache.exists("gone"));
+    assert(cache.dirty_count() == 2 && cache.expired_count() == 1);
+
+    // A live key is not touched
+    assert(!cache.expire_absent("a"));
+    assert(expired.size() == 1 && cache.get("a").value == "1");
+}
+
 TEST(test_delete) {
     dcs::cache::LRUCache cache(5);
     cache.put("x", "100");
@@ -129,12 +341,86 @@ TEST(test_dirty_tracking) {
     assert(dirty[0].first == "b");
 }
 
+TEST(test_dirty_queue_drains_oldest_first_and_coalesces) {
+    dcs::cache::LRUCache cache(10);
+    cache.put("a", "1");
+    cache.put("b", "2");
+    cache.put("c", "3");
+    cache.put("a", "1b");                        // still queued: coalesces in place
+    cache.put("b", std::string(3000, 'x'));      // moves to a bigger block, keeps its place
+    assert(cache.dirty_count() == 3);
+
+    std::vector<dcs::cache::DirtyEntry> out;
+    assert(cache.drain_dirty(2, out) == 2);
+    assert(out.size() == 2);
+    assert(out[0].key == "a" && out[0].value == "1b");
+    assert(out[1].key == "b" && out[1].value.size() == 3000);
+    assert(cache.dirty_count() == 1);
+
+    assert(cache.flushing("a") && cache.flushing("b") && !cache.flushing("c"));
+    cache.put("a", "1c");                        // re-dirtied after its drain: back of the queue
+    cache.del("c");                              // leaves the queue with the entry
+    assert(cache.dirty_count() == 1);
+    cache.settle_flush("a", true);               // stored, but the rewrite stays queued
+    cache.settle_flush("b", false);              // a failed store puts it back
+    cache.settle_flush("c", false);              // gone: no-op
+    assert(cache.dirty_count() == 2 && !cache.flushing("a"));
+    out.clear();
+    assert(cache.drain_dirty(10, out) == 2);
+    assert(out[0].key == "a" && out[0].value == "1c" && out[1].key == "b");
+    cache.settle_flush("a", true);
+    cache.settle_flush("b", true);
+    cache.settle_flush("b", false);              // already settled: no-op
+    assert(cache.dirty_count() == 0 && cache.dirty_entries().empty());
+    uint32_t since;
+    assert(!cache.oldest_dirty_since(since));
+}
+
+TEST(test_in_flight_entry_evicts_as_dirty) {
+    dcs::cache::LRUCache cache(2);
+    std::vector<std::pair<std::string, bool>> evicted;
+    cache.set_eviction_callback([&](const std::string& k, const std::string&, bool dirty, uint64_t) {
+        evicted.emplace_back(k, dirty);
+    });
+    cache.put("a", "1");
+    cache.put("b", "2");
+    std::vector<dcs::cache::DirtyEntry> out;
+    assert(cache.drain_dirty(10, out) == 2 && cache.dirty_count() == 0);
+    cache.settle_flush("b", true);
+
+    cache.put("c", "3");   // evicts "a": drained, batch not stored yet
+    cache.put("d", "4");   // evicts "b": stored
+    assert(evicted.size() == 2);
+    assert(evicted[0].first == "a" && evicted[0].second);
+    assert(evicted[1].first == "b" && !evicted[1].second);
+    cache.settle_flush("a", false);   // gone: nothing to requeue
+    assert(cache.dirty_count() == 2);
+}
+
+TEST(test_redrain_before_settle_links_in_flight_once) {
+    dcs::cache::LRUCache cache(4);
+    std::vector<dcs::cache::DirtyEntry> out;
+    cache.put("a", "1");
+    cache.put("b", "2");
+    assert(cache.drain_dirty(10, out) == 2 && cache.in_flight_count() == 2);
+    cache.put("a", "1b");   // rewritten in flight, then drained before its batch settles
+    assert(cache.drain_dirty(10, out) == 1 && out.back().value == "1b");
+    assert(cache.in_flight_count() == 2 && cache.dirty_count() == 0);
+
+    cache.settle_flush("a", true);
+    cache.settle_flush("b", true);
+    assert(cache.in_flight_count() == 0);
+    cache.put("a", "1c");
+    cache.del("b");
+    assert(cache.dirty_count() == 1 && cache.in_flight_count() == 0);
+}
+
 TEST(test_eviction_callback) {
     std::string evicted_key;
     std::string evicted_val;
 
     dcs::cache::LRUCache cache(2);
-    cache.set_eviction_callback([&](const std::string& k, const std::string& v, bool) {
+    cache.set_eviction_callback([&](const std::string& k, const std::string& v, bool, uint64_t) {
         evicted_key = k;
         evicted_val = v;
     });
@@ -168,6 +454,44 @@ TEST(test_large_values) {
 
 // ══════════════════════════════════════════════════════════════════════
 // Runner
+TEST(test_value_resize_in_place_and_grow) {
+    dcs::cache::LRUCache cache(4);
+    cache.put("k", "small");
+    cache.put("k", "tiny");                      // shrinks in place
+    assert(cache.get("k").value == "tiny");
+
+    std::string big(5000, 'x');
+    cache.put("k", big);                          // outgrows its block
+    auto r = cache.get("k");
+    assert(r.hit && r.value == big);
+    assert(cache.size() == 1);
+    assert(cache.payload_bytes() == 1 + big.size());
+}
+
+TEST(test_slab_memory_accounting) {
+    dcs::cache::LRUCache cache(2000);
+    std::string value(100, 'v');
+    for (int i = 0; i < 1000; ++i) {
+        std::string key = "user:session:" + std::to_string(1000000 + i) + ":profile:abcdefghij";
+        cache.put(key, value);
+    }
+    size_t per_entry = cache.memory_bytes() / cache.size();
+    std::cout << "    bytes/entry (≈40B key, 100B value): " << per_entry << "\n";
+    assert(cache.payload_bytes() > 1000 * 100);
+    assert(per_entry < 300);
+
+    // Freed blocks are recycled rather than reserving new pages
+    size_t reserved = cache.memory_bytes();
+    for (int i = 0; i < 1000; ++i) {
+        cache.del("user:session:" + std::to_string(1000000 + i) + ":profile:abcdefghij");
+    }
+    assert(cache.payload_bytes() == 0);
+    for (int i = 0; i < 1000; ++i) {
+        cache.put("user:session:" + std::to_string(2000000 + i) + ":profile:abcdefghij", value);
+    }
+    assert(cache.memory_bytes() <= reserved);
+}
+
 // ══════════════════════════════════════════════════════════════════════
 
 int main() {
@@ -0,0 +1,602 @@
+/**
+ * Test suite for Raft: log persistence, RPC encoding, replication over
+ * the in-process and TCP transports, snapshot installation, and
+ * linearizable reads.
+ */
+
+#include "include/raft/raft_log.h"
+#include "include/raft/raft_node.h"
+#include "include/raft/tcp_transport.h"
+
+#include <cassert>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef _WIN32
+#include <direct.h>
+#define MKDIR(p) _mkdir(p)
+#else
+#include <sys/stat.h>
+#define MKDIR(p) mkdir(p, 0755)
+#endif
+
+#define TEST(name) \
+    static void name(); \
+    struct name##_reg { name##_reg() { tests.push_back({#name, name}); } } name##_inst; \
+    static void name()
+
+static std::vector<std::pair<std::string, void(*)()>> tests;
+
+using namespace dcs::raft;
+
+static const std::string kDir = "test_raft_data";
+
+static LogEntry entry_of(uint64_t term, uint64_t index) {
+    return {term, index, "SET k" + std::to_string(index) + " v"};
+}
+
+// Applied commands per node, in apply order.
+struct AppliedLog {
+    dcs::compat::Mutex       mu;
+    std::vector<std::string> commands;
+
+    size_t size() {
+        dcs::compat::LockGuard<dcs::compat::Mutex> lock(mu);
+        return commands.size();
+    }
+};
+
+template <class Pred>
+static bool wait_until(Pred pred, int timeout_ms = 10000) {
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms);
+    while (std::chrono::steady_clock::now() < deadline) {
+        if (pred()) return true;
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    return pred();
+}
+
+static int find_leader(const std::vector<std::unique_ptr<RaftNode>>& nodes) {
+    int leader = -1;
+    wait_until([&] {
+        for (size_t i = 0; i < nodes.size(); i++) {
+            if (nodes[i]->IsLeader()) { leader = static_cast<int>(i); return true; }
+        }
+        return false;
+    });
+    return leader;
+}
+
+// Proposes `n` commands (retrying through leader changes) and checks
+// every node applies all of them in the same order.
+static void replicate_and_check(std::vector<std::unique_ptr<RaftNode>>& nodes,
+                                std::vector<std::unique_ptr<AppliedLog>>& applied, int n) {
+    for (int i = 0; i < n; i++) {
+        std::string cmd = "SET k" + std::to_string(i) + " " + std::to_string(i);
+        while (true) {
+            int leader = find_leader(nodes);
+            assert(leader >= 0);
+            if (nodes[leader]->Propose(cmd)) break;
+        }
+    }
+    for (auto& a : applied) {
+        assert(wait_until([&] { return a->size() >= static_cast<size_t>(n); }));
+    }
+    std::vector<std::string> first;
+    for (auto& a : applied) {
+        dcs::compat::LockGuard<dcs::compat::Mutex> lock(a->mu);
+        assert(a->commands.size() == static_cast<size_t>(n));
+        if (first.empty()) first = a->commands;
+        assert(a->commands == first);
+    }
+    assert(first.front() == "SET k0 0" && first.back() == "SET k" + std::to_string(n - 1) + " " +
+                                                          std::to_string(n - 1));
+}
+
+static void make_cluster(const std::string& dir, int size,
+                         std::vector<std::unique_ptr<RaftNode>>& nodes,
+                         std::vector<std::unique_ptr<AppliedLog>>& applied) {
+    MKDIR(dir.c_str());
+    for (int i = 0; i < size; i++) {
+        nodes.push_back(std::make_unique<RaftNode>(i, size, dir + "/node" + std::to_string(i)));
+        applied.push_back(std::make_unique<AppliedLog>());
+        AppliedLog* log = applied.back().get();
+        nodes.back()->SetApplyCallback([log](uint64_t, const std::string& command) {
+            dcs::compat::LockGuard<dcs::compat::Mutex> lock(log->mu);
+            log->commands.push_back(command);
+        });
+    }
+}
+
+// ══════════════════════════════════════════════════════════════════════
+// Raft Log Tests
+// ══════════════════════════════════════════════════════════════════════
+
+TEST(test_raft_log_batch_append_and_reload) {
+    std::string dir = kDir + "/log";
+    {
+        RaftLog log(dir);
+        std::vector<LogEntry> batch;
+        for (uint64_t i = 1; i <= 100; i++) batch.push_back(entry_of(1, i));
+        assert(log.AppendBatch(batch));
+        assert(log.Append(entry_of(2, 101)));
+        assert(log.LastIndex() == 101 && log.LastTerm() == 2);
+        auto range = log.GetRange(95, 3);
+        assert(range.size() == 3 && range[0].index == 95 && range[2].index == 97);
+    }
+    {
+        RaftLog log(dir);
+        assert(log.Size() == 101 && log.TermAt(50) == 1 && log.TermAt(101) == 2);
+        LogEntry e;
+        assert(log.GetEntry(42, e) && e.command == "SET k42 v");
+
+        // Truncation and compaction keep index lookups and the file in step
+        log.TruncateFrom(90);
+        assert(log.LastIndex() == 89);
+        log.CompactTo(9, 1);
+        assert(log.Size() == 80 && !log.GetEntry(9, e) && log.GetEntry(10, e));
+        assert(log.SnapshotIndex() == 9 && log.TermAt(9) == 1 && log.MatchesAt(9, 1));
+        assert(log.Append(entry_of(3, 90)));
+        assert(log.GetRange(1).front().index == 10);
+    }
+    // A torn record from a crash mid-append is dropped on load
+    {
+        std::ofstream f(dir + "/raft_log_00000001.dat", std::ios::binary | std::ios::app);
+        f.write("\x05\x00\x00", 3);
+    }
+    RaftLog log(dir);
+    assert(log.Size() == 81 && log.LastIndex() == 90 && log.LastTerm() == 3);
+    assert(log.SnapshotIndex() == 9);
+    assert(log.Append(entry_of(3, 91)) && log.LastIndex() == 91);
+}
+
+static uint64_t file_size(const std::string& path) {
+    std::ifstream f(path, std::ios::binary | std::ios::ate);
+    return f.is_open() ? static_cast<uint64_t>(f.tellg()) : 0;
+}
+
+TEST(test_raft_log_segments_compact_without_rewrite) {
+    std::string dir = kDir + "/segments";
+    {
+        RaftLog log(dir, true, 256);
+        for (uint64_t i = 1; i <= 100; i++) assert(log.Append(entry_of(1, i)));
+        size_t before = log.SegmentCount();
+        assert(before > 5);
+        uint64_t active = file_size(dir + "/raft_log_" + std::string(8 - std::to_string(before).size(), '0') +
+                                    std::to_string(before) + ".dat");
+
+        // Compaction deletes whole segments below the base and leaves the
+        // rest of the files as they were
+        log.CompactTo(60, 1);
+        assert(log.SegmentCount() < before && log.Size() == 40 && log.SnapshotIndex() == 60);
+        assert(file_size(dir + "/raft_log_00000001.dat") == 0);
+        assert(file_size(dir + "/raft_log_" + std::string(8 - std::to_string(before).size(), '0') +
+                         std::to_string(before) + ".dat") == active);
+    }
+    {
+        RaftLog log(dir, true, 256);
+        LogEntry e;
+        assert(log.Size() == 40 && log.GetRange(1).front().index == 61 && log.LastIndex() == 100);
+        assert(!log.GetEntry(60, e) && log.GetEntry(61, e) && e.command == "SET k61 v");
+
+        // A snapshot past the end of the log replaces it
+        log.CompactTo(150, 4);
+        assert(log.Size() == 0 && log.LastIndex() == 150 && log.LastTerm() == 4);
+        assert(log.Append(entry_of(4, 151)));
+    }
+    RaftLog log(dir, true, 256);
+    assert(log.SnapshotIndex() == 150 && log.Size() == 1 && log.LastIndex() == 151);
+}
+
+TEST(test_raft_rpc_codec_round_trip) {
+    AppendEntriesArgs args{7, 2, 40, 6, {entry_of(6, 41), entry_of(7, 42)}, 39};
+    args.entries[1].command = std::string("bin\0ary", 7);
+    std::string body = rpc_detail::Encode(args);
+    rpc_detail::Reader r{body.data(), body.size()};
+    AppendEntriesArgs out;
+    assert(rpc_detail::Decode(r, out));
+    assert(out.term == 7 && out.leader_id == 2 && out.prev_log_index == 40 &&
+           out.prev_log_term == 6 && out.leader_commit == 39);
+    assert(out.entries.size() == 2 && out.entries[1].index == 42 &&
+           out.entries[1].command == args.entries[1].command);
+
+    // Truncated bodies are rejected rather than read past
+    for (size_t cut = 0; cut < body.size(); cut += 5) {
+        rpc_detail::Reader partial{body.data(), cut};
+        assert(!rpc_detail::Decode(partial, out));
+    }
+
+    AppendEntriesReply reply{9, true, 42};
+    std::string rbody = rpc_detail::Encode(reply);
+    rpc_detail::Reader rr{rbody.data(), rbody.size()};
+    AppendEntriesReply rout{};
+    assert(rpc_detail::Decode(rr, rout) && rout.term == 9 && rout.success && rout.match_index == 42);
+
+    InstallSnapshotArgs snap{5, 1, 900, 4, 65536, std::string("chunk\0data", 10), true};
+    std::string sbody = rpc_detail::Encode(snap);
+    rpc_detail::Reader sr{sbody.data(), sbody.size()};
+    InstallSnapshotArgs sout;
+    assert(rpc_detail::Decode(sr, sout));
+    assert(sout.term == 5 && sout.leader_id == 1 && sout.last_included_index == 900 &&
+           sout.last_included_term == 4 && sout.offset == 65536 && sout.done && sout.data == snap.data);
+    rpc_detail::Reader spartial{sbody.data(), sbody.size() - 1};
+    assert(!rpc_detail::Decode(spartial, sout));
+
+    ReadIndexReply ri{3, true, 77};
+    std::string ribody = rpc_detail::Encode(ri);
+    rpc_detail::Reader rir{ribody.data(), ribody.size()};
+    ReadIndexReply riout{};
+    assert(rpc_detail::Decode(rir, riout) && riout.term == 3 && riout.success && riout.read_index == 77);
+}
+
+// ══════════════════════════════════════════════════════════════════════
+// Replication Tests
+// ══════════════════════════════════════════════════════════════════════
+
+TEST(test_raft_local_cluster_replicates) {
+    std::vector<std::unique_ptr<RaftNode>> nodes;
+    std::vector<std::unique_ptr<AppliedLog>> applied;
+    make_cluster(kDir + "/local", 3, nodes, applied);
+    LocalRaftTransport transport;
+    for (int i = 0; i < 3; i++) {
+        nodes[i]->SetTransport(&transport);
+        transport.RegisterNode(i, nodes[i].get());
+    }
+    for (auto& n : nodes) n->Start();
+    replicate_and_check(nodes, applied, 2000);
+    for (auto& n : nodes) n->Stop();
+}
+
+TEST(test_raft_tcp_cluster_replicates) {
+    const int size = 3;
+    std::vector<std::unique_ptr<RaftNode>> nodes;
+    std::vector<std::unique_ptr<AppliedLog>> applied;
+    make_cluster(kDir + "/tcp", size, nodes, applied);
+
+    std::vector<std::unique_ptr<RaftRpcServer>> servers;
+    for (int i = 0; i < size; i++) {
+        servers.push_back(std::make_unique<RaftRpcServer>(nodes[i].get(), 0));
+        assert(servers.back()->Start() && servers.back()->Port() != 0);
+    }
+    std::vector<std::unique_ptr<TcpRaftTransport>> transports;
+    for (int i = 0; i < size; i++) {
+        std::map<int, TcpRaftTransport::PeerAddress> peers;
+        for (int j = 0; j < size; j++) {
+            if (j != i) peers[j] = {"127.0.0.1", servers[j]->Port()};
+        }
+        transports.push_back(std::make_unique<TcpRaftTransport>(peers));
+        nodes[i]->SetTransport(transports.back().get());
+    }
+    for (auto& n : nodes) n->Start();
+    replicate_and_check(nodes, applied, 5000);
+
+    // A follower that goes away and comes back (same port) catches up
+    int leader = find_leader(nodes);
+    int follower = (leader + 1) % size;
+    uint16_t port = servers[follower]->Port();
+    servers[follower]->Stop();
+    for (int i = 0; i < 200; i++) {
+        while (!nodes[find_leader(nodes)]->Propose("SET late " + std::to_string(i))) {}
+    }
+    servers[follower] = std::make_unique<RaftRpcServer>(nodes[follower].get(), port);
+    assert(servers[follower]->Start());
+    for (auto& a : applied) {
+        assert(wait_until([&] { return a->size() == 5200; }));
+    }
+
+    for (auto& n : nodes) n->Stop();
+    for (auto& s : servers) s->Stop();
+}
+
+TEST(test_raft_tcp_connect_to_blackholed_peer_is_bounded) {
+    // A listener that never accepts, its backlog already full: further
+    // SYNs are dropped, so connect() would block for the kernel timeout
+    socket_t listener = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    assert(bind(listener, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == 0);
+    assert(listen(listener, 0) == 0);
+    socklen_t len = sizeof(addr);
+    assert(getsockname(listener, reinterpret_cast<sockaddr*>(&addr), &len) == 0);
+    uint16_t port = ntohs(addr.sin_port);
+    socket_t filler = rpc_detail::ConnectWithTimeout("127.0.0.1", port, 1000);
+    assert(filler != SOCKET_INVALID);
+
+    TcpRaftTransport transport({{1, {"127.0.0.1", port}}});
+    auto t0 = std::chrono::steady_clock::now();
+    std::thread other;
+    bool threw = false;
+    try {
+        other = std::thread([&] {
+            // Sent while the first call is dialing: fails at once instead
+            // of queueing behind the connect
+            std::this_thread::sleep_for(std::chrono::milliseconds(50));
+            auto s0 = std::chrono::steady_clock::now();
+            bool ok = true;
+            transport.SendAppendEntriesAsync(1, AppendEntriesArgs{}, [&](bool r, const AppendEntriesReply&) { ok = r; });
+            assert(!ok && std::chrono::steady_clock::now() - s0 < std::chrono::milliseconds(100));
+        });
+        transport.SendRequestVote(1, RequestVoteArgs{});
+    } catch (const std::runtime_error&) {
+        threw = true;
+    }
+    other.join();
+    auto elapsed = std::chrono::steady_clock::now() - t0;
+    assert(threw);
+    assert(elapsed < std::chrono::milliseconds(3 * TcpRaftTransport::kCallTimeoutMs));
+
+    CLOSE_SOCKET(filler);
+    CLOSE_SOCKET(listener);
+}
+
+// ══════════════════════════════════════════════════════════════════════
+// Snapshot Tests
+// ══════════════════════════════════════════════════════════════════════
+
+// A SET-only key/value state machine that can snapshot itself.
+struct KvState {
+    dcs::compat::Mutex                 mu;
+    std::map<std::string, std::string> data;
+    int                                restores = 0;
+
+    void Apply(const std::string& command) {
+        std::istringstream in(command);
+        std::string op, key, value;
+        in >> op >> key >> value;
+        dcs::compat::LockGuard<dcs::compat::Mutex> lock(mu);
+        data[key] = value;
+    }
+    bool Save(const std::string& path) {
+        dcs::compat::LockGuard<dcs::compat::Mutex> lock(mu);
+        std::ofstream f(path, std::ios::trunc);
+        for (const auto& kv : data) f << kv.first << ' ' << kv.second << '\n';
+        return static_cast<bool>(f.flush());
+    }
+    bool Restore(const std::string& path) {
+        dcs::compat::LockGuard<dcs::compat::Mutex> lock(mu);
+        std::ifstream f(path);
+        data.clear();
+        std::string key, value;
+        while (f >> key >> value) data[key] = value;
+        restores++;
+        return true;
+    }
+    size_t size() {
+        dcs::compat::LockGuard<dcs::compat::Mutex> lock(mu);
+        return data.size();
+    }
+};
+
+// Per-node view of a LocalRaftTransport that can cut one node off.
+struct PartitionTransport : RaftTransport {
+    LocalRaftTransport*       net;
+    int                       self;
+    dcs::compat::Atomic<int>* cut;
+
+    PartitionTransport(LocalRaftTransport* n, int id, dcs::compat::Atomic<int>* c) : net(n), self(id), cut(c) {}
+
+    void Check(int peer) {
+        if (*cut == self || *cut == peer) throw std::runtime_error("partitioned");
+    }
+    RequestVoteReply SendRequestVote(int peer, const RequestVoteArgs& args) override {
+        Check(peer);
+        return net->SendRequestVote(peer, args);
+    }
+    AppendEntriesReply SendAppendEntries(int peer, const AppendEntriesArgs& args) override {
+        Check(peer);
+        return net->SendAppendEntries(peer, args);
+    }
+    InstallSnapshotReply SendInstallSnapshot(int peer, const InstallSnapshotArgs& args) override {
+        Check(peer);
+        return net->SendInstallSnapshot(peer, args);
+    }
+    ReadIndexReply SendReadIndex(int peer, const ReadIndexArgs& args) override {
+        Check(peer);
+        return net->SendReadIndex(peer, args);
+    }
+};
+
+static RaftNode* make_kv_node(const std::string& dir, int id, int size, const RaftOptions& opts,
+                              KvState* kv, std::vector<std::unique_ptr<RaftNode>>& nodes) {
+    nodes.push_back(std::make_unique<RaftNode>(id, size, dir + "/node" + std::to_string(id), opts));
+    RaftNode* node = nodes.back().get();
+    node->SetApplyCallback([kv](uint64_t, const std::string& command) { kv->Apply(command); });
+    node->SetSnapshotCallbacks([kv](const std::string& path) { return kv->Save(path); },
+                               [kv](const std::string& path) { return kv->Restore(path); });
+    return node;
+}
+
+// Started KvState nodes over one in-process network; `cut` isolates a node.
+struct KvCluster {
+    LocalRaftTransport                               net;
+    dcs::compat::Atomic<int>                         cut{-1};
+    std::vector<std::unique_ptr<KvState>>            kvs;
+    std::vector<std::unique_ptr<RaftNode>>           nodes;
+    std::vector<std::unique_ptr<PartitionTransport>> transports;
+
+    KvCluster(const std::string& dir, int size, const RaftOptions& opts) {
+        MKDIR(dir.c_str());
+        for (int i = 0; i < size; i++) {
+            kvs.push_back(std::make_unique<KvState>());
+            make_kv_node(dir, i, size, opts, kvs.back().get(), nodes);
+            transports.push_back(std::make_unique<PartitionTransport>(&net, i, &cut));
+            nodes[i]->SetTransport(transports.back().get());
+            net.RegisterNode(i, nodes[i].get());
+        }
+        for (auto& n : nodes) n->Start();
+    }
+    ~KvCluster() { Stop(); }
+
+    void Stop() {
+        for (auto& n : nodes) n->Stop();
+    }
+
+    // SET k<i> <i> for i in [from, to), each through whoever leads.
+    void Propose(int from, int to) {
+        for (int i = from; i < to; i++) {
+            std::string cmd = "SET k" + std::to_string(i) + " " + std::to_string(i);
+            while (true) {
+                int leader = find_leader(nodes);
+                assert(leader >= 0);
+                if (nodes[leader]->Propose(cmd)) break;
+            }
+        }
+    }
+
+    bool Has(int node, const std::string& key) {
+        dcs::compat::LockGuard<dcs::compat::Mutex> lock(kvs[node]->mu);
+        return kvs[node]->data.count(key) > 0;
+    }
+};
+
+TEST(test_raft_snapshot_catches_up_lagging_follower) {
+    const int size = 3;
+    std::string dir = kDir + "/snapshot";
+    RaftOptions opts;
+    opts.snapshot_threshold   = 200;
+    opts.snapshot_chunk_bytes = 512;   // a ~15KB snapshot goes out in many chunks
+    KvCluster c(dir, size, opts);
+
+    c.Propose(0, 300);
+    for (auto& kv : c.kvs) assert(wait_until([&] { return kv->size() == 300; }));
+
+    // Cut a follower off while the leader snapshots past everything it has
+    int leader = find_leader(c.nodes);
+    int lagging = (leader + 1) % size;
+    c.cut = lagging;
+    c.Propose(300, 1300);
+    assert(wait_until([&] {
+        for (int i = 0; i < size; i++) {
+            if (i != lagging && c.nodes[i]->GetState().snapshot_index < 1000) return false;
+        }
+        return true;
+    }));
+    assert(c.nodes[find_leader(c.nodes)]->GetState().log_size < 1000);
+
+    // Once reachable again it can only catch up through InstallSnapshot
+    int restores_before = c.kvs[lagging]->restores;
+    c.cut = -1;
+    for (auto& kv : c.kvs) assert(wait_until([&] { return kv->size() == 1300; }));
+    assert(c.kvs[lagging]->restores > restores_before);
+    for (int i = 0; i < size; i++) {
+        dcs::compat::LockGuard<dcs::compat::Mutex> lock(c.kvs[i]->mu);
+        assert(c.kvs[i]->data == c.kvs[0]->data);
+    }
+    c.Stop();
+
+    // A restarted node starts from its snapshot, not from an empty state.
+    // (Each leader's no-op takes an index too, hence the slack.)
+    uint64_t base = c.nodes[lagging]->GetState().snapshot_index;
+    assert(base >= 1000);
+    KvState fresh;
+    std::vector<std::unique_ptr<RaftNode>> restarted;
+    RaftNode* node = make_kv_node(dir, lagging, size, opts, &fresh, restarted);
+    node->Start();
+    assert(fresh.restores == 1 && fresh.size() + 10 >= base);
+    assert(node->GetState().last_applied == base && node->GetState().snapshot_index == base);
+    node->Stop();
+}
+
+// ══════════════════════════════════════════════════════════════════════
+// Read Tests
+// ══════════════════════════════════════════════════════════════════════
+
+TEST(test_raft_read_barrier_on_every_replica) {
+    const int size = 3;
+    KvCluster c(kDir + "/reads", size, RaftOptions());
+
+    // A write the leader has applied is visible on any replica after a
+    // barrier, even one that hasn't heard the new commit index yet
+    for (int i = 0; i < 20; i++) {
+        c.Propose(i, i + 1);
+        std::string key = "k" + std::to_string(i);
+        int leader = find_leader(c.nodes);
+        assert(wait_until([&] { return c.Has(leader, key); }));
+        for (int n = 0; n < size; n++) {
+            assert(c.nodes[n]->ReadBarrier());
+            assert(c.Has(n, key));
+        }
+    }
+
+    // A leader cut off from its followers can't confirm it still leads
+    int old_leader = find_leader(c.nodes);
+    c.cut = old_leader;
+    assert(!c.nodes[old_leader]->ReadBarrier());
+    // ...while the majority side elects a new leader and serves reads
+    int other = (old_leader + 1) % size;
+    assert(wait_until([&] { return c.nodes[other]->ReadBarrier(); }));
+    c.cut = -1;
+}
+
+TEST(test_raft_lease_reads_and_vote_stickiness) {
+    const int size = 3;
+    RaftOptions opts;
+    opts.lease_ms = 100;
+    KvCluster c(kDir + "/lease", size, opts);
+
+    c.Propose(0, 1);
+    int leader = find_leader(c.nodes);
+    assert(wait_until([&] { return c.Has(leader, "k0"); }));
+    assert(c.nodes[leader]->ReadBarrier());
+
+    // Followers that hear from the leader won't vote, so no other leader
+    // can be elected while its lease stands
+    int follower = (leader + 1) % size;
+    uint64_t term = c.nodes[follower]->GetState().term;
+    RequestVoteReply vote = c.nodes[follower]->HandleRequestVote({term + 5, (leader + 2) % size, 1u << 20, term + 5});
+    assert(!vote.vote_granted && c.nodes[follower]->GetState().term == term);
+
+    // Cut off, the leader's lease lapses and it stops serving reads
+    c.cut = leader;
+    std::this_thread::sleep_for(std::chrono::milliseconds(3 * RaftNode::kHeartbeatMs));
+    assert(!c.nodes[leader]->ReadBarrier());
+    c.cut = -1;
+}
+
+// ══════════════════════════════════════════════════════════════════════
+
+int main() {
+#ifdef _WIN32
+    system(("rmdir /s /q " + kDir + " 2>nul").c_str());
+#else
+    system(("rm -rf " + kDir).c_str());
+#endif
+    MKDIR(kDir.c_str());
+
+    int passed = 0, failed = 0;
+    std::cout << "=== Raft Tests ===\n\n";
+
+    for (size_t i = 0; i < tests.size(); ++i) {
+        try {
+            tests[i].second();
+            std::cout << "  [PASS] " << tests[i].first << "\n";
+            ++passed;
+        } catch (const std::exception& e) {
+            std::cout << "  [FAIL] " << tests[i].first << ": " << e.what() << "\n";
+            ++failed;
+        } catch (...) {
+            std::cout << "  [FAIL] " << tests[i].first << ": assertion failed\n";
+            ++failed;
+        }
+    }
+
+    std::cout << "\nResults: " << passed << " passed, " << failed << " failed.\n";
+
+    // Cleanup
+#ifdef _WIN32
+    system(("rmdir /s /q " + kDir + " 2>nul").c_str());
+#else
+    system(("rm -rf " + kDir).c_str());
+#endif
+    return failed > 0 ? 1 : 0;
+}
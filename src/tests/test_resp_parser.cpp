@@ -4,14 +4,21 @@
 
 #include "include/network/resp_parser.h"
 #include "include/network/client_handler.h"
+#include "include/network/glob.h"
 #include "include/sync/cache_manager.h"
 #include "include/persistence/file_storage.h"
+#include "include/storage/lsm_engine.h"
 
 #include <iostream>
 #include <cassert>
 #include <string>
+#include <string_view>
 #include <vector>
 #include <cstdlib>
+#include <set>
+#include <fstream>
+#include <thread>
+#include <chrono>
 
 #define TEST(name) \
     static void name(); \
@@ -90,6 +97,125 @@ TEST(test_encode_array) {
     assert(result == "*2\r\n$1\r\na\r\n$1\r\nb\r\n");
 }
 
+TEST(test_append_encoders_share_buffer) {
+    std::string out;
+    RESPParser::append_simple_string(out, "OK");
+    RESPParser::append_integer(out, -7);
+    RESPParser::append_bulk_string(out, "hi");
+    RESPParser::append_null(out);
+    RESPParser::append_array(out, {"a"});
+    assert(out == "+OK\r\n:-7\r\n$2\r\nhi\r\n$-1\r\n*1\r\n$1\r\na\r\n");
+}
+
+// ══════════════════════════════════════════════════════════════════════
+// RESP Stream (incremental) Tests
+// ══════════════════════════════════════════════════════════════════════
+
+TEST(test_stream_pipelined_commands) {
+    RESPStream stream;
+    stream.append("*2\r\n$3\r\nGET\r\n$1\r\na\r\nPING\r\n*3\r\n$3\r\nSET\r\n$1\r\nk\r\n$0\r\n\r\n");
+    std::vector<std::string_view> argv;
+
+    assert(stream.next(argv) == RESPStream::Status::Ok);
+    assert(argv.size() == 2 && argv[0] == "GET" && argv[1] == "a");
+    assert(stream.next(argv) == RESPStream::Status::Ok);
+    assert(argv.size() == 1 && argv[0] == "PING");
+    assert(stream.next(argv) == RESPStream::Status::Ok);
+    assert(argv.size() == 3 && argv[2].empty());
+    assert(stream.next(argv) == RESPStream::Status::NeedMore);
+    assert(stream.buffered() == 0);
+}
+
+TEST(test_stream_byte_at_a_time) {
+    std::string msg = "*3\r\n$3\r\nSET\r\n$4\r\nname\r\n$12\r\nhello\r\nworld\r\n";
+    RESPStream stream;
+    std::vector<std::string_view> argv;
+    for (size_t i = 0; i + 1 < msg.size(); ++i) {
+        stream.append(msg.data() + i, 1);
+        assert(stream.next(argv) == RESPStream::Status::NeedMore);
+    }
+    stream.append(msg.data() + msg.size() - 1, 1);
+    assert(stream.next(argv) == RESPStream::Status::Ok);
+    assert(argv.size() == 3);
+    assert(argv[1] == "name");
+    assert(argv[2] == "hello\r\nworld");  // binary-safe bulk payload
+}
+
+TEST(test_stream_compacts_buffer) {
+    RESPStream stream;
+    std::vector<std::string_view> argv;
+    std::string cmd = "*2\r\n$3\r\nGET\r\n$3\r\nkey\r\n";
+    for (int i = 0; i < 10000; ++i) {
+        stream.append(cmd);
+        assert(stream.next(argv) == RESPStream::Status::Ok);
+        assert(argv[1] == "key");
+    }
+    // Consumed bytes are reclaimed instead of growing the buffer
+    assert(stream.capacity() == RESPStream::kInitialCapacity);
+}
+
+TEST(test_stream_array_header_does_not_preallocate_claimed_args) {
+    RESPStream stream;
+    std::vector<std::string_view> argv;
+    stream.append("*1048576\r\n");
+    assert(stream.next(argv) == RESPStream::Status::NeedMore);
+    assert(stream.arg_capacity() <= static_cast<size_t>(RESPStream::kReserveArgs));
+
+    // Arguments that do arrive still parse, growing past the reserve
+    RESPStream many;
+    std::string cmd = "*200\r\n";
+    for (int i = 0; i < 200; ++i) cmd += "$1\r\nx\r\n";
+    many.append(cmd);
+    assert(many.next(argv) == RESPStream::Status::Ok);
+    assert(argv.size() == 200 && argv[199] == "x");
+}
+
+TEST(test_stream_partial_survives_compaction) {
+    RESPStream stream;
+    std::vector<std::string_view> argv;
+    std::string big(RESPStream::kInitialCapacity, 'v');
+    std::string cmd = "*3\r\n$3\r\nSET\r\n$1\r\nk\r\n$" + std::to_string(big.size()) + "\r\n";
+    stream.append("PING\r\n");
+    stream.append(cmd);
+    assert(stream.next(argv) == RESPStream::Status::Ok);
+    assert(stream.next(argv) == RESPStream::Status::NeedMore);
+    stream.append(big);
+    stream.append("\r\n");
+    assert(stream.next(argv) == RESPStream::Status::Ok);
+    assert(argv.size() == 3 && argv[2].size() == big.size());
+}
+
+TEST(test_stream_skips_long_run_of_empty_frames) {
+    // Each empty frame used to cost a stack frame; 200k of them overflowed
+    // the stack in an unoptimized build.
+    RESPStream stream;
+    std::vector<std::string_view> argv;
+    std::string junk;
+    for (int i = 0; i < 100000; ++i) junk += "*0\r\n*-1\r\n";
+    for (int i = 0; i < 50000; ++i) junk += "\r\n";
+    stream.append(junk);
+    stream.append("PING\r\n");
+    assert(stream.next(argv) == RESPStream::Status::Ok);
+    assert(argv.size() == 1 && argv[0] == "PING");
+    assert(stream.buffered() == 0);
+
+    stream.append(junk);
+    assert(stream.next(argv) == RESPStream::Status::NeedMore);
+    assert(stream.buffered() == 0);
+}
+
+TEST(test_stream_protocol_error) {
+    RESPStream stream;
+    std::vector<std::string_view> argv;
+    stream.append("*1\r\n$3\r\nGETX\r\n");
+    assert(stream.next(argv) == RESPStream::Status::Error);
+    assert(!stream.error().empty());
+
+    RESPStream bad_len;
+    bad_len.append("*x\r\n");
+    assert(bad_len.next(argv) == RESPStream::Status::Error);
+}
+
 // ══════════════════════════════════════════════════════════════════════
 // Client Handler Tests
 // ══════════════════════════════════════════════════════════════════════
@@ -221,6 +347,420 @@ TEST(test_handler_quit) {
 #endif
 }
 
+TEST(test_handler_execute_into_coalesces) {
+    std::string test_file = "test_data/handler_batch.dat";
+    dcs::persistence::FileStorage storage(test_file);
+    dcs::sync::CacheManager::Config cfg;
+    dcs::sync::CacheManager manager(cfg, &storage);
+    ClientHandler handler(&manager);
+
+    RESPStream stream;
+    stream.append("SET a 1\r\nGET a\r\nGET b\r\nQUIT\r\nPING\r\n");
+    std::vector<std::string_view> argv;
+    std::string out;
+    bool quit = false;
+    while (!quit && stream.next(argv) == RESPStream::Status::Ok) {
+        quit = handler.execute_into(argv, out);
+    }
+    assert(quit);
+    assert(out == "+OK\r\n$1\r\n1\r\n$-1\r\n+OK\r\n");
+
+    manager.shutdown();
+#ifdef _WIN32
+    system("rmdir /s /q test_data 2>nul");
+#else
+    system("rm -rf test_data");
+#endif
+}
+
+TEST(test_handler_mget_mset) {
+    std::string test_file = "test_data/handler_multi.dat";
+    dcs::persistence::FileStorage storage(test_file);
+    dcs::sync::CacheManager::Config cfg;
+    cfg.write_mode = dcs::sync::WriteMode::WriteThrough;
+    dcs::sync::CacheManager manager(cfg, &storage);
+    ClientHandler handler(&manager);
+
+    auto resp = handler.execute({"MSET", "a", "1", "b", "2", "c", "3"});
+    assert(resp.data == "+OK\r\n");
+    assert(storage.disk_size() == 3);
+
+    // Order and duplicates preserved; "cold" is read through from storage
+    storage.store("cold", "4");
+    resp = handler.execute({"MGET", "a", "missing", "c", "cold", "a"});
+    assert(resp.data == "*5\r\n$1\r\n1\r\n$-1\r\n$1\r\n3\r\n$1\r\n4\r\n$1\r\n1\r\n");
+
+    resp = handler.execute({"EXISTS", "a", "b", "nope", "a"});
+    assert(resp.data == ":3\r\n");
+
+    handler.execute({"DEL", "a", "b"});
+    resp = handler.execute({"MGET", "a", "b", "c"});
+    assert(resp.data == "*3\r\n$-1\r\n$-1\r\n$1\r\n3\r\n");
+
+    resp = handler.execute({"MSET", "a", "1", "b"});
+    assert(resp.data.find("-ERR wrong number") == 0);
+
+    manager.shutdown();
+#ifdef _WIN32
+    system("rmdir /s /q test_data 2>nul");
+#else
+    system("rm -rf test_data");
+#endif
+}
+
+TEST(test_glob_match) {
+    assert(glob_match("*", ""));
+    assert(glob_match("user:*", "user:42"));
+    assert(!glob_match("user:*", "session:1"));
+    assert(glob_match("u?er:[0-9]*", "user:7x"));
+    assert(!glob_match("u?er:[0-9]*", "user:x7"));
+    assert(glob_match("*[^a]", "bab"));
+    assert(!glob_match("*[^b]", "bab"));
+    assert(glob_match("a\\*b", "a*b"));
+    assert(!glob_match("a\\*b", "axb"));
+    assert(glob_match("*a*b*c*", "xxaxxbxxc"));
+    assert(glob_literal_prefix("user:*") == "user:");
+    assert(glob_literal_prefix("a\\*b?") == "a*b");
+    assert(glob_literal_prefix("[ab]c") == "");
+}
+
+// Runs SCAN to completion, returning every key and the number of calls
+static std::multiset<std::string> scan_all(ClientHandler& handler, const char* pattern,
+                                           const char* count, size_t& calls) {
+    std::multiset<std::string> seen;
+    std::string cursor = "0";
+    calls = 0;
+    do {
+        auto resp = handler.execute({"SCAN", cursor, "MATCH", pattern, "COUNT", count});
+        // *2 $<cursor> *N $k... — decode by hand
+        size_t pos = resp.data.find("\r\n$") + 3;
+        size_t len_end = resp.data.find("\r\n", pos);
+        size_t len = std::stoul(resp.data.substr(pos, len_end - pos));
+        cursor = resp.data.substr(len_end + 2, len);
+        pos = resp.data.find('*', len_end + 2 + len);
+        size_t n_end = resp.data.find("\r\n", pos);
+        size_t n = std::stoul(resp.data.substr(pos + 1, n_end - pos - 1));
+        pos = n_end + 2;
+        for (size_t i = 0; i < n; ++i) {
+            len_end = resp.data.find("\r\n", pos);
+            len = std::stoul(resp.data.substr(pos + 1, len_end - pos - 1));
+            seen.insert(resp.data.substr(len_end + 2, len));
+            pos = len_end + 2 + len + 2;
+        }
+        ++calls;
+    } while (cursor != "0" && calls < 10000);
+    return seen;
+}
+
+TEST(test_handler_scan_cache_segments) {
+    // FileStorage can't iterate in order, so SCAN walks cache segments
+    std::string test_file = "test_data/handler_scan.dat";
+    dcs::persistence::FileStorage storage(test_file);
+    dcs::sync::CacheManager::Config cfg;
+    cfg.write_mode = dcs::sync::WriteMode::WriteThrough;
+    cfg.segments = 8;
+    dcs::sync::CacheManager manager(cfg, &storage);
+    ClientHandler handler(&manager);
+
+    for (int i = 0; i < 200; ++i) manager.put("user:" + std::to_string(i), "v");
+    for (int i = 0; i < 50; ++i) manager.put("session:" + std::to_string(i), "v");
+
+    size_t calls = 0;
+    auto users = scan_all(handler, "user:*", "10", calls);
+    assert(users.size() == 200);
+    assert(calls > 1);
+    auto all = scan_all(handler, "*", "1000", calls);
+    assert(all.size() == 250);
+    assert(calls == 1);
+
+    assert(handler.execute({"SCAN", "99"}).data.find("-ERR invalid cursor") == 0);
+    assert(handler.execute({"SCAN", "x"}).data.find("-ERR invalid cursor") == 0);
+    assert(handler.execute({"SCAN", "0", "COUNT", "0"}).data.find("-ERR syntax") == 0);
+    assert(handler.execute({"SCAN", "0", "BOGUS", "1"}).data.find("-ERR syntax") == 0);
+
+    auto resp = handler.execute({"KEYS", "session:4?"});
+    assert(resp.data.find("*10\r\n") == 0);
+
+    manager.shutdown();
+#ifdef _WIN32
+    system("rmdir /s /q test_data 2>nul");
+#else
+    system("rm -rf test_data");
+#endif
+}
+
+TEST(test_handler_scan_lsm_ordered) {
+    DCS_MKDIR("test_data");
+    std::string dir = "test_data/scan_lsm";
+    dcs::storage::LSMEngine engine(dir);
+    dcs::sync::CacheManager::Config cfg;
+    cfg.write_mode = dcs::sync::WriteMode::WriteThrough;
+    dcs::sync::CacheManager manager(cfg, &engine);
+    ClientHandler handler(&manager);
+
+    // Keys split between SSTables and the memtable, some deleted
+    for (int i = 0; i < 300; ++i) manager.put("k:" + std::to_string(1000 + i), "v");
+    engine.ForceCompaction();
+    for (int i = 300; i < 400; ++i) manager.put("k:" + std::to_string(1000 + i), "v");
+    for (int i = 0; i < 400; i += 4) manager.del("k:" + std::to_string(1000 + i));
+    manager.put("other", "v");
+
+    size_t calls = 0;
+    auto keys = scan_all(handler, "k:*", "25", calls);
+    assert(keys.size() == 300);
+    assert(calls == 12 || calls == 13);
+    assert(keys.count("k:1000") == 0 && keys.count("k:1001") == 1 && keys.count("k:1399") == 1);
+    assert(scan_all(handler, "k:13?9", "1000", calls).size() == 10);
+
+    // Cursors carry their position: a retry returns the same page, and
+    // any number of scans may be open at once
+    auto resp = handler.execute({"SCAN", "0", "COUNT", "5"});
+    size_t pos = resp.data.find("\r\n$") + 3;
+    size_t len_end = resp.data.find("\r\n", pos);
+    std::string cursor = resp.data.substr(len_end + 2, std::stoul(resp.data.substr(pos, len_end - pos)));
+    assert(cursor != "0");
+    auto page = handler.execute({"SCAN", cursor});
+    assert(page.data[0] == '*');
+    for (int i = 0; i < 2000; ++i) handler.execute({"SCAN", "0", "COUNT", "5"});
+    assert(handler.execute({"SCAN", cursor}).data == page.data);
+    assert(handler.execute({"SCAN", "1999"}).data.find("-ERR invalid cursor") == 0);
+    assert(handler.execute({"SCAN", "12"}).data.find("-ERR invalid cursor") == 0);
+
+    manager.shutdown();
+}
+
+TEST(test_handler_scan_lsm_includes_unflushed_keys) {
+    DCS_MKDIR("test_data");
+    dcs::storage::LSMEngine engine("test_data/scan_lsm_wb");
+    dcs::sync::CacheManager::Config cfg;
+    cfg.write_mode = dcs::sync::WriteMode::WriteBack;
+    cfg.flush_interval = std::chrono::seconds(3600);
+    dcs::sync::CacheManager manager(cfg, &engine);
+    ClientHandler handler(&manager);
+
+    // Even keys flushed, odd ones only in the cache; some of each rewritten
+    for (int i = 0; i < 200; i += 2) manager.put("w:" + std::to_string(1000 + i), "v");
+    manager.flush();
+    for (int i = 1; i < 200; i += 2) manager.put("w:" + std::to_string(1000 + i), "v");
+    for (int i = 0; i < 200; i += 10) manager.put("w:" + std::to_string(1000 + i), "v2");
+    manager.put("w:", "boundary");
+    manager.put("w:0", "before the rest");
+    assert(manager.dirty_count() > 100);
+
+    size_t calls = 0;
+    auto keys = scan_all(handler, "w:*", "7", calls);
+    assert(keys.size() == 202);                      // each key exactly once
+    assert(keys.count("w:1001") == 1 && keys.count("w:1199") == 1 && keys.count("w:") == 1);
+    assert(calls >= 200 / 2 / 7);
+    assert(scan_all(handler, "w:119?", "3", calls).size() == 10);
+
+    // Unflushed keys past the last stored one come with the final page
+    manager.put("w:9999", "last");
+    keys = scan_all(handler, "w:*", "1000", calls);
+    assert(keys.size() == 203 && calls == 1);
+
+    manager.shutdown();
+}
+
+TEST(test_handler_info_latencystats) {
+    DCS_MKDIR("test_data");
+    dcs::storage::LSMEngine engine("test_data/info_latency");
+    dcs::sync::CacheManager::Config cfg;
+    cfg.write_mode = dcs::sync::WriteMode::WriteThrough;
+    dcs::sync::CacheManager manager(cfg, &engine);
+    ClientHandler handler(&manager);
+
+    handler.execute({"SET", "lat", "v"});
+    handler.execute({"GET", "lat"});
+    handler.execute({"GET", "nowhere"});   // misses the cache and every LSM tier
+
+    auto info = handler.execute({"INFO"}).data;
+    assert(info.find("# Latencystats\r\n") != std::string::npos);
+    assert(info.find("latency_percentiles_usec_cmd_get:p50=") != std::string::npos);
+    assert(info.find("latency_percentiles_usec_cmd_set:p50=") != std::string::npos);
+    assert(info.find("latency_percentiles_usec_cache_get_hit:p50=") != std::string::npos);
+    assert(info.find("latency_percentiles_usec_cache_get_miss:p50=") != std::string::npos);
+    assert(info.find("latency_percentiles_usec_lsm_get_miss:p50=") != std::string::npos);
+    assert(info.find("latency_percentiles_usec_wal_append:p50=") != std::string::npos);
+    assert(info.find(",p99.9=") != std::string::npos);
+    // Histograms with no samples are left out
+    assert(info.find("latency_percentiles_usec_lsm_compaction") == std::string::npos);
+
+    dcs::metrics::LatencyReport report;
+    engine.collect_latency(report);
+    for (const auto& e : report) {
+        if (e.first == "lsm_get_miss") assert(e.second.count == 1);
+    }
+    manager.shutdown();
+}
+
+TEST(test_handler_client_tracking_pushes_invalidations) {
+    dcs::sync::CacheManager::Config cfg;
+    dcs::sync::CacheManager manager(cfg, nullptr);
+    ClientHandler reader(&manager), writer(&manager);
+    std::vector<std::string> pushes;
+    reader.set_push([&](std::string frame) { pushes.push_back(std::move(frame)); });
+
+    // Pushes need RESP3, and a transport that can deliver them
+    assert(reader.execute({"CLIENT", "TRACKING", "ON"}).data.rfind("-ERR", 0) == 0);
+    assert(writer.execute({"HELLO", "3"}).data.rfind("%6\r\n", 0) == 0);
+    assert(writer.execute({"CLIENT", "TRACKING", "ON"}).data.rfind("-ERR", 0) == 0);
+    assert(reader.execute({"HELLO", "4"}).data.rfind("-NOPROTO", 0) == 0);
+    auto hello = reader.execute({"HELLO", "3"}).data;
+    assert(hello.find("$5\r\nproto\r\n:3\r\n") != std::string::npos);
+    assert(hello.find(":" + std::to_string(reader.id()) + "\r\n") != std::string::npos);
+    assert(reader.execute({"CLIENT", "ID"}).data == ":" + std::to_string(reader.id()) + "\r\n");
+    assert(reader.execute({"CLIENT", "TRACKING", "ON", "PREFIX", "a"}).data.rfind("-ERR", 0) == 0);
+    assert(reader.execute({"CLIENT", "TRACKING", "ON"}).data == "+OK\r\n");
+
+    writer.execute({"SET", "k", "v1"});
+    assert(pushes.empty());                       // not read yet
+    reader.execute({"GET", "k"});
+    writer.execute({"SET", "k", "v2"});
+    assert(pushes.size() == 1);
+    assert(pushes[0] == ">2\r\n$10\r\ninvalidate\r\n*1\r\n$1\r\nk\r\n");
+    assert(pushes[0] == ClientHandler::invalidation_frame({"k"}));
+    writer.execute({"SET", "k", "v3"});
+    assert(pushes.size() == 1);                   // told once until read again
+    reader.execute({"MGET", "k", "other"});
+    writer.execute({"DEL", "other"});
+    writer.execute({"EXPIRE", "k", "100"});
+    assert(pushes.size() == 3);
+    writer.execute({"FLUSHALL"});
+    assert(pushes.back() == ">2\r\n$10\r\ninvalidate\r\n_\r\n");
+
+    // Broadcast mode: every write under a prefix, no reads needed
+    pushes.clear();
+    assert(reader.execute({"CLIENT", "TRACKING", "ON", "BCAST", "PREFIX", "user:"}).data == "+OK\r\n");
+    writer.execute({"MSET", "user:1", "a", "order:1", "b"});
+    assert(pushes.size() == 1 && pushes[0] == ClientHandler::invalidation_frame({"user:1"}));
+
+    assert(reader.execute({"CLIENT", "TRACKING", "OFF"}).data == "+OK\r\n");
+    writer.execute({"SET", "user:2", "c"});
+    assert(pushes.size() == 1);
+    assert(manager.tracking().clients() == 0);
+
+    // Dropped with the connection
+    {
+        ClientHandler brief(&manager);
+        brief.set_push([](std::string) {});
+        brief.execute({"HELLO", "3"});
+        brief.execute({"CLIENT", "TRACKING", "ON"});
+        assert(manager.tracking().clients() == 1);
+    }
+    assert(manager.tracking().clients() == 0);
+    manager.shutdown();
+}
+
+TEST(test_handler_hotkeys) {
+    dcs::sync::CacheManager::Config cfg;
+    cfg.hot_key_sample_shift = 0;
+    cfg.hot_key_interval = std::chrono::milliseconds(0);
+    dcs::sync::CacheManager manager(cfg, nullptr);
+    ClientHandler handler(&manager);
+    handler.execute({"SET", "hot", "v"});
+    handler.execute({"SET", "warm", "v"});
+    for (int i = 0; i < 40; ++i) handler.execute({"GET", "hot"});
+    for (int i = 0; i < 10; ++i) handler.execute({"GET", "warm"});
+    manager.refresh_hot_keys();
+
+    std::string seg = std::to_string(manager.segment_index("hot"));
+    auto r = handler.execute({"HOTKEYS", "COUNT", "1"}).data;
+    assert(r == "*1\r\n*4\r\n$3\r\nhot\r\n:40\r\n:" + seg + "\r\n:1\r\n");
+    r = handler.execute({"HOTKEYS"}).data;
+    assert(r.rfind("*2\r\n", 0) == 0 && r.find("$4\r\nwarm\r\n:10\r\n") != std::string::npos);
+    assert(handler.execute({"HOTKEYS", "COUNT", "0"}).data.rfind("-ERR", 0) == 0);
+    assert(handler.execute({"HOTKEYS", "1"}).data.rfind("-ERR", 0) == 0);
+    assert(handler.execute({"INFO"}).data.find("hot_keys_replicated:2\r\n") != std::string::npos);
+    manager.shutdown();
+}
+
+// ══════════════════════════════════════════════════════════════════════
+// File Storage (append-only log) Tests
+// ══════════════════════════════════════════════════════════════════════
+
+TEST(test_file_storage_log_roundtrip_and_recovery) {
+    using dcs::persistence::FileStorage;
+    using dcs::persistence::FileStorageOptions;
+    std::string path = "test_data/log_roundtrip.dat";
+    FileStorageOptions opts;
+    opts.max_file_bytes = 4096;                  // force several files
+    opts.merge_interval_ms = 0;
+    std::string awkward = "tab\there\nnewline\r\n";
+    {
+        FileStorage storage(path, opts);
+        for (int i = 0; i < 300; ++i) assert(storage.store("k" + std::to_string(i), "v" + std::to_string(i)));
+        assert(storage.store(awkward, awkward));
+        assert(storage.store("k7", "seven"));
+        assert(storage.remove("k8"));
+        assert(!storage.remove("k8"));
+        assert(storage.batch_store({{"b1", "x"}, {"b2", std::string(5000, 'y')}}));
+        assert(storage.file_count() > 2);
+        assert(storage.load("k7").value == "seven");
+        assert(!storage.load("k8").found);
+    }
+    {
+        std::ofstream torn(path + ".000099", std::ios::binary);   // crash mid-append
+        torn << "\x01\x02\x03";
+    }
+    FileStorage storage(path, opts);
+    assert(storage.disk_size() == 302);
+    assert(storage.load(awkward).value == awkward);
+    assert(storage.load("k7").value == "seven" && storage.load("k299").value == "v299");
+    assert(!storage.load("k8").found);
+    assert(storage.load("b2").value.size() == 5000);
+    assert(storage.store("after", "torn"));      // appends past the cut tail
+    assert(storage.load("after").value == "torn");
+}
+
+TEST(test_file_storage_merge_and_legacy_import) {
+    using dcs::persistence::FileStorage;
+    using dcs::persistence::FileStorageOptions;
+    system("mkdir -p test_data");
+    std::string path = "test_data/log_merge.dat";
+    {
+        std::ofstream legacy(path);
+        legacy << "old\tvalue\nbroken line\nother\tv2\n";
+    }
+    FileStorageOptions opts;
+    opts.max_file_bytes = 2048;
+    opts.merge_interval_ms = 0;
+    {
+        FileStorage storage(path, opts);
+        assert(storage.disk_size() == 2 && storage.load("old").value == "value");
+        for (int round = 0; round < 20; ++round) {
+            for (int i = 0; i < 50; ++i) storage.store("k" + std::to_string(i), "r" + std::to_string(round));
+        }
+        for (int i = 0; i < 10; ++i) storage.remove("k" + std::to_string(i));
+        uint64_t before = storage.total_bytes();
+        size_t files = storage.file_count();
+        assert(storage.live_bytes() * 4 < before);
+        assert(storage.merge());
+        assert(storage.merge_count() == 1);
+        assert(storage.total_bytes() < before / 4);
+        assert(storage.file_count() < files);
+        assert(storage.total_bytes() - storage.live_bytes() < 2 * opts.max_file_bytes);   // only the active file's
+        assert(storage.load("k49").value == "r19" && !storage.load("k3").found);
+        assert(storage.load("other").value == "v2");
+    }
+    std::ifstream gone(path);
+    assert(!gone.is_open());                     // imported, then removed
+
+    // The background merger does the same once garbage crosses the ratio
+    opts.merge_interval_ms = 5;
+    opts.merge_min_bytes = 1;
+    FileStorage storage(path, opts);
+    assert(storage.disk_size() == 42);
+    for (int round = 0; round < 10; ++round) {
+        for (int i = 0; i < 50; ++i) storage.store("k" + std::to_string(i), "s" + std::to_string(round));
+    }
+    for (int i = 0; i < 200 && storage.merge_count() == 0; ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    assert(storage.merge_count() > 0);
+    assert(storage.load("k0").value == "s9" && storage.disk_size() == 52);
+}
+
 // ══════════════════════════════════════════════════════════════════════
 
 int main() {